@@ -168,7 +168,7 @@ bool Ace::extractFromGui()
       return false;
    }
    inputs.mThreshold = pAceGui->getThreshold();
-   inputs.mSignatures = pAceGui->getExtractedSignatures();
+   inputs.mSignatures = SpectralUtilities::extractSignatures(pAceGui->getSignatures());
    inputs.mResultsName = pAceGui->getResultsName();
    inputs.mpAoi = pAceGui->getAoi();
    inputs.mbCreatePseudocolor = pAceGui->isPseudocolorLayerUsed();
@@ -18,11 +18,11 @@
 #include "PlugInRegistration.h"
 #include "PlugInResource.h"
 #include "ProgressTracker.h"
-#include "Resampler.h"
 #include "AceInputs.h"
 #include "AceAlg.h"
 #include "AceErr.h"
 #include "Signature.h"
+#include "SignatureResampler.h"
 #include "SpectralUtilities.h"
 #include "SpectralVersion.h"
 #include "Statistics.h"
@@ -420,7 +420,7 @@ bool AceAlgorithm::resampleSpectrum(Signature* pSignature,
 
    vector<double> fwhm = const_cast<Wavelengths&>(wavelengths).getFwhm();
    PlugInResource resampler("Resampler");
-   Resampler* pResampler = dynamic_cast<Resampler*>(resampler.get());
+   SignatureResampler* pResampler = dynamic_cast<SignatureResampler*>(resampler.get());
    if (pResampler == NULL)
    {
       string messageText = "The resampler plug-in could not be created.";
@@ -429,26 +429,12 @@ bool AceAlgorithm::resampleSpectrum(Signature* pSignature,
       return false;
    }
    string err;
-   try
-   {
-      vector<double> sigReflectance = dv_cast<vector<double> >(pSignature->getData("Reflectance"));
-      resampledAmplitude.reserve(sigReflectance.size());
-      resampledBands.reserve(sigReflectance.size());
-      if (!pResampler->execute(sigReflectance,
-                              resampledAmplitude,
-                              dv_cast<vector<double> >(pSignature->getData("Wavelength")),
-                              wavelengths.getCenterValues(),
-                              fwhm,
-                              resampledBands,
-                              err))
-      {
-         string messageText = "Resampling failed: " + err;
-         if (pProgress != NULL) pProgress->updateProgress(messageText, 0, ERRORS);
-         pStep->finalize(Message::Failure, messageText);
-         return false;
-      }
-   }
-   catch(std::bad_cast&)
+   if (!pResampler->resampleSignature(pSignature,
+                                      wavelengths.getCenterValues(),
+                                      fwhm,
+                                      resampledAmplitude,
+                                      resampledBands,
+                                      err))
    {
       string messageText = "Resampling failed: " + err;
       if (pProgress != NULL) pProgress->updateProgress(messageText, 0, ERRORS);
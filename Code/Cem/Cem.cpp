@@ -15,6 +15,7 @@
 #include "BitMaskIterator.h"
 #include "Cem.h"
 #include "CemDlg.h"
+#include "CovarianceEstimator.h"
 #include "DataAccessor.h"
 #include "DataAccessorImpl.h"
 #include "DataRequest.h"
@@ -28,14 +29,17 @@
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 #include "RasterUtilities.h"
-#include "Resampler.h"
 #include "Signature.h"
+#include "SignatureResampler.h"
 #include "SpectralUtilities.h"
 #include "SpectralVersion.h"
 #include "Statistics.h"
 #include "switchOnEncoding.h"
 #include "Wavelengths.h"
 
+#include <ostream>
+#include <string.h>
+
 using namespace std;
 
 struct InsertReflectance : public unary_function<unsigned int,bool>
@@ -112,6 +116,76 @@ Cem::~Cem()
 {
 }
 
+bool Cem::runOperationalTests(Progress* pProgress, ostream& failure)
+{
+   return runAllTests(pProgress, failure);
+}
+
+bool Cem::runAllTests(Progress* pProgress, ostream& failure)
+{
+   if (runSparseAoiCovarianceTest(failure) == false)
+   {
+      return false;
+   }
+
+   if (pProgress != NULL)
+   {
+      pProgress->updateProgress("Running CEM Tests...", 100, NORMAL);
+   }
+
+   return true;
+}
+
+bool Cem::runSparseAoiCovarianceTest(ostream& failure)
+{
+   // Pixels in only three of the 64 sample blocks, with a different spread in each block
+   const unsigned int numRows = 256;
+   const unsigned int numColumns = 256;
+   const unsigned int numBands = 2;
+   const unsigned int blockRows[] = { 0, 128, 224 };
+   const unsigned int blockColumns[] = { 0, 96, 224 };
+   const unsigned int pixelsPerBlock = 10;
+
+   ModelResource<RasterElement> pRaster(RasterUtilities::createRasterElement(getName() + " Covariance Test",
+      numRows, numColumns, numBands, FLT8BYTES, BIP));
+   FactoryResource<BitMask> pMask;
+   if (pRaster.get() == NULL || pRaster->getRawData() == NULL || pMask.get() == NULL)
+   {
+      failure << getName() << " was unable to create the covariance test data.";
+      return false;
+   }
+
+   double* pData = reinterpret_cast<double*>(pRaster->getRawData());
+   memset(pData, 0, numRows * numColumns * numBands * sizeof(double));
+   for (unsigned int block = 0; block < 3; ++block)
+   {
+      for (unsigned int pixel = 0; pixel < pixelsPerBlock; ++pixel)
+      {
+         const unsigned int row = blockRows[block] + pixel;
+         const unsigned int column = blockColumns[block] + (pixel * 3) % 7;
+         double* pPixel = pData + (row * numColumns + column) * numBands;
+         pPixel[0] = (pixel + 1.0) * (block + 1.0) * 10.0;
+         pPixel[1] = ((pixel % 3) + 1.0) * (block * block + 1.0);
+         pMask->setPixel(column, row, true);
+      }
+   }
+
+   // The empty blocks between the populated ones must not converge the estimate
+   AdaptiveCovarianceEstimator estimator(pRaster.get(), pMask.get(), 0.001);
+   while (estimator.isConverged() == false && estimator.processNextBlock())
+   {
+   }
+
+   if (estimator.getAccumulator().getCount() != 3.0 * pixelsPerBlock)
+   {
+      failure << getName() << " stopped sampling a sparse AOI after " << estimator.getAccumulator().getCount() <<
+         " of " << 3 * pixelsPerBlock << " pixels.";
+      return false;
+   }
+
+   return true;
+}
+
 bool Cem::populateBatchInputArgList(PlugInArgList* pInArgList)
 {
    if (!populateInteractiveInputArgList(pInArgList))
@@ -123,6 +197,8 @@ bool Cem::populateBatchInputArgList(PlugInArgList* pInArgList)
    VERIFY(pInArgList->addArg<AoiElement>("AOI", NULL));
    VERIFY(pInArgList->addArg<bool>("Display Results", false));
    VERIFY(pInArgList->addArg<string>("Results Name", string("CEM Results")));
+   VERIFY(pInArgList->addArg<double>("Statistics Tolerance", 0.0, "Relative change in the second moment "
+      "estimate at which adaptive block sampling stops. If zero, the Second Moment plug-in is used."));
    return true;
 }
 
@@ -167,6 +243,7 @@ bool Cem::parseInputArgList(PlugInArgList* pInArgList)
       mInputs.mpAoi = pInArgList->getPlugInArgValue<AoiElement>("AOI");
       VERIFY(pInArgList->getPlugInArgValue("Display Results", mInputs.mbDisplayResults));
       VERIFY(pInArgList->getPlugInArgValue("Results Name", mInputs.mResultsName));
+      VERIFY(pInArgList->getPlugInArgValue("Statistics Tolerance", mInputs.mStatisticsTolerance));
 
       mInputs.mSignatures = SpectralUtilities::extractSignatures(vector<Signature*>(1, pSignatures));
    }
@@ -216,7 +293,7 @@ bool Cem::extractFromGui()
       return false;
    }
    mInputs.mThreshold = mpCemGui->getThreshold();
-   mInputs.mSignatures = mpCemGui->getExtractedSignatures();
+   mInputs.mSignatures = SpectralUtilities::extractSignatures(mpCemGui->getSignatures());
    mInputs.mResultsName = mpCemGui->getResultsName();
    mInputs.mpAoi = mpCemGui->getAoi();
    mInputs.mbCreatePseudocolor = mpCemGui->isPseudocolorLayerUsed();
@@ -297,22 +374,41 @@ bool CemAlgorithm::processAll()
    ColorType::getUniqueColors(iSignatureCount + 2, layerColors, excludeColors); // 2 for "no match" and "interminacy
 
    // get SMM^-1
-   ExecutableResource smmPlugin("Second Moment", string(), progress.getCurrentProgress(), !isInteractive());
-   if (smmPlugin->getPlugIn() == NULL)
+   double* pSmm = NULL;
+   double* pInvSmm = NULL;
+   vector<double> sampledSmm;
+   vector<double> sampledInvSmm;
+   if (mInputs.mStatisticsTolerance > 0.0)
    {
-      progress.report("Second Moment Matrix plug-in not available.", 0, ERRORS, true);
-      return false;
+      if (!sampleSecondMoment(progress, sampledSmm, sampledInvSmm))
+      {
+         return false;
+      }
+      pSmm = &sampledSmm.front();
+      pInvSmm = &sampledInvSmm.front();
    }
-   smmPlugin->getInArgList().setPlugInArgValue<RasterElement>(Executable::DataElementArg(), pElement);
-   smmPlugin->getInArgList().setPlugInArgValue<AoiElement>("AOI", mInputs.mpAoi);
-   RasterElement* pSmm = NULL;
-   RasterElement* pInvSmm = NULL;
-   if (!smmPlugin->execute() ||
-      (pSmm = smmPlugin->getOutArgList().getPlugInArgValue<RasterElement>("Second Moment Matrix")) == NULL ||
-      (pInvSmm = smmPlugin->getOutArgList().getPlugInArgValue<RasterElement>("Inverse Second Moment Matrix")) == NULL)
+   else
    {
-      progress.report("Failed to calculate second moment matrix.", 0, ERRORS, true);
-      return false;
+      ExecutableResource smmPlugin("Second Moment", string(), progress.getCurrentProgress(), !isInteractive());
+      if (smmPlugin->getPlugIn() == NULL)
+      {
+         progress.report("Second Moment Matrix plug-in not available.", 0, ERRORS, true);
+         return false;
+      }
+      smmPlugin->getInArgList().setPlugInArgValue<RasterElement>(Executable::DataElementArg(), pElement);
+      smmPlugin->getInArgList().setPlugInArgValue<AoiElement>("AOI", mInputs.mpAoi);
+      RasterElement* pSmmElement = NULL;
+      RasterElement* pInvSmmElement = NULL;
+      if (!smmPlugin->execute() ||
+         (pSmmElement = smmPlugin->getOutArgList().getPlugInArgValue<RasterElement>("Second Moment Matrix")) == NULL ||
+         (pInvSmmElement = smmPlugin->getOutArgList().getPlugInArgValue<RasterElement>(
+            "Inverse Second Moment Matrix")) == NULL)
+      {
+         progress.report("Failed to calculate second moment matrix.", 0, ERRORS, true);
+         return false;
+      }
+      pSmm = reinterpret_cast<double*>(pSmmElement->getRawData());
+      pInvSmm = reinterpret_cast<double*>(pInvSmmElement->getRawData());
    }
 
    // get cube wavelengths
@@ -476,14 +572,13 @@ bool CemAlgorithm::processAll()
             if (!compareBands(resampledBands, prevResampledBands))
             {
                prevResampledBands = resampledBands;
-               computeSmmSubset(numBands, reinterpret_cast<double*>(pSmm->getRawData()), &smmSubset.front(),
-                  resampledBands);
+               computeSmmSubset(numBands, pSmm, &smmSubset.front(), resampledBands);
             }
             computeWoper(spectrumValues, &smmSubset.front(), numBands, woper, resampledBands);
          }
          else
          {
-            computeWoper(spectrumValues, reinterpret_cast<double*>(pInvSmm->getRawData()), numBands, woper, resampledBands);
+            computeWoper(spectrumValues, pInvSmm, numBands, woper, resampledBands);
          }
 
          BitMaskIterator iterChecker(getPixelsToProcess(), 0, 0, pDescriptor->getColumnCount() - 1,
@@ -720,7 +815,7 @@ bool CemAlgorithm::resampleSpectrum(Signature* pSignature,
 
    vector<double> fwhm = const_cast<Wavelengths&>(wavelengths).getFwhm();
    PlugInResource resampler("Resampler");
-   Resampler* pResampler = dynamic_cast<Resampler*>(resampler.get());
+   SignatureResampler* pResampler = dynamic_cast<SignatureResampler*>(resampler.get());
    if (pResampler == NULL)
    {
       string messageText = "The resampler plug-in could not be created.";
@@ -729,26 +824,12 @@ bool CemAlgorithm::resampleSpectrum(Signature* pSignature,
       return false;
    }
    string err;
-   try
-   {
-      vector<double> sigReflectance = dv_cast<vector<double> >(pSignature->getData("Reflectance"));
-      resampledAmplitude.reserve(sigReflectance.size());
-      resampledBands.reserve(sigReflectance.size());
-      if (!pResampler->execute(sigReflectance,
-                              resampledAmplitude,
-                              dv_cast<vector<double> >(pSignature->getData("Wavelength")),
-                              wavelengths.getCenterValues(),
-                              fwhm,
-                              resampledBands,
-                              err))
-      {
-         string messageText = "Resampling failed: " + err;
-         if (pProgress != NULL) pProgress->updateProgress(messageText, 0, ERRORS);
-         pStep->finalize(Message::Failure, messageText);
-         return false;
-      }
-   }
-   catch(std::bad_cast&)
+   if (!pResampler->resampleSignature(pSignature,
+                                      wavelengths.getCenterValues(),
+                                      fwhm,
+                                      resampledAmplitude,
+                                      resampledBands,
+                                      err))
    {
       string messageText = "Resampling failed: " + err;
       if (pProgress != NULL) pProgress->updateProgress(messageText, 0, ERRORS);
@@ -760,6 +841,41 @@ bool CemAlgorithm::resampleSpectrum(Signature* pSignature,
    return true;
 }
 
+bool CemAlgorithm::sampleSecondMoment(ProgressTracker& progress, vector<double>& smm, vector<double>& invSmm)
+{
+   AdaptiveCovarianceEstimator estimator(getRasterElement(), getPixelsToProcess(), mInputs.mStatisticsTolerance);
+   if (!estimator.isValid())
+   {
+      progress.report("Unable to sample the cube for the second moment matrix.", 0, ERRORS, true);
+      return false;
+   }
+
+   while (!mAbortFlag && !estimator.isConverged() && estimator.processNextBlock())
+   {
+      progress.report("Sampling second moment matrix", estimator.getPercentSampled(), NORMAL);
+   }
+   if (mAbortFlag)
+   {
+      progress.abort();
+      mAbortFlag = false;
+      return false;
+   }
+
+   const CovarianceAccumulator& statistics = estimator.getAccumulator();
+   int numBands = static_cast<int>(statistics.getNumBands());
+   smm.resize(numBands * numBands);
+   invSmm.resize(numBands * numBands);
+   if (!statistics.getSecondMoment(&smm.front()) ||
+      !MatrixFunctions::invertSquareMatrix1D(&invSmm.front(), &smm.front(), numBands))
+   {
+      progress.report("Failed to calculate second moment matrix.", 0, ERRORS, true);
+      return false;
+   }
+   progress.getCurrentStep()->addProperty("Second Moment Pixels Sampled", statistics.getCount());
+
+   return true;
+}
+
 RasterElement* CemAlgorithm::createResults(int numRows, int numColumns, const string& sigName)
 {
    RasterElement* pElement = getRasterElement();
@@ -14,6 +14,7 @@
 #include "AlgorithmShell.h"
 #include "MultiThreadedAlgorithm.h"
 #include "ProgressTracker.h"
+#include "Testable.h"
 
 #include <math.h>
 #include <string>
@@ -32,13 +33,15 @@ struct CemInputs
                  mbDisplayResults(false),
                  mResultsName("CEM Results"),
                  mpAoi(NULL),
-                 mbCreatePseudocolor(true) {}
+                 mbCreatePseudocolor(true),
+                 mStatisticsTolerance(0.0) {}
    std::vector<Signature*> mSignatures;
    double mThreshold;
    bool mbDisplayResults;
    std::string mResultsName;
    AoiElement* mpAoi;
    bool mbCreatePseudocolor;
+   double mStatisticsTolerance;
 };
 
 class CemAlgorithm : public AlgorithmPattern
@@ -50,6 +53,7 @@ class CemAlgorithm : public AlgorithmPattern
    RasterElement* createResults(int numRows, int numColumns, const std::string& sigName);
    bool resampleSpectrum(Signature* pSignature, std::vector<double>& resampledAmplitude, 
       const Wavelengths& wavelengths, std::vector<int>& resampledBands);
+   bool sampleSecondMoment(ProgressTracker& progress, std::vector<double>& smm, std::vector<double>& invSmm);
    bool canAbort() const;
    bool doAbort();
    void computeWoper(std::vector<double>& pSpectrum, double* pSmm,
@@ -117,14 +121,19 @@ struct CemAlgOutput
    }
 };
 
-class Cem : public AlgorithmPlugIn
+class Cem : public AlgorithmPlugIn, public Testable
 {
 public:
    Cem();
    ~Cem();
    SETTING(CemHelp, SpectralContextSensitiveHelp, std::string, "");
 
+   bool runOperationalTests(Progress* pProgress, std::ostream& failure);
+   bool runAllTests(Progress* pProgress, std::ostream& failure);
+
 private:
+   bool runSparseAoiCovarianceTest(std::ostream& failure);
+
    bool canRunBatch() const { return true; }
    bool canRunInteractive() const { return true; }
    bool populateBatchInputArgList(PlugInArgList* pInArgList);
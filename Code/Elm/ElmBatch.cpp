@@ -7,25 +7,101 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QStringList>
+#include <QtCore/QThread>
+
 #include "AoiElement.h"
 #include "AppVerify.h"
 #include "ElmBatch.h"
+#include "FileDescriptor.h"
 #include "LayerList.h"
 #include "MessageLogResource.h"
 #include "ModelServices.h"
+#include "ObjectResource.h"
 #include "PlugInArgList.h"
 #include "PlugInRegistration.h"
 #include "PlugInResource.h"
 #include "Progress.h"
+#include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "RasterUtilities.h"
 #include "Signature.h"
 #include "SpatialDataView.h"
 #include "SpectralVersion.h"
+#include "TypeConverter.h"
+
+#include <sstream>
 
 using namespace std;
 
 REGISTER_PLUGIN_BASIC(SpectralElm, ElmBatch);
 
+namespace
+{
+   /**
+    * Reads the files of a scene in the background so that they are in the
+    * file system cache by the time the scene is imported.
+    *
+    * Importers create elements and so must run on the main thread; this only
+    * overlaps the disk reads of the next scene with the calibration of the current one.
+    */
+   class ScenePrefetchThread : public QThread
+   {
+   public:
+      ScenePrefetchThread(const string& filename) :
+         mFilename(filename),
+         mStop(false)
+      {
+      }
+
+      ~ScenePrefetchThread()
+      {
+         stop();
+      }
+
+      void stop()
+      {
+         mStop = true;
+         wait();
+      }
+
+   protected:
+      void run()
+      {
+         // Also read files which share the base name of the scene, e.g. a header and its data file
+         QFileInfo sceneInfo(QString::fromStdString(mFilename));
+         QDir sceneDir = sceneInfo.absoluteDir();
+         QStringList files = sceneDir.entryList(QStringList(sceneInfo.completeBaseName() + ".*"), QDir::Files);
+         if (files.contains(sceneInfo.fileName()) == false)
+         {
+            files.append(sceneInfo.fileName());
+         }
+
+         vector<char> buffer(4 * 1024 * 1024);
+         for (int i = 0; i < files.size() && mStop == false; ++i)
+         {
+            QFile file(sceneDir.filePath(files[i]));
+            if (file.open(QIODevice::ReadOnly) == false)
+            {
+               continue;
+            }
+
+            while (mStop == false && file.read(&buffer.front(), buffer.size()) > 0)
+            {
+               // The data is discarded; reading it is enough to cache it
+            }
+         }
+      }
+
+   private:
+      string mFilename;
+      volatile bool mStop;
+   };
+}
+
 ElmBatch::ElmBatch()
 {
    setCreator("Ball Aerospace & Technologies Corp.");
@@ -59,6 +135,19 @@ bool ElmBatch::getInputSpecification(PlugInArgList*& pArgList)
    VERIFY(pArgList->addArg<Filename>(GainsOffsetsFilenameArg()));
    VERIFY(pArgList->addArg<vector<Filename> >(SignatureFilenamesArg()));
    VERIFY(pArgList->addArg<vector<Filename> >(AoiFilenamesArg()));
+   VERIFY(pArgList->addArg<bool>(VirtualOutputArg(), false, "If true, the data is left unchanged and the "
+      "output is a new element which applies the gains/offsets as its data is read."));
+   VERIFY(pArgList->addArg<EncodingType>(OutputDataTypeArg(), NULL, "If set, the data is left unchanged and "
+      "the reflectance is written to a new element of this type. Float (4 byte) stores the reflectance directly "
+      "and Signed Short (2 byte) stores it multiplied by 10000. If not set, the data is calibrated in place, "
+      "except for the \"" + SceneFilenamesArg() + "\", which are written to Float (4 byte) elements."));
+   VERIFY(pArgList->addArg<vector<Filename> >(SceneFilenamesArg(), NULL, "If set, each scene is imported, "
+      "calibrated with the same gains/offsets and exported in turn, and the \"" + Executable::DataElementArg() +
+      "\" argument is ignored. The gains/offsets are read or computed from the first scene only."));
+   VERIFY(pArgList->addArg<vector<Filename> >(OutputFilenamesArg(), NULL, "The file to export each calibrated "
+      "scene to. This must contain one filename for each of the \"" + SceneFilenamesArg() + "\"."));
+   VERIFY(pArgList->addArg<string>(ExporterArg(), string("ICE Exporter"),
+      "The exporter used to save each calibrated scene."));
 
    return true;
 }
@@ -84,21 +173,26 @@ bool ElmBatch::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
       return false;
    }
 
-   bool success = executeElm(mGainsOffsetsFilename, mpSignatures, mpAoiElements);
-
-   Service<ModelServices> pModel;
-   for (vector<Signature*>::iterator iter =  mpSignaturesToDestroy.begin();
-      iter != mpSignaturesToDestroy.end(); ++iter)
+   if (mSceneFilenames.empty() == false)
    {
-      pModel->destroyElement(dynamic_cast<DataElement*>(*iter));
+      if (calibrateScenes() == false)
+      {
+         pStep->finalize(Message::Failure, "Unable to calibrate all of the scenes.");
+         return false;
+      }
+
+      pStep->finalize();
+      return true;
    }
 
-   for (vector<AoiElement*>::iterator iter =  mpAoiElementsToDestroy.begin();
-      iter != mpAoiElementsToDestroy.end(); ++iter)
+   bool success = loadCalibrationElements();
+   if (success == true)
    {
-      pModel->destroyElement(dynamic_cast<DataElement*>(*iter));
+      success = executeElm(mGainsOffsetsFilename, mpSignatures, mpAoiElements);
    }
 
+   destroyCalibrationElements();
+
    if (success == false)
    {
       pStep->finalize(Message::Failure, "ElmCore::executeElm() returned false");
@@ -111,7 +205,7 @@ bool ElmBatch::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
       return false;
    }
 
-   if (pOutputArgList->setPlugInArgValue(DataElementArg(), mpRasterElement) == false)
+   if (pOutputArgList->setPlugInArgValue(DataElementArg(), mpOutputRasterElement) == false)
    {
       pStep->finalize(Message::Failure, "Unable to set output argument.");
       return false;
@@ -121,6 +215,12 @@ bool ElmBatch::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgLi
    return true;
 }
 
+bool ElmBatch::abort()
+{
+   mAbortFlag = true;
+   return AlgorithmShell::abort();
+}
+
 bool ElmBatch::extractInputArgs(PlugInArgList* pInputArgList)
 {
    if (ElmCore::extractInputArgs(pInputArgList) == false)
@@ -131,6 +231,21 @@ bool ElmBatch::extractInputArgs(PlugInArgList* pInputArgList)
    StepResource pStep("Extract Batch Input Args", "app", "32A136BE-8531-42ca-8B22-086293B5A925");
    VERIFY(pStep.get() != NULL);
 
+   if (pInputArgList->getPlugInArgValue<bool>(VirtualOutputArg(), mVirtualOutput) == false)
+   {
+      pStep->finalize(Message::Failure, "The \"" + VirtualOutputArg() + "\" input arg is invalid.");
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+      }
+
+      return false;
+   }
+
+   // The output data type is optional
+   mOutputDataType = EncodingType();
+   pInputArgList->getPlugInArgValue<EncodingType>(OutputDataTypeArg(), mOutputDataType);
+
    // Get the Use Gains/Offsets Flag.
    if (pInputArgList->getPlugInArgValue<bool>(UseGainsOffsetsArg(), mUseGainsOffsets) == false)
    {
@@ -143,16 +258,15 @@ bool ElmBatch::extractInputArgs(PlugInArgList* pInputArgList)
       return false;
    }
 
+   mGainsOffsetsFilename.clear();
+   mSignatureFilenames.clear();
+   mAoiFilenames.clear();
    if (mUseGainsOffsets == true)
    {
       // If the Use Gains/Offsets Flag is set to true, get the Gains/Offsets Filename.
+      // If it is not set, the default is used once the data to calibrate is known.
       Filename* pFilename = pInputArgList->getPlugInArgValue<Filename>(GainsOffsetsFilenameArg());
-      if (pFilename == NULL || pFilename->getFullPathAndName().empty() == true)
-      {
-         // If the Gains/Offsets Filename is not set, use the default.
-         mGainsOffsetsFilename = getDefaultGainsOffsetsFilename();
-      }
-      else if (pFilename->isDirectory() == true)
+      if (pFilename != NULL && pFilename->isDirectory() == true)
       {
          pStep->finalize(Message::Failure, "The \"" + GainsOffsetsFilenameArg() + "\" cannot be a directory.");
          if (mpProgress != NULL)
@@ -162,7 +276,7 @@ bool ElmBatch::extractInputArgs(PlugInArgList* pInputArgList)
 
          return false;
       }
-      else
+      else if (pFilename != NULL)
       {
          mGainsOffsetsFilename = pFilename->getFullPathAndName();
       }
@@ -185,33 +299,109 @@ bool ElmBatch::extractInputArgs(PlugInArgList* pInputArgList)
 
       for (vector<Filename*>::iterator iter = pSignatureFilenames.begin(); iter != pSignatureFilenames.end(); ++iter)
       {
-         bool previouslyLoaded;
-         Signature* pSignature = dynamic_cast<Signature*>
-            (getElement(*iter, "Signature", NULL, previouslyLoaded));
-         if (pSignature == NULL)
+         mSignatureFilenames.push_back(*iter == NULL ? string() : (*iter)->getFullPathAndName());
+      }
+
+      // Get the AOI names.
+      vector<Filename*> pAoiFilenames;
+      if (pInputArgList->getPlugInArgValue<vector<Filename*> >(AoiFilenamesArg(), pAoiFilenames) == false)
+      {
+         pStep->finalize(Message::Failure, "The \"" + AoiFilenamesArg() + "\" input arg is invalid.");
+         if (mpProgress != NULL)
          {
-            pStep->finalize(Message::Failure, "The \"" + SignatureFilenamesArg() +
-               "\" input arg contains an invalid value.");
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
-            }
+            mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+         }
+
+         return false;
+      }
 
-            return false;
+      for (vector<Filename*>::iterator iter = pAoiFilenames.begin(); iter != pAoiFilenames.end(); ++iter)
+      {
+         mAoiFilenames.push_back(*iter == NULL ? string() : (*iter)->getFullPathAndName());
+      }
+   }
+
+   // Get the optional list of scenes to calibrate and the files to export them to.
+   mSceneFilenames.clear();
+   mOutputFilenames.clear();
+   vector<Filename*> pSceneFilenames;
+   vector<Filename*> pOutputFilenames;
+   pInputArgList->getPlugInArgValue<vector<Filename*> >(SceneFilenamesArg(), pSceneFilenames);
+   pInputArgList->getPlugInArgValue<vector<Filename*> >(OutputFilenamesArg(), pOutputFilenames);
+   for (vector<Filename*>::iterator iter = pSceneFilenames.begin(); iter != pSceneFilenames.end(); ++iter)
+   {
+      mSceneFilenames.push_back(*iter == NULL ? string() : (*iter)->getFullPathAndName());
+   }
+
+   for (vector<Filename*>::iterator iter = pOutputFilenames.begin(); iter != pOutputFilenames.end(); ++iter)
+   {
+      mOutputFilenames.push_back(*iter == NULL ? string() : (*iter)->getFullPathAndName());
+   }
+
+   if (mSceneFilenames.empty() == false)
+   {
+      if (mOutputFilenames.size() != mSceneFilenames.size())
+      {
+         pStep->finalize(Message::Failure, "The \"" + OutputFilenamesArg() + "\" input arg must contain one "
+            "filename for each of the \"" + SceneFilenamesArg() + "\".");
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
          }
 
-         mpSignatures.push_back(pSignature);
-         if (previouslyLoaded == false)
+         return false;
+      }
+
+      if (pInputArgList->getPlugInArgValue<string>(ExporterArg(), mExporter) == false || mExporter.empty() == true)
+      {
+         pStep->finalize(Message::Failure, "The \"" + ExporterArg() + "\" input arg is invalid.");
+         if (mpProgress != NULL)
          {
-            mpSignaturesToDestroy.push_back(pSignature);
+            mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
          }
+
+         return false;
       }
 
-      // Get the AOI names.
-      vector<Filename*> pAoiFilenames;
-      if (pInputArgList->getPlugInArgValue<vector<Filename*> >(AoiFilenamesArg(), pAoiFilenames) == false)
+      // Scenes are imported by this plug-in and may already be loaded, so they are never calibrated in place
+      if (mVirtualOutput == false && mOutputDataType.isValid() == false)
       {
-         pStep->finalize(Message::Failure, "The \"" + AoiFilenamesArg() + "\" input arg is invalid.");
+         mOutputDataType = FLT4BYTES;
+         pStep->addMessage("The \"" + OutputDataTypeArg() + "\" input arg is not set, so the scenes are "
+            "calibrated to Float (4 byte) elements.", "app", "7AA54F39-EC75-4bfb-B157-F6A0C2888A01");
+      }
+   }
+
+   pStep->finalize();
+   return true;
+}
+
+bool ElmBatch::loadCalibrationElements()
+{
+   StepResource pStep("Load Calibration Elements", "app", "9C3E41D2-6B7A-4f0e-8D15-2A4C7E9B0F63");
+   VERIFY(pStep.get() != NULL);
+
+   if (mUseGainsOffsets == true)
+   {
+      // If the Gains/Offsets Filename is not set, use the default.
+      if (mGainsOffsetsFilename.empty() == true)
+      {
+         mGainsOffsetsFilename = getDefaultGainsOffsetsFilename();
+      }
+
+      pStep->finalize();
+      return true;
+   }
+
+   for (vector<string>::iterator iter = mSignatureFilenames.begin(); iter != mSignatureFilenames.end(); ++iter)
+   {
+      bool previouslyLoaded;
+      Signature* pSignature = dynamic_cast<Signature*>
+         (getElement(*iter, "Signature", NULL, previouslyLoaded));
+      if (pSignature == NULL)
+      {
+         pStep->finalize(Message::Failure, "The \"" + SignatureFilenamesArg() +
+            "\" input arg contains an invalid value.");
          if (mpProgress != NULL)
          {
             mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
@@ -220,43 +410,227 @@ bool ElmBatch::extractInputArgs(PlugInArgList* pInputArgList)
          return false;
       }
 
-      for (vector<Filename*>::iterator iter = pAoiFilenames.begin(); iter != pAoiFilenames.end(); ++iter)
+      mpSignatures.push_back(pSignature);
+      if (previouslyLoaded == false)
       {
-         bool previouslyLoaded;
-         AoiElement* pAoiElement = dynamic_cast<AoiElement*>
-            (getElement(*iter, "AoiElement", mpRasterElement, previouslyLoaded));
-         if (pAoiElement == NULL)
+         mpSignaturesToDestroy.push_back(pSignature);
+      }
+   }
+
+   for (vector<string>::iterator iter = mAoiFilenames.begin(); iter != mAoiFilenames.end(); ++iter)
+   {
+      bool previouslyLoaded;
+      AoiElement* pAoiElement = dynamic_cast<AoiElement*>
+         (getElement(*iter, "AoiElement", mpRasterElement, previouslyLoaded));
+      if (pAoiElement == NULL)
+      {
+         pStep->finalize(Message::Failure, "The \"" + AoiFilenamesArg() +
+            "\" input arg contains an invalid value.");
+         if (mpProgress != NULL)
          {
-            pStep->finalize(Message::Failure, "The \"" + AoiFilenamesArg() +
-               "\" input arg contains an invalid value.");
-            if (mpProgress != NULL)
-            {
-               mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
-            }
+            mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+         }
+
+         return false;
+      }
+
+      mpAoiElements.push_back(pAoiElement);
+      if (previouslyLoaded == false)
+      {
+         mpAoiElementsToDestroy.push_back(pAoiElement);
+      }
+   }
+
+   pStep->finalize();
+   return true;
+}
+
+void ElmBatch::destroyCalibrationElements()
+{
+   Service<ModelServices> pModel;
+   for (vector<Signature*>::iterator iter =  mpSignaturesToDestroy.begin();
+      iter != mpSignaturesToDestroy.end(); ++iter)
+   {
+      pModel->destroyElement(dynamic_cast<DataElement*>(*iter));
+   }
+
+   for (vector<AoiElement*>::iterator iter =  mpAoiElementsToDestroy.begin();
+      iter != mpAoiElementsToDestroy.end(); ++iter)
+   {
+      pModel->destroyElement(dynamic_cast<DataElement*>(*iter));
+   }
+
+   mpSignatures.clear();
+   mpSignaturesToDestroy.clear();
+   mpAoiElements.clear();
+   mpAoiElementsToDestroy.clear();
+}
+
+bool ElmBatch::calibrateScenes()
+{
+   StepResource pStep("Calibrate Scenes", "app", "5E07B3A1-C2D8-4b6f-9A41-83F6D0E2C7B9");
+   VERIFY(pStep.get() != NULL);
+
+   // The gains/offsets are read or computed for the first scene and resampled for the others
+   setReuseGainsOffsets(true);
+
+   Service<ModelServices> pModel;
+   const unsigned int numScenes = mSceneFilenames.size();
+   unsigned int numFailed = 0;
+   ScenePrefetchThread* pPrefetch = NULL;
+   for (unsigned int scene = 0; scene < numScenes && mAbortFlag == false; ++scene)
+   {
+      stringstream sceneName;
+      sceneName << "Scene " << (scene + 1) << " of " << numScenes << " (" << mSceneFilenames[scene] << ")";
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress("Importing " + sceneName.str(), 0, NORMAL);
+      }
+
+      // Stop reading ahead so the importer has the disk to itself
+      delete pPrefetch;
+      pPrefetch = NULL;
+      bool previouslyLoaded = false;
+      RasterElement* pScene = dynamic_cast<RasterElement*>
+         (getElement(mSceneFilenames[scene], TypeConverter::toString<RasterElement>(), NULL, previouslyLoaded));
+
+      // Read the next scene while this one is calibrated and exported
+      if (scene + 1 < numScenes)
+      {
+         pPrefetch = new ScenePrefetchThread(mSceneFilenames[scene + 1]);
+         pPrefetch->start();
+      }
 
-            return false;
+      bool calibrated = false;
+      bool success = false;
+      mpRasterElement = pScene;
+      mpOutputRasterElement = NULL;
+      if (pScene == NULL)
+      {
+         pStep->addMessage("Unable to import " + sceneName.str() + ".", "app",
+            "0F6A2C84-7D3E-4a59-B1C6-E48D92A5307F");
+      }
+      else
+      {
+         if (scene == 0)
+         {
+            success = loadCalibrationElements();
+         }
+         else
+         {
+            success = true;
          }
 
-         mpAoiElements.push_back(pAoiElement);
-         if (previouslyLoaded == false)
+         if (success == true)
          {
-            mpAoiElementsToDestroy.push_back(pAoiElement);
+            success = executeElm(mGainsOffsetsFilename, mpSignatures, mpAoiElements);
+            calibrated = success;
          }
+
+         // Signatures and AOIs are only needed to compute the gains/offsets from the first scene
+         if (scene == 0)
+         {
+            destroyCalibrationElements();
+         }
+      }
+
+      if (success == true && mpOutputRasterElement != NULL)
+      {
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress("Exporting " + sceneName.str(), 100, NORMAL);
+         }
+
+         const RasterDataDescriptor* pDescriptor =
+            dynamic_cast<const RasterDataDescriptor*>(mpOutputRasterElement->getDataDescriptor());
+         FactoryResource<FileDescriptor> pFileDescriptor(pDescriptor == NULL ? NULL :
+            RasterUtilities::generateFileDescriptorForExport(pDescriptor, mOutputFilenames[scene]));
+         ExporterResource exporter(mExporter, mpProgress);
+         success = false;
+         if (pFileDescriptor.get() != NULL && exporter->getPlugIn() != NULL)
+         {
+            exporter->setItem(mpOutputRasterElement);
+            exporter->setFileDescriptor(pFileDescriptor.get());
+            success = exporter->execute();
+         }
+
+         if (success == false)
+         {
+            pStep->addMessage("Unable to export " + sceneName.str() + " to \"" + mOutputFilenames[scene] + "\".",
+               "app", "B83D5F17-4E2C-4d0a-96A7-1C5E3F8D2B40");
+         }
+      }
+
+      if (success == false)
+      {
+         ++numFailed;
+      }
+
+      // Free the scene before moving on to the next one
+      if (mpOutputRasterElement != NULL && mpOutputRasterElement != pScene)
+      {
+         pModel->destroyElement(mpOutputRasterElement);
       }
+
+      if (pScene != NULL && previouslyLoaded == false)
+      {
+         pModel->destroyElement(pScene);
+      }
+
+      mpRasterElement = NULL;
+      mpOutputRasterElement = NULL;
+
+      // Later scenes cannot be calibrated without the gains/offsets from the first one
+      if (scene == 0 && calibrated == false)
+      {
+         numFailed = numScenes;
+         break;
+      }
+   }
+
+   delete pPrefetch;
+   setReuseGainsOffsets(false);
+
+   if (mAbortFlag == true)
+   {
+      pStep->finalize(Message::Abort);
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress("ELM aborted by the user.", 0, ABORT);
+      }
+
+      return false;
+   }
+
+   if (numFailed != 0)
+   {
+      stringstream message;
+      message << numFailed << " of " << numScenes << " scenes could not be calibrated.";
+      pStep->finalize(Message::Failure, message.str());
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+      }
+
+      return false;
    }
 
    pStep->finalize();
+   if (mpProgress != NULL)
+   {
+      mpProgress->updateProgress("Done", 100, NORMAL);
+   }
+
    return true;
 }
 
-DataElement* ElmBatch::getElement(const Filename* pFilename,
+DataElement* ElmBatch::getElement(const string& filename,
    const string& type, DataElement* pParent, bool& previouslyLoaded)
 {
    DataElement* pDataElement = NULL;
-   if (pFilename != NULL)
+   if (filename.empty() == false)
    {
       Service<ModelServices> pModel;
-      const string& filename = pFilename->getFullPathAndName();
       pDataElement = pModel->getElement(filename, type, pParent);
       if (pDataElement != NULL)
       {
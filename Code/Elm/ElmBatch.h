@@ -28,20 +28,34 @@ public:
 
 
    bool execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList);
+   bool abort();
 
 protected:
    bool extractInputArgs(PlugInArgList* pInputArgList);
 
 private:
-   DataElement* getElement(const Filename* pFilename,
+   DataElement* getElement(const std::string& filename,
       const std::string& type, DataElement* pParent, bool& previouslyLoaded);
+   bool loadCalibrationElements();
+   void destroyCalibrationElements();
+   bool calibrateScenes();
    static std::string UseGainsOffsetsArg() { return "Use Existing Gains/Offsets File"; }
    static std::string GainsOffsetsFilenameArg() { return "Existing Gains/Offsets Filename"; }
    static std::string SignatureFilenamesArg() { return "Signature Filenames"; }
    static std::string AoiFilenamesArg() { return "AOI Filenames"; }
+   static std::string VirtualOutputArg() { return "Virtual Output"; }
+   static std::string OutputDataTypeArg() { return "Output Data Type"; }
+   static std::string SceneFilenamesArg() { return "Scene Filenames"; }
+   static std::string OutputFilenamesArg() { return "Output Filenames"; }
+   static std::string ExporterArg() { return "Exporter"; }
 
    bool mUseGainsOffsets;
    std::string mGainsOffsetsFilename;
+   std::vector<std::string> mSignatureFilenames;
+   std::vector<std::string> mAoiFilenames;
+   std::vector<std::string> mSceneFilenames;
+   std::vector<std::string> mOutputFilenames;
+   std::string mExporter;
    std::vector<Signature*> mpSignatures;
    std::vector<Signature*> mpSignaturesToDestroy;
    std::vector<AoiElement*> mpAoiElements;
@@ -29,27 +29,98 @@
 #include "Progress.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "RasterUtilities.h"
 #include "Resampler.h"
 #include "Signature.h"
 #include "SpecialMetadata.h"
+#include "StringUtilities.h"
 #include "switchOnEncoding.h"
+#include "TypeConverter.h"
 #include "Units.h"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
 
+namespace
+{
+   template<typename T>
+   void accumulateAoiRow(T* pRow, int row, int startColumn, unsigned int numBands, unsigned int numSums,
+      const vector<const BitMask*>& masks, const vector<int>& boxes, vector<double>& sums, vector<double>& counts)
+   {
+      for (unsigned int element = 0; element < masks.size(); ++element)
+      {
+         // boxes holds x1, y1, x2, y2 for each AOI
+         const int* pBox = &boxes[4 * element];
+         if (row < pBox[1] || row > pBox[3])
+         {
+            continue;
+         }
+
+         double* pSums = &sums[element * numSums];
+         for (int column = pBox[0]; column <= pBox[2]; ++column)
+         {
+            if (masks[element]->getPixel(column, row) == true)
+            {
+               const T* pPixel = pRow + (column - startColumn) * numBands;
+               for (unsigned int band = 0; band < numSums; ++band)
+               {
+                  pSums[band] += static_cast<double>(pPixel[band]);
+               }
+               ++counts[element];
+            }
+         }
+      }
+   }
+
+   template<typename T, typename U>
+   void calibrateValues(const T* pSource, U* pDestination, unsigned int count, double gain, double offset,
+      double lowerLimit, double upperLimit)
+   {
+      for (unsigned int i = 0; i < count; ++i)
+      {
+         double result = static_cast<double>(pSource[i]) * gain + offset;
+         result = (result < lowerLimit ? lowerLimit : result);
+         result = (result > upperLimit ? upperLimit : result);
+         pDestination[i] = static_cast<U>(result);
+      }
+   }
+
+   template<typename T, typename U>
+   void calibratePixels(const T* pSource, U* pDestination, unsigned int count, const double* pGains,
+      const double* pOffsets, const double* pLowerLimits, const double* pUpperLimits, unsigned int numBands)
+   {
+      for (unsigned int pixel = 0; pixel < count; ++pixel, pSource += numBands, pDestination += numBands)
+      {
+         for (unsigned int band = 0; band < numBands; ++band)
+         {
+            double result = static_cast<double>(pSource[band]) * pGains[band] + pOffsets[band];
+            result = (result < pLowerLimits[band] ? pLowerLimits[band] : result);
+            result = (result > pUpperLimits[band] ? pUpperLimits[band] : result);
+            pDestination[band] = static_cast<U>(result);
+         }
+      }
+   }
+}
+
 ElmCore::ElmCore() :
    mpProgress(NULL),
    mpRasterElement(NULL),
-   mpRasterDataDescriptor(NULL)
+   mpRasterDataDescriptor(NULL),
+   mpOutputRasterElement(NULL),
+   mVirtualOutput(false),
+   mOutputDataType(),
+   mAbortFlag(false),
+   mReuseGainsOffsets(false),
+   mpGainsOffsetsCache(NULL)
 {
    // Do nothing
 }
 
 ElmCore::~ElmCore()
 {
-   // Do nothing
+   delete mpGainsOffsetsCache;
 }
 
 Progress* ElmCore::getProgress() const
@@ -62,6 +133,16 @@ const RasterElement* ElmCore::getRasterElement() const
    return mpRasterElement;
 }
 
+void ElmCore::setReuseGainsOffsets(bool reuse)
+{
+   mReuseGainsOffsets = reuse;
+   if (mReuseGainsOffsets == false)
+   {
+      delete mpGainsOffsetsCache;
+      mpGainsOffsetsCache = NULL;
+   }
+}
+
 bool ElmCore::getInputSpecification(PlugInArgList*& pArgList)
 {
    pArgList = mpPlugInManager->getPlugInArgList();
@@ -125,6 +206,7 @@ bool ElmCore::executeElm(string gainsOffsetsFilename,
    StepResource pStep("Execute ELM Algorithm", "app", "BD5F228F-629D-4520-BAF8-6FCBDE1A8F62");
    VERIFY(pStep.get() != NULL);
    mExecuting = true;
+   mAbortFlag = false;
 
    // Check that all input arguments are valid.
    if (inputArgsAreValid() == false)
@@ -153,9 +235,26 @@ bool ElmCore::executeElm(string gainsOffsetsFilename,
       return false;
    }
 
-   // If a Gains/Offsets filename was supplied, use it.
+   // If Gains/Offsets are being reused from a previous execution, resample them to this data.
+   // Otherwise, if a Gains/Offsets filename was supplied, use it.
    // Otherwise, compute the results and attempt to save them.
-   if (gainsOffsetsFilename.empty() == false)
+   if (mpGainsOffsetsCache != NULL)
+   {
+      mpGainsOffsetsCache->setCenterWavelengths(mCenterWavelengths);
+      mpGainsOffsetsCache->setGainsOffsets(pGainsOffsets);
+      if (mpGainsOffsetsCache->readResults() == false)
+      {
+         pStep->finalize(Message::Failure, "Unable to resample the reused Gains/Offsets.");
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+         }
+
+         mExecuting = false;
+         return false;
+      }
+   }
+   else if (gainsOffsetsFilename.empty() == false)
    {
       if (getGainsOffsetsFromFile(gainsOffsetsFilename, pGainsOffsets) == false)
       {
@@ -181,13 +280,26 @@ bool ElmCore::executeElm(string gainsOffsetsFilename,
       return false;
    }
 
-   // Apply the Gains/Offsets to the View.
-   if (applyResults(pGainsOffsets) == false)
+   // Apply the Gains/Offsets to the View, or create a virtual element which applies them as the data is read.
+   mpOutputRasterElement = mpRasterElement;
+   const bool applied = (mVirtualOutput ? createVirtualResults(pGainsOffsets) : applyResults(pGainsOffsets));
+   if (applied == false)
    {
-      pStep->finalize(Message::Failure, "Unable to Apply Gains/Offsets to View.");
-      if (mpProgress != NULL)
+      if (mAbortFlag == true)
       {
-         mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+         pStep->finalize(Message::Abort);
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress("ELM aborted by the user.", 0, ABORT);
+         }
+      }
+      else
+      {
+         pStep->finalize(Message::Failure, "Unable to Apply Gains/Offsets to View.");
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress(pStep->getFailureMessage(), 100, ERRORS);
+         }
       }
 
       mExecuting = false;
@@ -221,13 +333,31 @@ bool ElmCore::getGainsOffsetsFromScratch(const vector<Signature*>& pSignatures,
       }
    }
 
+   if (mReuseGainsOffsets == true)
+   {
+      delete mpGainsOffsetsCache;
+      mpGainsOffsetsCache = new ElmFile(elmFile);
+      mpGainsOffsetsCache->cacheResults();
+   }
+
    return true;
 }
 
 bool ElmCore::getGainsOffsetsFromFile(const string& filename, double** pGainsOffsets)
 {
    ElmFile elmFile(filename, mCenterWavelengths, pGainsOffsets);
-   return elmFile.readResults();
+   if (elmFile.readResults() == false)
+   {
+      return false;
+   }
+
+   if (mReuseGainsOffsets == true)
+   {
+      delete mpGainsOffsetsCache;
+      mpGainsOffsetsCache = new ElmFile(elmFile);
+   }
+
+   return true;
 }
 
 bool ElmCore::inputArgsAreValid()
@@ -246,9 +376,10 @@ bool ElmCore::inputArgsAreValid()
       }
       else
       {
+         // Only calibrating in place modifies the data, so the other outputs do not need it to be writable
          FactoryResource<DataRequest> pRequest;
          VERIFY(pRequest.get() != NULL);
-         pRequest->setWritable(true);
+         pRequest->setWritable(mVirtualOutput == false && mOutputDataType.isValid() == false);
          const string failedDataRequestErrorMessage =
             SpectralUtilities::getFailedDataRequestErrorMessage(pRequest.get(), mpRasterElement);
          DataAccessor daAccessor = mpRasterElement->getDataAccessor(pRequest.release());
@@ -270,6 +401,12 @@ bool ElmCore::inputArgsAreValid()
             errorMessage += "Complex data is not supported.\n";
          }
 
+         if (mOutputDataType.isValid() == true && mOutputDataType != FLT4BYTES && mOutputDataType != INT2SBYTES)
+         {
+            errorMessage += "The output data type must be either " + StringUtilities::toDisplayString(FLT4BYTES) +
+               " or " + StringUtilities::toDisplayString(INT2SBYTES) + ".\n";
+         }
+
          mpUnits = mpRasterDataDescriptor->getUnits();
          if (mpUnits == NULL)
          {
@@ -342,12 +479,9 @@ bool ElmCore::computeResults(const vector<Signature*>& pSignatures,
    }
 
    string errorMessage;
-   const int polynomialOrder = 2;
    const int numElements = static_cast<int>(pAoiElements.size());
    const int numWavelengths = static_cast<int>(mCenterWavelengths.size());
-   vector<double> referenceValues(totalNumPoints);
-   vector<double> pixelValues(totalNumPoints);
-   vector<double> coefficients(polynomialOrder);
+   const unsigned int numBands = mpRasterDataDescriptor->getBandCount();
 
    MatrixFunctions::MatrixResource<double> pReferenceSpectra(numElements, numWavelengths);
    if (pReferenceSpectra.get() == NULL)
@@ -359,116 +493,132 @@ bool ElmCore::computeResults(const vector<Signature*>& pSignatures,
    {
       errorMessage += "Unable to read Signature Files.\n";
    }
+   else if (static_cast<unsigned int>(numWavelengths) > numBands)
+   {
+      errorMessage += "There are more wavelengths than bands.\n";
+   }
    else
    {
-      double percent = 0;
-      const double step = 100.0 / numWavelengths;
-      Service<ModelServices> pModel;
-      for (int band = 0; band < numWavelengths; ++band)
+      // Find the bounding box of each AOI and of all of them together
+      const int maxRow = static_cast<int>(mpRasterDataDescriptor->getRowCount());
+      const int maxCol = static_cast<int>(mpRasterDataDescriptor->getColumnCount());
+      vector<const BitMask*> masks(numElements);
+      vector<int> boxes(4 * numElements);
+      int minX = maxCol;
+      int minY = maxRow;
+      int maxX = -1;
+      int maxY = -1;
+      for (int element = 0; element < numElements; ++element)
       {
-         DimensionDescriptor activeBand = mpRasterDataDescriptor->getActiveBand(band);
-         if (activeBand.isValid() == false)
+         masks[element] = pAoiElements[element]->getSelectedPoints();
+         if (masks[element] == NULL)
          {
-            errorMessage += "Active Band is invalid.\n";
+            errorMessage += "getSelectedPoints() returned NULL.\n";
             break;
          }
 
-         FactoryResource<DataRequest> pRequest;
-         if (pRequest.get() == NULL)
+         BitMaskIterator it(masks[element], mpRasterElement);
+         int x1, y1, x2, y2;
+         it.getBoundingBox(x1, y1, x2, y2);
+         if (x1 < 0 || y1 < 0 || x2 >= maxCol || y2 >= maxRow)
          {
-            errorMessage += "FactoryResource<DataRequest> returned NULL.\n";
+            errorMessage += "The AOI cannot contain points outside the image.\n";
             break;
          }
 
-         pRequest->setBands(activeBand, activeBand);
+         boxes[4 * element] = x1;
+         boxes[4 * element + 1] = y1;
+         boxes[4 * element + 2] = x2;
+         boxes[4 * element + 3] = y2;
+         minX = min(minX, x1);
+         minY = min(minY, y1);
+         maxX = max(maxX, x2);
+         maxY = max(maxY, y2);
+      }
+
+      // Gather the band sums of every AOI in a single BIP pass over the combined bounding box
+      vector<double> elementSums(numElements * numWavelengths, 0.0);
+      vector<double> elementCounts(numElements, 0.0);
+      if (errorMessage.empty() == true)
+      {
+         FactoryResource<DataRequest> pRequest;
+         VERIFY(pRequest.get() != NULL);
+         pRequest->setInterleaveFormat(BIP);
+         pRequest->setRows(mpRasterDataDescriptor->getActiveRow(minY), mpRasterDataDescriptor->getActiveRow(maxY));
+         pRequest->setColumns(mpRasterDataDescriptor->getActiveColumn(minX),
+            mpRasterDataDescriptor->getActiveColumn(maxX));
          DataAccessor daAccessor = mpRasterElement->getDataAccessor(pRequest.release());
          if (daAccessor.isValid() == false)
          {
             errorMessage += "Unable to obtain a DataAccessor.\n";
-            break;
          }
 
-         unsigned int numPointsProcessed = 0;
-         for (int element = 0; element < numElements && daAccessor.isValid(); ++element)
+         const EncodingType dataType = mpRasterDataDescriptor->getDataType();
+         for (int row = minY; row <= maxY && errorMessage.empty() == true; ++row)
          {
-            const BitMask* pMask = pAoiElements[element]->getSelectedPoints();
-            if (pMask == NULL)
+            if (daAccessor.isValid() == false)
             {
-               errorMessage += "getSelectedPoints() returned NULL.\n";
-               break;
-            }
-            BitMaskIterator it(pMask, mpRasterElement);
-            int x1, y1, x2, y2;
-            it.getBoundingBox(x1, y1, x2, y2);
-            const int maxRow = static_cast<int>(mpRasterDataDescriptor->getRowCount());
-            const int maxCol = static_cast<int>(mpRasterDataDescriptor->getColumnCount());
-            if (x1 < 0 || y1 < 0 || x2 > maxCol || y2 > maxRow)
-            {
-               errorMessage += "The AOI cannot contain points outside the image.\n";
+               errorMessage += "Unable to read from the DataAccessor.\n";
                break;
             }
 
-            for (int yCount = y1; yCount <= y2 && daAccessor.isValid(); ++yCount)
+            switchOnEncoding(dataType, accumulateAoiRow, daAccessor->getRow(), row, minX, numBands,
+               static_cast<unsigned int>(numWavelengths), masks, boxes, elementSums, elementCounts);
+            daAccessor->nextRow();
+
+            if (mpProgress != NULL)
             {
-               for (int xCount = x1; xCount <= x2 && daAccessor.isValid(); ++xCount)
-               {
-                  if (it.getPixel(xCount, yCount) == true)
-                  {
-                     referenceValues[numPointsProcessed] = pReferenceSpectra[element][band];
-                     daAccessor->toPixel(yCount, xCount);
-                     if (daAccessor.isValid() == false)
-                     {
-                        errorMessage += "Unable to read from the DataAccessor.\n";
-                        break;
-                     }
-
-                     pixelValues[numPointsProcessed++] =
-                        pModel->getDataValue(mpRasterDataDescriptor->getDataType(), daAccessor->getColumn(), 0);
-                  }
-               }
+               mpProgress->updateProgress("Computing Gains/Offsets...",
+                  static_cast<int>(100.0 * (row - minY + 1) / (maxY - minY + 1)), NORMAL);
             }
          }
+      }
 
-         if (numPointsProcessed != totalNumPoints && errorMessage.empty() == true)
+      double numPointsProcessed = 0.0;
+      for (int element = 0; element < numElements; ++element)
+      {
+         numPointsProcessed += elementCounts[element];
+      }
+
+      if (numPointsProcessed != totalNumPoints && errorMessage.empty() == true)
+      {
+         errorMessage = "Not all points could be processed.\n";
+      }
+
+      // Fit pixel = offset + gain * reference for every band at once.
+      // The reference value is the same for every pixel of an AOI,
+      // so the least squares sums only need each AOI's pixel count and band sums.
+      for (int band = 0; band < numWavelengths && errorMessage.empty() == true; ++band)
+      {
+         double referenceMean = 0.0;
+         double pixelMean = 0.0;
+         for (int element = 0; element < numElements; ++element)
          {
-            errorMessage = "Not all points could be processed.\n";
+            referenceMean += elementCounts[element] * pReferenceSpectra[element][band];
+            pixelMean += elementSums[element * numWavelengths + band];
          }
-         else
-         {
-            const int numRows = totalNumPoints;
-            const int numCols = polynomialOrder;
-            MatrixFunctions::MatrixResource<double> pMatrix(numRows, numCols);
-            if (pMatrix.get() == NULL)
-            {
-               errorMessage = "Unable to allocate memory to run ELM.\n";
-            }
-            else
-            {
-               for (int row = 0; row < numRows; ++row)
-               {
-                  basisFunction(referenceValues[row], pMatrix[row], numCols);
-               }
+         referenceMean /= numPointsProcessed;
+         pixelMean /= numPointsProcessed;
 
-               if (MatrixFunctions::solveLinearEquation(&coefficients.front(),
-                  pMatrix, &pixelValues.front(), numRows, numCols) == false)
-               {
-                  errorMessage = "Unable to solve the linear equation.\n";
-               }
-            }
+         double referenceVariance = 0.0;
+         double covariance = 0.0;
+         for (int element = 0; element < numElements; ++element)
+         {
+            const double referenceDelta = pReferenceSpectra[element][band] - referenceMean;
+            referenceVariance += elementCounts[element] * referenceDelta * referenceDelta;
+            covariance += referenceDelta *
+               (elementSums[element * numWavelengths + band] - elementCounts[element] * pixelMean);
          }
 
-         if (errorMessage.empty() == false)
+         if (referenceVariance <= 0.0)
          {
+            errorMessage = "Unable to solve the linear equation.\n";
             break;
          }
 
-         pGainsOffsets[band][1] = coefficients[0]; // save offsets
-         pGainsOffsets[band][0] = coefficients[1]; // save gains
-         percent += step;
-         if (mpProgress != NULL)
-         {
-            mpProgress->updateProgress("Computing Gains/Offsets...", static_cast<int>(percent), NORMAL);
-         }
+         const double gain = covariance / referenceVariance;
+         pGainsOffsets[band][1] = pixelMean - gain * referenceMean; // save offsets
+         pGainsOffsets[band][0] = gain; // save gains
       }
    }
 
@@ -614,30 +764,349 @@ bool ElmCore::applyResults(double** pGainsOffsets)
 {
    StepResource pStep("Apply Gains/Offsets to View", "app", "2560A2F6-9F72-47b7-81A7-4A5B5C8036B6");
    VERIFY(pStep.get() != NULL);
+   VERIFY(mpRasterElement != NULL && mpRasterDataDescriptor != NULL);
 
-   void* pData = NULL;
-   VERIFY(mpRasterDataDescriptor != NULL);
-   switchOnEncoding(mpRasterDataDescriptor->getDataType(), scaleCube, pData, pGainsOffsets);
+   const unsigned int numBands = mpRasterDataDescriptor->getBandCount();
+   VERIFY(mCenterWavelengths.size() == numBands);
 
-   VERIFY(mpUnits != NULL);
-   mpUnits->setUnitType(REFLECTANCE);
-   mpUnits->setRangeMin(0.0);
-   mpUnits->setRangeMax(0.0);
-   double scaleValue = 0.0;
-   switchOnEncoding(mpRasterDataDescriptor->getDataType(), getScaleValue, pData, scaleValue);
+   RasterElement* pOutput = mpRasterElement;
+   if (mOutputDataType.isValid() == true)
+   {
+      pOutput = createOutputRasterElement();
+      if (pOutput == NULL)
+      {
+         pStep->finalize(Message::Failure, "Unable to create the output Raster Element.");
+         return false;
+      }
+   }
+
+   RasterDataDescriptor* pOutputDescriptor = dynamic_cast<RasterDataDescriptor*>(pOutput->getDataDescriptor());
+   VERIFY(pOutputDescriptor != NULL);
 
+   // Reflectance is stored multiplied by the scale value of the output type
+   void* pData = NULL;
+   double scaleValue = 0.0;
+   double maxValue = 0.0;
+   switchOnEncoding(pOutputDescriptor->getDataType(), getScaleValue, pData, scaleValue);
+   switchOnEncoding(pOutputDescriptor->getDataType(), getMaxValue, pData, maxValue);
    VERIFY(scaleValue != 0.0);
-   mpUnits->setScaleFromStandard(1.0 / scaleValue);
 
+   // Express (value - offset) * scale / gain as value * gain + offset for the kernel.
+   // Bands without a gain are left unchanged in place and set to zero in a new element.
+   vector<double> gains(numBands, pOutput == mpRasterElement ? 1.0 : 0.0);
+   vector<double> offsets(numBands, 0.0);
+   vector<double> lowerLimits(numBands, pOutput == mpRasterElement ? -numeric_limits<double>::max() : 0.0);
+   vector<double> upperLimits(numBands, pOutput == mpRasterElement ? numeric_limits<double>::max() : 0.0);
+   for (unsigned int band = 0; band < numBands; ++band)
+   {
+      if (fabs(pGainsOffsets[band][0]) > 0.0000)
+      {
+         gains[band] = scaleValue / pGainsOffsets[band][0];
+         offsets[band] = -pGainsOffsets[band][1] * gains[band];
+         lowerLimits[band] = 0.0;
+         upperLimits[band] = maxValue;
+      }
+   }
+
+   const string message = "Applying Gains/Offsets...";
+   ElmAlgInput elmInput(mpRasterElement, pOutput, gains, offsets, lowerLimits, upperLimits, &mAbortFlag);
+   ElmAlgOutput elmOutput;
+   mta::ProgressObjectReporter reporter(message, mpProgress);
+   mta::MultiThreadedAlgorithm<ElmAlgInput, ElmAlgOutput, ElmThread>
+      mtaElm(Service<ConfigurationSettings>()->getSettingThreadCount(), elmInput, elmOutput, &reporter);
+   mtaElm.run();
+
+   if (mAbortFlag == true || elmOutput.mSuccess == false)
+   {
+      if (pOutput != mpRasterElement)
+      {
+         Service<ModelServices>()->destroyElement(pOutput);
+      }
+
+      if (mAbortFlag == true)
+      {
+         pStep->finalize(Message::Abort);
+      }
+      else
+      {
+         pStep->finalize(Message::Failure, "Unable to apply the Gains/Offsets to the data.");
+      }
+
+      return false;
+   }
+
+   pOutput->updateData();
+
+   Units* pUnits = (pOutput == mpRasterElement ? mpUnits : pOutputDescriptor->getUnits());
+   VERIFY(pUnits != NULL);
+   pUnits->setUnitType(REFLECTANCE);
+   pUnits->setRangeMin(0.0);
+   pUnits->setRangeMax(0.0);
+   pUnits->setScaleFromStandard(1.0 / scaleValue);
+
+   mpOutputRasterElement = pOutput;
    pStep->finalize();
    return true;
 }
 
-void ElmCore::basisFunction(double scale, double* pCoefficients, int numCoeffs)
+RasterElement* ElmCore::createOutputRasterElement()
 {
-   pCoefficients[0] = 1.0;
-   for (int coeff = 1; coeff < numCoeffs; ++coeff)
+   VERIFYRV(mpRasterElement != NULL && mpRasterDataDescriptor != NULL, NULL);
+
+   // The results are a child of the source element, the same as the virtual results
+   const string name = mpRasterElement->getName() + " - ELM";
+   Service<ModelServices> pModel;
+   DataElement* pExistingElement = pModel->getElement(name, TypeConverter::toString<RasterElement>(), mpRasterElement);
+   if (pExistingElement != NULL)
    {
-      pCoefficients[coeff] = pCoefficients[coeff - 1] * scale;
+      pModel->destroyElement(pExistingElement);
    }
+
+   // If creating the element fails in memory, try to create it on disk
+   const unsigned int numRows = mpRasterDataDescriptor->getRowCount();
+   const unsigned int numColumns = mpRasterDataDescriptor->getColumnCount();
+   const unsigned int numBands = mpRasterDataDescriptor->getBandCount();
+   const InterleaveFormatType interleave = mpRasterDataDescriptor->getInterleaveFormat();
+   RasterElement* pOutput = RasterUtilities::createRasterElement(name, numRows, numColumns, numBands,
+      mOutputDataType, interleave, true, mpRasterElement);
+   if (pOutput == NULL)
+   {
+      pOutput = RasterUtilities::createRasterElement(name, numRows, numColumns, numBands,
+         mOutputDataType, interleave, false, mpRasterElement);
+   }
+
+   if (pOutput != NULL)
+   {
+      RasterDataDescriptor* pOutputDescriptor = dynamic_cast<RasterDataDescriptor*>(pOutput->getDataDescriptor());
+      VERIFYRV(pOutputDescriptor != NULL, NULL);
+      pOutputDescriptor->setMetadata(mpRasterElement->getMetadata());
+   }
+
+   return pOutput;
+}
+
+bool ElmCore::createVirtualResults(double** pGainsOffsets)
+{
+   StepResource pStep("Create Virtual Reflectance Element", "app", "0C7E5B2A-91F4-4d6e-A3B8-6E2D14F9C057");
+   VERIFY(pStep.get() != NULL);
+   VERIFY(mpRasterElement != NULL && mpRasterDataDescriptor != NULL);
+
+   const unsigned int numBands = mpRasterDataDescriptor->getBandCount();
+   VERIFY(mCenterWavelengths.size() == numBands);
+
+   // Use the same correction as scaleCube(), (value - offset) / gain, leaving bands without a gain unchanged
+   vector<double> gains(numBands, 1.0);
+   vector<double> offsets(numBands, 0.0);
+   for (unsigned int band = 0; band < numBands; ++band)
+   {
+      if (fabs(pGainsOffsets[band][0]) > 0.0000)
+      {
+         gains[band] = 1.0 / pGainsOffsets[band][0];
+         offsets[band] = -pGainsOffsets[band][1] / pGainsOffsets[band][0];
+      }
+   }
+
+   const string name = mpRasterElement->getName() + " - ELM";
+   Service<ModelServices> pModel;
+   DataElement* pExistingElement = pModel->getElement(name, TypeConverter::toString<RasterElement>(), mpRasterElement);
+   if (pExistingElement != NULL)
+   {
+      pModel->destroyElement(pExistingElement);
+   }
+
+   RasterElement* pResults = SpectralUtilities::createGainOffsetElement(name, mpRasterElement, gains, offsets,
+      FLT4BYTES, true);
+   if (pResults == NULL)
+   {
+      pStep->finalize(Message::Failure, "Unable to create the virtual reflectance element.");
+      return false;
+   }
+
+   RasterDataDescriptor* pResultsDescriptor = dynamic_cast<RasterDataDescriptor*>(pResults->getDataDescriptor());
+   VERIFY(pResultsDescriptor != NULL);
+   Units* pUnits = pResultsDescriptor->getUnits();
+   if (pUnits != NULL)
+   {
+      pUnits->setUnitType(REFLECTANCE);
+      pUnits->setRangeMin(0.0);
+      pUnits->setRangeMax(0.0);
+      pUnits->setScaleFromStandard(1.0);
+   }
+
+   mpOutputRasterElement = pResults;
+   pStep->finalize();
+   return true;
+}
+
+ElmThread::ElmThread(const ElmAlgInput& input,
+                     int threadCount,
+                     int threadIndex,
+                     mta::ThreadReporter& reporter) :
+   mta::AlgorithmThread(threadIndex, reporter),
+   mInput(input),
+   mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
+      input.mpInput->getDataDescriptor())->getRowCount())),
+   mSuccess(false)
+{
+}
+
+void ElmThread::run()
+{
+   EncodingType encoding = static_cast<const RasterDataDescriptor*>(mInput.mpInput->getDataDescriptor())->getDataType();
+   switchOnEncoding(encoding, ElmThread::applyGainsOffsets, NULL);
+}
+
+bool ElmThread::isSuccessful() const
+{
+   return mSuccess;
+}
+
+template<class T>
+void ElmThread::applyGainsOffsets(T* pDummyData)
+{
+   if (mInput.mpOutput == mInput.mpInput)
+   {
+      applyGainsOffsets(pDummyData, pDummyData);
+      return;
+   }
+
+   const RasterDataDescriptor* pOutputDescriptor =
+      static_cast<const RasterDataDescriptor*>(mInput.mpOutput->getDataDescriptor());
+   switch (pOutputDescriptor->getDataType())
+   {
+   case FLT4BYTES:
+      applyGainsOffsets(pDummyData, static_cast<float*>(NULL));
+      break;
+
+   case INT2SBYTES:
+      applyGainsOffsets(pDummyData, static_cast<short*>(NULL));
+      break;
+
+   default:
+      break;
+   }
+}
+
+template<class T, class U>
+void ElmThread::applyGainsOffsets(T* pDummyData, U* pDummyOutput)
+{
+   const RasterDataDescriptor* pInputDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mInput.mpInput->getDataDescriptor());
+   const RasterDataDescriptor* pOutputDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mInput.mpOutput->getDataDescriptor());
+   VERIFYNRV(pInputDescriptor != NULL && pOutputDescriptor != NULL);
+
+   const unsigned int numBands = pInputDescriptor->getBandCount();
+   const unsigned int numColumns = pInputDescriptor->getColumnCount();
+   const InterleaveFormatType interleave = pInputDescriptor->getInterleaveFormat();
+   VERIFYNRV(mInput.mGains.size() == numBands && mInput.mOffsets.size() == numBands);
+   VERIFYNRV(mInput.mLowerLimits.size() == numBands && mInput.mUpperLimits.size() == numBands);
+   VERIFYNRV(pOutputDescriptor->getInterleaveFormat() == interleave);
+   const double* pGains = &mInput.mGains.front();
+   const double* pOffsets = &mInput.mOffsets.front();
+   const double* pLowerLimits = &mInput.mLowerLimits.front();
+   const double* pUpperLimits = &mInput.mUpperLimits.front();
+   const bool inPlace = (mInput.mpOutput == mInput.mpInput);
+
+   mRowRange.mFirst = max(0, mRowRange.mFirst);
+   mRowRange.mLast = min(mRowRange.mLast, static_cast<int>(pInputDescriptor->getRowCount()) - 1);
+   if (mRowRange.mFirst > mRowRange.mLast)
+   {
+      mSuccess = true;
+      return;
+   }
+
+   // BIP and BIL rows hold every band, so one pass covers the whole tile;
+   // BSQ bands are stored one after another, so they are processed in sequence
+   const unsigned int numPasses = (interleave == BSQ ? numBands : 1);
+   const int numTileRows = mRowRange.mLast - mRowRange.mFirst + 1;
+   int oldPercentDone = -1;
+   for (unsigned int pass = 0; pass < numPasses; ++pass)
+   {
+      FactoryResource<DataRequest> pDestinationRequest;
+      pDestinationRequest->setRows(pOutputDescriptor->getActiveRow(mRowRange.mFirst),
+         pOutputDescriptor->getActiveRow(mRowRange.mLast));
+      pDestinationRequest->setWritable(true);
+      if (interleave == BSQ)
+      {
+         pDestinationRequest->setBands(pOutputDescriptor->getActiveBand(pass),
+            pOutputDescriptor->getActiveBand(pass));
+      }
+
+      DataAccessor destinationAccessor = mInput.mpOutput->getDataAccessor(pDestinationRequest.release());
+      if (destinationAccessor.isValid() == false)
+      {
+         return;
+      }
+
+      // Calibrating in place reads and writes through the same accessor
+      DataAccessor sourceAccessor = destinationAccessor;
+      if (inPlace == false)
+      {
+         FactoryResource<DataRequest> pSourceRequest;
+         pSourceRequest->setRows(pInputDescriptor->getActiveRow(mRowRange.mFirst),
+            pInputDescriptor->getActiveRow(mRowRange.mLast));
+         if (interleave == BSQ)
+         {
+            pSourceRequest->setBands(pInputDescriptor->getActiveBand(pass), pInputDescriptor->getActiveBand(pass));
+         }
+
+         sourceAccessor = mInput.mpInput->getDataAccessor(pSourceRequest.release());
+         if (sourceAccessor.isValid() == false)
+         {
+            return;
+         }
+      }
+
+      for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
+      {
+         int percentDone = static_cast<int>(100.0 * (pass * numTileRows + row - mRowRange.mFirst) /
+            (numPasses * numTileRows));
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
+
+         if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+         {
+            return;
+         }
+
+         VERIFYNRV(sourceAccessor.isValid() && destinationAccessor.isValid());
+         const T* pSource = reinterpret_cast<const T*>(sourceAccessor->getRow());
+         U* pDestination = reinterpret_cast<U*>(destinationAccessor->getRow());
+
+         switch (interleave)
+         {
+         case BIP:
+            calibratePixels(pSource, pDestination, numColumns, pGains, pOffsets, pLowerLimits, pUpperLimits,
+               numBands);
+            break;
+
+         case BIL:
+            for (unsigned int band = 0; band < numBands; ++band)
+            {
+               calibrateValues(pSource + band * numColumns, pDestination + band * numColumns, numColumns,
+                  pGains[band], pOffsets[band], pLowerLimits[band], pUpperLimits[band]);
+            }
+            break;
+
+         default:
+            calibrateValues(pSource, pDestination, numColumns, pGains[pass], pOffsets[pass],
+               pLowerLimits[pass], pUpperLimits[pass]);
+            break;
+         }
+
+         if (inPlace == false)
+         {
+            sourceAccessor->nextRow();
+         }
+
+         destinationAccessor->nextRow();
+      }
+   }
+
+   getReporter().reportProgress(getThreadIndex(), 100);
+   mSuccess = true;
 }
@@ -13,14 +13,17 @@
 #include "ConfigurationSettings.h"
 #include "DataAccessorImpl.h"
 #include "DataRequest.h"
+#include "MultiThreadedAlgorithm.h"
 #include "PlugInManagerServices.h"
 #include "SpectralUtilities.h"
+#include "TypesFile.h"
 
 #include <limits>
 #include <string>
 #include <vector>
 
 class AoiElement;
+class ElmFile;
 class Filename;
 class Progress;
 class RasterDataDescriptor;
@@ -28,6 +31,83 @@ class RasterElement;
 class Signature;
 class Units;
 
+struct ElmAlgInput
+{
+   ElmAlgInput(RasterElement* pInput,
+      RasterElement* pOutput,
+      const std::vector<double>& gains,
+      const std::vector<double>& offsets,
+      const std::vector<double>& lowerLimits,
+      const std::vector<double>& upperLimits,
+      const bool* pAbortFlag) :
+         mpInput(pInput),
+         mpOutput(pOutput),
+         mGains(gains),
+         mOffsets(offsets),
+         mLowerLimits(lowerLimits),
+         mUpperLimits(upperLimits),
+         mpAbortFlag(pAbortFlag)
+   {
+   }
+
+   RasterElement* mpInput;
+   RasterElement* mpOutput;
+   const std::vector<double>& mGains;
+   const std::vector<double>& mOffsets;
+   const std::vector<double>& mLowerLimits;
+   const std::vector<double>& mUpperLimits;
+   const bool* mpAbortFlag;
+};
+
+/**
+ * Applies the ELM gains/offsets to one tile of rows.
+ *
+ * Each value of a band becomes value * gain + offset, clipped to the band's limits.
+ * The input and output are processed in their native interleave, and when they are
+ * the same element the tile is calibrated in place through a single writable accessor.
+ */
+class ElmThread : public mta::AlgorithmThread
+{
+public:
+   ElmThread(const ElmAlgInput& input,
+      int threadCount,
+      int threadIndex,
+      mta::ThreadReporter& reporter);
+
+   void run();
+   bool isSuccessful() const;
+
+   template<class T> void applyGainsOffsets(T* pDummyData);
+
+private:
+   template<class T, class U> void applyGainsOffsets(T* pDummyData, U* pDummyOutput);
+
+   const ElmAlgInput& mInput;
+   mta::AlgorithmThread::Range mRowRange;
+   bool mSuccess;
+};
+
+struct ElmAlgOutput
+{
+   ElmAlgOutput() : mSuccess(false) {}
+
+   bool compileOverallResults(const std::vector<ElmThread*>& threads)
+   {
+      mSuccess = true;
+      for (std::vector<ElmThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+      {
+         if (*iter == NULL || (*iter)->isSuccessful() == false)
+         {
+            mSuccess = false;
+         }
+      }
+
+      return mSuccess;
+   }
+
+   bool mSuccess;
+};
+
 class ElmCore
 {
 public:
@@ -43,6 +123,16 @@ public:
 
    const RasterElement* getRasterElement() const;
 
+   /**
+    * Sets whether the gains/offsets are reused by later calls to executeElm().
+    *
+    * While enabled, the first call reads or computes the gains/offsets as usual.
+    * Later calls resample those values to the center wavelengths of their data
+    * instead of reading the file or computing them again, so signatures and AOIs
+    * are only needed by the first call. Disabling discards the reused values.
+    */
+   void setReuseGainsOffsets(bool reuse);
+
 protected:
    bool getInputSpecification(PlugInArgList*& pArgList);
    virtual bool extractInputArgs(PlugInArgList* pInputArgList);
@@ -52,12 +142,20 @@ protected:
    Progress* mpProgress;
    RasterElement* mpRasterElement;
    RasterDataDescriptor* mpRasterDataDescriptor;
+   RasterElement* mpOutputRasterElement;
+   bool mVirtualOutput;
+
+   // If valid, the results are written to a new element of this type instead of calibrating the data in place
+   EncodingType mOutputDataType;
+   bool mAbortFlag;
    Service<PlugInManagerServices> const mpPlugInManager;
 
    std::vector<double> mCenterWavelengths;
 
 private:
    bool mExecuting;
+   bool mReuseGainsOffsets;
+   ElmFile* mpGainsOffsetsCache;
    bool inputArgsAreValid();
 
    bool getGainsOffsetsFromFile(const std::string& gainsOffsetsFilename, double** pGainsOffsets);
@@ -72,10 +170,8 @@ private:
 
    bool readSignatureFiles(const std::vector<Signature*>& pSignatures, double** pReferenceSpectra);
    bool applyResults(double** pGainsOffsets);
-   void basisFunction(double scale, double* pCoefficients, int numCoeffs);
-
-   template<typename T>
-   void scaleCube(T* pData, double** pGainsOffsets);
+   bool createVirtualResults(double** pGainsOffsets);
+   RasterElement* createOutputRasterElement();
 
    template<typename T>
    inline void getScaleValue(T* pData, double& scaleValue);
@@ -84,91 +180,6 @@ private:
    inline void getMaxValue(T* pData, double& maxValue);
 };
 
-template<typename T>
-void ElmCore::scaleCube(T* pData, double** pGainsOffsets)
-{
-   VERIFYNRV(mpRasterElement != NULL);
-   VERIFYNRV(mpRasterDataDescriptor != NULL);
-
-   const unsigned int numBands = mpRasterDataDescriptor->getBandCount();
-   const unsigned int numRows = mpRasterDataDescriptor->getRowCount();
-   const unsigned int numCols = mpRasterDataDescriptor->getColumnCount();
-
-   VERIFYNRV(numRows != 0 && numCols != 0 && numBands != 0);
-   const double step = 100.0 / numBands;
-   double percent = 0;
-
-   double maxValue;
-   double scaleValue;
-   getMaxValue(pData, maxValue);
-   getScaleValue(pData, scaleValue);
-
-   for (unsigned int band = 0; band < numBands; ++band, ++pData)
-   {
-      if (fabs(pGainsOffsets[band][0]) > 0.0000)
-      {
-         const double netGain = scaleValue / pGainsOffsets[band][0];
-         const double netOffset = pGainsOffsets[band][1];
-         const DimensionDescriptor activeBand = mpRasterDataDescriptor->getActiveBand(band);
-         VERIFYNRV(activeBand.isValid() == true);
-
-         FactoryResource<DataRequest> pRequest;
-         VERIFYNRV(pRequest.get() != NULL);
-         pRequest->setWritable(true);
-         pRequest->setBands(activeBand, activeBand);
-         const std::string failedDataRequestErrorMessage =
-            SpectralUtilities::getFailedDataRequestErrorMessage(pRequest.get(), mpRasterElement);
-         DataAccessor daAccessor = mpRasterElement->getDataAccessor(pRequest.release());
-         if (daAccessor.isValid() == false)
-         {
-            if (mpProgress != NULL)
-            {
-               if (failedDataRequestErrorMessage.empty() == false)
-               {
-                  mpProgress->updateProgress(failedDataRequestErrorMessage, 100, ERRORS);
-               }
-               else
-               {
-                  mpProgress->updateProgress("Unable to obtain a writable DataAccessor.", 100, ERRORS);
-               }
-            }
-
-            break;
-         }
-
-         for (unsigned int row = 0; row < numRows && daAccessor.isValid() == true; row++, daAccessor->nextRow())
-         {
-            for (unsigned int col = 0; col < numCols && daAccessor.isValid() == true; col++, daAccessor->nextColumn())
-            {
-               pData = static_cast<T*>(daAccessor->getColumn());
-
-               double result = static_cast<double>(*pData);
-               result = (result - netOffset) * netGain;
-               if (result < 0)
-               {
-                  result = 0;
-               }
-               else if (result > maxValue)
-               {
-                  result = maxValue;
-               }
-
-               *pData = static_cast<T>(result);
-            }
-         }
-      }
-
-      percent += step;
-
-      if (mpProgress != NULL)
-      {
-         mpProgress->updateProgress("Applying Gains/Offsets...", static_cast<int>(percent), NORMAL);
-      }
-   }
-
-   mpRasterElement->updateData();
-}
-
 template<typename T>
 inline void ElmCore::getScaleValue(T* pData, double& scaleValue)
 {
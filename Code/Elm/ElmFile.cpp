@@ -24,7 +24,8 @@ using namespace std;
 ElmFile::ElmFile(const string& filename, vector<double> centerWavelengths, double** pGainsOffsets) :
    mCenterWavelengths(centerWavelengths),
    mpGainsOffsets(pGainsOffsets),
-   mFilename(filename)
+   mFilename(filename),
+   mResultsLoaded(false)
 {
       // Do nothing
 }
@@ -34,6 +35,45 @@ ElmFile::~ElmFile()
    // Do nothing
 }
 
+void ElmFile::setFilename(const string& filename)
+{
+   if (filename != mFilename)
+   {
+      mFilename = filename;
+      mResultsLoaded = false;
+   }
+}
+
+const string& ElmFile::getFilename() const
+{
+   return mFilename;
+}
+
+void ElmFile::setCenterWavelengths(const vector<double>& centerWavelengths)
+{
+   mCenterWavelengths = centerWavelengths;
+}
+
+void ElmFile::setGainsOffsets(double** pGainsOffsets)
+{
+   mpGainsOffsets = pGainsOffsets;
+}
+
+void ElmFile::cacheResults()
+{
+   const unsigned int numWavelengths = mCenterWavelengths.size();
+   mWavelengths = mCenterWavelengths;
+   mGains.resize(numWavelengths);
+   mOffsets.resize(numWavelengths);
+   for (unsigned int i = 0; i < numWavelengths; ++i)
+   {
+      mGains[i] = mpGainsOffsets[i][0];
+      mOffsets[i] = mpGainsOffsets[i][1];
+   }
+
+   mResultsLoaded = true;
+}
+
 bool ElmFile::saveResults()
 {
    StepResource pStep("Save Gains/Offsets File", "app", "1723A695-125D-42d0-9BC7-BEFE1C52073E");
@@ -106,32 +146,36 @@ bool ElmFile::readResults()
    StepResource pStep("Read Gains/Offsets File", "app", "D52A2267-4D43-44c1-A772-A8C6FD130E87");
    VERIFY(pStep.get() != NULL);
 
-   ifstream input(mFilename.c_str());
-   if (input.good() == false)
-   {
-      pStep->finalize(Message::Failure, "Unable to open file \"" + mFilename + "\".");
-      return false;
-   }
-
-   vector<double> wavelengths;
-   vector<double> gains;
-   vector<double> offsets;
-   while (input.good() == true)
+   if (mResultsLoaded == false)
    {
-      double wavelength = 0;
-      double gain = 0;
-      double offset = 0;
+      ifstream input(mFilename.c_str());
+      if (input.good() == false)
+      {
+         pStep->finalize(Message::Failure, "Unable to open file \"" + mFilename + "\".");
+         return false;
+      }
 
-      input >> wavelength >> gain >> offset;
-      if (input.good() == true)
+      mWavelengths.clear();
+      mGains.clear();
+      mOffsets.clear();
+      while (input.good() == true)
       {
-         wavelengths.push_back(wavelength);
-         gains.push_back(gain);
-         offsets.push_back(offset);
+         double wavelength = 0;
+         double gain = 0;
+         double offset = 0;
+
+         input >> wavelength >> gain >> offset;
+         if (input.good() == true)
+         {
+            mWavelengths.push_back(wavelength);
+            mGains.push_back(gain);
+            mOffsets.push_back(offset);
+         }
       }
-   }
 
-   input.close();
+      input.close();
+      mResultsLoaded = true;
+   }
 
    PlugInResource pPlugIn("Resampler");
    Resampler* pResampler = dynamic_cast<Resampler*>(pPlugIn.get());
@@ -145,14 +189,15 @@ bool ElmFile::readResults()
    vector<int> toBands;
    vector<double> toFwhm;
    vector<double> toGains;
-   if (pResampler->execute(gains, toGains, wavelengths, mCenterWavelengths, toFwhm, toBands, errorMsg) == false)
+   if (pResampler->execute(mGains, toGains, mWavelengths, mCenterWavelengths, toFwhm, toBands, errorMsg) == false)
    {
       pStep->finalize(Message::Failure, "Unable to compute Gains.\nResampler reported \"" + errorMsg + "\".");
       return false;
    }
 
    vector<double> toOffsets;
-   if (pResampler->execute(offsets, toOffsets, wavelengths, mCenterWavelengths, toFwhm, toBands, errorMsg) == false)
+   if (pResampler->execute(mOffsets, toOffsets, mWavelengths, mCenterWavelengths, toFwhm, toBands,
+      errorMsg) == false)
    {
       pStep->finalize(Message::Failure, "Unable to compute Offsets.\nResampler reported \"" + errorMsg + "\".");
       return false;
@@ -164,25 +209,50 @@ bool ElmFile::readResults()
       return false;
    }
 
+   if (toGains.size() != toBands.size() || toOffsets.size() != toBands.size())
+   {
+      pStep->finalize(Message::Failure, "The resampled Gains/Offsets do not match the resampled bands.");
+      return false;
+   }
+
+   // The resampler only returns values for the bands it could resample, so the rest are set to zero
+   const unsigned int numBands = mCenterWavelengths.size();
+   for (unsigned int band = 0; band < numBands; ++band)
+   {
+      mpGainsOffsets[band][0] = 0.0;
+      mpGainsOffsets[band][1] = 0.0;
+   }
+
+   if (toBands.size() < numBands)
+   {
+      stringstream message;
+      message << (numBands - toBands.size()) << " of " << numBands << " bands are outside the wavelengths of the "
+         "Gains/Offsets file and are set to zero.";
+      pStep->addMessage(message.str(), "app", "3B6E0D95-1F27-4c8a-A4E2-7D90C5B1F846");
+   }
+
    int width = 1;
-   for (unsigned int size = toGains.size(); (size - 1) / 10 > 0; size /= 10)
+   for (unsigned int size = numBands; (size - 1) / 10 > 0; size /= 10)
    {
       width++;
    }
 
-   for (unsigned int bandCount = 0; bandCount < toGains.size(); ++bandCount)
+   for (unsigned int i = 0; i < toBands.size(); ++i)
    {
+      const int band = toBands[i];
+      VERIFY(band >= 0 && static_cast<unsigned int>(band) < numBands);
+
       stringstream name;
       name << "Band ";
-      name << setw(width) << setfill('0') << (bandCount + 1);
+      name << setw(width) << setfill('0') << (band + 1);
 
       stringstream text;
-      text << "Gain: " << setprecision(16) << toGains[bandCount];
-      text << ", Offset: " << setprecision(16) << toOffsets[bandCount];
+      text << "Gain: " << setprecision(16) << toGains[i];
+      text << ", Offset: " << setprecision(16) << toOffsets[i];
       pStep->addProperty(name.str(), text.str());
 
-      mpGainsOffsets[bandCount][0] = toGains[bandCount];
-      mpGainsOffsets[bandCount][1] = toOffsets[bandCount];
+      mpGainsOffsets[band][0] = toGains[i];
+      mpGainsOffsets[band][1] = toOffsets[i];
    }
 
    pStep->finalize();
@@ -17,9 +17,27 @@ public:
    ~ElmFile();
 
    void setFilename(const std::string& filename);
+   const std::string& getFilename() const;
+   void setCenterWavelengths(const std::vector<double>& centerWavelengths);
+   void setGainsOffsets(double** pGainsOffsets);
    bool saveResults();
+
+   /**
+    * Resamples the gains/offsets in the file to the center wavelengths.
+    *
+    * The file is only parsed by the first call. Later calls, e.g. after
+    * setCenterWavelengths() for another scene, resample the values already read.
+    *
+    * @return True if the gains/offsets matrix was populated, false otherwise.
+    */
    bool readResults();
 
+   /**
+    * Keeps the current contents of the gains/offsets matrix so that later calls
+    * to readResults() resample them instead of reading the file.
+    */
+   void cacheResults();
+
    static const std::string& getExt()
    {
       static std::string ext(".eog");
@@ -30,6 +48,11 @@ private:
    std::string mFilename;
    std::vector<double> mCenterWavelengths;
    double** mpGainsOffsets;
+
+   bool mResultsLoaded;
+   std::vector<double> mWavelengths;
+   std::vector<double> mGains;
+   std::vector<double> mOffsets;
 };
 
 #endif
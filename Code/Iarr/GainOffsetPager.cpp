@@ -0,0 +1,292 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "GainOffsetPager.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "SpectralVersion.h"
+#include "switchOnEncoding.h"
+
+#include <algorithm>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralIarr, GainOffsetPager);
+
+GainOffsetRasterPage::GainOffsetRasterPage(char* pBuffer,
+                                           unsigned int offset,
+                                           unsigned int rows,
+                                           unsigned int columns,
+                                           unsigned int bands) :
+   mpBuffer(pBuffer),
+   mOffset(offset),
+   mRows(rows),
+   mColumns(columns),
+   mBands(bands)
+{
+}
+
+GainOffsetRasterPage::~GainOffsetRasterPage()
+{
+   delete [] mpBuffer;
+}
+
+void* GainOffsetRasterPage::getRawData()
+{
+   return mpBuffer + mOffset;
+}
+
+unsigned int GainOffsetRasterPage::getNumRows()
+{
+   return mRows;
+}
+
+unsigned int GainOffsetRasterPage::getNumColumns()
+{
+   return mColumns;
+}
+
+unsigned int GainOffsetRasterPage::getNumBands()
+{
+   return mBands;
+}
+
+unsigned int GainOffsetRasterPage::getInterlineBytes()
+{
+   return 0;
+}
+
+GainOffsetPager::GainOffsetPager() :
+   mpElement(NULL),
+   mpSource(NULL),
+   mClipNegative(false),
+   mInterleave(BIP),
+   mDataType(FLT4BYTES),
+   mRows(0),
+   mColumns(0),
+   mBands(0)
+{
+   setName("GainOffsetPager");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Provides the data of a virtual raster element by applying per-band gains and offsets "
+                  "to the data of a source raster element as it is read.");
+   setDescriptorId("{5A3C0F61-8E7B-4d29-9B1E-2F64C7D0A8B3}");
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+}
+
+GainOffsetPager::~GainOffsetPager()
+{
+}
+
+bool GainOffsetPager::getInputSpecification(PlugInArgList*& pArgList)
+{
+   VERIFY((pArgList = Service<PlugInManagerServices>()->getPlugInArgList()) != NULL);
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element",
+      "The virtual raster element which will use this pager."));
+   VERIFY(pArgList->addArg<RasterElement>("Source Element", "The raster element containing the uncorrected data."));
+   VERIFY(pArgList->addArg<vector<double> >("Gains", "The gain for each band of the source element."));
+   VERIFY(pArgList->addArg<vector<double> >("Offsets", "The offset for each band of the source element. "
+      "If not specified, no offset is applied."));
+   VERIFY(pArgList->addArg<bool>("Clip Negative Values", false,
+      "Whether negative corrected values are set to zero."));
+   return true;
+}
+
+bool GainOffsetPager::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList)
+{
+   VERIFY(pInputArgList != NULL);
+   mpElement = pInputArgList->getPlugInArgValue<RasterElement>("Raster Element");
+   mpSource = pInputArgList->getPlugInArgValue<RasterElement>("Source Element");
+   VERIFY(mpElement != NULL && mpSource != NULL);
+
+   const RasterDataDescriptor* pDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   const RasterDataDescriptor* pSourceDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mpSource->getDataDescriptor());
+   VERIFY(pDescriptor != NULL && pSourceDescriptor != NULL);
+
+   mInterleave = pDescriptor->getInterleaveFormat();
+   mDataType = pDescriptor->getDataType();
+   mRows = pDescriptor->getRowCount();
+   mColumns = pDescriptor->getColumnCount();
+   mBands = pDescriptor->getBandCount();
+   if (mRows != pSourceDescriptor->getRowCount() || mColumns != pSourceDescriptor->getColumnCount() ||
+      mBands != pSourceDescriptor->getBandCount() || (mDataType != FLT4BYTES && mDataType != FLT8BYTES))
+   {
+      return false;
+   }
+
+   VERIFY(pInputArgList->getPlugInArgValue<vector<double> >("Gains", mGains));
+   if (pInputArgList->getPlugInArgValue<vector<double> >("Offsets", mOffsets) == false || mOffsets.empty())
+   {
+      mOffsets.assign(mBands, 0.0);
+   }
+   VERIFY(pInputArgList->getPlugInArgValue<bool>("Clip Negative Values", mClipNegative));
+
+   return mGains.size() == mBands && mOffsets.size() == mBands;
+}
+
+template<typename T>
+void GainOffsetPager::applyGainsOffsets(const T* pSource, char* pDestination, InterleaveFormatType interleave,
+                                        unsigned int band) const
+{
+   if (mDataType == FLT4BYTES)
+   {
+      scaleRow(pSource, reinterpret_cast<float*>(pDestination), interleave, band);
+   }
+   else
+   {
+      scaleRow(pSource, reinterpret_cast<double*>(pDestination), interleave, band);
+   }
+}
+
+template<typename T, typename U>
+void GainOffsetPager::scaleRow(const T* pSource, U* pDestination, InterleaveFormatType interleave,
+                               unsigned int band) const
+{
+   const double* pGains = &mGains.front();
+   const double* pOffsets = &mOffsets.front();
+   switch (interleave)
+   {
+   case BIP:
+      for (unsigned int column = 0; column < mColumns; ++column, pSource += mBands, pDestination += mBands)
+      {
+         for (unsigned int index = 0; index < mBands; ++index)
+         {
+            pDestination[index] = static_cast<U>(static_cast<double>(pSource[index]) * pGains[index] +
+               pOffsets[index]);
+         }
+      }
+      pDestination -= mColumns * mBands;
+      break;
+
+   case BIL:
+      for (unsigned int index = 0; index < mBands; ++index, pSource += mColumns, pDestination += mColumns)
+      {
+         for (unsigned int column = 0; column < mColumns; ++column)
+         {
+            pDestination[column] = static_cast<U>(static_cast<double>(pSource[column]) * pGains[index] +
+               pOffsets[index]);
+         }
+      }
+      pDestination -= mColumns * mBands;
+      break;
+
+   default:
+      for (unsigned int column = 0; column < mColumns; ++column)
+      {
+         pDestination[column] = static_cast<U>(static_cast<double>(pSource[column]) * pGains[band] +
+            pOffsets[band]);
+      }
+      break;
+   }
+
+   if (mClipNegative)
+   {
+      const unsigned int count = mColumns * (interleave == BSQ ? 1 : mBands);
+      for (unsigned int index = 0; index < count; ++index)
+      {
+         if (pDestination[index] < 0)
+         {
+            pDestination[index] = 0;
+         }
+      }
+   }
+}
+
+RasterPage* GainOffsetPager::getPage(DataRequest* pOriginalRequest,
+                                     DimensionDescriptor startRow,
+                                     DimensionDescriptor startColumn,
+                                     DimensionDescriptor startBand)
+{
+   VERIFYRV(pOriginalRequest != NULL && mpSource != NULL, NULL);
+   VERIFYRV(pOriginalRequest->getWritable() == false, NULL);
+   VERIFYRV(startRow.isActiveNumberValid() && startColumn.isActiveNumberValid() &&
+      startBand.isActiveNumberValid(), NULL);
+
+   const RasterDataDescriptor* pSourceDescriptor =
+      static_cast<const RasterDataDescriptor*>(mpSource->getDataDescriptor());
+   const unsigned int firstRow = startRow.getActiveNumber();
+   const unsigned int band = startBand.getActiveNumber();
+   VERIFYRV(firstRow < mRows && band < mBands, NULL);
+   const unsigned int numRows = min(max(pOriginalRequest->getConcurrentRows(), 1U), mRows - firstRow);
+
+   InterleaveFormatType interleave = pOriginalRequest->getInterleaveFormat();
+   if (interleave.isValid() == false)
+   {
+      interleave = mInterleave;
+   }
+
+   // BSQ pages hold a single band; BIP and BIL rows hold every band
+   const unsigned int pageBands = (interleave == BSQ ? 1 : mBands);
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(interleave);
+   pRequest->setRows(pSourceDescriptor->getActiveRow(firstRow),
+      pSourceDescriptor->getActiveRow(firstRow + numRows - 1));
+   if (interleave == BSQ)
+   {
+      pRequest->setBands(pSourceDescriptor->getActiveBand(band), pSourceDescriptor->getActiveBand(band));
+   }
+   DataAccessor accessor = mpSource->getDataAccessor(pRequest.release());
+   VERIFYRV(accessor.isValid(), NULL);
+
+   const unsigned int elementSize = (mDataType == FLT4BYTES ? sizeof(float) : sizeof(double));
+   const unsigned int rowSize = mColumns * pageBands * elementSize;
+   char* pBuffer = new char[numRows * rowSize];
+   for (unsigned int row = 0; row < numRows; ++row)
+   {
+      if (accessor.isValid() == false)
+      {
+         delete [] pBuffer;
+         return NULL;
+      }
+
+      switchOnEncoding(pSourceDescriptor->getDataType(), applyGainsOffsets, accessor->getRow(),
+         pBuffer + row * rowSize, interleave, band);
+      accessor->nextRow();
+   }
+
+   // The page data starts at the requested column and band
+   unsigned int offset = startColumn.getActiveNumber();
+   switch (interleave)
+   {
+   case BIP:
+      offset = offset * mBands + band;
+      break;
+
+   case BIL:
+      offset += band * mColumns;
+      break;
+
+   default:
+      break;
+   }
+
+   return new GainOffsetRasterPage(pBuffer, offset * elementSize, numRows, mColumns, pageBands);
+}
+
+void GainOffsetPager::releasePage(RasterPage* pPage)
+{
+   delete dynamic_cast<GainOffsetRasterPage*>(pPage);
+}
+
+int GainOffsetPager::getSupportedRequestVersion() const
+{
+   return 1;
+}
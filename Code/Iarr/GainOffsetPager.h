@@ -0,0 +1,87 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef GAINOFFSETPAGER_H__
+#define GAINOFFSETPAGER_H__
+
+#include "RasterPage.h"
+#include "RasterPagerShell.h"
+#include "TypesFile.h"
+#include <vector>
+
+class RasterElement;
+
+class GainOffsetRasterPage : public RasterPage
+{
+public:
+   GainOffsetRasterPage(char* pBuffer, unsigned int offset, unsigned int rows, unsigned int columns,
+                        unsigned int bands);
+   void* getRawData();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getNumBands();
+   unsigned int getInterlineBytes();
+
+protected:
+   ~GainOffsetRasterPage();
+   friend class GainOffsetPager;
+
+private:
+   char* mpBuffer;
+   unsigned int mOffset;
+   unsigned int mRows;
+   unsigned int mColumns;
+   unsigned int mBands;
+};
+
+/**
+ * Pages the data of a virtual raster element by applying per-band gains and
+ * offsets to the data of a source element as it is read.
+ *
+ * Each output value is computed as source * gain + offset. The source element
+ * is never modified and no copy of the corrected cube is kept, so corrected
+ * data is available immediately regardless of the size of the source.
+ *
+ * The virtual element must have the same dimensions as the source and be of
+ * type FLT4BYTES or FLT8BYTES. It is read only.
+ */
+class GainOffsetPager : public RasterPagerShell
+{
+public:
+   GainOffsetPager();
+   ~GainOffsetPager();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList);
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                       DimensionDescriptor startColumn, DimensionDescriptor startBand);
+   void releasePage(RasterPage* pPage);
+   int getSupportedRequestVersion() const;
+
+   template<typename T>
+   void applyGainsOffsets(const T* pSource, char* pDestination, InterleaveFormatType interleave,
+      unsigned int band) const;
+
+private:
+   template<typename T, typename U>
+   void scaleRow(const T* pSource, U* pDestination, InterleaveFormatType interleave, unsigned int band) const;
+
+   RasterElement* mpElement;
+   RasterElement* mpSource;
+   std::vector<double> mGains;
+   std::vector<double> mOffsets;
+   bool mClipNegative;
+   InterleaveFormatType mInterleave;
+   EncodingType mDataType;
+   unsigned int mRows;
+   unsigned int mColumns;
+   unsigned int mBands;
+};
+
+#endif
@@ -14,7 +14,9 @@
 
 #include "AoiElement.h"
 #include "AppVerify.h"
+#include "BandMeanCalculator.h"
 #include "BitMask.h"
+#include "ConfigurationSettings.h"
 #include "DataRequest.h"
 #include "DesktopServices.h"
 #include "FileResource.h"
@@ -29,6 +31,7 @@
 #include "RasterUtilities.h"
 #include "SpatialDataView.h"
 #include "SpatialDataWindow.h"
+#include "SpectralUtilities.h"
 #include "SpectralVersion.h"
 #include "StringUtilities.h"
 #include "switchOnEncoding.h"
@@ -36,6 +39,7 @@
 #include "Undo.h"
 #include "Units.h"
 
+#include <algorithm>
 #include <fstream>
 #include <ostream>
 #include <string>
@@ -45,7 +49,35 @@ using namespace std;
 
 REGISTER_PLUGIN_BASIC(SpectralIarr, Iarr);
 
+namespace
+{
+   // BSQ and BIL rows hold the values of one band, so a single gain scales the whole row; BIP rows
+   // interleave the bands, so the gains are indexed by band within each pixel
+   template<class T, class U>
+   void scaleValues(const T* pSource, U* pDestination, unsigned int count, double gain)
+   {
+      for (unsigned int index = 0; index < count; ++index)
+      {
+         pDestination[index] = static_cast<U>(static_cast<double>(pSource[index]) * gain);
+      }
+   }
+
+   template<class T, class U>
+   void scalePixels(const T* pSource, U* pDestination, unsigned int numPixels, const double* pGains,
+      unsigned int numBands)
+   {
+      for (unsigned int pixel = 0; pixel < numPixels; ++pixel, pSource += numBands, pDestination += numBands)
+      {
+         for (unsigned int band = 0; band < numBands; ++band)
+         {
+            pDestination[band] = static_cast<U>(static_cast<double>(pSource[band]) * pGains[band]);
+         }
+      }
+   }
+}
+
 Iarr::Iarr() :
+   mAbortFlag(false),
    mpProgress(NULL),
    mpInputRasterElement(NULL),
    mpInputRasterLayer(NULL),
@@ -54,6 +86,7 @@ Iarr::Iarr() :
    mColumnStepFactor(1),
    mOutputDataType(FLT4BYTES),
    mInMemory(true),
+   mVirtualOutput(false),
    mDisplayResults(true),
    mExtension(".iarr")
 {
@@ -73,6 +106,12 @@ Iarr::~Iarr()
 {
 }
 
+bool Iarr::abort()
+{
+   mAbortFlag = true;
+   return AlgorithmShell::abort();
+}
+
 bool Iarr::runOperationalTests(Progress* pProgress, ostream& failure)
 {
    return runAllTests(pProgress, failure);
@@ -323,6 +362,8 @@ bool Iarr::getInputSpecification(PlugInArgList*& pArgList)
 
       VERIFY(pArgList->addArg<EncodingType>("Output Data Type", mOutputDataType));
       VERIFY(pArgList->addArg<bool>("In Memory", mInMemory));
+      VERIFY(pArgList->addArg<bool>("Virtual Output", mVirtualOutput, "If true, the output Raster Element "
+         "applies the gains to the input data as it is read instead of storing a corrected copy."));
 
       VERIFY(pArgList->addArg<bool>("Display Results", mDisplayResults));
       VERIFY(pArgList->addArg<Filename>("Output Filename"));
@@ -464,6 +505,7 @@ bool Iarr::extractAndValidateInputArguments(PlugInArgList* pInputArgList)
 
       VERIFY(pInputArgList->getPlugInArgValue<EncodingType>("Output Data Type", mOutputDataType) == true);
       VERIFY(pInputArgList->getPlugInArgValue<bool>("In Memory", mInMemory) == true);
+      VERIFY(pInputArgList->getPlugInArgValue<bool>("Virtual Output", mVirtualOutput) == true);
       VERIFY(pInputArgList->getPlugInArgValue<bool>("Display Results", mDisplayResults) == true);
 
       Filename* pOutputFilename = pInputArgList->getPlugInArgValue<Filename>("Output Filename");
@@ -508,6 +550,7 @@ bool Iarr::extractAndValidateInputArguments(PlugInArgList* pInputArgList)
 
       mOutputDataType = inputDialog.getOutputDataType();
       mInMemory = (inputDialog.getProcessingLocation() == IN_MEMORY);
+      mVirtualOutput = inputDialog.isVirtualOutput();
       mOutputFilename = inputDialog.getOutputFilename().toStdString();
       mDisplayResults = true;
    }
@@ -617,14 +660,20 @@ RasterElement* Iarr::runAlgorithm()
    StepResource pStep("Run " + getName() + " algorithm", "spectral", "906AD62E-00FC-4dcf-94A3-0D719020AF65");
    VERIFYRV(pStep.get() != NULL, NULL);
    ErrorLog errorLog(pStep.get(), mpProgress);
+   mAbortFlag = false;
 
    // Create a Raster Element for output
    // This work is done here so that if it fails the user is informed before actually running the algorithm
-   ModelResource<RasterElement> pOutputRasterElement(createOutputRasterElement());
-   if (pOutputRasterElement.get() == NULL)
+   // A virtual Raster Element needs the gains, so it is created after they are determined
+   ModelResource<RasterElement> pOutputRasterElement(static_cast<RasterElement*>(NULL));
+   if (mVirtualOutput == false)
    {
-      errorLog.setError("Unable to create a Raster Element.");
-      return NULL;
+      pOutputRasterElement = ModelResource<RasterElement>(createOutputRasterElement());
+      if (pOutputRasterElement.get() == NULL)
+      {
+         errorLog.setError("Unable to create a Raster Element.");
+         return NULL;
+      }
    }
 
    // Calculate (or load) gains
@@ -635,9 +684,19 @@ RasterElement* Iarr::runAlgorithm()
       return NULL;
    }
 
-   // Apply the gains to the RasterElement
-   if (applyGains(gains, pOutputRasterElement.get()) == false)
+   if (mVirtualOutput == true)
+   {
+      // The gains are applied by the Raster Element's pager whenever its data is read
+      pOutputRasterElement = ModelResource<RasterElement>(createOutputRasterElement(&gains));
+      if (pOutputRasterElement.get() == NULL)
+      {
+         errorLog.setError("Unable to create a virtual Raster Element.");
+         return NULL;
+      }
+   }
+   else if (applyGains(gains, pOutputRasterElement.get()) == false)
    {
+      // Apply the gains to the RasterElement
       errorLog.setError("Unable to apply gains.");
       return NULL;
    }
@@ -651,7 +710,7 @@ RasterElement* Iarr::runAlgorithm()
    return pOutputRasterElement.release();
 }
 
-RasterElement* Iarr::createOutputRasterElement()
+RasterElement* Iarr::createOutputRasterElement(const vector<double>* pVirtualGains)
 {
    StepResource pStep("Create output Raster Element", "spectral", "F10ED0BB-AE4D-4948-A9D9-7AF87543D2D6");
    VERIFYRV(pStep.get() != NULL, NULL);
@@ -661,9 +720,11 @@ RasterElement* Iarr::createOutputRasterElement()
 
    // If an IARR Raster Element already exists, make sure that the user wants to recreate it
    // In batch mode, do not prompt the user; simply destroy the Raster Element
+   // Both stored and virtual results are children of the input Raster Element
    Service<ModelServices> pModelServices;
    RasterElement* pExistingRasterElement = dynamic_cast<RasterElement*>
-      (pModelServices->getElement(outputRasterElementName, TypeConverter::toString<RasterElement>(), NULL));
+      (pModelServices->getElement(outputRasterElementName, TypeConverter::toString<RasterElement>(),
+      mpInputRasterElement));
    if (pExistingRasterElement != NULL)
    {
       const string message = "A Raster Element containing the " + getName() + " results already exists.\n"
@@ -692,8 +753,24 @@ RasterElement* Iarr::createOutputRasterElement()
    const unsigned int numColumns = pInputRasterDataDescriptor->getColumnCount();
 
    // Create a RasterElement to store the results of the calculation
-   RasterElement* pOutputRasterElement = RasterUtilities::createRasterElement(outputRasterElementName, numRows,
-      numColumns, numBands, mOutputDataType, pInputRasterDataDescriptor->getInterleaveFormat(), mInMemory);
+   RasterElement* pOutputRasterElement = NULL;
+   if (pVirtualGains != NULL)
+   {
+      pOutputRasterElement = SpectralUtilities::createGainOffsetElement(outputRasterElementName,
+         mpInputRasterElement, *pVirtualGains, vector<double>(), mOutputDataType, false);
+      if (pOutputRasterElement == NULL)
+      {
+         errorLog.setError("Unable to create a virtual Raster Element for " + getName() + " results.");
+         return NULL;
+      }
+   }
+   else
+   {
+      pOutputRasterElement = RasterUtilities::createRasterElement(outputRasterElementName, numRows,
+         numColumns, numBands, mOutputDataType, pInputRasterDataDescriptor->getInterleaveFormat(), mInMemory,
+         mpInputRasterElement);
+   }
+
    if (pOutputRasterElement == NULL)
    {
       // If creating a RasterElement fails in memory, try to create it on disk
@@ -701,7 +778,8 @@ RasterElement* Iarr::createOutputRasterElement()
       {
          mInMemory = false;
          pOutputRasterElement = RasterUtilities::createRasterElement(outputRasterElementName, numRows,
-            numColumns, numBands, mOutputDataType, pInputRasterDataDescriptor->getInterleaveFormat(), mInMemory);
+            numColumns, numBands, mOutputDataType, pInputRasterDataDescriptor->getInterleaveFormat(), mInMemory,
+            mpInputRasterElement);
       }
 
       if (pOutputRasterElement == NULL)
@@ -746,9 +824,6 @@ bool Iarr::determineGains(vector<double>& gains)
       dynamic_cast<RasterDataDescriptor*>(mpInputRasterElement->getDataDescriptor());
    VERIFY(pInputRasterDataDescriptor != NULL);
    const unsigned int numBands = pInputRasterDataDescriptor->getBandCount();
-   const unsigned int numRows = pInputRasterDataDescriptor->getRowCount();
-   const unsigned int numColumns = pInputRasterDataDescriptor->getColumnCount();
-   const EncodingType inputDataType = pInputRasterDataDescriptor->getDataType();
 
    gains.clear();
    if (mInputFilename.empty() == false)
@@ -793,77 +868,34 @@ bool Iarr::determineGains(vector<double>& gains)
          }
       }
 
-      // Set the maximum completion percentage to 99.9% so that mpProgress does not disappear between bands
-      const double calculateAverageStep = 99.9 / (numRows / mRowStepFactor);
-      for (unsigned int band = 0; band < numBands; ++band)
+      // Band means computed by a previous run over the same pixels are reused instead of reading the data again
+      BandMeanCalculator meanCalculator(mpInputRasterElement, pBitMask, mRowStepFactor, mColumnStepFactor);
+      if (meanCalculator.findCachedMeans() == true)
       {
-         // Build a name to identify this band
-         stringstream bandName;
-         bandName << "Band " << (band + 1) << "/" << (numBands);
-
-         // Obtain a DataAccessor for this band for pInputRasterElement
-         DimensionDescriptor activeBand = pInputRasterDataDescriptor->getActiveBand(band);
-         if (activeBand.isValid() == false)
-         {
-            errorLog.setError("Active Band is invalid for " + bandName.str() + ".");
-            return false;
-         }
-
-         FactoryResource<DataRequest> pRequest;
-         VERIFY(pRequest.get() != NULL);
-         pRequest->setBands(activeBand, activeBand);
-         DataAccessor daAccessor = mpInputRasterElement->getDataAccessor(pRequest.release());
-         if (daAccessor.isValid() == false)
-         {
-            errorLog.setError("Unable to obtain a Data Accessor for " + bandName.str() + ".");
-            return false;
-         }
-
-         double percent = 0.0;
-         double totalValue = 0.0;
-         unsigned int totalCounted = 0;
-         for (unsigned int row = 0; row < numRows && daAccessor.isValid(); row += mRowStepFactor)
+         pStep->addProperty("Band Means", "Reused from a previous run");
+      }
+      else
+      {
+         if (meanCalculator.compute(mpProgress, &mAbortFlag, "Calculating Gains (Step 1/2)") == false)
          {
-            // Update mpProgress
-            if (mpProgress != NULL)
-            {
-               percent += calculateAverageStep;
-               mpProgress->updateProgress(bandName.str() + ": Calculating Gain (Step 1/2)",
-                  static_cast<int>(percent), NORMAL);
-
-               // Check if the operation has been cancelled
-               if (isAborted() == true)
-               {
-                  errorLog.aborted();
-                  return false;
-               }
-            }
-
-            for (unsigned int column = 0; column < numColumns && daAccessor.isValid(); column += mColumnStepFactor)
+            if (mAbortFlag == true || isAborted() == true)
             {
-               if (pBitMask == NULL || pBitMask->getPixel(column, row) == true)
-               {
-                  daAccessor->toPixel(row, column);
-                  if (daAccessor.isValid() == false)
-                  {
-                     errorLog.setError("Unable to read from the Data Accessor for " + bandName.str() + ".");
-                     return false;
-                  }
-
-                  totalValue += Service<ModelServices>()->getDataValue(inputDataType, daAccessor->getColumn(), 0);
-                  ++totalCounted;
-               }
+               errorLog.aborted();
+               return false;
             }
-         }
 
-#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : Use \"fabs(totalValue / totalCounted)\"? (dadkins)")
-         if (totalCounted == 0)
-         {
             errorLog.setError("Unable to compute an average value.\nNo pixels within the image are selected.");
             return false;
          }
 
-         const double averageValue = totalValue / totalCounted;
+         meanCalculator.cacheMeans();
+      }
+
+#pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : Use \"fabs(averageValue)\" for the gain? (dadkins)")
+      const vector<double>& means = meanCalculator.getMeans();
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         const double averageValue = means[band];
          double gain = 1.0;
          if (averageValue != 0.0)
          {
@@ -907,9 +939,6 @@ bool Iarr::applyGains(const vector<double>& gains, RasterElement* pOutputRasterE
       dynamic_cast<RasterDataDescriptor*>(mpInputRasterElement->getDataDescriptor());
    VERIFY(pInputRasterDataDescriptor != NULL);
    const unsigned int numBands = pInputRasterDataDescriptor->getBandCount();
-   const unsigned int numRows = pInputRasterDataDescriptor->getRowCount();
-   const unsigned int numColumns = pInputRasterDataDescriptor->getColumnCount();
-   const EncodingType inputDataType = pInputRasterDataDescriptor->getDataType();
    if (gains.size() != numBands)
    {
       stringstream errorMessage;
@@ -922,94 +951,188 @@ bool Iarr::applyGains(const vector<double>& gains, RasterElement* pOutputRasterE
    RasterDataDescriptor* pOutputRasterDataDescriptor =
       dynamic_cast<RasterDataDescriptor*>(pOutputRasterElement->getDataDescriptor());
    VERIFY(pOutputRasterDataDescriptor != NULL);
+   VERIFY(pOutputRasterDataDescriptor->getInterleaveFormat() == pInputRasterDataDescriptor->getInterleaveFormat());
 
-   // Set the maximum completion percentage to 99.9% so that mpProgress does not disappear and reappear between bands
-   const double applyGainsStep = 99.9 / numRows;
-   Service<ModelServices> pModelServices;
+   // Display the gains in the message log
    for (unsigned int band = 0; band < numBands; ++band)
    {
-      // Build a name to identify this band
       stringstream bandName;
       bandName << "Band " << (band + 1) << "/" << (numBands);
 
-      // Display the gain in the message log
-      const double gain = gains[band];
       stringstream gainString;
       gainString.precision(17);
-      gainString << "Gain: " << gain;
+      gainString << "Gain: " << gains[band];
       pStep->addProperty(bandName.str(), gainString.str());
+   }
 
-      // Obtain a DataAccessor for this band for pInputRasterElement
-      const DimensionDescriptor inputBand = pInputRasterDataDescriptor->getActiveBand(band);
-      if (inputBand.isValid() == false)
-      {
-         errorLog.setError("Unable to obtain the active input band for " + bandName.str() + ".");
-         return false;
-      }
+   // Stream the cube once in its native interleave, applying every band gain as each row is read
+   const string message = "Applying Gains (Step 2/2)";
+   if (mpProgress != NULL)
+   {
+      mpProgress->updateProgress(message, 0, NORMAL);
+   }
 
+   IarrAlgInput iarrInput(mpInputRasterElement, pOutputRasterElement, gains, &mAbortFlag);
+   IarrAlgOutput iarrOutput;
+   mta::ProgressObjectReporter reporter(message, mpProgress);
+   mta::MultiThreadedAlgorithm<IarrAlgInput, IarrAlgOutput, IarrThread>
+      mtaIarr(Service<ConfigurationSettings>()->getSettingThreadCount(), iarrInput, iarrOutput, &reporter);
+   mtaIarr.run();
+
+   if (mAbortFlag == true || isAborted() == true)
+   {
+      errorLog.aborted();
+      return false;
+   }
+
+   if (iarrOutput.mSuccess == false)
+   {
+      errorLog.setError("Unable to apply the gains to the output Raster Element.");
+      return false;
+   }
+
+   pOutputRasterElement->updateData();
+   return true;
+}
+
+IarrThread::IarrThread(const IarrAlgInput& input,
+                       int threadCount,
+                       int threadIndex,
+                       mta::ThreadReporter& reporter) :
+   mta::AlgorithmThread(threadIndex, reporter),
+   mInput(input),
+   mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
+      input.mpInput->getDataDescriptor())->getRowCount())),
+   mSuccess(false)
+{
+}
+
+void IarrThread::run()
+{
+   EncodingType encoding = static_cast<const RasterDataDescriptor*>(mInput.mpInput->getDataDescriptor())->getDataType();
+   switchOnEncoding(encoding, IarrThread::applyGains, NULL);
+}
+
+bool IarrThread::isSuccessful() const
+{
+   return mSuccess;
+}
+
+template<class T>
+void IarrThread::applyGains(const T* pDummyData)
+{
+   const RasterDataDescriptor* pOutputDescriptor =
+      static_cast<const RasterDataDescriptor*>(mInput.mpOutput->getDataDescriptor());
+   switch (pOutputDescriptor->getDataType())
+   {
+   case FLT4BYTES:
+      applyGains(pDummyData, static_cast<const float*>(NULL));
+      break;
+
+   case FLT8BYTES:
+      applyGains(pDummyData, static_cast<const double*>(NULL));
+      break;
+
+   default:
+      break;
+   }
+}
+
+template<class T, class U>
+void IarrThread::applyGains(const T* pDummyData, const U* pDummyOutput)
+{
+   const RasterDataDescriptor* pInputDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mInput.mpInput->getDataDescriptor());
+   const RasterDataDescriptor* pOutputDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(mInput.mpOutput->getDataDescriptor());
+   VERIFYNRV(pInputDescriptor != NULL && pOutputDescriptor != NULL);
+
+   const unsigned int numBands = pInputDescriptor->getBandCount();
+   const unsigned int numColumns = pInputDescriptor->getColumnCount();
+   const InterleaveFormatType interleave = pInputDescriptor->getInterleaveFormat();
+   VERIFYNRV(mInput.mGains.size() == numBands);
+   const double* pGains = &mInput.mGains.front();
+
+   mRowRange.mFirst = std::max(0, mRowRange.mFirst);
+   mRowRange.mLast = std::min(mRowRange.mLast, static_cast<int>(pInputDescriptor->getRowCount()) - 1);
+   if (mRowRange.mFirst > mRowRange.mLast)
+   {
+      mSuccess = true;
+      return;
+   }
+
+   // BIP and BIL rows hold every band, so one pass covers the whole tile;
+   // BSQ bands are stored one after another, so they are read in sequence
+   const unsigned int numPasses = (interleave == BSQ ? numBands : 1);
+   const int numTileRows = mRowRange.mLast - mRowRange.mFirst + 1;
+   int oldPercentDone = -1;
+   for (unsigned int pass = 0; pass < numPasses; ++pass)
+   {
       FactoryResource<DataRequest> pSourceRequest;
-      VERIFYRV(pSourceRequest.get() != NULL, NULL);
-      pSourceRequest->setBands(inputBand, inputBand);
-      DataAccessor sourceAccessor = mpInputRasterElement->getDataAccessor(pSourceRequest.release());
-      if (sourceAccessor.isValid() == false)
+      pSourceRequest->setRows(pInputDescriptor->getActiveRow(mRowRange.mFirst),
+         pInputDescriptor->getActiveRow(mRowRange.mLast));
+      FactoryResource<DataRequest> pDestinationRequest;
+      pDestinationRequest->setRows(pOutputDescriptor->getActiveRow(mRowRange.mFirst),
+         pOutputDescriptor->getActiveRow(mRowRange.mLast));
+      pDestinationRequest->setWritable(true);
+      if (interleave == BSQ)
       {
-         errorLog.setError("Unable to obtain a source Data Accessor for " + bandName.str() + ".");
-         return false;
+         pSourceRequest->setBands(pInputDescriptor->getActiveBand(pass), pInputDescriptor->getActiveBand(pass));
+         pDestinationRequest->setBands(pOutputDescriptor->getActiveBand(pass),
+            pOutputDescriptor->getActiveBand(pass));
       }
 
-      // Obtain a writable DataAccessor for this band for pOutputRasterElement
-      const DimensionDescriptor outputBand = pOutputRasterDataDescriptor->getActiveBand(band);
-      if (outputBand.isValid() == false)
+      DataAccessor sourceAccessor = mInput.mpInput->getDataAccessor(pSourceRequest.release());
+      DataAccessor destinationAccessor = mInput.mpOutput->getDataAccessor(pDestinationRequest.release());
+      if (sourceAccessor.isValid() == false || destinationAccessor.isValid() == false)
       {
-         errorLog.setError("Unable to obtain the active output band for " + bandName.str() + ".");
-         return false;
+         return;
       }
 
-      FactoryResource<DataRequest> pDestinationRequest;
-      VERIFYRV(pDestinationRequest.get() != NULL, NULL);
-      pDestinationRequest->setWritable(true);
-      pDestinationRequest->setBands(outputBand, outputBand);
-      DataAccessor destinationAccessor = pOutputRasterElement->getDataAccessor(pDestinationRequest.release());
-      if (destinationAccessor.isValid() == false)
+      for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
       {
-         errorLog.setError("Unable to obtain a writable destination Data Accessor for " + bandName.str() + ".");
-         return false;
-      }
+         int percentDone = static_cast<int>(100.0 * (pass * numTileRows + row - mRowRange.mFirst) /
+            (numPasses * numTileRows));
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
 
-      // Apply the gain for this band to each pixel
-      double percent = 0.0;
-      for (unsigned int row = 0;
-         row < numRows && sourceAccessor.isValid() == true && destinationAccessor.isValid() == true;
-         ++row, sourceAccessor->nextRow(), destinationAccessor->nextRow())
-      {
-         // Update mpProgress
-         if (mpProgress != NULL)
+         if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+         {
+            return;
+         }
+
+         VERIFYNRV(sourceAccessor.isValid() && destinationAccessor.isValid());
+         const T* pSource = reinterpret_cast<const T*>(sourceAccessor->getRow());
+         U* pDestination = reinterpret_cast<U*>(destinationAccessor->getRow());
+
+         switch (interleave)
          {
-            percent += applyGainsStep;
-            mpProgress->updateProgress(bandName.str() + ": Applying Gain (Step 2/2)",
-               static_cast<int>(percent), NORMAL);
+         case BIP:
+            scalePixels(pSource, pDestination, numColumns, pGains, numBands);
+            break;
 
-            // Check if the operation has been cancelled
-            if (isAborted() == true)
+         case BIL:
+            for (unsigned int band = 0; band < numBands; ++band)
             {
-               errorLog.aborted();
-               return false;
+               scaleValues(pSource + band * numColumns, pDestination + band * numColumns, numColumns, pGains[band]);
             }
-         }
+            break;
 
-         for (unsigned int column = 0;
-            column < numColumns && sourceAccessor.isValid() == true && destinationAccessor.isValid() == true;
-            ++column, sourceAccessor->nextColumn(), destinationAccessor->nextColumn())
-         {
-            // Copy the value from pInputRasterElement to mpOutputRasterElement, scaling appropriately
-            const double sourceData = pModelServices->getDataValue(inputDataType, sourceAccessor->getColumn(), 0);
-            switchOnEncoding(mOutputDataType, writeData, destinationAccessor->getColumn(), sourceData * gain);
+         default:
+            scaleValues(pSource, pDestination, numColumns, pGains[pass]);
+            break;
          }
+
+         sourceAccessor->nextRow();
+         destinationAccessor->nextRow();
       }
    }
 
-   pOutputRasterElement->updateData();
-   return true;
+   getReporter().reportProgress(getThreadIndex(), 100);
+   mSuccess = true;
 }
 
 Iarr::ErrorLog::ErrorLog(Step* pStep, Progress* pProgress) :
@@ -14,6 +14,7 @@
 #include "DataAccessorImpl.h"
 #include "DataRequest.h"
 #include "MessageLogResource.h"
+#include "MultiThreadedAlgorithm.h"
 #include "RasterElement.h"
 #include "Statistics.h"
 #include "Testable.h"
@@ -32,6 +33,73 @@ class SpatialDataWindow;
 #include <string>
 #include <vector>
 
+struct IarrAlgInput
+{
+   IarrAlgInput(const RasterElement* pInput,
+      RasterElement* pOutput,
+      const std::vector<double>& gains,
+      const bool* pAbortFlag) :
+         mpInput(pInput),
+         mpOutput(pOutput),
+         mGains(gains),
+         mpAbortFlag(pAbortFlag)
+   {
+   }
+
+   const RasterElement* mpInput;
+   RasterElement* mpOutput;
+   const std::vector<double>& mGains;
+   const bool* mpAbortFlag;
+};
+
+/**
+ * Applies the IARR gains to one tile of rows.
+ *
+ * The input and output cubes are read and written in their native interleave
+ * so each row of the input is read exactly once, regardless of the number of bands.
+ */
+class IarrThread : public mta::AlgorithmThread
+{
+public:
+   IarrThread(const IarrAlgInput& input,
+      int threadCount,
+      int threadIndex,
+      mta::ThreadReporter& reporter);
+
+   void run();
+   bool isSuccessful() const;
+
+   template<class T> void applyGains(const T* pDummyData);
+
+private:
+   template<class T, class U> void applyGains(const T* pDummyData, const U* pDummyOutput);
+
+   const IarrAlgInput& mInput;
+   mta::AlgorithmThread::Range mRowRange;
+   bool mSuccess;
+};
+
+struct IarrAlgOutput
+{
+   IarrAlgOutput() : mSuccess(false) {}
+
+   bool compileOverallResults(const std::vector<IarrThread*>& threads)
+   {
+      mSuccess = true;
+      for (std::vector<IarrThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+      {
+         if (*iter == NULL || (*iter)->isSuccessful() == false)
+         {
+            mSuccess = false;
+         }
+      }
+
+      return mSuccess;
+   }
+
+   bool mSuccess;
+};
+
 class Iarr : public AlgorithmShell, public Testable
 {
 public:
@@ -45,8 +113,10 @@ public:
    bool getOutputSpecification(PlugInArgList*& pArgList);
 
    bool execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList);
+   bool abort();
 
 private:
+   bool mAbortFlag;
    Progress* mpProgress;
    RasterElement* mpInputRasterElement;
    RasterLayer* mpInputRasterLayer;
@@ -58,6 +128,7 @@ private:
 
    EncodingType mOutputDataType;
    bool mInMemory;
+   bool mVirtualOutput;
    bool mDisplayResults;
    std::string mOutputFilename;
 
@@ -66,13 +137,10 @@ private:
    bool extractAndValidateInputArguments(PlugInArgList* pInputArgList);
    SpatialDataWindow* createWindow(const std::string& windowName);
    RasterElement* runAlgorithm();
-   RasterElement* createOutputRasterElement();
+   RasterElement* createOutputRasterElement(const std::vector<double>* pVirtualGains = NULL);
    bool determineGains(std::vector<double>& gains);
    bool applyGains(const std::vector<double>& gains, RasterElement* pOutputRasterElement);
 
-   template <typename T>
-   void writeData(T* pDestination, double value);
-
    template<typename T>
    bool runTest(unsigned int numRows, unsigned int numColumns,
       unsigned int numBands, EncodingType inputDataType, const T* pData, std::ostream& failure);
@@ -94,15 +162,6 @@ private:
    };
 };
 
-template <typename T>
-void Iarr::writeData(T* pDestination, double value)
-{
-   if (pDestination != NULL)
-   {
-      *pDestination = static_cast<T>(value);
-   }
-}
-
 template<typename T>
 bool Iarr::runTest(unsigned int numRows, unsigned int numColumns,
    unsigned int numBands, EncodingType inputDataType, const T* pData, std::ostream& failure)
@@ -129,6 +188,7 @@ bool Iarr::runTest(unsigned int numRows, unsigned int numColumns,
 
    mOutputDataType = FLT8BYTES;
    mInMemory = true;
+   mVirtualOutput = false;
 
    for (mRowStepFactor = 1; mRowStepFactor < numRows; ++mRowStepFactor)
    {
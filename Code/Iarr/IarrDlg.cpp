@@ -173,6 +173,11 @@ IarrDlg::IarrDlg(const string& defaultFilename, const vector<string>& aoiNames,
       mpProcessingLocationCombo->addItem(QString::fromStdString(StringUtilities::toDisplayString(IN_MEMORY)));
    }
 
+   // The virtual option applies the gains as the data is read instead of creating a corrected copy
+   mpProcessingLocationCombo->addItem(getVirtualLocationText());
+   mpProcessingLocationCombo->setToolTip("Select \"" + getVirtualLocationText() + "\" to apply the gains as the "
+      "data is read\ninstead of creating a corrected copy of the data set.");
+
    // Set the default name of the output file
    mpOutputFileBrowser->setFilename(QString::fromStdString(defaultFilename));
 
@@ -248,6 +253,16 @@ ProcessingLocation IarrDlg::getProcessingLocation() const
       mpProcessingLocationCombo->currentText().toStdString());
 }
 
+bool IarrDlg::isVirtualOutput() const
+{
+   return mpProcessingLocationCombo->currentText() == getVirtualLocationText();
+}
+
+QString IarrDlg::getVirtualLocationText()
+{
+   return "Virtual (Computed On Read)";
+}
+
 QString IarrDlg::getOutputFilename() const
 {
    if (mpOutputFileBrowser->isEnabled() == true)
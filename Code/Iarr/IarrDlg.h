@@ -37,12 +37,15 @@ public:
    unsigned int getColumnStepFactor() const;
    EncodingType getOutputDataType() const;
    ProcessingLocation getProcessingLocation() const;
+   bool isVirtualOutput() const;
    QString getOutputFilename() const;
 
 public slots:
    void accept();
 
 private:
+   static QString getVirtualLocationText();
+
    QRadioButton* mpInputFileRadio;
    FileBrowser* mpInputFileBrowser;
 
@@ -0,0 +1,71 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BATCHRESAMPLER_H
+#define BATCHRESAMPLER_H
+
+#include <string>
+#include <vector>
+
+class Progress;
+
+/**
+ * Resamples many spectra which share the same wavelengths in one call.
+ *
+ * The Resampler plug-in implements this interface in addition to Resampler.
+ * Obtain it the same way:
+ * @code
+ * PlugInResource resampler("Resampler");
+ * BatchResampler* pResampler = dynamic_cast<BatchResampler*>(resampler.get());
+ * @endcode
+ *
+ * The resampling weights are computed once for all of the spectra and the
+ * spectra are resampled in parallel, so this is much faster than calling
+ * Resampler::execute() for each spectrum of a large library.
+ */
+class BatchResampler
+{
+public:
+   /**
+    * Resamples a set of spectra from one set of wavelengths to another.
+    *
+    * @param fromData
+    *        The spectra to resample, one after another. Each spectrum contains one value
+    *        for each of fromWavelengths, so the size must be a multiple of that count.
+    * @param toData
+    *        Receives the resampled spectra, one after another. Each contains one value
+    *        for each of toBands.
+    * @param fromWavelengths
+    *        The wavelengths of each spectrum in fromData.
+    * @param toWavelengths
+    *        The wavelengths to resample to.
+    * @param toFwhm
+    *        The full width at half maximum of each of toWavelengths. This may be empty.
+    * @param toBands
+    *        Receives the indices of the target bands which could be resampled. These are
+    *        the same for all of the spectra.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    * @param resamplerMethod
+    *        One of the ResamplerOptions methods. If empty, the user's default method is used.
+    * @param pProgress
+    *        Optional progress object updated while the spectra are resampled.
+    *
+    * @return False if the spectra could not be resampled, true otherwise.
+    */
+   virtual bool executeBatch(const std::vector<double>& fromData, std::vector<double>& toData,
+      const std::vector<double>& fromWavelengths, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, std::vector<int>& toBands, std::string& errorMessage,
+      const std::string& resamplerMethod, Progress* pProgress) = 0;
+
+protected:
+   virtual ~BatchResampler() {}
+};
+
+#endif
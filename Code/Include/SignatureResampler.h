@@ -0,0 +1,94 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef SIGNATURERESAMPLER_H
+#define SIGNATURERESAMPLER_H
+
+#include <string>
+#include <vector>
+
+class Progress;
+class Signature;
+class SignatureSet;
+
+/**
+ * Resamples the reflectance of a signature to a set of wavelengths.
+ *
+ * The Resampler plug-in implements this interface in addition to Resampler.
+ * Obtain it the same way:
+ * @code
+ * PlugInResource resampler("Resampler");
+ * SignatureResampler* pResampler = dynamic_cast<SignatureResampler*>(resampler.get());
+ * @endcode
+ *
+ * Results are kept for the session, so resampling the same signature to the same
+ * wavelengths again only copies the previous results. Stored results are discarded
+ * when the signature is modified.
+ *
+ * The first time a signature of a spectral library is resampled to a set of wavelengths,
+ * the whole library is resampled with resampleLibrary(). If the library was loaded from
+ * a file, the results are also saved to a file next to it, so the library is only
+ * resampled once for each sensor rather than once for each session.
+ */
+class SignatureResampler
+{
+public:
+   /**
+    * Resamples the "Reflectance" data of a signature from its "Wavelength" data using
+    * the Resampler options.
+    *
+    * @param pSignature
+    *        The signature to resample.
+    * @param toWavelengths
+    *        The wavelengths to resample to.
+    * @param toFwhm
+    *        The full width at half maximum of each of toWavelengths. This may be empty.
+    * @param toData
+    *        Receives the resampled values, one for each of toBands.
+    * @param toBands
+    *        Receives the indices of the target bands which could be resampled.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    *
+    * @return False if the signature could not be resampled, true otherwise.
+    */
+   virtual bool resampleSignature(Signature* pSignature, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, std::vector<double>& toData, std::vector<int>& toBands,
+      std::string& errorMessage) = 0;
+
+   /**
+    * Resamples all of the signatures in a spectral library and its nested libraries, so
+    * later calls to resampleSignature() for them only copy the results.
+    *
+    * Signatures sharing the same wavelengths are resampled together. If the library has
+    * a filename, the results for each set of target wavelengths are read from and saved
+    * to a file named after the library file and a hash of the wavelengths. Signatures
+    * which do not contain wavelength and reflectance data are skipped.
+    *
+    * @param pLibrary
+    *        The library to resample.
+    * @param toWavelengths
+    *        The wavelengths to resample to.
+    * @param toFwhm
+    *        The full width at half maximum of each of toWavelengths. This may be empty.
+    * @param pProgress
+    *        Optional progress object updated while the signatures are resampled.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    *
+    * @return False if the signatures could not be resampled, true otherwise.
+    */
+   virtual bool resampleLibrary(SignatureSet* pLibrary, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, Progress* pProgress, std::string& errorMessage) = 0;
+
+protected:
+   virtual ~SignatureResampler() {}
+};
+
+#endif
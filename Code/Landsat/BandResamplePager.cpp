@@ -10,29 +10,163 @@
 #include "AppAssert.h"
 #include "AppVerify.h"
 #include "BandResamplePager.h"
-#include "DataAccessor.h"
-#include "DataAccessorImpl.h"
 #include "DataRequest.h"
+#include "Endian.h"
 #include "Filename.h"
-#include "ImportDescriptor.h"
-#include "ObjectResource.h"
 #include "PlugInArgList.h"
 #include "PlugInManagerServices.h"
 #include "PlugInRegistration.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 #include "RasterFileDescriptor.h"
-#include "RasterUtilities.h"
 #include "SpectralVersion.h"
 
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
 using namespace std;
 
 REGISTER_PLUGIN_BASIC(SpectralLandsat, BandResamplePager);
 
+namespace
+{
+   // Tiles of about this size are upsampled at a time
+   const unsigned int sTileBytes = 4 * 1024 * 1024;
+   const unsigned int sMaxCachedTiles = 8;
+
+   /**
+    * Replicates each pixel of a source row across columnStep columns of a destination row.
+    */
+   template<class T>
+   void replicateColumns(const char* pSrcRow, char* pDstRow, unsigned int dstColumns, unsigned int columnStep)
+   {
+      const T* pSrc = reinterpret_cast<const T*>(pSrcRow);
+      T* pDst = reinterpret_cast<T*>(pDstRow);
+      for (unsigned int dstColumn = 0; dstColumn < dstColumns; dstColumn += columnStep)
+      {
+         fill_n(pDst + dstColumn, min(columnStep, dstColumns - dstColumn), *pSrc++);
+      }
+   }
+
+   void replicateColumns(const char* pSrcRow, char* pDstRow, unsigned int dstColumns, unsigned int columnStep,
+      unsigned int elementSize)
+   {
+      switch (elementSize)
+      {
+      case 1:
+         replicateColumns<unsigned char>(pSrcRow, pDstRow, dstColumns, columnStep);
+         break;
+      case 2:
+         replicateColumns<unsigned short>(pSrcRow, pDstRow, dstColumns, columnStep);
+         break;
+      case 4:
+         replicateColumns<unsigned int>(pSrcRow, pDstRow, dstColumns, columnStep);
+         break;
+      default:
+         for (unsigned int dstColumn = 0; dstColumn < dstColumns; ++dstColumn)
+         {
+            memcpy(pDstRow + dstColumn * elementSize, pSrcRow + (dstColumn / columnStep) * elementSize,
+               elementSize);
+         }
+         break;
+      }
+   }
+
+   // Keys' cubic convolution kernel with a = -0.5
+   double cubicConvolution(double x)
+   {
+      x = fabs(x);
+      if (x < 1.0)
+      {
+         return (1.5 * x - 2.5) * x * x + 1.0;
+      }
+
+      if (x < 2.0)
+      {
+         return ((-0.5 * x + 2.5) * x - 4.0) * x + 2.0;
+      }
+
+      return 0.0;
+   }
+
+   template<class T>
+   T toElement(double value)
+   {
+      if (numeric_limits<T>::is_integer)
+      {
+         value = floor(value + 0.5);
+         value = max(value, static_cast<double>(numeric_limits<T>::min()));
+         value = min(value, static_cast<double>(numeric_limits<T>::max()));
+      }
+
+      return static_cast<T>(value);
+   }
+
+   /**
+    * Interpolates rows of a tile from the band rows which have been read.
+    *
+    * The band rows behind each output row are summed first, so each band row is weighted once per output
+    * row rather than once per output value, and the column pass reads only one summed row.
+    */
+   template<class T>
+   void interpolateTypedRows(const char* pSrcRows, size_t srcRowStride, unsigned int numSrcRows,
+      unsigned int firstSrcRow, unsigned int srcColumns, const vector<unsigned int>& rowIndices,
+      const vector<double>& rowWeights, const vector<unsigned int>& columnIndices, const vector<double>& columnWeights,
+      unsigned int taps, char* pDstRows, unsigned int dstRows, unsigned int dstColumns)
+   {
+      // The band rows may not be aligned in the file so they are copied element by element
+      vector<double> source(numSrcRows * srcColumns);
+      for (unsigned int srcRow = 0; srcRow < numSrcRows; ++srcRow)
+      {
+         const char* pSrcRow = pSrcRows + srcRow * srcRowStride;
+         double* pSource = &source[srcRow * srcColumns];
+         for (unsigned int srcColumn = 0; srcColumn < srcColumns; ++srcColumn)
+         {
+            T value;
+            memcpy(&value, pSrcRow + srcColumn * sizeof(T), sizeof(T));
+            pSource[srcColumn] = static_cast<double>(value);
+         }
+      }
+
+      vector<double> rowSum(srcColumns);
+      T* pDst = reinterpret_cast<T*>(pDstRows);
+      for (unsigned int dstRow = 0; dstRow < dstRows; ++dstRow)
+      {
+         fill(rowSum.begin(), rowSum.end(), 0.0);
+         for (unsigned int tap = 0; tap < taps; ++tap)
+         {
+            const double weight = rowWeights[dstRow * taps + tap];
+            const double* pSource = &source[(rowIndices[dstRow * taps + tap] - firstSrcRow) * srcColumns];
+            for (unsigned int srcColumn = 0; srcColumn < srcColumns; ++srcColumn)
+            {
+               rowSum[srcColumn] += weight * pSource[srcColumn];
+            }
+         }
+
+         const unsigned int* pIndices = &columnIndices.front();
+         const double* pWeights = &columnWeights.front();
+         for (unsigned int dstColumn = 0; dstColumn < dstColumns; ++dstColumn)
+         {
+            double value = 0.0;
+            for (unsigned int tap = 0; tap < taps; ++tap)
+            {
+               value += *pWeights++ * rowSum[*pIndices++];
+            }
+
+            *pDst++ = toElement<T>(value);
+         }
+      }
+   }
+}
+
 BandResampleRasterPage::BandResampleRasterPage(void* pData,
+                                               unsigned int row,
+                                               unsigned int column,
                                                unsigned int rows,
                                                unsigned int columns):
-         mpData(pData), mRows(rows), mColumns(columns)
+         mpData(pData), mRow(row), mColumn(column), mRows(rows), mColumns(columns)
 {
 }
 
@@ -66,7 +200,7 @@ unsigned int BandResampleRasterPage::getInterlineBytes()
 }
 
 BandResamplePager::BandResamplePager() : mpElement(NULL), mpFileDescriptor(NULL),
-                                         mpMemoryMappedPager(NULL), mpRemapData(NULL)
+                                         mpMemoryMappedPager(NULL), mRowStep(1), mColumnStep(1), mTaps(0)
 {
    setName("BandResamplePager");
    setCopyright(SPECTRAL_COPYRIGHT);
@@ -80,7 +214,6 @@ BandResamplePager::BandResamplePager() : mpElement(NULL), mpFileDescriptor(NULL)
 
 BandResamplePager::~BandResamplePager()
 {
-   delete mpRemapData;
 }
 
 bool BandResamplePager::getInputSpecification(PlugInArgList*& pArgList)
@@ -93,6 +226,9 @@ bool BandResamplePager::getInputSpecification(PlugInArgList*& pArgList)
    VERIFY(pArgList->addArg<unsigned int>("Band", "Original band number which needs resampling."));
    VERIFY(pArgList->addArg<unsigned int>("Rows", "Number of rows in the band to resample."));
    VERIFY(pArgList->addArg<unsigned int>("Columns", "Number of columns in the band to resample."));
+   VERIFY(pArgList->addArg<string>("Interpolation", NearestNeighborInterpolation(), "The method used to "
+      "upsample the band: \"" + NearestNeighborInterpolation() + "\", \"" + BilinearInterpolation() + "\" or \"" +
+      CubicConvolutionInterpolation() + "\"."));
    return true;
 }
 
@@ -117,6 +253,31 @@ bool BandResamplePager::execute(PlugInArgList* pInputArgList, PlugInArgList* pOu
    VERIFY(pInputArgList->getPlugInArgValue<unsigned int>("Band", mBand));
    VERIFY(pInputArgList->getPlugInArgValue<unsigned int>("Rows", mRows));
    VERIFY(pInputArgList->getPlugInArgValue<unsigned int>("Columns", mColumns));
+   VERIFY(mRows > 0 && mColumns > 0);
+
+   // Each pixel of the band is replicated over a block of rowStep by columnStep pixels
+   const RasterDataDescriptor* pRasterDescriptor = static_cast<RasterDataDescriptor*>(pDescriptor);
+   mRowStep = pRasterDescriptor->getRowCount() / mRows + (pRasterDescriptor->getRowCount() % mRows == 0 ? 0 : 1);
+   mColumnStep = pRasterDescriptor->getColumnCount() / mColumns +
+      (pRasterDescriptor->getColumnCount() % mColumns == 0 ? 0 : 1);
+   mTiles.clear();
+
+   string interpolation = NearestNeighborInterpolation();
+   pInputArgList->getPlugInArgValue<string>("Interpolation", interpolation);
+   VERIFY(getInterpolationTaps(interpolation, mTaps));
+
+   // Complex data is always replicated
+   const EncodingType dataType = pRasterDescriptor->getDataType();
+   if (dataType == INT4SCOMPLEX || dataType == FLT8COMPLEX)
+   {
+      mTaps = 0;
+   }
+
+   if (mTaps > 0)
+   {
+      computeWeights(0, pRasterDescriptor->getColumnCount(), mColumns, mColumnStep, mTaps, mColumnIndices,
+         mColumnWeights);
+   }
 
    mMemoryMappedPagerPlugin = ExecutableResource("MemoryMappedPager");
    mMemoryMappedPagerPlugin->getInArgList().setPlugInArgValue("Raster Element", mpElement);
@@ -139,71 +300,29 @@ RasterPage* BandResamplePager::getPage(DataRequest* pOriginalRequest,
 {
    VERIFYRV(pOriginalRequest != NULL && mpMemoryMappedPager != NULL, NULL);
    VERIFYRV(pOriginalRequest->getConcurrentBands() == 1, NULL);
-   RasterPage* pPage = NULL;
-   if (startBand.getOriginalNumber() == mBand)
+   if (startBand.getOriginalNumber() != mBand)
    {
-      RasterDataDescriptor* pDstDescriptor = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
-      unsigned int elementSize = pDstDescriptor->getBytesPerElement();
-      unsigned int dstRowSize = pDstDescriptor->getColumnCount() * elementSize;
-      if (mpRemapData == NULL)
-      {
-         // load the data with generic
-         ImporterResource remapImporter("Generic Importer", mpFileDescriptor->getBandFiles()[startBand.getOnDiskNumber()]->getFullPathAndName());
-         RasterDataDescriptor* pSrcDescriptor = static_cast<RasterDataDescriptor*>(
-            remapImporter->getImportDescriptors().front()->getDataDescriptor());
-         pSrcDescriptor->setProcessingLocation(ON_DISK_READ_ONLY);
-         RasterFileDescriptor* pSrcFileDescriptor = static_cast<RasterFileDescriptor*>(pSrcDescriptor->getFileDescriptor());
-         pSrcFileDescriptor->setEndian(mpFileDescriptor->getEndian());
-         pSrcFileDescriptor->setBitsPerElement(mpFileDescriptor->getBitsPerElement());
-         pSrcFileDescriptor->setRows(RasterUtilities::generateDimensionVector(mRows, true, true, true));
-         pSrcFileDescriptor->setColumns(RasterUtilities::generateDimensionVector(mColumns, true, true, true));
-         pSrcFileDescriptor->setBands(RasterUtilities::generateDimensionVector(1, true, true, true));
-         pSrcFileDescriptor->setPostlineBytes(mpFileDescriptor->getPostlineBytes());
-         pSrcFileDescriptor->setPrelineBytes(mpFileDescriptor->getPrelineBytes());
-         pSrcDescriptor->setDataType(pDstDescriptor->getDataType());
-         pSrcDescriptor->setRows(pSrcFileDescriptor->getRows());
-         pSrcDescriptor->setColumns(pSrcFileDescriptor->getColumns());
-         pSrcDescriptor->setBands(pSrcFileDescriptor->getBands());
-         if (remapImporter->execute())
-         {
-            ModelResource<RasterElement> pSrcElement(static_cast<RasterElement*>(remapImporter->getImportedElements().front()));
-            FactoryResource<DataRequest> pSrcRequest;
-            DataAccessor pSrcAccessor = pSrcElement->getDataAccessor(pSrcRequest.release());
-            unsigned int srcRowSize = pSrcDescriptor->getColumnCount() * elementSize;
-            unsigned int columnStep = pDstDescriptor->getColumnCount() / mColumns + (pDstDescriptor->getColumnCount() % mColumns == 0 ? 0 : 1);
-            unsigned int rowStep = pDstDescriptor->getRowCount() / mRows + (pDstDescriptor->getRowCount() % mRows == 0 ? 0 : 1);
-            unsigned int dstRow = 0, dstColumn = 0;
-            mpRemapData = new char[pDstDescriptor->getRowCount() * dstRowSize];
-            for (; pSrcAccessor.isValid(); pSrcAccessor->nextRow())
-            {
-               for (unsigned int srcColumn = 0; pSrcAccessor.isValid() && srcColumn < pSrcDescriptor->getColumnCount(); srcColumn++)
-               {
-                  char* pSrcLocation = reinterpret_cast<char*>(pSrcAccessor->getColumn());
-                  for (unsigned int step = 0; step < columnStep && dstColumn < pDstDescriptor->getColumnCount(); step++)
-                  {
-                     char* pDstLocation = mpRemapData + (dstRow * dstRowSize + dstColumn++ * elementSize);
-                     memcpy(pDstLocation, pSrcLocation, elementSize);
-                  }
-                  pSrcAccessor->nextColumn();
-               }
-               dstColumn = 0;
-               char* pDstSrcLocation = mpRemapData + dstRow * dstRowSize;
-               for (unsigned int step = 0; step < rowStep && dstRow < pDstDescriptor->getRowCount()-1; step++)
-               {
-                  char* pDstLocation = mpRemapData + ++dstRow * dstRowSize;
-                  memcpy(pDstLocation, pDstSrcLocation, dstRowSize);
-               }
-            }
-         }
-      }
-      unsigned int offset = startRow.getOnDiskNumber() * dstRowSize + startColumn.getOnDiskNumber() * elementSize;
-      pPage = new BandResampleRasterPage(mpRemapData + offset, pDstDescriptor->getRowCount(), pDstDescriptor->getColumnCount());
+      return mpMemoryMappedPager->getPage(pOriginalRequest, startRow, startColumn, startBand);
    }
-   else
+
+   const RasterDataDescriptor* pDstDescriptor = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   const unsigned int elementSize = pDstDescriptor->getBytesPerElement();
+   const unsigned int dstRowSize = pDstDescriptor->getColumnCount() * elementSize;
+   const unsigned int row = startRow.getOnDiskNumber();
+   const unsigned int column = startColumn.getOnDiskNumber();
+   VERIFYRV(row < pDstDescriptor->getRowCount() && column < pDstDescriptor->getColumnCount(), NULL);
+
+   QMutexLocker lock(&mTileMutex);
+   Tile* pTile = getTile(row, max(pOriginalRequest->getConcurrentRows(), 1U), startBand.getOnDiskNumber());
+   if (pTile == NULL)
    {
-      pPage = mpMemoryMappedPager->getPage(pOriginalRequest, startRow, startColumn, startBand);
+      return NULL;
    }
-   return pPage;
+
+   ++pTile->mReferences;
+   char* pData = &pTile->mData.front() + (row - pTile->mStartRow) * dstRowSize + column * elementSize;
+   return new BandResampleRasterPage(pData, row, column, pTile->mStartRow + pTile->mRows - row,
+      pDstDescriptor->getColumnCount());
 }
 
 void BandResamplePager::releasePage(RasterPage* pPage)
@@ -212,6 +331,20 @@ void BandResamplePager::releasePage(RasterPage* pPage)
    BandResampleRasterPage* pTmpPage = dynamic_cast<BandResampleRasterPage*>(pPage);
    if (pTmpPage != NULL)
    {
+      QMutexLocker lock(&mTileMutex);
+      for (list<Tile>::iterator iter = mTiles.begin(); iter != mTiles.end(); ++iter)
+      {
+         if (pTmpPage->mRow >= iter->mStartRow && pTmpPage->mRow < iter->mStartRow + iter->mRows)
+         {
+            const char* pData = static_cast<const char*>(pTmpPage->mpData);
+            if (pData >= &iter->mData.front() && pData < &iter->mData.front() + iter->mData.size())
+            {
+               --iter->mReferences;
+               break;
+            }
+         }
+      }
+
       delete pTmpPage;
    }
    else
@@ -225,3 +358,219 @@ int BandResamplePager::getSupportedRequestVersion() const
    VERIFYRV(mpMemoryMappedPager != NULL, -1);
    return mpMemoryMappedPager->getSupportedRequestVersion();
 }
+
+BandResamplePager::Tile* BandResamplePager::getTile(unsigned int row, unsigned int concurrentRows,
+                                                    unsigned int onDiskBand)
+{
+   // Tiles stop at the last row, so requests near the bottom only need the rows which exist
+   const RasterDataDescriptor* pDstDescriptor = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   const unsigned int rowCount = pDstDescriptor->getRowCount();
+   concurrentRows = min(concurrentRows, rowCount - row);
+
+   for (list<Tile>::iterator iter = mTiles.begin(); iter != mTiles.end(); ++iter)
+   {
+      if (row >= iter->mStartRow && row + concurrentRows <= iter->mStartRow + iter->mRows)
+      {
+         mTiles.splice(mTiles.begin(), mTiles, iter);
+         return &mTiles.front();
+      }
+   }
+
+   // Tiles start on a multiple of the tile size unless a request would span two tiles
+   const unsigned int dstRowSize = pDstDescriptor->getColumnCount() * pDstDescriptor->getBytesPerElement();
+   const unsigned int tileRows = max(sTileBytes / dstRowSize, 1U);
+
+   // Tiles in use by pages stay until the pages are released
+   list<Tile>::iterator iter = mTiles.end();
+   while (mTiles.size() >= sMaxCachedTiles && iter != mTiles.begin())
+   {
+      --iter;
+      if (iter->mReferences == 0)
+      {
+         iter = mTiles.erase(iter);
+      }
+   }
+
+   Tile tile;
+   tile.mStartRow = row - row % tileRows;
+   tile.mRows = min(max(tile.mStartRow + tileRows, row + concurrentRows), rowCount) - tile.mStartRow;
+   tile.mReferences = 0;
+   mTiles.push_front(tile);
+   if (loadTile(mTiles.front(), onDiskBand) == false)
+   {
+      mTiles.pop_front();
+      return NULL;
+   }
+
+   return &mTiles.front();
+}
+
+bool BandResamplePager::loadTile(Tile& tile, unsigned int onDiskBand)
+{
+   if (mBandFile.validHandle() == false)
+   {
+      const vector<const Filename*>& bandFiles = mpFileDescriptor->getBandFiles();
+      VERIFY(onDiskBand < bandFiles.size() && bandFiles[onDiskBand] != NULL);
+      if (mBandFile.open(bandFiles[onDiskBand]->getFullPathAndName(), O_RDONLY | O_BINARY, S_IREAD) == false)
+      {
+         return false;
+      }
+   }
+
+   const RasterDataDescriptor* pDstDescriptor = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   const unsigned int elementSize = pDstDescriptor->getBytesPerElement();
+   const unsigned int dstColumns = pDstDescriptor->getColumnCount();
+   const unsigned int dstRowSize = dstColumns * elementSize;
+
+   // Read all of the band rows used by the tile at once
+   const unsigned int srcRowSize = mColumns * elementSize;
+   const int64_t srcRowStride = mpFileDescriptor->getPrelineBytes() + srcRowSize + mpFileDescriptor->getPostlineBytes();
+   unsigned int firstSrcRow = min(tile.mStartRow / mRowStep, mRows - 1);
+   unsigned int lastSrcRow = min((tile.mStartRow + tile.mRows - 1) / mRowStep, mRows - 1);
+   vector<unsigned int> rowIndices;
+   vector<double> rowWeights;
+   if (mTaps > 0)
+   {
+      computeWeights(tile.mStartRow, tile.mRows, mRows, mRowStep, mTaps, rowIndices, rowWeights);
+      firstSrcRow = *min_element(rowIndices.begin(), rowIndices.end());
+      lastSrcRow = *max_element(rowIndices.begin(), rowIndices.end());
+   }
+
+   const unsigned int numSrcRows = lastSrcRow - firstSrcRow + 1;
+   mSourceRows.resize(static_cast<size_t>(numSrcRows * srcRowStride));
+   if (mBandFile.seek(firstSrcRow * srcRowStride, SEEK_SET) == -1 ||
+      mBandFile.read(&mSourceRows.front(), mSourceRows.size()) != static_cast<int64_t>(mSourceRows.size()))
+   {
+      return false;
+   }
+
+   if (elementSize > 1 && mpFileDescriptor->getEndian() != Endian::getSystemEndian())
+   {
+      for (unsigned int srcRow = 0; srcRow < numSrcRows; ++srcRow)
+      {
+         char* pSrcRow = &mSourceRows.front() + srcRow * srcRowStride + mpFileDescriptor->getPrelineBytes();
+         for (char* pElement = pSrcRow; pElement < pSrcRow + srcRowSize; pElement += elementSize)
+         {
+            reverse(pElement, pElement + elementSize);
+         }
+      }
+   }
+
+   tile.mData.resize(tile.mRows * dstRowSize);
+   if (mTaps > 0)
+   {
+      const char* pSrcRows = &mSourceRows.front() + mpFileDescriptor->getPrelineBytes();
+      const size_t stride = static_cast<size_t>(srcRowStride);
+      return interpolateRows(pDstDescriptor->getDataType(), pSrcRows, stride, numSrcRows, firstSrcRow, mColumns,
+         rowIndices, rowWeights, mColumnIndices, mColumnWeights, mTaps, &tile.mData.front(), tile.mRows, dstColumns);
+   }
+
+   // Expand each band row once and copy it to the other rows it covers
+   unsigned int expandedSrcRow = mRows;
+   char* pExpandedRow = NULL;
+   for (unsigned int dstRow = 0; dstRow < tile.mRows; ++dstRow)
+   {
+      const unsigned int srcRow = min((tile.mStartRow + dstRow) / mRowStep, mRows - 1);
+      char* pDstRow = &tile.mData.front() + dstRow * dstRowSize;
+      if (srcRow == expandedSrcRow)
+      {
+         memcpy(pDstRow, pExpandedRow, dstRowSize);
+         continue;
+      }
+
+      const char* pSrcRow = &mSourceRows.front() + (srcRow - firstSrcRow) * srcRowStride +
+         mpFileDescriptor->getPrelineBytes();
+      replicateColumns(pSrcRow, pDstRow, dstColumns, mColumnStep, elementSize);
+      expandedSrcRow = srcRow;
+      pExpandedRow = pDstRow;
+   }
+
+   return true;
+}
+
+bool BandResamplePager::getInterpolationTaps(const string& interpolation, unsigned int& taps)
+{
+   if (interpolation.empty() || interpolation == NearestNeighborInterpolation())
+   {
+      taps = 0;
+   }
+   else if (interpolation == BilinearInterpolation())
+   {
+      taps = 2;
+   }
+   else if (interpolation == CubicConvolutionInterpolation())
+   {
+      taps = 4;
+   }
+   else
+   {
+      return false;
+   }
+
+   return true;
+}
+
+void BandResamplePager::computeWeights(unsigned int dstFirst, unsigned int dstCount, unsigned int srcCount,
+   unsigned int step, unsigned int taps, vector<unsigned int>& indices, vector<double>& weights)
+{
+   indices.resize(dstCount * taps);
+   weights.resize(dstCount * taps);
+   for (unsigned int dst = 0; dst < dstCount; ++dst)
+   {
+      const double srcPosition = (dstFirst + dst + 0.5) / step - 0.5;
+      const int first = static_cast<int>(floor(srcPosition)) - static_cast<int>(taps / 2 - 1);
+      for (unsigned int tap = 0; tap < taps; ++tap)
+      {
+         const int src = first + static_cast<int>(tap);
+         const double distance = srcPosition - src;
+         indices[dst * taps + tap] = static_cast<unsigned int>(max(0, min(src, static_cast<int>(srcCount) - 1)));
+         weights[dst * taps + tap] = (taps == 2) ? 1.0 - fabs(distance) : cubicConvolution(distance);
+      }
+   }
+}
+
+bool BandResamplePager::interpolateRows(EncodingType dataType, const char* pSrcRows, size_t srcRowStride,
+   unsigned int numSrcRows, unsigned int firstSrcRow, unsigned int srcColumns, const vector<unsigned int>& rowIndices,
+   const vector<double>& rowWeights, const vector<unsigned int>& columnIndices, const vector<double>& columnWeights,
+   unsigned int taps, char* pDstRows, unsigned int dstRows, unsigned int dstColumns)
+{
+   switch (dataType)
+   {
+   case INT1SBYTE:
+      interpolateTypedRows<signed char>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case INT1UBYTE:
+      interpolateTypedRows<unsigned char>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case INT2SBYTES:
+      interpolateTypedRows<signed short>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case INT2UBYTES:
+      interpolateTypedRows<unsigned short>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case INT4SBYTES:
+      interpolateTypedRows<signed int>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case INT4UBYTES:
+      interpolateTypedRows<unsigned int>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case FLT4BYTES:
+      interpolateTypedRows<float>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   case FLT8BYTES:
+      interpolateTypedRows<double>(pSrcRows, srcRowStride, numSrcRows, firstSrcRow, srcColumns, rowIndices,
+         rowWeights, columnIndices, columnWeights, taps, pDstRows, dstRows, dstColumns);
+      break;
+   default:
+      return false;
+   }
+
+   return true;
+}
@@ -10,9 +10,16 @@
 #ifndef BANDRESAMPLEPAGER_H__
 #define BANDRESAMPLEPAGER_H__
 
+#include <QtCore/QMutex>
+
+#include "FileResource.h"
 #include "RasterPage.h"
 #include "RasterPagerShell.h"
 #include "PlugInResource.h"
+#include "TypesFile.h"
+
+#include <list>
+#include <string>
 #include <vector>
 
 class RasterElement;
@@ -21,7 +28,8 @@ class RasterFileDescriptor;
 class BandResampleRasterPage : public RasterPage
 {
 public:
-   BandResampleRasterPage(void* pData, unsigned int rows, unsigned int columns);
+   BandResampleRasterPage(void* pData, unsigned int row, unsigned int column, unsigned int rows,
+      unsigned int columns);
    void* getRawData();
    unsigned int getNumRows();
    unsigned int getNumColumns();
@@ -40,6 +48,18 @@ private:
    unsigned int mColumns;
 };
 
+/**
+ * Pages a data set whose bands are in separate files, one of which has a lower
+ * spatial resolution than the others.
+ *
+ * The full resolution bands are paged by the Memory Mapped Pager. The low resolution
+ * band is upsampled one tile of rows at a time as its pages are requested, so only the
+ * parts of the band which are accessed are read and expanded. The most recently used
+ * tiles are kept for later requests.
+ *
+ * The band is upsampled by pixel replication unless the "Interpolation" argument
+ * selects bilinear or cubic convolution interpolation.
+ */
 class BandResamplePager : public RasterPagerShell
 {
 public:
@@ -53,7 +73,52 @@ public:
    void releasePage(RasterPage* pPage);
    int getSupportedRequestVersion() const;
 
+   static std::string NearestNeighborInterpolation() { return "Nearest Neighbor"; }
+   static std::string BilinearInterpolation() { return "Bilinear"; }
+   static std::string CubicConvolutionInterpolation() { return "Cubic Convolution"; }
+
+   /**
+    * Gets the number of band pixels used for each upsampled pixel in each dimension.
+    *
+    * @return False if the interpolation method is not known.
+    */
+   static bool getInterpolationTaps(const std::string& interpolation, unsigned int& taps);
+
+   /**
+    * Computes the band pixels and weights used for a range of upsampled pixels along one dimension.
+    *
+    * Each band pixel covers step upsampled pixels, as with pixel replication, so switching
+    * between the interpolation methods does not shift the image. Pixels past the edge of
+    * the band are replaced by the edge pixel.
+    */
+   static void computeWeights(unsigned int dstFirst, unsigned int dstCount, unsigned int srcCount, unsigned int step,
+      unsigned int taps, std::vector<unsigned int>& indices, std::vector<double>& weights);
+
+   /**
+    * Interpolates upsampled rows from band rows with the weights from computeWeights().
+    *
+    * The values are rounded and clamped to the data type.
+    *
+    * @return False if the data type is not supported.
+    */
+   static bool interpolateRows(EncodingType dataType, const char* pSrcRows, size_t srcRowStride,
+      unsigned int numSrcRows, unsigned int firstSrcRow, unsigned int srcColumns,
+      const std::vector<unsigned int>& rowIndices, const std::vector<double>& rowWeights,
+      const std::vector<unsigned int>& columnIndices, const std::vector<double>& columnWeights, unsigned int taps,
+      char* pDstRows, unsigned int dstRows, unsigned int dstColumns);
+
 private:
+   struct Tile
+   {
+      unsigned int mStartRow;
+      unsigned int mRows;
+      unsigned int mReferences;
+      std::vector<char> mData;
+   };
+
+   Tile* getTile(unsigned int row, unsigned int concurrentRows, unsigned int onDiskBand);
+   bool loadTile(Tile& tile, unsigned int onDiskBand);
+
    RasterElement* mpElement;
    RasterFileDescriptor* mpFileDescriptor;
    unsigned int mBand;
@@ -61,7 +126,19 @@ private:
    unsigned int mColumns;
    ExecutableResource mMemoryMappedPagerPlugin;
    RasterPager* mpMemoryMappedPager;
-   char* mpRemapData;
+   unsigned int mRowStep;
+   unsigned int mColumnStep;
+
+   // The number of band pixels used for each upsampled pixel in each dimension, or 0 for pixel replication
+   unsigned int mTaps;
+   std::vector<unsigned int> mColumnIndices;
+   std::vector<double> mColumnWeights;
+   LargeFileResource mBandFile;
+   std::vector<char> mSourceRows;
+
+   // The most recently used tile is at the front
+   std::list<Tile> mTiles;
+   QMutex mTileMutex;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,306 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BandResamplePager.h"
+#include "DataRequest.h"
+#include "FileResource.h"
+#include "Filename.h"
+#include "LandsatCalibrationPager.h"
+#include "LandsatUtilities.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterFileDescriptor.h"
+#include "SpectralVersion.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralLandsat, LandsatCalibrationPager);
+
+namespace
+{
+   // Pages hold at least this many bytes of calibrated values
+   const unsigned int sPageBytes = 1024 * 1024;
+}
+
+LandsatCalibrationRasterPage::LandsatCalibrationRasterPage(unsigned int rows,
+                                                           unsigned int columns,
+                                                           unsigned int startColumn) :
+   mData(rows * columns),
+   mRows(rows),
+   mColumns(columns),
+   mStartColumn(startColumn)
+{
+}
+
+LandsatCalibrationRasterPage::~LandsatCalibrationRasterPage()
+{
+}
+
+void* LandsatCalibrationRasterPage::getRawData()
+{
+   return mData.empty() ? NULL : &mData[mStartColumn];
+}
+
+unsigned int LandsatCalibrationRasterPage::getNumRows()
+{
+   return mRows;
+}
+
+unsigned int LandsatCalibrationRasterPage::getNumColumns()
+{
+   return mColumns;
+}
+
+unsigned int LandsatCalibrationRasterPage::getNumBands()
+{
+   return 1;
+}
+
+unsigned int LandsatCalibrationRasterPage::getInterlineBytes()
+{
+   return 0;
+}
+
+LandsatCalibrationPager::LandsatCalibrationPager() :
+   mpElement(NULL),
+   mpFileDescriptor(NULL),
+   mResampledBand(numeric_limits<unsigned int>::max()),
+   mBandRows(0),
+   mBandColumns(0),
+   mTaps(0)
+{
+   setName("LandsatCalibrationPager");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Computes calibrated floating point values from the digital numbers of a Landsat scene "
+                  "as they are read.");
+   setDescriptorId("{0B5C8A31-7E2D-4F46-9A0C-6D3E1F84B2A7}");
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+}
+
+LandsatCalibrationPager::~LandsatCalibrationPager()
+{
+}
+
+bool LandsatCalibrationPager::getInputSpecification(PlugInArgList*& pArgList)
+{
+   VERIFY((pArgList = Service<PlugInManagerServices>()->getPlugInArgList()) != NULL);
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element"));
+   VERIFY(pArgList->addArg<vector<double> >("Scales", "The scale applied to the digital numbers of each band."));
+   VERIFY(pArgList->addArg<vector<double> >("Offsets", "The offset added to the scaled digital numbers of "
+      "each band."));
+   VERIFY(pArgList->addArg<unsigned int>("Resampled Band", "Original band number of a band which has "
+      "a lower resolution than the data set."));
+   VERIFY(pArgList->addArg<unsigned int>("Rows", "Number of rows in the lower resolution band."));
+   VERIFY(pArgList->addArg<unsigned int>("Columns", "Number of columns in the lower resolution band."));
+   VERIFY(pArgList->addArg<string>("Interpolation", BandResamplePager::NearestNeighborInterpolation(),
+      "The method used to upsample the lower resolution band, as for the BandResamplePager."));
+   return true;
+}
+
+bool LandsatCalibrationPager::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList)
+{
+   VERIFY(pInputArgList != NULL);
+   mpElement = pInputArgList->getPlugInArgValue<RasterElement>("Raster Element");
+   VERIFY(mpElement != NULL);
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   VERIFY(pDescriptor != NULL && pDescriptor->getDataType() == FLT4BYTES);
+   mpFileDescriptor = dynamic_cast<const RasterFileDescriptor*>(pDescriptor->getFileDescriptor());
+   VERIFY(mpFileDescriptor != NULL && mpFileDescriptor->getBitsPerElement() == 8);
+   VERIFY(mpFileDescriptor->getBandFiles().size() >= pDescriptor->getBandCount());
+
+   vector<double> scales;
+   vector<double> offsets;
+   VERIFY(pInputArgList->getPlugInArgValue<vector<double> >("Scales", scales));
+   VERIFY(pInputArgList->getPlugInArgValue<vector<double> >("Offsets", offsets));
+   VERIFY(scales.size() == offsets.size() && scales.size() >= mpFileDescriptor->getBandFiles().size());
+
+   if (pInputArgList->getPlugInArgValue<unsigned int>("Resampled Band", mResampledBand))
+   {
+      VERIFY(pInputArgList->getPlugInArgValue<unsigned int>("Rows", mBandRows) && mBandRows > 0);
+      VERIFY(pInputArgList->getPlugInArgValue<unsigned int>("Columns", mBandColumns) && mBandColumns > 0);
+
+      // The band is upsampled the same way as in the uncalibrated data set so the two still match
+      string interpolation = BandResamplePager::NearestNeighborInterpolation();
+      pInputArgList->getPlugInArgValue<string>("Interpolation", interpolation);
+      VERIFY(BandResamplePager::getInterpolationTaps(interpolation, mTaps));
+      if (mTaps > 0)
+      {
+         const unsigned int columnCount = pDescriptor->getColumnCount();
+         const unsigned int columnStep = columnCount / mBandColumns + (columnCount % mBandColumns == 0 ? 0 : 1);
+         BandResamplePager::computeWeights(0, columnCount, mBandColumns, columnStep, mTaps, mColumnIndices,
+            mColumnWeights);
+      }
+   }
+
+   // Digital numbers are 8 bits so every possible value is calibrated once here. The fill value marks
+   // pixels outside the scene, as it does in the mosaic pager, and is not calibrated so the copied bad
+   // values of the data set still match it.
+   const unsigned char fillValue = Landsat::getFillValue(pDescriptor);
+   mLookup.resize(scales.size());
+   for (vector<double>::size_type band = 0; band < scales.size(); ++band)
+   {
+      mLookup[band].resize(256);
+      for (unsigned int dn = 0; dn < 256; ++dn)
+      {
+         mLookup[band][dn] = static_cast<float>(dn == fillValue ? dn : scales[band] * dn + offsets[band]);
+      }
+   }
+
+   return true;
+}
+
+RasterPage* LandsatCalibrationPager::getPage(DataRequest* pOriginalRequest,
+                                             DimensionDescriptor startRow,
+                                             DimensionDescriptor startColumn,
+                                             DimensionDescriptor startBand)
+{
+   VERIFYRV(pOriginalRequest != NULL && mpElement != NULL, NULL);
+   VERIFYRV(pOriginalRequest->getConcurrentBands() == 1, NULL);
+
+   const RasterDataDescriptor* pDescriptor = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   const unsigned int rowCount = pDescriptor->getRowCount();
+   const unsigned int columnCount = pDescriptor->getColumnCount();
+   const unsigned int row = startRow.getOnDiskNumber();
+   const unsigned int band = startBand.getOnDiskNumber();
+   VERIFYRV(row < rowCount && startColumn.getOnDiskNumber() < columnCount && band < mLookup.size(), NULL);
+
+   const unsigned int pageRows = max(sPageBytes / (columnCount * sizeof(float)), 1U);
+   const unsigned int numRows = min(max(pOriginalRequest->getConcurrentRows(), pageRows), rowCount - row);
+   LandsatCalibrationRasterPage* pPage = new LandsatCalibrationRasterPage(numRows, columnCount,
+      startColumn.getOnDiskNumber());
+
+   const vector<float>& lookup = mLookup[band];
+   vector<unsigned char> digitalNumbers;
+   if (startBand.getOriginalNumber() != mResampledBand)
+   {
+      if (readRows(band, row, numRows, columnCount, digitalNumbers) == false)
+      {
+         delete pPage;
+         return NULL;
+      }
+
+      float* pValue = &pPage->mData.front();
+      for (vector<unsigned char>::const_iterator iter = digitalNumbers.begin(); iter != digitalNumbers.end(); ++iter)
+      {
+         *pValue++ = lookup[*iter];
+      }
+
+      return pPage;
+   }
+
+   const unsigned int rowStep = rowCount / mBandRows + (rowCount % mBandRows == 0 ? 0 : 1);
+   if (mTaps > 0)
+   {
+      // Interpolate the digital numbers and calibrate the result, as the uncalibrated data set would show them
+      vector<unsigned int> rowIndices;
+      vector<double> rowWeights;
+      BandResamplePager::computeWeights(row, numRows, mBandRows, rowStep, mTaps, rowIndices, rowWeights);
+      const unsigned int firstBandRow = *min_element(rowIndices.begin(), rowIndices.end());
+      const unsigned int lastBandRow = *max_element(rowIndices.begin(), rowIndices.end());
+      vector<unsigned char> interpolated(numRows * columnCount);
+      if (readRows(band, firstBandRow, lastBandRow - firstBandRow + 1, mBandColumns, digitalNumbers) == false ||
+         BandResamplePager::interpolateRows(INT1UBYTE, reinterpret_cast<const char*>(&digitalNumbers.front()),
+            mBandColumns, lastBandRow - firstBandRow + 1, firstBandRow, mBandColumns, rowIndices, rowWeights,
+            mColumnIndices, mColumnWeights, mTaps, reinterpret_cast<char*>(&interpolated.front()), numRows,
+            columnCount) == false)
+      {
+         delete pPage;
+         return NULL;
+      }
+
+      float* pValue = &pPage->mData.front();
+      for (vector<unsigned char>::const_iterator iter = interpolated.begin(); iter != interpolated.end(); ++iter)
+      {
+         *pValue++ = lookup[*iter];
+      }
+
+      return pPage;
+   }
+
+   // Replicate the pixels of the lower resolution band
+   const unsigned int columnStep = columnCount / mBandColumns + (columnCount % mBandColumns == 0 ? 0 : 1);
+   const unsigned int firstBandRow = min(row / rowStep, mBandRows - 1);
+   const unsigned int lastBandRow = min((row + numRows - 1) / rowStep, mBandRows - 1);
+   if (readRows(band, firstBandRow, lastBandRow - firstBandRow + 1, mBandColumns, digitalNumbers) == false)
+   {
+      delete pPage;
+      return NULL;
+   }
+
+   for (unsigned int pageRow = 0; pageRow < numRows; ++pageRow)
+   {
+      const unsigned int bandRow = min((row + pageRow) / rowStep, mBandRows - 1);
+      const unsigned char* pDigitalNumber = &digitalNumbers[(bandRow - firstBandRow) * mBandColumns];
+      float* pValue = &pPage->mData[pageRow * columnCount];
+      for (unsigned int column = 0; column < columnCount; column += columnStep)
+      {
+         fill_n(pValue + column, min(columnStep, columnCount - column), lookup[*pDigitalNumber++]);
+      }
+   }
+
+   return pPage;
+}
+
+void LandsatCalibrationPager::releasePage(RasterPage* pPage)
+{
+   delete dynamic_cast<LandsatCalibrationRasterPage*>(pPage);
+}
+
+int LandsatCalibrationPager::getSupportedRequestVersion() const
+{
+   return 1;
+}
+
+bool LandsatCalibrationPager::readRows(unsigned int onDiskBand, unsigned int firstRow, unsigned int numRows,
+                                       unsigned int numColumns, vector<unsigned char>& rows) const
+{
+   const Filename* pFilename = mpFileDescriptor->getBandFiles()[onDiskBand];
+   VERIFY(pFilename != NULL);
+
+   // Each page opens the band file itself so pages can be read from several threads at once
+   LargeFileResource bandFile;
+   if (bandFile.open(pFilename->getFullPathAndName(), O_RDONLY | O_BINARY, S_IREAD) == false)
+   {
+      return false;
+   }
+
+   const unsigned int prelineBytes = mpFileDescriptor->getPrelineBytes();
+   const unsigned int postlineBytes = mpFileDescriptor->getPostlineBytes();
+   const int64_t rowStride = prelineBytes + numColumns + postlineBytes;
+   vector<unsigned char> buffer(static_cast<size_t>(numRows * rowStride));
+   if (bandFile.seek(firstRow * rowStride, SEEK_SET) == -1 ||
+      bandFile.read(&buffer.front(), buffer.size()) != static_cast<int64_t>(buffer.size()))
+   {
+      return false;
+   }
+
+   if (prelineBytes == 0 && postlineBytes == 0)
+   {
+      rows.swap(buffer);
+      return true;
+   }
+
+   rows.resize(numRows * numColumns);
+   for (unsigned int row = 0; row < numRows; ++row)
+   {
+      copy(buffer.begin() + row * rowStride + prelineBytes, buffer.begin() + row * rowStride + prelineBytes +
+         numColumns, rows.begin() + row * numColumns);
+   }
+
+   return true;
+}
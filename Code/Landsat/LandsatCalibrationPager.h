@@ -0,0 +1,85 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef LANDSATCALIBRATIONPAGER_H
+#define LANDSATCALIBRATIONPAGER_H
+
+#include "RasterPage.h"
+#include "RasterPagerShell.h"
+
+#include <vector>
+
+class RasterElement;
+class RasterFileDescriptor;
+
+class LandsatCalibrationRasterPage : public RasterPage
+{
+public:
+   LandsatCalibrationRasterPage(unsigned int rows, unsigned int columns, unsigned int startColumn);
+   void* getRawData();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getNumBands();
+   unsigned int getInterlineBytes();
+
+protected:
+   ~LandsatCalibrationRasterPage();
+   friend class LandsatCalibrationPager;
+
+private:
+   std::vector<float> mData;
+   unsigned int mRows;
+   unsigned int mColumns;
+   unsigned int mStartColumn;
+};
+
+/**
+ * Pages calibrated floating point values computed from the 8-bit digital numbers
+ * in the band files of a Landsat scene.
+ *
+ * Each value is computed as it is read from the scale and offset of its band, so
+ * radiance or top of atmosphere reflectance can be used without storing a floating
+ * point copy of the scene. The fill value from Landsat::getFillValue(), normally
+ * zero, marks pixels outside the scene and is not calibrated. One band may have a
+ * lower resolution than the others, in which case it is upsampled by the "Interpolation"
+ * method, as by the BandResamplePager, before it is calibrated.
+ */
+class LandsatCalibrationPager : public RasterPagerShell
+{
+public:
+   LandsatCalibrationPager();
+   ~LandsatCalibrationPager();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList);
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                       DimensionDescriptor startColumn, DimensionDescriptor startBand);
+   void releasePage(RasterPage* pPage);
+   int getSupportedRequestVersion() const;
+
+private:
+   bool readRows(unsigned int onDiskBand, unsigned int firstRow, unsigned int numRows, unsigned int numColumns,
+      std::vector<unsigned char>& rows) const;
+
+   RasterElement* mpElement;
+   const RasterFileDescriptor* mpFileDescriptor;
+   unsigned int mResampledBand;
+   unsigned int mBandRows;
+   unsigned int mBandColumns;
+
+   // The number of band pixels used for each upsampled pixel in each dimension, or 0 for pixel replication
+   unsigned int mTaps;
+   std::vector<unsigned int> mColumnIndices;
+   std::vector<double> mColumnWeights;
+
+   // The calibrated value of each digital number in each band
+   std::vector<std::vector<float> > mLookup;
+};
+
+#endif
@@ -105,6 +105,7 @@ vector<ImportDescriptor*> LandsatEtmPlusImporter::getImportDescriptors(const str
       pDescriptor->getUnits()->setUnitType(DIGITAL_NO);
 
       descriptors.push_back(pLowGainImportDescriptor.release());
+      Landsat::addCalibratedDescriptors(pDescriptor, getSolarIrradiance(LOW_GAIN), descriptors);
 
       // high gain
       pDescriptor = static_cast<RasterDataDescriptor*>(pDescriptor->copy(highGainDatasetName, NULL));
@@ -120,6 +121,7 @@ vector<ImportDescriptor*> LandsatEtmPlusImporter::getImportDescriptors(const str
       populateMetaData(pMetadata, pFileDescriptor, HIGH_GAIN);
 
       descriptors.push_back(pHighGainImportDescriptor.release());
+      Landsat::addCalibratedDescriptors(pDescriptor, getSolarIrradiance(HIGH_GAIN), descriptors);
    }
 
    if (!mFieldHPN.empty())
@@ -147,6 +149,7 @@ vector<ImportDescriptor*> LandsatEtmPlusImporter::getImportDescriptors(const str
       pDescriptor->getUnits()->setUnitType(DIGITAL_NO);
 
       descriptors.push_back(pPanImportDescriptor.release());
+      Landsat::addCalibratedDescriptors(pDescriptor, getSolarIrradiance(PANCHROMATIC), descriptors);
    }
 
    return descriptors;
@@ -167,6 +170,10 @@ bool LandsatEtmPlusImporter::createRasterPager(RasterElement* pRaster) const
          return false;
       }
    }
+   if (Landsat::isCalibrated(pRaster))
+   {
+      return Landsat::createCalibrationPager(pRaster, 5, mB6Rows, mB6Cols, getSettingBandSixInterpolation());
+   }
    // create the pager
    ExecutableResource pPager("BandResamplePager");
    VERIFY(pPager->getPlugIn() != NULL);
@@ -188,6 +195,8 @@ bool LandsatEtmPlusImporter::createRasterPager(RasterElement* pRaster) const
    pPager->getInArgList().setPlugInArgValue("Band", &band);
    pPager->getInArgList().setPlugInArgValue("Rows", &rows);
    pPager->getInArgList().setPlugInArgValue("Columns", &cols);
+   string interpolation = getSettingBandSixInterpolation();
+   pPager->getInArgList().setPlugInArgValue("Interpolation", &interpolation);
    if (!pPager->execute())
    {
       return false;
@@ -206,6 +215,22 @@ bool LandsatEtmPlusImporter::createRasterPager(RasterElement* pRaster) const
    return true;
 }
 
+vector<double> LandsatEtmPlusImporter::getSolarIrradiance(BandSetType bandSet)
+{
+   // Mean exoatmospheric solar irradiance from the Landsat 7 Science Data Users Handbook
+   vector<double> irradiance;
+   if (bandSet == PANCHROMATIC)
+   {
+      irradiance += 1362.0;
+   }
+   else
+   {
+      irradiance += 1997.0, 1812.0, 1533.0, 1039.0, 230.8, 0.0, 84.90;
+   }
+
+   return irradiance;
+}
+
 void LandsatEtmPlusImporter::populateMetaData(DynamicObject* pMetadata, RasterFileDescriptor* pFileDescriptor, BandSetType bandSet)
 {
    vector<string> &field = (bandSet == PANCHROMATIC) ? mFieldHPN : mFieldHRF;
@@ -242,6 +267,12 @@ void LandsatEtmPlusImporter::populateMetaData(DynamicObject* pMetadata, RasterFi
    pMetadata->setAttribute("Record Length", StringUtilities::fromDisplayString<unsigned int>(field[REC_SIZE]));
    pMetadata->setAttribute("Output Bits per Pixel", StringUtilities::fromDisplayString<unsigned int>(field[OUTPUT_BITS_PER_PIXEL]));
    pMetadata->setAttribute("Acquired Bits per Pixel", StringUtilities::fromDisplayString<unsigned int>(field[ACQUIRED_BITS_PER_PIXEL]));
+   pMetadata->setAttribute("Pixel Size", StringUtilities::fromDisplayString<double>(field[PIXEL_SIZE]));
+   if (bandSet != PANCHROMATIC)
+   {
+      pMetadata->setAttribute("Band 6 Rows", mB6Rows);
+      pMetadata->setAttribute("Band 6 Columns", mB6Cols);
+   }
    vector<double> gain;
    vector<double> bias;
    gain += StringUtilities::fromDisplayString<double>(field[GAIN_1]);
@@ -310,6 +341,7 @@ void LandsatEtmPlusImporter::populateMetaData(DynamicObject* pMetadata, RasterFi
    VERIFYNRV(collectionDate.get() != NULL);
    collectionDate->set(yyyy, mm, dd);
    pMetadata->setAttributeByPath(COLLECTION_DATE_TIME_METADATA_PATH, *collectionDate.get());
+   pMetadata->setAttribute("Earth-Sun Distance", Landsat::EarthSunDistance(yyyy, mm, dd));
    pMetadata->setAttribute("Sun Elevation", StringUtilities::fromDisplayString<double>(field[SUN_ELEVATION]));
    pMetadata->setAttribute("Sun Azimuth", StringUtilities::fromDisplayString<double>(field[SUN_AZIMUTH]));
 
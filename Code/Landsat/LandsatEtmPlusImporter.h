@@ -10,6 +10,7 @@
 #ifndef LANDSATETMPLUSIMPORTER_H
 #define LANDSATETMPLUSIMPORTER_H
 
+#include "ConfigurationSettings.h"
 #include "EnumWrapper.h"
 #include "RasterElementImporterShell.h"
 
@@ -28,6 +29,12 @@ public:
    std::vector<ImportDescriptor*> getImportDescriptors(const std::string& filename);
    bool createRasterPager(RasterElement* pRaster) const;
 
+   /**
+    * The method used to upsample band 6 to the resolution of the other bands: "Nearest Neighbor",
+    * "Bilinear" or "Cubic Convolution".
+    */
+   SETTING(BandSixInterpolation, LandsatEtmPlusImporter, std::string, "Nearest Neighbor");
+
 protected:
    enum FieldIndexEnum
    {
@@ -127,6 +134,7 @@ protected:
    };
    typedef EnumWrapper<BandSetTypeEnum> BandSetType;
    void populateMetaData(DynamicObject* pMetadata, RasterFileDescriptor* pFileDescriptor, BandSetType bandSet);
+   static std::vector<double> getSolarIrradiance(BandSetType bandSet);
    void initFieldLengths();
    bool readHeader(const std::string& strInFstHeaderFileName);
    bool parseHeader(const std::vector<std::string>& header, std::vector<std::string>& field);
@@ -0,0 +1,407 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "Filename.h"
+#include "ImportDescriptor.h"
+#include "LandsatEtmPlusImporter.h"
+#include "LandsatMosaicImporter.h"
+#include "LandsatTmImporter.h"
+#include "ModelServices.h"
+#include "PlugInArgList.h"
+#include "PlugInRegistration.h"
+#include "PlugInResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterFileDescriptor.h"
+#include "RasterPager.h"
+#include "RasterUtilities.h"
+#include "SpectralVersion.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <list>
+#include <math.h>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralLandsat, LandsatMosaicImporter);
+
+namespace
+{
+   struct Scene
+   {
+      unsigned int mRows;
+      unsigned int mColumns;
+      unsigned int mStartRow;
+      unsigned int mStartColumn;
+      double mEasting;
+      double mNorthing;
+      vector<string> mBandFiles;
+      vector<unsigned int> mBandRows;
+      vector<unsigned int> mBandColumns;
+      list<GcpPoint> mGcps;
+   };
+
+   /**
+    * Gets the descriptors of a scene from the importer which can load its header.
+    */
+   class SceneDescriptors
+   {
+   public:
+      explicit SceneDescriptors(const string& headerFilename)
+      {
+         LandsatTmImporter tmImporter;
+         LandsatEtmPlusImporter etmPlusImporter;
+         if (tmImporter.getFileAffinity(headerFilename) != Importer::CAN_NOT_LOAD)
+         {
+            mImporterName = tmImporter.getName();
+            mDescriptors = tmImporter.getImportDescriptors(headerFilename);
+         }
+         else if (etmPlusImporter.getFileAffinity(headerFilename) != Importer::CAN_NOT_LOAD)
+         {
+            mImporterName = etmPlusImporter.getName();
+            mDescriptors = etmPlusImporter.getImportDescriptors(headerFilename);
+         }
+      }
+
+      ~SceneDescriptors()
+      {
+         for (vector<ImportDescriptor*>::iterator iter = mDescriptors.begin(); iter != mDescriptors.end(); ++iter)
+         {
+            Service<ModelServices>()->destroyImportDescriptor(*iter);
+         }
+      }
+
+      const string& getImporterName() const
+      {
+         return mImporterName;
+      }
+
+      const RasterDataDescriptor* getDefaultDescriptor() const
+      {
+         if (mDescriptors.empty() || mDescriptors.front() == NULL)
+         {
+            return NULL;
+         }
+
+         return dynamic_cast<const RasterDataDescriptor*>(mDescriptors.front()->getDataDescriptor());
+      }
+
+   private:
+      SceneDescriptors(const SceneDescriptors& rhs);
+      SceneDescriptors& operator=(const SceneDescriptors& rhs);
+
+      string mImporterName;
+      vector<ImportDescriptor*> mDescriptors;
+   };
+
+   bool getScene(const RasterDataDescriptor* pDescriptor, Scene& scene, double& pixelSize, int& mapZone)
+   {
+      const RasterFileDescriptor* pFileDescriptor =
+         dynamic_cast<const RasterFileDescriptor*>(pDescriptor->getFileDescriptor());
+      const DynamicObject* pMetadata = pDescriptor->getMetadata();
+      if (pFileDescriptor == NULL || pMetadata == NULL || pDescriptor->getDataType() != INT1UBYTE)
+      {
+         return false;
+      }
+
+      const double* pPixelSize = dv_cast<double>(&pMetadata->getAttribute("Pixel Size"));
+      const int* pMapZone = dv_cast<int>(&pMetadata->getAttribute("USGS Map Zone"));
+      const double* pEasting = dv_cast<double>(&pMetadata->getAttribute("UL Easting"));
+      const double* pNorthing = dv_cast<double>(&pMetadata->getAttribute("UL Northing"));
+      if (pPixelSize == NULL || *pPixelSize <= 0.0 || pMapZone == NULL || pEasting == NULL || pNorthing == NULL)
+      {
+         return false;
+      }
+
+      pixelSize = *pPixelSize;
+      mapZone = *pMapZone;
+      scene.mRows = pDescriptor->getRowCount();
+      scene.mColumns = pDescriptor->getColumnCount();
+      scene.mEasting = *pEasting;
+      scene.mNorthing = *pNorthing;
+      scene.mGcps = pFileDescriptor->getGcps();
+
+      const vector<const Filename*>& bandFiles = pFileDescriptor->getBandFiles();
+      if (bandFiles.size() != pDescriptor->getBandCount())
+      {
+         return false;
+      }
+
+      // Band 6 of an ETM+ scene has a lower resolution than the other bands
+      const unsigned int* pBandSixRows = dv_cast<unsigned int>(&pMetadata->getAttribute("Band 6 Rows"));
+      const unsigned int* pBandSixColumns = dv_cast<unsigned int>(&pMetadata->getAttribute("Band 6 Columns"));
+      for (vector<const Filename*>::size_type band = 0; band < bandFiles.size(); ++band)
+      {
+         VERIFY(bandFiles[band] != NULL);
+         scene.mBandFiles.push_back(bandFiles[band]->getFullPathAndName());
+         if (band == 5 && pBandSixRows != NULL && pBandSixColumns != NULL && *pBandSixRows > 0 &&
+            *pBandSixColumns > 0)
+         {
+            scene.mBandRows.push_back(*pBandSixRows);
+            scene.mBandColumns.push_back(*pBandSixColumns);
+         }
+         else
+         {
+            scene.mBandRows.push_back(scene.mRows);
+            scene.mBandColumns.push_back(scene.mColumns);
+         }
+      }
+
+      return true;
+   }
+}
+
+LandsatMosaicImporter::LandsatMosaicImporter()
+{
+   setDescriptorId("{2F6B8E1D-94C3-4A7E-8D05-B3C1E6A9F472}");
+   setName("Landsat Mosaic Importer");
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setShortDescription("Landsat Mosaic");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+   setExtensions("Landsat Mosaic Files (*.mosaic)");
+}
+
+LandsatMosaicImporter::~LandsatMosaicImporter()
+{
+}
+
+unsigned char LandsatMosaicImporter::getFileAffinity(const string& filename)
+{
+   if (QFileInfo(QString::fromStdString(filename)).suffix().toLower() != "mosaic")
+   {
+      return CAN_NOT_LOAD;
+   }
+
+   vector<string> headers = getHeaderFilenames(filename);
+   if (headers.empty())
+   {
+      return CAN_NOT_LOAD;
+   }
+
+   LandsatTmImporter tmImporter;
+   LandsatEtmPlusImporter etmPlusImporter;
+   if (tmImporter.getFileAffinity(headers.front()) == CAN_NOT_LOAD &&
+      etmPlusImporter.getFileAffinity(headers.front()) == CAN_NOT_LOAD)
+   {
+      return CAN_NOT_LOAD;
+   }
+
+   return CAN_LOAD;
+}
+
+vector<ImportDescriptor*> LandsatMosaicImporter::getImportDescriptors(const string& filename)
+{
+   vector<ImportDescriptor*> descriptors;
+   vector<string> headers = getHeaderFilenames(filename);
+   if (headers.empty())
+   {
+      return descriptors;
+   }
+
+   // Only the default data set of each scene is mosaicked
+   vector<Scene> scenes(headers.size());
+   SceneDescriptors firstSceneDescriptors(headers.front());
+   const RasterDataDescriptor* pFirstDescriptor = firstSceneDescriptors.getDefaultDescriptor();
+   double firstPixelSize = 0.0;
+   int firstMapZone = 0;
+   if (pFirstDescriptor == NULL || getScene(pFirstDescriptor, scenes.front(), firstPixelSize, firstMapZone) == false)
+   {
+      return descriptors;
+   }
+
+   for (vector<string>::size_type index = 1; index < headers.size(); ++index)
+   {
+      // Scenes must be aligned on the same grid and have the same bands
+      SceneDescriptors sceneDescriptors(headers[index]);
+      const RasterDataDescriptor* pSceneDescriptor = sceneDescriptors.getDefaultDescriptor();
+      double pixelSize = 0.0;
+      int mapZone = 0;
+      if (pSceneDescriptor == NULL || getScene(pSceneDescriptor, scenes[index], pixelSize, mapZone) == false ||
+         sceneDescriptors.getImporterName() != firstSceneDescriptors.getImporterName() ||
+         mapZone != firstMapZone || fabs(pixelSize - firstPixelSize) > 1e-6 ||
+         scenes[index].mBandFiles.size() != scenes.front().mBandFiles.size())
+      {
+         return descriptors;
+      }
+   }
+
+   // Place each scene by its upper left corner
+   double minEasting = numeric_limits<double>::max();
+   double maxNorthing = -numeric_limits<double>::max();
+   for (vector<Scene>::const_iterator scene = scenes.begin(); scene != scenes.end(); ++scene)
+   {
+      minEasting = min(minEasting, scene->mEasting);
+      maxNorthing = max(maxNorthing, scene->mNorthing);
+   }
+
+   unsigned int rowCount = 0;
+   unsigned int columnCount = 0;
+   vector<string> bandFiles;
+   vector<unsigned int> bandRows;
+   vector<unsigned int> bandColumns;
+   vector<unsigned int> sceneRows;
+   vector<unsigned int> sceneColumns;
+   vector<unsigned int> startRows;
+   vector<unsigned int> startColumns;
+   list<GcpPoint> gcps;
+   for (vector<Scene>::iterator scene = scenes.begin(); scene != scenes.end(); ++scene)
+   {
+      scene->mStartRow = static_cast<unsigned int>((maxNorthing - scene->mNorthing) / firstPixelSize + 0.5);
+      scene->mStartColumn = static_cast<unsigned int>((scene->mEasting - minEasting) / firstPixelSize + 0.5);
+      rowCount = max(rowCount, scene->mStartRow + scene->mRows);
+      columnCount = max(columnCount, scene->mStartColumn + scene->mColumns);
+
+      bandFiles.insert(bandFiles.end(), scene->mBandFiles.begin(), scene->mBandFiles.end());
+      bandRows.insert(bandRows.end(), scene->mBandRows.begin(), scene->mBandRows.end());
+      bandColumns.insert(bandColumns.end(), scene->mBandColumns.begin(), scene->mBandColumns.end());
+      sceneRows.push_back(scene->mRows);
+      sceneColumns.push_back(scene->mColumns);
+      startRows.push_back(scene->mStartRow);
+      startColumns.push_back(scene->mStartColumn);
+
+      for (list<GcpPoint>::iterator gcp = scene->mGcps.begin(); gcp != scene->mGcps.end(); ++gcp)
+      {
+         gcp->mPixel.mX += scene->mStartColumn;
+         gcp->mPixel.mY += scene->mStartRow;
+         gcps.push_back(*gcp);
+      }
+   }
+
+   // The mosaic has the bands, display settings and metadata of the first scene
+   RasterDataDescriptor* pDescriptor = RasterUtilities::generateRasterDataDescriptor(filename, NULL,
+      rowCount, columnCount, pFirstDescriptor->getBandCount(), BSQ, INT1UBYTE, ON_DISK_READ_ONLY);
+   VERIFYRV(pDescriptor != NULL, descriptors);
+   ImportDescriptorResource pImportDescriptor(pDescriptor);
+   VERIFYRV(pImportDescriptor.get() != NULL, descriptors);
+   RasterFileDescriptor* pFileDescriptor = static_cast<RasterFileDescriptor*>(
+      RasterUtilities::generateAndSetFileDescriptor(pDescriptor, filename, string(), LITTLE_ENDIAN_ORDER));
+   VERIFYRV(pFileDescriptor != NULL, descriptors);
+   pFileDescriptor->setGcps(gcps);
+
+   pDescriptor->setBadValues(pFirstDescriptor->getBadValues());
+   pDescriptor->setUnits(pFirstDescriptor->getUnits());
+   pDescriptor->setDisplayMode(pFirstDescriptor->getDisplayMode());
+   const RasterChannelType channels[] = { GRAY, RED, GREEN, BLUE };
+   for (int channel = 0; channel < 4; ++channel)
+   {
+      DimensionDescriptor band = pFirstDescriptor->getDisplayBand(channels[channel]);
+      if (band.isOriginalNumberValid())
+      {
+         pDescriptor->setDisplayBand(channels[channel], pDescriptor->getOriginalBand(band.getOriginalNumber()));
+      }
+   }
+
+   // The gains and corners of the first scene do not apply to the mosaic
+   DynamicObject* pMetadata = pDescriptor->getMetadata();
+   pMetadata->merge(pFirstDescriptor->getMetadata());
+   pMetadata->removeAttribute("Radiance Adjust");
+   pMetadata->setAttribute("UL Easting", minEasting);
+   pMetadata->setAttribute("UL Northing", maxNorthing);
+   pMetadata->setAttributeByPath("Mosaic/Headers", headers);
+   pMetadata->setAttributeByPath("Mosaic/Band Files", bandFiles);
+   pMetadata->setAttributeByPath("Mosaic/Band Rows", bandRows);
+   pMetadata->setAttributeByPath("Mosaic/Band Columns", bandColumns);
+   pMetadata->setAttributeByPath("Mosaic/Scene Rows", sceneRows);
+   pMetadata->setAttributeByPath("Mosaic/Scene Columns", sceneColumns);
+   pMetadata->setAttributeByPath("Mosaic/Start Rows", startRows);
+   pMetadata->setAttributeByPath("Mosaic/Start Columns", startColumns);
+
+   descriptors.push_back(pImportDescriptor.release());
+   return descriptors;
+}
+
+bool LandsatMosaicImporter::createRasterPager(RasterElement* pRaster) const
+{
+   VERIFY(pRaster != NULL);
+   const DynamicObject* pMetadata = pRaster->getMetadata();
+   VERIFY(pMetadata != NULL);
+   const vector<string>* pBandFiles = dv_cast<vector<string> >(&pMetadata->getAttributeByPath("Mosaic/Band Files"));
+   VERIFY(pBandFiles != NULL);
+   vector<string> bandFiles = *pBandFiles;
+
+   ExecutableResource pPager("LandsatMosaicPager");
+   VERIFY(pPager->getPlugIn() != NULL);
+   pPager->getInArgList().setPlugInArgValue("Raster Element", pRaster);
+   pPager->getInArgList().setPlugInArgValue("Band Files", &bandFiles);
+
+   const string layoutArgs[] = { "Band Rows", "Band Columns", "Scene Rows", "Scene Columns", "Start Rows",
+      "Start Columns" };
+   vector<vector<unsigned int> > layout(6);
+   for (int index = 0; index < 6; ++index)
+   {
+      const vector<unsigned int>* pValues =
+         dv_cast<vector<unsigned int> >(&pMetadata->getAttributeByPath("Mosaic/" + layoutArgs[index]));
+      VERIFY(pValues != NULL);
+      layout[index] = *pValues;
+      pPager->getInArgList().setPlugInArgValue(layoutArgs[index], &layout[index]);
+   }
+
+   if (!pPager->execute())
+   {
+      return false;
+   }
+
+   RasterPager* pRasterPager = dynamic_cast<RasterPager*>(pPager->getPlugIn());
+   if (pRasterPager == NULL)
+   {
+      return false;
+   }
+
+   pPager->releasePlugIn();
+   pRaster->setPager(pRasterPager);
+   return true;
+}
+
+int LandsatMosaicImporter::getValidationTest(const DataDescriptor* pDescriptor) const
+{
+   // The pixels are read from the band files of each scene rather than from the list of headers
+   return RasterElementImporterShell::getValidationTest(pDescriptor) & ~FILE_SIZE;
+}
+
+vector<string> LandsatMosaicImporter::getHeaderFilenames(const string& filename)
+{
+   vector<string> headers;
+   ifstream list(filename.c_str());
+   if (list.good() == false)
+   {
+      return headers;
+   }
+
+   const QDir folder = QFileInfo(QString::fromStdString(filename)).absoluteDir();
+   string line;
+   while (getline(list, line))
+   {
+      string::size_type first = line.find_first_not_of(" \t\r");
+      if (first == string::npos || line[first] == '#')
+      {
+         continue;
+      }
+
+      string::size_type last = line.find_last_not_of(" \t\r");
+      QFileInfo header(QString::fromStdString(line.substr(first, last - first + 1)));
+      if (header.isRelative())
+      {
+         header = QFileInfo(folder, header.filePath());
+      }
+
+      headers.push_back(header.absoluteFilePath().toStdString());
+   }
+
+   return headers;
+}
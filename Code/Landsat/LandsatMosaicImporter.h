@@ -0,0 +1,45 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef LANDSATMOSAICIMPORTER_H
+#define LANDSATMOSAICIMPORTER_H
+
+#include "RasterElementImporterShell.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Imports adjacent Landsat TM or ETM+ scenes as a single data set.
+ *
+ * The imported file is a text file listing the header file of each scene, one per line.
+ * Relative paths are relative to the folder of the list, and blank lines and lines
+ * starting with '#' are ignored. All of the scenes must be imported by the same importer
+ * and share a band set, a map zone and a pixel size. The scenes are placed by the easting
+ * and northing of their upper left corners, and the mosaic is paged by the
+ * LandsatMosaicPager directly from the band files of each scene.
+ */
+class LandsatMosaicImporter : public RasterElementImporterShell
+{
+public:
+   LandsatMosaicImporter();
+   ~LandsatMosaicImporter();
+
+   unsigned char getFileAffinity(const std::string& filename);
+   std::vector<ImportDescriptor*> getImportDescriptors(const std::string& filename);
+   bool createRasterPager(RasterElement* pRaster) const;
+
+protected:
+   int getValidationTest(const DataDescriptor* pDescriptor) const;
+
+private:
+   static std::vector<std::string> getHeaderFilenames(const std::string& filename);
+};
+
+#endif
@@ -0,0 +1,230 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataRequest.h"
+#include "FileResource.h"
+#include "LandsatMosaicPager.h"
+#include "LandsatUtilities.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "SpectralVersion.h"
+
+#include <algorithm>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralLandsat, LandsatMosaicPager);
+
+namespace
+{
+   // Pages hold at least this many bytes
+   const unsigned int sPageBytes = 1024 * 1024;
+}
+
+LandsatMosaicRasterPage::LandsatMosaicRasterPage(unsigned int rows, unsigned int columns, unsigned int startColumn,
+                                                 unsigned char fillValue) :
+   mData(rows * columns, fillValue),
+   mRows(rows),
+   mColumns(columns),
+   mStartColumn(startColumn)
+{
+}
+
+LandsatMosaicRasterPage::~LandsatMosaicRasterPage()
+{
+}
+
+void* LandsatMosaicRasterPage::getRawData()
+{
+   return mData.empty() ? NULL : &mData[mStartColumn];
+}
+
+unsigned int LandsatMosaicRasterPage::getNumRows()
+{
+   return mRows;
+}
+
+unsigned int LandsatMosaicRasterPage::getNumColumns()
+{
+   return mColumns;
+}
+
+unsigned int LandsatMosaicRasterPage::getNumBands()
+{
+   return 1;
+}
+
+unsigned int LandsatMosaicRasterPage::getInterlineBytes()
+{
+   return 0;
+}
+
+LandsatMosaicPager::LandsatMosaicPager() :
+   mpElement(NULL),
+   mFillValue(0)
+{
+   setName("LandsatMosaicPager");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setDescription("Reads a mosaic of Landsat scenes from the band files of each scene.");
+   setDescriptorId("{6E0D2B94-35A1-4C8F-B7E2-1F9A4D03C56B}");
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+}
+
+LandsatMosaicPager::~LandsatMosaicPager()
+{
+}
+
+bool LandsatMosaicPager::getInputSpecification(PlugInArgList*& pArgList)
+{
+   VERIFY((pArgList = Service<PlugInManagerServices>()->getPlugInArgList()) != NULL);
+   VERIFY(pArgList->addArg<RasterElement>("Raster Element"));
+   VERIFY(pArgList->addArg<vector<string> >("Band Files", "The band files of each scene."));
+   VERIFY(pArgList->addArg<vector<unsigned int> >("Band Rows", "Number of rows in each band file."));
+   VERIFY(pArgList->addArg<vector<unsigned int> >("Band Columns", "Number of columns in each band file."));
+   VERIFY(pArgList->addArg<vector<unsigned int> >("Scene Rows", "Number of mosaic rows covered by each scene."));
+   VERIFY(pArgList->addArg<vector<unsigned int> >("Scene Columns", "Number of mosaic columns covered by "
+      "each scene."));
+   VERIFY(pArgList->addArg<vector<unsigned int> >("Start Rows", "The first mosaic row of each scene."));
+   VERIFY(pArgList->addArg<vector<unsigned int> >("Start Columns", "The first mosaic column of each scene."));
+   return true;
+}
+
+bool LandsatMosaicPager::execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList)
+{
+   VERIFY(pInputArgList != NULL);
+   mpElement = pInputArgList->getPlugInArgValue<RasterElement>("Raster Element");
+   VERIFY(mpElement != NULL);
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   VERIFY(pDescriptor != NULL && pDescriptor->getDataType() == INT1UBYTE);
+   mFillValue = Landsat::getFillValue(pDescriptor);
+
+   VERIFY(pInputArgList->getPlugInArgValue("Band Files", mBandFiles));
+   VERIFY(pInputArgList->getPlugInArgValue("Band Rows", mBandRows));
+   VERIFY(pInputArgList->getPlugInArgValue("Band Columns", mBandColumns));
+   VERIFY(pInputArgList->getPlugInArgValue("Scene Rows", mSceneRows));
+   VERIFY(pInputArgList->getPlugInArgValue("Scene Columns", mSceneColumns));
+   VERIFY(pInputArgList->getPlugInArgValue("Start Rows", mStartRows));
+   VERIFY(pInputArgList->getPlugInArgValue("Start Columns", mStartColumns));
+
+   const vector<string>::size_type sceneCount = mSceneRows.size();
+   VERIFY(sceneCount > 0 && mSceneColumns.size() == sceneCount);
+   VERIFY(mStartRows.size() == sceneCount && mStartColumns.size() == sceneCount);
+   VERIFY(mBandFiles.size() == sceneCount * pDescriptor->getBandCount());
+   VERIFY(mBandRows.size() == mBandFiles.size() && mBandColumns.size() == mBandFiles.size());
+   for (vector<string>::size_type index = 0; index < mBandFiles.size(); ++index)
+   {
+      VERIFY(mBandRows[index] > 0 && mBandColumns[index] > 0);
+   }
+
+   return true;
+}
+
+RasterPage* LandsatMosaicPager::getPage(DataRequest* pOriginalRequest,
+                                        DimensionDescriptor startRow,
+                                        DimensionDescriptor startColumn,
+                                        DimensionDescriptor startBand)
+{
+   VERIFYRV(pOriginalRequest != NULL && mpElement != NULL, NULL);
+   VERIFYRV(pOriginalRequest->getConcurrentBands() == 1, NULL);
+
+   const RasterDataDescriptor* pDescriptor = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor());
+   const unsigned int rowCount = pDescriptor->getRowCount();
+   const unsigned int columnCount = pDescriptor->getColumnCount();
+   const unsigned int row = startRow.getOnDiskNumber();
+   const unsigned int band = startBand.getOnDiskNumber();
+   VERIFYRV(row < rowCount && startColumn.getOnDiskNumber() < columnCount, NULL);
+   VERIFYRV(band < pDescriptor->getBandCount(), NULL);
+
+   const unsigned int pageRows = max(sPageBytes / columnCount, 1U);
+   const unsigned int numRows = min(max(pOriginalRequest->getConcurrentRows(), pageRows), rowCount - row);
+   LandsatMosaicRasterPage* pPage = new LandsatMosaicRasterPage(numRows, columnCount,
+      startColumn.getOnDiskNumber(), mFillValue);
+
+   // Only the scenes which overlap the rows of the page are read
+   for (unsigned int scene = 0; scene < mSceneRows.size(); ++scene)
+   {
+      if (mStartRows[scene] < row + numRows && mStartRows[scene] + mSceneRows[scene] > row)
+      {
+         if (copyScene(scene, band, row, *pPage) == false)
+         {
+            delete pPage;
+            return NULL;
+         }
+      }
+   }
+
+   return pPage;
+}
+
+void LandsatMosaicPager::releasePage(RasterPage* pPage)
+{
+   delete dynamic_cast<LandsatMosaicRasterPage*>(pPage);
+}
+
+int LandsatMosaicPager::getSupportedRequestVersion() const
+{
+   return 1;
+}
+
+bool LandsatMosaicPager::copyScene(unsigned int scene, unsigned int onDiskBand, unsigned int firstRow,
+                                   LandsatMosaicRasterPage& page) const
+{
+   const unsigned int index = scene * mBandFiles.size() / mSceneRows.size() + onDiskBand;
+   const unsigned int bandRows = mBandRows[index];
+   const unsigned int bandColumns = mBandColumns[index];
+   const unsigned int sceneRows = mSceneRows[scene];
+   const unsigned int sceneColumns = min(mSceneColumns[scene], page.mColumns - mStartColumns[scene]);
+   const unsigned int rowStep = sceneRows / bandRows + (sceneRows % bandRows == 0 ? 0 : 1);
+   const unsigned int columnStep = mSceneColumns[scene] / bandColumns +
+      (mSceneColumns[scene] % bandColumns == 0 ? 0 : 1);
+
+   // Rows of the page and of the band file covered by the scene
+   const unsigned int pageRow = max(firstRow, mStartRows[scene]);
+   const unsigned int endPageRow = min(firstRow + page.mRows, mStartRows[scene] + sceneRows);
+   const unsigned int firstBandRow = min((pageRow - mStartRows[scene]) / rowStep, bandRows - 1);
+   const unsigned int lastBandRow = min((endPageRow - 1 - mStartRows[scene]) / rowStep, bandRows - 1);
+
+   // Each page opens the band file itself so pages can be read from several threads at once
+   LargeFileResource bandFile;
+   if (bandFile.open(mBandFiles[index], O_RDONLY | O_BINARY, S_IREAD) == false)
+   {
+      return false;
+   }
+
+   vector<unsigned char> digitalNumbers(static_cast<size_t>(lastBandRow - firstBandRow + 1) * bandColumns);
+   if (bandFile.seek(static_cast<int64_t>(firstBandRow) * bandColumns, SEEK_SET) == -1 ||
+      bandFile.read(&digitalNumbers.front(), digitalNumbers.size()) != static_cast<int64_t>(digitalNumbers.size()))
+   {
+      return false;
+   }
+
+   for (unsigned int row = pageRow; row < endPageRow; ++row)
+   {
+      const unsigned int bandRow = min((row - mStartRows[scene]) / rowStep, bandRows - 1);
+      const unsigned char* pSource = &digitalNumbers[(bandRow - firstBandRow) * bandColumns];
+      unsigned char* pDestination = &page.mData[(row - firstRow) * page.mColumns + mStartColumns[scene]];
+
+      // The fill value marks pixels outside a scene so an earlier scene's pixels are kept where scenes overlap
+      for (unsigned int column = 0; column < sceneColumns; ++column)
+      {
+         if (pDestination[column] == mFillValue)
+         {
+            pDestination[column] = pSource[min(column / columnStep, bandColumns - 1)];
+         }
+      }
+   }
+
+   return true;
+}
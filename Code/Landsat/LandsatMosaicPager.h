@@ -0,0 +1,81 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef LANDSATMOSAICPAGER_H
+#define LANDSATMOSAICPAGER_H
+
+#include "RasterPage.h"
+#include "RasterPagerShell.h"
+
+#include <string>
+#include <vector>
+
+class RasterElement;
+
+class LandsatMosaicRasterPage : public RasterPage
+{
+public:
+   LandsatMosaicRasterPage(unsigned int rows, unsigned int columns, unsigned int startColumn,
+      unsigned char fillValue);
+   void* getRawData();
+   unsigned int getNumRows();
+   unsigned int getNumColumns();
+   unsigned int getNumBands();
+   unsigned int getInterlineBytes();
+
+protected:
+   ~LandsatMosaicRasterPage();
+   friend class LandsatMosaicPager;
+
+private:
+   std::vector<unsigned char> mData;
+   unsigned int mRows;
+   unsigned int mColumns;
+   unsigned int mStartColumn;
+};
+
+/**
+ * Pages a mosaic of adjacent Landsat scenes directly from the band files of each scene.
+ *
+ * Each scene covers a rectangle of the mosaic starting at its "Start Rows" and "Start Columns"
+ * values. The "Band Files", "Band Rows" and "Band Columns" arguments hold the band files of the
+ * first scene followed by those of the second scene and so on. A band file with fewer rows or
+ * columns than its scene has its pixels replicated. Where scenes overlap, the first scene with
+ * a value other than the fill value from Landsat::getFillValue(), normally zero, provides the
+ * pixel, and pixels covered by no scene have the fill value.
+ */
+class LandsatMosaicPager : public RasterPagerShell
+{
+public:
+   LandsatMosaicPager();
+   ~LandsatMosaicPager();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInputArgList, PlugInArgList* pOutputArgList);
+   RasterPage* getPage(DataRequest* pOriginalRequest, DimensionDescriptor startRow,
+                       DimensionDescriptor startColumn, DimensionDescriptor startBand);
+   void releasePage(RasterPage* pPage);
+   int getSupportedRequestVersion() const;
+
+private:
+   bool copyScene(unsigned int scene, unsigned int onDiskBand, unsigned int firstRow,
+      LandsatMosaicRasterPage& page) const;
+
+   RasterElement* mpElement;
+   unsigned char mFillValue;
+   std::vector<std::string> mBandFiles;
+   std::vector<unsigned int> mBandRows;
+   std::vector<unsigned int> mBandColumns;
+   std::vector<unsigned int> mSceneRows;
+   std::vector<unsigned int> mSceneColumns;
+   std::vector<unsigned int> mStartRows;
+   std::vector<unsigned int> mStartColumns;
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "LandsatUtilities.h"
 #include "PlugInRegistration.h"
 #include "RasterDataDescriptor.h"
+#include "RasterElement.h"
 #include "RasterFileDescriptor.h"
 #include "RasterUtilities.h"
 #include "SpecialMetadata.h"
@@ -158,6 +159,7 @@ vector<ImportDescriptor*> LandsatTmImporter::getImportDescriptors(const string&
    pMetadata->setAttribute("Earth Ellipsoid", mField[EARTH_ELLIPSOID]);
    pMetadata->setAttribute("Semi-Major Axis", StringUtilities::fromDisplayString<double>(mField[SEMIMAJOR_AXIS]));
    pMetadata->setAttribute("Semi-Minor Axis", StringUtilities::fromDisplayString<double>(mField[SEMIMINOR_AXIS]));
+   pMetadata->setAttribute("Pixel Size", StringUtilities::fromDisplayString<double>(mField[PIXEL_SIZE]));
    pMetadata->setAttribute("UL Easting", StringUtilities::fromDisplayString<double>(mField[UL_EASTING]));
    pMetadata->setAttribute("UL Northing", StringUtilities::fromDisplayString<double>(mField[UL_NORTHING]));
    pMetadata->setAttribute("UR Easting", StringUtilities::fromDisplayString<double>(mField[UR_EASTING]));
@@ -186,6 +188,7 @@ vector<ImportDescriptor*> LandsatTmImporter::getImportDescriptors(const string&
    VERIFYRV(collectionDate.get() != NULL, descriptors);
    collectionDate->set(yyyy, mm, dd);
    pMetadata->setAttributeByPath(COLLECTION_DATE_TIME_METADATA_PATH, *collectionDate.get());
+   pMetadata->setAttribute("Earth-Sun Distance", Landsat::EarthSunDistance(yyyy, mm, dd));
    pMetadata->setAttribute("Sun Elevation", StringUtilities::fromDisplayString<double>(mField[SUN_ELEVATION]));
    pMetadata->setAttribute("Sun Azimuth", StringUtilities::fromDisplayString<double>(mField[SUN_AZIMUTH]));
 
@@ -209,9 +212,25 @@ vector<ImportDescriptor*> LandsatTmImporter::getImportDescriptors(const string&
    pFileDescriptor->setGcps(gcps);
 
    descriptors.push_back(pImportDescriptor.release());
+   if (success)
+   {
+      // Mean exoatmospheric solar irradiance of the Landsat 5 TM bands
+      vector<double> solarIrradiance;
+      solarIrradiance += 1983.0, 1796.0, 1536.0, 1031.0, 220.0, 0.0, 83.44;
+      Landsat::addCalibratedDescriptors(pDescriptor, solarIrradiance, descriptors);
+   }
    return descriptors;
 }
 
+bool LandsatTmImporter::createRasterPager(RasterElement* pRaster) const
+{
+   if (Landsat::isCalibrated(pRaster))
+   {
+      return Landsat::createCalibrationPager(pRaster);
+   }
+   return RasterElementImporterShell::createRasterPager(pRaster);
+}
+
 bool LandsatTmImporter::parseGainBias(size_t headerIndex, vector<double>& gain, vector<double>& bias)
 {
    if (mField[headerIndex].empty())
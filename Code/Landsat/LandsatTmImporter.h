@@ -23,6 +23,7 @@ public:
 
    unsigned char getFileAffinity(const std::string& filename);
    std::vector<ImportDescriptor*> getImportDescriptors(const std::string& filename);
+   bool createRasterPager(RasterElement* pRaster) const;
 
 protected:
    enum FieldIndexEnum
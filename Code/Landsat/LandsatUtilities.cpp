@@ -7,10 +7,30 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include "AppVerify.h"
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "ImportDescriptor.h"
 #include "LandsatUtilities.h"
+#include "ObjectResource.h"
+#include "PlugInResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterPager.h"
+#include "Units.h"
+
+#include <math.h>
 
 using namespace std;
 
+namespace
+{
+   const string sCalibrationAttribute = "Calibration";
+   const string sRadianceCalibration = "Radiance";
+   const string sReflectanceCalibration = "Reflectance";
+   const double sPi = 3.14159265358979323846;
+}
+
 namespace Landsat
 {
    double LatLongConvert(string strInputLatLongData)
@@ -44,4 +64,154 @@ namespace Landsat
 
       return dblValue;
    }
+
+   double EarthSunDistance(int year, int month, int day)
+   {
+      if (month < 1 || month > 12)
+      {
+         return 1.0;
+      }
+
+      const int daysBeforeMonth[] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+      int dayOfYear = daysBeforeMonth[month - 1] + day;
+      if (month > 2 && year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))
+      {
+         ++dayOfYear;
+      }
+
+      // The orbit's eccentricity is 0.01672 and perihelion is around the fourth of January
+      return 1.0 - 0.01672 * cos(0.9856 * sPi / 180.0 * (dayOfYear - 4));
+   }
+
+   void addCalibratedDescriptors(const RasterDataDescriptor* pDescriptor, const vector<double>& solarIrradiance,
+      vector<ImportDescriptor*>& descriptors)
+   {
+      VERIFYNRV(pDescriptor != NULL);
+      const string calibrations[] = { sRadianceCalibration, sReflectanceCalibration };
+      for (int i = 0; i < 2; ++i)
+      {
+         RasterDataDescriptor* pCalibratedDescriptor = dynamic_cast<RasterDataDescriptor*>(
+            pDescriptor->copy(pDescriptor->getName() + " " + calibrations[i], NULL));
+         VERIFYNRV(pCalibratedDescriptor != NULL);
+         ImportDescriptorResource pImportDescriptor(pCalibratedDescriptor);
+         VERIFYNRV(pImportDescriptor.get() != NULL);
+         pImportDescriptor->setImported(false);
+
+         // The values are computed as they are read so there is no reason to copy them into memory
+         pCalibratedDescriptor->setFileDescriptor(pDescriptor->getFileDescriptor());
+         pCalibratedDescriptor->setDataType(FLT4BYTES);
+         pCalibratedDescriptor->setProcessingLocation(ON_DISK_READ_ONLY);
+         pCalibratedDescriptor->getUnits()->setUnitType(calibrations[i] == sRadianceCalibration ?
+            RADIANCE : REFLECTANCE);
+         pCalibratedDescriptor->getUnits()->setUnitName(calibrations[i] == sRadianceCalibration ?
+            "W/(m^2 sr um)" : "Reflectance");
+
+         DynamicObject* pMetadata = pCalibratedDescriptor->getMetadata();
+         VERIFYNRV(pMetadata != NULL);
+         pMetadata->setAttribute(sCalibrationAttribute, calibrations[i]);
+         if (calibrations[i] == sReflectanceCalibration)
+         {
+            pMetadata->setAttributeByPath("Radiance Adjust/Solar Irradiance", solarIrradiance);
+         }
+
+         descriptors.push_back(pImportDescriptor.release());
+      }
+   }
+
+   bool isCalibrated(const RasterElement* pRaster)
+   {
+      if (pRaster == NULL || pRaster->getMetadata() == NULL)
+      {
+         return false;
+      }
+
+      const string* pCalibration = dv_cast<string>(&pRaster->getMetadata()->getAttribute(sCalibrationAttribute));
+      return pCalibration != NULL && pCalibration->empty() == false;
+   }
+
+   unsigned char getFillValue(const RasterDataDescriptor* pDescriptor)
+   {
+      if (pDescriptor != NULL)
+      {
+         const vector<int>& badValues = pDescriptor->getBadValues();
+         for (vector<int>::const_iterator iter = badValues.begin(); iter != badValues.end(); ++iter)
+         {
+            if (*iter >= 0 && *iter <= 255)
+            {
+               return static_cast<unsigned char>(*iter);
+            }
+         }
+      }
+
+      return 0;
+   }
+
+   bool createCalibrationPager(RasterElement* pRaster, unsigned int resampledBand, unsigned int bandRows,
+      unsigned int bandColumns, const string& interpolation)
+   {
+      VERIFY(pRaster != NULL);
+      const DynamicObject* pMetadata = pRaster->getMetadata();
+      VERIFY(pMetadata != NULL);
+      const string* pCalibration = dv_cast<string>(&pMetadata->getAttribute(sCalibrationAttribute));
+      const vector<double>* pGain = dv_cast<vector<double> >(&pMetadata->getAttributeByPath("Radiance Adjust/Gain"));
+      const vector<double>* pBias = dv_cast<vector<double> >(&pMetadata->getAttributeByPath("Radiance Adjust/Bias"));
+      VERIFY(pCalibration != NULL && pGain != NULL && pBias != NULL && pGain->size() == pBias->size());
+
+      // radiance = gain * DN + bias
+      // reflectance = pi * radiance * distance^2 / (irradiance * cos(solar zenith))
+      vector<double> scales = *pGain;
+      vector<double> offsets = *pBias;
+      if (*pCalibration == sReflectanceCalibration)
+      {
+         const vector<double>* pIrradiance =
+            dv_cast<vector<double> >(&pMetadata->getAttributeByPath("Radiance Adjust/Solar Irradiance"));
+         const double* pSunElevation = dv_cast<double>(&pMetadata->getAttribute("Sun Elevation"));
+         const double* pDistance = dv_cast<double>(&pMetadata->getAttribute("Earth-Sun Distance"));
+         VERIFY(pIrradiance != NULL && pIrradiance->size() == scales.size());
+         VERIFY(pSunElevation != NULL && *pSunElevation > 0.0 && pDistance != NULL);
+
+         const double cosZenith = sin(*pSunElevation * sPi / 180.0);
+         for (vector<double>::size_type band = 0; band < scales.size(); ++band)
+         {
+            if ((*pIrradiance)[band] > 0.0)
+            {
+               const double factor = sPi * *pDistance * *pDistance / ((*pIrradiance)[band] * cosZenith);
+               scales[band] *= factor;
+               offsets[band] *= factor;
+            }
+         }
+      }
+
+      ExecutableResource pPager("LandsatCalibrationPager");
+      VERIFY(pPager->getPlugIn() != NULL);
+      pPager->getInArgList().setPlugInArgValue("Raster Element", pRaster);
+      pPager->getInArgList().setPlugInArgValue("Scales", &scales);
+      pPager->getInArgList().setPlugInArgValue("Offsets", &offsets);
+      if (bandRows > 0)
+      {
+         pPager->getInArgList().setPlugInArgValue("Resampled Band", &resampledBand);
+         pPager->getInArgList().setPlugInArgValue("Rows", &bandRows);
+         pPager->getInArgList().setPlugInArgValue("Columns", &bandColumns);
+         if (interpolation.empty() == false)
+         {
+            string interpolationValue = interpolation;
+            pPager->getInArgList().setPlugInArgValue("Interpolation", &interpolationValue);
+         }
+      }
+
+      if (!pPager->execute())
+      {
+         return false;
+      }
+
+      RasterPager* pRasterPager = dynamic_cast<RasterPager*>(pPager->getPlugIn());
+      if (pRasterPager == NULL)
+      {
+         return false;
+      }
+
+      pPager->releasePlugIn();
+      pRaster->setPager(pRasterPager);
+      return true;
+   }
 };
\ No newline at end of file
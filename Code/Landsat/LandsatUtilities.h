@@ -11,10 +11,68 @@
 #define LANDSATUTILITIES_H
 
 #include <string>
+#include <vector>
+
+class ImportDescriptor;
+class RasterDataDescriptor;
+class RasterElement;
 
 namespace Landsat
 {
    double LatLongConvert(std::string strInputLatLongData);
+
+   /**
+    * Returns the distance from the Earth to the Sun in astronomical units on the given date.
+    */
+   double EarthSunDistance(int year, int month, int day);
+
+   /**
+    * Adds descriptors for radiance and top of atmosphere reflectance versions of a data set.
+    *
+    * The metadata of the data set must contain the "Radiance Adjust/Gain" and "Radiance Adjust/Bias"
+    * of each band, and the "Sun Elevation" and "Earth-Sun Distance" of the scene. The new data sets are
+    * not imported by default and are paged by the LandsatCalibrationPager.
+    *
+    * @param pDescriptor
+    *        The descriptor of the digital numbers.
+    * @param solarIrradiance
+    *        The mean exoatmospheric solar irradiance of each band. Bands with no irradiance,
+    *        such as the thermal band, are converted to radiance in the reflectance data set.
+    * @param descriptors
+    *        Receives the new descriptors.
+    */
+   void addCalibratedDescriptors(const RasterDataDescriptor* pDescriptor, const std::vector<double>& solarIrradiance,
+      std::vector<ImportDescriptor*>& descriptors);
+
+   /**
+    * Returns true if the element was created from one of the descriptors added by addCalibratedDescriptors().
+    */
+   bool isCalibrated(const RasterElement* pRaster);
+
+   /**
+    * Returns the digital number which marks pixels outside a scene.
+    *
+    * This is the first bad value of the data set from 0 to 255, or zero, which the Landsat products
+    * use, if there is none. The calibration and mosaic pagers both page it unchanged as no data.
+    */
+   unsigned char getFillValue(const RasterDataDescriptor* pDescriptor);
+
+   /**
+    * Creates a LandsatCalibrationPager for an element created from a calibrated descriptor.
+    *
+    * @param pRaster
+    *        The element to page.
+    * @param resampledBand
+    *        Original number of a band with a lower resolution than the element, if bandRows is not zero.
+    * @param bandRows
+    *        Number of rows in the lower resolution band, or zero if all bands have the same resolution.
+    * @param bandColumns
+    *        Number of columns in the lower resolution band.
+    * @param interpolation
+    *        The method used to upsample the lower resolution band, as for the BandResamplePager.
+    */
+   bool createCalibrationPager(RasterElement* pRaster, unsigned int resampledBand = 0, unsigned int bandRows = 0,
+      unsigned int bandColumns = 0, const std::string& interpolation = std::string());
 };
 
 #endif
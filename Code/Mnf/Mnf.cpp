@@ -17,6 +17,7 @@
 #include "AppVerify.h"
 #include "BitMaskIterator.h"
 #include "ConfigurationSettings.h"
+#include "CovarianceEstimator.h"
 #include "DataAccessorImpl.h"
 #include "DataElement.h"
 #include "DataRequest.h"
@@ -56,6 +57,7 @@
 #include <limits>
 #include <math.h>
 #include <sstream>
+#include <string.h>
 #include <typeinfo>
 
 using namespace std;
@@ -113,6 +115,58 @@ namespace
       }
    }
 
+   void writeStatistics(FILE* pFile, const char* pCaption, const CovarianceAccumulator& statistics)
+   {
+      unsigned int numBands = statistics.getNumBands();
+      const vector<double>& means = statistics.getMeans();
+      const vector<double>& crossProducts = statistics.getCrossProducts();
+
+      fprintf(pFile, "\n%s\n", pCaption);
+      fprintf(pFile, "%.17g\n", statistics.getCount());
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         fprintf(pFile, "%.17g ", means[band]);
+      }
+      fprintf(pFile, "\n");
+      for (unsigned int row = 0; row < numBands; ++row)
+      {
+         for (unsigned int col = 0; col < numBands; ++col)
+         {
+            fprintf(pFile, "%.17g ", crossProducts[row * numBands + col]);
+         }
+         fprintf(pFile, "\n");
+      }
+   }
+
+   bool readStatistics(FILE* pFile, unsigned int numBands, CovarianceAccumulator& statistics)
+   {
+      double count(0.0);
+      if (fscanf(pFile, "%lg", &count) != 1)
+      {
+         return false;
+      }
+
+      vector<double> means(numBands);
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         if (fscanf(pFile, "%lg", &means[band]) != 1)
+         {
+            return false;
+         }
+      }
+
+      vector<double> crossProducts(numBands * numBands);
+      for (unsigned int index = 0; index < crossProducts.size(); ++index)
+      {
+         if (fscanf(pFile, "%lg", &crossProducts[index]) != 1)
+         {
+            return false;
+         }
+      }
+
+      return statistics.setStatistics(count, means, crossProducts);
+   }
+
    template <class T>
    void computeMnfRow(T* pData, double* pMnfData,  double** pCoefficients, unsigned int numCols,
       unsigned int numBands, unsigned int numComponents)
@@ -157,6 +211,7 @@ Mnf::Mnf() :
    mNumComponentsToUse(0),
    mbUseSnrValPlot(false),
    mbDisplayResults(true),
+   mStatisticsTolerance(0.0),
    mNoiseStatisticsMethod(DIFFDATA)
 {
    setName("Minimum Noise Fraction Transform");
@@ -199,6 +254,10 @@ bool Mnf::getInputSpecification(PlugInArgList*& pArgList)
       VERIFY(pArgList->addArg<AoiElement>("NoiseStatistics AOI", NULL));
       VERIFY(pArgList->addArg<unsigned int>("Number of Components", 0));
       VERIFY(pArgList->addArg<bool>("Display Results", false));
+      VERIFY(pArgList->addArg<double>("Statistics Tolerance", 0.0, "Relative change in the covariance estimates "
+         "at which adaptive block sampling stops. If zero, every pixel is used."));
+      VERIFY(pArgList->addArg<Filename>("Merge Transform Filename", NULL, "MNF transform file whose saved signal "
+         "and noise statistics are merged with the statistics of this data set before the transform is solved."));
    }
 
    return true;
@@ -261,6 +320,8 @@ bool Mnf::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
                mNoiseStatisticsMethod = getNoiseEstimationMethodType(dlg.getNoiseStatisticsMethod());
             }
 
+            mStatisticsTolerance = dlg.getStatisticsTolerance();
+            mMergeTransformFilename = dlg.getMergeTransformFilename();
             mbUseSnrValPlot = dlg.selectNumComponentsFromPlot();
             if (!mbUseSnrValPlot)
             {
@@ -307,6 +368,10 @@ bool Mnf::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
       else
       {
          pStep->addProperty("Noise Estimation Method", getNoiseEstimationMethodString(mNoiseStatisticsMethod));
+         if (mStatisticsTolerance > 0.0)
+         {
+            pStep->addProperty("Statistics Tolerance", mStatisticsTolerance);
+         }
       }
 
       // create matrices for noise covariance and component coefficients
@@ -342,6 +407,21 @@ bool Mnf::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
       }
       else
       {
+         if (mMergeTransformFilename.empty() == false)
+         {
+            pStep->addProperty("Merge Transform File", mMergeTransformFilename);
+            if (!readInMnfStatistics(mMergeTransformFilename))
+            {
+               // mMessage set in readInMnfStatistics
+               if (mpProgress != NULL)
+               {
+                  mpProgress->updateProgress(mMessage, 0, ERRORS);
+               }
+               pStep->finalize(Message::Failure, mMessage);
+               return false;
+            }
+         }
+
          // generate statistics to use for MNF
          if (!generateNoiseStatistics())
          {
@@ -630,6 +710,19 @@ bool Mnf::extractInputArgs(const PlugInArgList* pArgList)
       }
 
       VERIFY(pArgList->getPlugInArgValue<bool>("Display Results", mbDisplayResults));
+      VERIFY(pArgList->getPlugInArgValue<double>("Statistics Tolerance", mStatisticsTolerance));
+      if (mStatisticsTolerance < 0.0)
+      {
+         mMessage = "The statistics tolerance can not be negative.";
+         mpStep->finalize(Message::Failure, mMessage);
+         return false;
+      }
+
+      Filename* pMergeName = pArgList->getPlugInArgValue<Filename>("Merge Transform Filename");
+      if (pMergeName != NULL)
+      {
+         mMergeTransformFilename = pMergeName->getFullPathAndName();
+      }
    }
 
    return true;
@@ -1104,7 +1197,7 @@ bool Mnf::calculateEigenValues()
    // get signal covariance matrix
    MatrixFunctions::MatrixResource<double> signalCovarMatrix(mNumBands, mNumBands);
    double** pSigCovar = signalCovarMatrix;
-   if (!computeCovarianceMatrix(mpRaster, pSigCovar,"Signal Data" , mpProcessingAoi))
+   if (!computeCovarianceMatrix(mpRaster, pSigCovar,"Signal Data" , mpProcessingAoi, 1, 1, &mSignalStatistics))
    {
       // mMessage set in called method;
       pStep->finalize(Message::Failure, mMessage);
@@ -1115,6 +1208,23 @@ bool Mnf::calculateEigenValues()
       return false;
    }
 
+   // combine with the statistics saved from previously processed data
+   if (mBaseSignalStatistics.getCount() > 0.0)
+   {
+      if (!mergeStatistics(mSignalStatistics, mBaseSignalStatistics, pSigCovar, "signal"))
+      {
+         // mMessage set in mergeStatistics
+         pStep->finalize(Message::Failure, mMessage);
+         if (mpProgress != NULL)
+         {
+            mpProgress->updateProgress(mMessage, 100, ERRORS);
+         }
+         return false;
+      }
+      mSignalBandMeans = mSignalStatistics.getMeans();
+      pStep->addProperty("Merged Signal Pixels", mSignalStatistics.getCount());
+   }
+
    if (!performCholeskyDecomp(pSigCovar, pEigenValues, mNumBands, mNumBands))
    {
       // mMessage set in performCholeskyDecomp
@@ -1360,6 +1470,7 @@ bool Mnf::generateNoiseStatistics()
 
    QString message;
    bool success = false;
+   bool computed = false;
    switch (mNoiseStatisticsMethod)
    {
    case DIFFDATA:
@@ -1400,14 +1511,8 @@ bool Mnf::generateNoiseStatistics()
          ModelResource<AoiElement> pDiffAoi(createDifferenceAoi(mpNoiseAoi, mpNoiseRaster.get()));
 
          success = computeCovarianceMatrix(mpNoiseRaster.get(), mpNoiseCovarMatrix,
-            "Noise Estimation Data", pDiffAoi.get());
-
-         if (success)
-         {
-            strFilename += ".mnfcvm";
-            writeMatrixToFile(strFilename, const_cast<const double**>(mpNoiseCovarMatrix),
-               mNumBands, "Noise Covariance");
-         }
+            "Noise Estimation Data", pDiffAoi.get(), 1, 1, &mNoiseStatistics);
+         computed = true;
       }
       break;
 
@@ -1438,14 +1543,8 @@ bool Mnf::generateNoiseStatistics()
          }
 
          success = computeCovarianceMatrix(mpNoiseRaster.get(), mpNoiseCovarMatrix,
-            "Dark Current Data", mpNoiseAoi, rowSkip, colSkip);
-
-         if (success)
-         {
-            strFilename += ".mnfcvm";
-            writeMatrixToFile(strFilename, const_cast<const double**>(mpNoiseCovarMatrix),
-               mNumBands, "Noise Covariance");
-         }
+            "Dark Current Data", mpNoiseAoi, rowSkip, colSkip, &mNoiseStatistics);
+         computed = true;
       }
       break;
 
@@ -1475,6 +1574,22 @@ bool Mnf::generateNoiseStatistics()
       break;
    }
 
+   // Combine with the statistics from the merge transform file before saving, so the saved
+   // noise covariance is the one used for the transform
+   if (success && mBaseNoiseStatistics.getCount() > 0.0 &&
+      !mergeStatistics(mNoiseStatistics, mBaseNoiseStatistics, mpNoiseCovarMatrix, "noise"))
+   {
+      // mMessage set in mergeStatistics
+      return false;
+   }
+
+   if (success && computed)
+   {
+      strFilename += ".mnfcvm";
+      writeMatrixToFile(strFilename, const_cast<const double**>(mpNoiseCovarMatrix),
+         mNumBands, "Noise Covariance");
+   }
+
    return success;
 }
 
@@ -1747,6 +1862,16 @@ bool Mnf::writeOutMnfTransform(const string& filename)
       }
    }
 
+   // save the sufficient statistics so the transform can be updated with more data later
+   if (mSignalStatistics.getCount() > 0.0 && mSignalStatistics.getNumBands() == mNumBands)
+   {
+      writeStatistics(pFile, "Signal Statistics", mSignalStatistics);
+   }
+   if (mNoiseStatistics.getCount() > 0.0 && mNoiseStatistics.getNumBands() == mNumBands)
+   {
+      writeStatistics(pFile, "Noise Statistics", mNoiseStatistics);
+   }
+
    mMessage = "MNF transform saved to disk as " + filename;
    if (mpProgress != NULL)
    {
@@ -1756,6 +1881,75 @@ bool Mnf::writeOutMnfTransform(const string& filename)
    return true;
 }
 
+bool Mnf::readInMnfStatistics(const string& filename)
+{
+   FileResource pFile(filename.c_str(), "rt");
+   if (pFile.get() == NULL)
+   {
+      mMessage = "Unable to read MNF statistics from file " + filename;
+      return false;
+   }
+
+   unsigned int lnumBands = 0;
+   if (fscanf(pFile, "%u\n", &lnumBands) != 1 || lnumBands != mNumBands)
+   {
+      mMessage = "Mismatch between number of bands in cube and in MNF transform file.";
+      return false;
+   }
+
+   mBaseSignalStatistics.reset(0);
+   mBaseNoiseStatistics.reset(0);
+
+   // the statistics sections follow the transform matrix and optional wavelengths
+   char line[512];
+   bool success = true;
+   while (success && fgets(line, sizeof(line), pFile) != NULL)
+   {
+      if (strncmp(line, "Signal Statistics", 17) == 0)
+      {
+         success = readStatistics(pFile, mNumBands, mBaseSignalStatistics);
+      }
+      else if (strncmp(line, "Noise Statistics", 16) == 0)
+      {
+         success = readStatistics(pFile, mNumBands, mBaseNoiseStatistics);
+      }
+   }
+
+   if (!success)
+   {
+      mMessage = "Error reading the MNF statistics from " + filename;
+      return false;
+   }
+
+   if (mBaseSignalStatistics.getCount() == 0.0 || mBaseNoiseStatistics.getCount() == 0.0)
+   {
+      mMessage = "The MNF transform file " + filename + " does not contain signal and noise statistics. "
+         "Only transforms saved with statistics can be updated.";
+      return false;
+   }
+
+   return true;
+}
+
+bool Mnf::mergeStatistics(CovarianceAccumulator& statistics, const CovarianceAccumulator& baseStatistics,
+                          double** pMatrix, const string& info)
+{
+   if (statistics.getCount() == 0.0)
+   {
+      mMessage = "The " + info + " statistics of this data set are not available to merge with the MNF "
+         "transform file. Previously saved noise statistics can not be used when updating a transform.";
+      return false;
+   }
+
+   if (!statistics.merge(baseStatistics) || !statistics.getCovariance(pMatrix))
+   {
+      mMessage = "Unable to merge the " + info + " statistics with those from the MNF transform file.";
+      return false;
+   }
+
+   return true;
+}
+
 AoiElement* Mnf::getAoiElement(const std::string& aoiName, RasterElement* pRaster)
 {
    AoiElement* pAoi = dynamic_cast<AoiElement*>(mpModel->getElement(aoiName,
@@ -1987,7 +2181,8 @@ bool Mnf::performCholeskyDecomp(double** pMatrix, double* pVector, int numRows,
 }
 
 bool Mnf::computeCovarianceMatrix(RasterElement* pRaster, double **pMatrix, std::string info,
-                                       AoiElement* pAoi, int rowFactor, int columnFactor)
+                                       AoiElement* pAoi, int rowFactor, int columnFactor,
+                                       CovarianceAccumulator* pStatistics)
 {
    VERIFY(pRaster != NULL);
    VERIFY(pMatrix != NULL);
@@ -2020,6 +2215,12 @@ bool Mnf::computeCovarianceMatrix(RasterElement* pRaster, double **pMatrix, std:
       }
    }
 
+   // adaptive sampling replaces the fixed skip factors
+   if (mStatisticsTolerance > 0.0)
+   {
+      return computeSampledCovarianceMatrix(pRaster, pMatrix, info, pAoi, pStatistics);
+   }
+
    unsigned int row, col;
    unsigned int band1, band2;
 
@@ -2169,6 +2370,19 @@ bool Mnf::computeCovarianceMatrix(RasterElement* pRaster, double **pMatrix, std:
             pMatrix[band1][band2] = pMatrix[band2][band1];
          }
       }
+
+      if (pStatistics != NULL)
+      {
+         vector<double> crossProducts(numBands * numBands);
+         for (band2 = 0; band2 < numBands; ++band2)
+         {
+            for (band1 = 0; band1 < numBands; ++band1)
+            {
+               crossProducts[band2 * numBands + band1] = pMatrix[band2][band1] * (pixCount2 - 1);
+            }
+         }
+         pStatistics->setStatistics(pixCount2, means, crossProducts);
+      }
    }
 
    // if calculating for mpRaster, then save the band means
@@ -2192,6 +2406,81 @@ bool Mnf::computeCovarianceMatrix(RasterElement* pRaster, double **pMatrix, std:
    return true;
 }
 
+bool Mnf::computeSampledCovarianceMatrix(RasterElement* pRaster, double** pMatrix, const string& info,
+                                         AoiElement* pAoi, CovarianceAccumulator* pStatistics)
+{
+   VERIFY(pRaster != NULL);
+   VERIFY(pMatrix != NULL);
+
+   const BitMask* pMask(NULL);
+   if (pAoi != NULL)
+   {
+      pMask = pAoi->getSelectedPoints();
+      VERIFY(pMask != NULL);
+   }
+
+   AdaptiveCovarianceEstimator estimator(pRaster, pMask, mStatisticsTolerance);
+   if (estimator.isValid() == false)
+   {
+      mMessage = "Unable to sample the " + info + " for the covariance computation.";
+      return false;
+   }
+
+   while (estimator.isConverged() == false && estimator.processNextBlock())
+   {
+      if (isAborted())
+      {
+         break;
+      }
+
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress("Sampling Covariance Matrix for " + info + "...",
+            estimator.getPercentSampled(), NORMAL);
+      }
+   }
+
+   if (isAborted())
+   {
+      if (mpProgress != NULL)
+      {
+         mpProgress->updateProgress("Aborted computing Covariance Matrix", 0, ABORT);
+      }
+      return true;
+   }
+
+   const CovarianceAccumulator& statistics = estimator.getAccumulator();
+   if (statistics.getCovariance(pMatrix) == false)
+   {
+      mMessage = "Too few pixels were sampled from the " + info + " to compute the covariance.";
+      return false;
+   }
+
+   if (mpStep != NULL)
+   {
+      mpStep->addProperty(info + " Pixels Sampled", statistics.getCount());
+      mpStep->addProperty(info + " Blocks Sampled", estimator.getNumBlocksProcessed());
+   }
+
+   // if calculating for mpRaster, then save the band means
+   if (pRaster == mpRaster)
+   {
+      mSignalBandMeans = statistics.getMeans();
+   }
+
+   if (pStatistics != NULL)
+   {
+      *pStatistics = statistics;
+   }
+
+   if (mpProgress != NULL)
+   {
+      mpProgress->updateProgress("Covariance Matrix Complete", 100, NORMAL);
+   }
+
+   return true;
+}
+
 AoiElement* Mnf::createDifferenceAoi(AoiElement* pAoi, RasterElement* pParent)
 {
    if (pAoi == NULL || pParent == NULL)
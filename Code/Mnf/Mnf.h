@@ -16,6 +16,7 @@
 #include "AlgorithmShell.h"
 #include "ApplicationServices.h"
 #include "BitMask.h"
+#include "CovarianceEstimator.h"
 #include "DesktopServices.h"
 #include "EnumWrapper.h"
 #include "MessageLogMgr.h"
@@ -48,7 +49,12 @@ public:
 protected:
    virtual bool extractInputArgs(const PlugInArgList* pArgList);
    bool computeCovarianceMatrix(RasterElement* pRaster, double** pMatrix,
-      std::string info = std::string(), AoiElement* pAoi = NULL, int rowSkip = 1, int colSkip = 1);
+      std::string info = std::string(), AoiElement* pAoi = NULL, int rowSkip = 1, int colSkip = 1,
+      CovarianceAccumulator* pStatistics = NULL);
+   bool computeSampledCovarianceMatrix(RasterElement* pRaster, double** pMatrix, const std::string& info,
+      AoiElement* pAoi, CovarianceAccumulator* pStatistics);
+   bool mergeStatistics(CovarianceAccumulator& statistics, const CovarianceAccumulator& baseStatistics,
+      double** pMatrix, const std::string& info);
    bool calculateEigenValues();
    bool createMnfCube();
    bool computeMnfValues();
@@ -57,6 +63,7 @@ protected:
    AoiElement* getAoiElement(const std::string& aoiName, RasterElement* pRaster);
    bool writeOutMnfTransform(const std::string& filename);
    bool readInMnfTransform(const std::string& filename);
+   bool readInMnfStatistics(const std::string& filename);
    AoiElement* generateAutoSelectionMask(float bandFractionThreshold);
    RasterElement* createDifferenceRaster(AoiElement* pAoi);
    AoiElement* createDifferenceAoi(AoiElement* pAoi, RasterElement* pParent);
@@ -95,6 +102,12 @@ private:
    unsigned int mNumComponentsToUse;
    bool mbUseSnrValPlot;
    bool mbDisplayResults;
+   double mStatisticsTolerance;
+   std::string mMergeTransformFilename;
+   CovarianceAccumulator mSignalStatistics;
+   CovarianceAccumulator mNoiseStatistics;
+   CovarianceAccumulator mBaseSignalStatistics;
+   CovarianceAccumulator mBaseNoiseStatistics;
    std::string mMessage;
 
 
@@ -12,6 +12,7 @@
 #include <QtGui/QCheckBox>
 #include <QtGui/QComboBox>
 #include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
 #include <QtGui/QFileDialog>
 #include <QtGui/QLineEdit>
 #include <QtGui/QGroupBox>
@@ -55,14 +56,46 @@ MnfDlg::MnfDlg(const vector<string> &aoiList, unsigned int ulBands, QWidget* par
    pMethodLayout->addWidget(mpMethodCombo);
    pMethodLayout->addStretch(10);
 
+   mpAdaptiveCheck = new QCheckBox("Adaptive Sampling Tolerance (%):", pTransformGroup);
+   mpAdaptiveCheck->setToolTip("Sample the statistics from randomly ordered blocks of the data and\n"
+      "stop once the covariance estimates change by less than the tolerance.");
+   mpToleranceSpin = new QDoubleSpinBox(pTransformGroup);
+   mpToleranceSpin->setDecimals(3);
+   mpToleranceSpin->setRange(0.001, 10.0);
+   mpToleranceSpin->setSingleStep(0.05);
+   mpToleranceSpin->setValue(0.1);
+
+   QHBoxLayout* pAdaptiveLayout = new QHBoxLayout();
+   pAdaptiveLayout->setMargin(0);
+   pAdaptiveLayout->setSpacing(5);
+   pAdaptiveLayout->addWidget(mpAdaptiveCheck);
+   pAdaptiveLayout->addWidget(mpToleranceSpin);
+   pAdaptiveLayout->addStretch(10);
+
+   mpMergeCheck = new QCheckBox("Merge Statistics From:", pTransformGroup);
+   mpMergeCheck->setToolTip("Combine the signal and noise statistics saved in a previous MNF transform\n"
+      "file with the statistics of this data set, e.g. to update a transform one strip at a time.");
+   mpMergeEdit = new QLineEdit(pTransformGroup);
+
+   QIcon icnBrowse(":/icons/Open");
+
+   mpMergeBrowseButton = new QPushButton(icnBrowse, QString(), pTransformGroup);
+   mpMergeBrowseButton->setFixedWidth(27);
+   VERIFYNRV(connect(mpMergeBrowseButton, SIGNAL(clicked()), this, SLOT(browseMerge())));
+
+   QHBoxLayout* pMergeLayout = new QHBoxLayout();
+   pMergeLayout->setMargin(0);
+   pMergeLayout->setSpacing(5);
+   pMergeLayout->addWidget(mpMergeCheck);
+   pMergeLayout->addWidget(mpMergeEdit, 10);
+   pMergeLayout->addWidget(mpMergeBrowseButton);
+
    mpFileRadio = new QRadioButton("Load From File", pTransformGroup);
    mpFileRadio->setFocusPolicy(Qt::StrongFocus);
 
    mpFileEdit = new QLineEdit(pTransformGroup);
    mpFileEdit->setMinimumWidth(250);
 
-   QIcon icnBrowse(":/icons/Open");
-
    QPushButton* pBrowseButton = new QPushButton(icnBrowse, QString(), pTransformGroup);
    pBrowseButton->setFixedWidth(27);
    VERIFYNRV(connect(pBrowseButton, SIGNAL(clicked()), this, SLOT(browse())));
@@ -79,12 +112,20 @@ MnfDlg::MnfDlg(const vector<string> &aoiList, unsigned int ulBands, QWidget* par
    pTransformGrid->setColumnMinimumWidth(0, 13);
    pTransformGrid->addWidget(mpCalculateRadio, 0, 0, 1, 2);
    pTransformGrid->addLayout(pMethodLayout, 1, 1);
-   pTransformGrid->addWidget(mpFileRadio, 2, 0, 1, 2);
-   pTransformGrid->addLayout(pFileLayout, 3, 1);
-   pTransformGrid->setRowStretch(4, 10);
+   pTransformGrid->addLayout(pAdaptiveLayout, 2, 1);
+   pTransformGrid->addLayout(pMergeLayout, 3, 1);
+   pTransformGrid->addWidget(mpFileRadio, 4, 0, 1, 2);
+   pTransformGrid->addLayout(pFileLayout, 5, 1);
+   pTransformGrid->setRowStretch(6, 10);
 
    VERIFYNRV(connect(mpCalculateRadio, SIGNAL(toggled(bool)), pMethodLabel, SLOT(setEnabled(bool))));
    VERIFYNRV(connect(mpCalculateRadio, SIGNAL(toggled(bool)), mpMethodCombo, SLOT(setEnabled(bool))));
+   VERIFYNRV(connect(mpCalculateRadio, SIGNAL(toggled(bool)), mpAdaptiveCheck, SLOT(setEnabled(bool))));
+   VERIFYNRV(connect(mpCalculateRadio, SIGNAL(toggled(bool)), this, SLOT(updateToleranceWidget())));
+   VERIFYNRV(connect(mpAdaptiveCheck, SIGNAL(toggled(bool)), this, SLOT(updateToleranceWidget())));
+   VERIFYNRV(connect(mpCalculateRadio, SIGNAL(toggled(bool)), mpMergeCheck, SLOT(setEnabled(bool))));
+   VERIFYNRV(connect(mpCalculateRadio, SIGNAL(toggled(bool)), this, SLOT(updateMergeWidgets())));
+   VERIFYNRV(connect(mpMergeCheck, SIGNAL(toggled(bool)), this, SLOT(updateMergeWidgets())));
    VERIFYNRV(connect(mpFileRadio, SIGNAL(toggled(bool)), mpFileEdit, SLOT(setEnabled(bool))));
    VERIFYNRV(connect(mpFileRadio, SIGNAL(toggled(bool)), pBrowseButton, SLOT(setEnabled(bool))));
 
@@ -166,6 +207,10 @@ MnfDlg::MnfDlg(const vector<string> &aoiList, unsigned int ulBands, QWidget* par
    pBrowseButton->setEnabled(false);
    mpComponentsSpin->setValue(ulBands);
    mpRoiCombo->setEnabled(false);
+   mpAdaptiveCheck->setChecked(false);
+   updateToleranceWidget();
+   mpMergeCheck->setChecked(false);
+   updateMergeWidgets();
 }
 
 MnfDlg::~MnfDlg()
@@ -213,6 +258,57 @@ string MnfDlg::getRoiName() const
    return strRoiName;
 }
 
+double MnfDlg::getStatisticsTolerance() const
+{
+   double tolerance = 0.0;
+   if (mpCalculateRadio->isChecked() && mpAdaptiveCheck->isChecked())
+   {
+      tolerance = mpToleranceSpin->value() / 100.0;
+   }
+
+   return tolerance;
+}
+
+string MnfDlg::getMergeTransformFilename() const
+{
+   string strFilename;
+   if (mpCalculateRadio->isChecked() && mpMergeCheck->isChecked())
+   {
+      strFilename = mpMergeEdit->text().toStdString();
+   }
+
+   return strFilename;
+}
+
+void MnfDlg::browseMerge()
+{
+   QString importPath;
+   const Filename* pImportPath = ConfigurationSettings::getSettingImportPath();
+   if (pImportPath != NULL)
+   {
+      importPath = QString::fromStdString(pImportPath->getFullPathAndName());
+   }
+
+   QString strFilename = QFileDialog::getOpenFileName(this, "Select MNF Transform File", importPath,
+      "MNF files (*.mnf);;All Files (*)");
+   if (strFilename.isEmpty() == false)
+   {
+      mpMergeEdit->setText(strFilename);
+   }
+}
+
+void MnfDlg::updateToleranceWidget()
+{
+   mpToleranceSpin->setEnabled(mpCalculateRadio->isChecked() && mpAdaptiveCheck->isChecked());
+}
+
+void MnfDlg::updateMergeWidgets()
+{
+   bool enableMerge = mpCalculateRadio->isChecked() && mpMergeCheck->isChecked();
+   mpMergeEdit->setEnabled(enableMerge);
+   mpMergeBrowseButton->setEnabled(enableMerge);
+}
+
 void MnfDlg::browse()
 {
    QString importPath;
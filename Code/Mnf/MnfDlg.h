@@ -19,6 +19,7 @@
 
 class QCheckBox;
 class QComboBox;
+class QDoubleSpinBox;
 class QLineEdit;
 class QPushButton;
 class QRadioButton;
@@ -36,6 +37,8 @@ public:
    std::string getNoiseStatisticsMethod() const;
    std::string getTransformFilename() const;
    std::string getRoiName() const;
+   double getStatisticsTolerance() const;
+   std::string getMergeTransformFilename() const;
 
    bool selectNumComponentsFromPlot();
    unsigned int getNumComponents() const;
@@ -44,10 +47,18 @@ public:
 
 protected slots:
    void browse();
+   void browseMerge();
+   void updateToleranceWidget();
+   void updateMergeWidgets();
 
 private:
    QRadioButton* mpCalculateRadio;
    QComboBox* mpMethodCombo;
+   QCheckBox* mpAdaptiveCheck;
+   QDoubleSpinBox* mpToleranceSpin;
+   QCheckBox* mpMergeCheck;
+   QLineEdit* mpMergeEdit;
+   QPushButton* mpMergeBrowseButton;
    QRadioButton* mpFileRadio;
    QLineEdit* mpFileEdit;
    QSpinBox* mpComponentsSpin;
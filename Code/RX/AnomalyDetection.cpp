@@ -15,6 +15,7 @@
 #include "SpatialDataWindow.h"
 #include "switchOnEncoding.h"
 #include "AnomalyDetection.h"
+#include "CovarianceEstimator.h"
 #include <limits>
 #include <iostream>
 
@@ -26,52 +27,6 @@ REGISTER_PLUGIN_BASIC(AnomalyDetectionModule, AnomalyDetection);
 
 namespace
 {
-	int meanmat(TNT::Matrix<double> subdata, int col, int row,int bands, TNT::Matrix<double> &u)
-	{		
-		if (u.num_rows()<bands)
-			return -1;
-
-		int count = col*row;
-		for (int i = 0; i < bands; i++)
-		{
-			for (int j = 0; j < count; j++)
-				u[i][0] += subdata[i][j];
-			u[i][0] = (u)[i][0] / count;
-		}
-		return 1;
-	}
-
-	int covmat(TNT::Matrix<double> subData, int col, int row, int bands, TNT::Matrix<double> me, TNT::Matrix<double> &cov)
-	{
-
-		TNT::Matrix<double> temp(bands, 1, 0.0); 
-
-		int count = col * row;
-		for (int i = 0; i < count; i++)
-		{
-			for (int j = 0; j < bands; j++)
-				temp[j][0] = subData[j][i] - me[j][0];
-
-			for (int m = 0; m < bands; m++)
-				for (int n = m; n < bands; n++)
-				{
-					cov[n][m] = temp[m][0] * temp[n][0];
-				}
-		}
-
-		int count2 = count-1;
-		for (int i = 0; i < bands; i++)
-		{
-			for (int j = i + 1; j < bands; j++)
-			{
-				cov[j][i] /= count2;
-				cov[i][j] = cov[j][i];
-			}
-			cov[i][i] /= count2;
-		}
-		return 1;
-	}
-
 	int adddiag(int bands, double weight,TNT::Matrix<double> &cov)
 	{
 		for (int i = 0; i < bands; i++)
@@ -80,7 +35,8 @@ namespace
 		return 1;
 	}
 
-	int rxl(TNT::Matrix<double> &rxd, TNT::Matrix<double> realdata,int samples, int lines, int bands, Progress *pProgress)
+	int rxl(TNT::Matrix<double> &rxd, TNT::Matrix<double> realdata,int samples, int lines, int bands,
+		const CovarianceAccumulator& statistics, Progress *pProgress)
 	{
 		TNT::Matrix<double> u(bands, 1, 0.0);  
 		TNT::Matrix<double> temp(bands , 1, 0.0);  
@@ -97,13 +53,20 @@ namespace
 			return -1;
 		}
 
-		ret = meanmat(realdata,samples,lines,bands,u);
+		const std::vector<double>& means = statistics.getMeans();
+		for (int i = 0; i < bands; i++)
+			u[i][0] = means[i];
+
+		double **pCov = cov;
+		if (!statistics.getCovariance(pCov))
+		{
+			return -1;
+		}
+		ret = 1;
 		if (pProgress != NULL)
 		{
-			pProgress->updateProgress("Calculating", 20 * 100 / 100, NORMAL);
+			pProgress->updateProgress("Calculating", 30 * 100 / 100, NORMAL);
 		}
-		ret = covmat(realdata,samples ,lines,bands,u,cov);
-		pProgress->updateProgress("Calculating", 30 * 100 / 100, NORMAL);
 		for (int i = 0; i < bands; i++)
 		{
 			weight += cov[i][i];
@@ -147,7 +110,8 @@ namespace
 
 	template <class T>
 	void RxAnomalyDetection(T *pData, DataAccessor pSrcAcc, DataAccessor desAcc, 
-							int rowCount, int colCount, int bandCount, Progress *pProgress) 
+							int rowCount, int colCount, int bandCount, const CovarianceAccumulator* pStatistics,
+							Progress *pProgress) 
 	{
 	   int ret=0;
 
@@ -169,7 +133,7 @@ namespace
 			pProgress->updateProgress("Calculating", 10 * 100 / 100, NORMAL);
 		}
 
-	   ret = rxl(rxdResult, background, colCount, rowCount, bandCount, pProgress);
+	   ret = rxl(rxdResult, background, colCount, rowCount, bandCount, *pStatistics, pProgress);
 
 	   for (int row = 0; row < rowCount; row++)
 	   {
@@ -209,6 +173,8 @@ bool AnomalyDetection::getInputSpecification(PlugInArgList*& pInArgList)
    VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
    pInArgList->addArg<Progress>(Executable::ProgressArg(), NULL, "Progress reporter");
    pInArgList->addArg<RasterElement>(Executable::DataElementArg(), "Perform edge detection on this data element");
+   pInArgList->addArg<double>("Statistics Tolerance", 0.0, "Relative change in the background covariance estimate "
+      "at which adaptive block sampling stops. If zero, every pixel is used.");
    return true;
 }
 
@@ -258,6 +224,39 @@ bool AnomalyDetection::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArg
       return false;
    }
 
+   double tolerance = 0.0;
+   pInArgList->getPlugInArgValue<double>("Statistics Tolerance", tolerance);
+
+   // background statistics, sampled from random blocks when a tolerance is given
+   AdaptiveCovarianceEstimator estimator(pCube, NULL, tolerance);
+   while (!estimator.isConverged() && estimator.processNextBlock())
+   {
+      if (isAborted())
+      {
+         pStep->finalize(Message::Abort);
+         if (pProgress != NULL)
+         {
+            pProgress->updateProgress("RX anomaly detection aborted.", 0, ABORT);
+         }
+         return false;
+      }
+      if (pProgress != NULL)
+      {
+         pProgress->updateProgress("Computing background statistics", estimator.getPercentSampled() / 10, NORMAL);
+      }
+   }
+   if (estimator.getAccumulator().getCount() < 2.0)
+   {
+      std::string msg = "Unable to compute the background statistics.";
+      pStep->finalize(Message::Failure, msg);
+      if (pProgress != NULL) 
+      {
+         pProgress->updateProgress(msg, 0, ERRORS);
+      }
+      return false;
+   }
+   pStep->addProperty("Background Pixels Sampled", estimator.getAccumulator().getCount());
+
    FactoryResource<DataRequest> pRequest;
    pRequest->setInterleaveFormat(BIP);
    DataAccessor pSrcAcc = pCube->getDataAccessor(pRequest.release());
@@ -280,7 +279,8 @@ bool AnomalyDetection::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArg
    pResultRequest->setWritable(true);
    DataAccessor pDestAcc = pResultCube->getDataAccessor(pResultRequest.release());
    switchOnEncoding(pDesc->getDataType(), RxAnomalyDetection, pDestAcc->getColumn(), pSrcAcc, pDestAcc, 
-	                pDesc->getRowCount(), pDesc->getColumnCount(), pDesc->getBandCount(), pProgress);	
+	                pDesc->getRowCount(), pDesc->getColumnCount(), pDesc->getBandCount(), &estimator.getAccumulator(),
+	                pProgress);	
 //   switchOnEncoding(pDesc->getDataType(), cannyEdgeDetection, pDestAcc->getColumn(), pSrcAcc, pDestAcc, pDesc->getRowCount(), pDesc->getColumnCount());
 
    if (!isBatch())
@@ -0,0 +1,493 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include <QtCore/QStringList>
+#include <QtGui/QInputDialog>
+#include <QtGui/QMessageBox>
+
+#include "AppVerify.h"
+#include "ConfigurationSettings.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "DataSetResampler.h"
+#include "DesktopServices.h"
+#include "DynamicObject.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "Progress.h"
+#include "ProgressTracker.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterUtilities.h"
+#include "ResamplerOptions.h"
+#include "ResamplingPlan.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "SpectralVersion.h"
+#include "switchOnEncoding.h"
+#include "TypeConverter.h"
+#include "Undo.h"
+#include "Wavelengths.h"
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralResampler, DataSetResampler);
+
+DataSetResampler::DataSetResampler() :
+   mAbortFlag(false)
+{
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+   setName("Data Set Resampler");
+   setDescription("Resamples every pixel of a data set to the wavelengths of another sensor.");
+   setShortDescription("Resamples a data set to new wavelengths.");
+   setDescriptorId("{5DA2DFF2-7FAD-4CFB-A6EC-973C92F30812}");
+   setMenuLocation("[Spectral]\\Preprocessing\\Resample Data Set");
+   setAbortSupported(true);
+}
+
+DataSetResampler::~DataSetResampler()
+{
+}
+
+bool DataSetResampler::getInputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = Service<PlugInManagerServices>()->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+   VERIFY(pArgList->addArg<Progress>(Executable::ProgressArg(), NULL));
+   VERIFY(pArgList->addArg<RasterElement>(Executable::DataElementArg(), NULL, "The data set to resample."));
+   VERIFY(pArgList->addArg<RasterElement>("Target Data Element", NULL,
+      "A data set whose wavelengths are used as the target wavelengths."));
+   VERIFY(pArgList->addArg<DynamicObject>(Wavelengths::WavelengthsArg(), NULL,
+      "The target wavelengths. If set, \"Target Data Element\" is ignored."));
+   VERIFY(pArgList->addArg<string>("Resampler Method", string(),
+      "The resampling method. If empty, the method in the Resampler options is used."));
+
+   return true;
+}
+
+bool DataSetResampler::getOutputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = Service<PlugInManagerServices>()->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+   VERIFY(pArgList->addArg<RasterElement>(Executable::DataElementArg(), NULL, "The resampled data set."));
+
+   return true;
+}
+
+bool DataSetResampler::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   VERIFY(pInArgList != NULL);
+   ProgressTracker progress(pInArgList->getPlugInArgValue<Progress>(Executable::ProgressArg()),
+      "Resampling data set", "spectral", "D7A79E12-B4E8-42F6-9061-7DAE321543E4");
+   mAbortFlag = false;
+
+   RasterElement* pInput = pInArgList->getPlugInArgValue<RasterElement>(Executable::DataElementArg());
+   if (pInput == NULL)
+   {
+      progress.report("No data set was specified.", 0, ERRORS, true);
+      return false;
+   }
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pInput->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+   const EncodingType encoding = pDescriptor->getDataType();
+   if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+   {
+      progress.report(getName() + " cannot be used on data sets containing complex data.", 0, ERRORS, true);
+      return false;
+   }
+
+   vector<double> fromWavelengths;
+   vector<double> fromFwhm;
+   if (getWavelengths(pInput->getMetadata(), fromWavelengths, fromFwhm) == false ||
+      fromWavelengths.size() != pDescriptor->getBandCount())
+   {
+      progress.report("The data set does not have a wavelength for each band.", 0, ERRORS, true);
+      return false;
+   }
+
+   DynamicObject* pWavelengthData = pInArgList->getPlugInArgValue<DynamicObject>(Wavelengths::WavelengthsArg());
+   if (pWavelengthData == NULL)
+   {
+      RasterElement* pTarget = pInArgList->getPlugInArgValue<RasterElement>("Target Data Element");
+      if (pTarget == NULL && isBatch() == false)
+      {
+         pTarget = getTargetElement(pInput);
+      }
+
+      if (pTarget != NULL)
+      {
+         pWavelengthData = pTarget->getMetadata();
+      }
+   }
+
+   vector<double> toWavelengths;
+   vector<double> toFwhm;
+   if (getWavelengths(pWavelengthData, toWavelengths, toFwhm) == false)
+   {
+      progress.report("No target wavelengths were specified.", 0, ERRORS, true);
+      return false;
+   }
+
+   string resamplerMethod;
+   pInArgList->getPlugInArgValue<string>("Resampler Method", resamplerMethod);
+   if (resamplerMethod.empty())
+   {
+      resamplerMethod = ResamplerOptions::getSettingResamplerMethod();
+   }
+
+   progress.getCurrentStep()->addProperty("Data Set", pInput->getName());
+   progress.getCurrentStep()->addProperty("Resampler Method", resamplerMethod);
+
+   ResamplingPlan plan;
+   string errorMessage;
+   if (plan.initialize(fromWavelengths, toWavelengths, toFwhm, resamplerMethod,
+      ResamplerOptions::getSettingDropOutWindow(), ResamplerOptions::getSettingFullWidthHalfMax(),
+      errorMessage) == false)
+   {
+      progress.report("Unable to resample the data set: " + errorMessage, 0, ERRORS, true);
+      return false;
+   }
+
+   ModelResource<RasterElement> pOutput(createOutputRasterElement(pInput, toWavelengths, toFwhm,
+      plan.getToBands(), errorMessage));
+   if (pOutput.get() == NULL)
+   {
+      progress.report(errorMessage, 0, ERRORS, true);
+      return false;
+   }
+
+   DataSetResamplerInput resamplerInput(pInput, pOutput.get(), plan, &mAbortFlag);
+   DataSetResamplerOutput resamplerOutput;
+   mta::ProgressObjectReporter reporter("Resampling data set", progress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<DataSetResamplerInput, DataSetResamplerOutput, DataSetResamplerThread>
+      mtaResampler(Service<ConfigurationSettings>()->getSettingThreadCount(), resamplerInput,
+      resamplerOutput, &reporter);
+   mtaResampler.run();
+   if (mAbortFlag)
+   {
+      progress.abort();
+      return false;
+   }
+
+   if (resamplerOutput.mSuccess == false)
+   {
+      progress.report("Unable to resample the data set.", 0, ERRORS, true);
+      return false;
+   }
+
+   pOutput->updateData();
+
+   if (isBatch() == false)
+   {
+      Service<DesktopServices> pDesktop;
+      SpatialDataWindow* pWindow = dynamic_cast<SpatialDataWindow*>(
+         pDesktop->createWindow(pOutput->getName(), SPATIAL_DATA_WINDOW));
+      SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+      if (pView == NULL)
+      {
+         progress.report("Unable to create a window for the resampled data set.", 0, WARNING, true);
+      }
+      else
+      {
+         UndoLock undoLock(pView);
+         if (pView->setPrimaryRasterElement(pOutput.get()) == false ||
+            pView->createLayer(RASTER, pOutput.get()) == NULL)
+         {
+            progress.report("Unable to display the resampled data set.", 0, WARNING, true);
+         }
+      }
+   }
+
+   if (pOutArgList != NULL)
+   {
+      pOutArgList->setPlugInArgValue(Executable::DataElementArg(), pOutput.get());
+   }
+
+   pOutput.release();
+   progress.report("Data set resampled", 100, NORMAL);
+   progress.upALevel();
+   return true;
+}
+
+bool DataSetResampler::abort()
+{
+   mAbortFlag = true;
+   return AlgorithmShell::abort();
+}
+
+RasterElement* DataSetResampler::getTargetElement(const RasterElement* pInput) const
+{
+   vector<RasterElement*> targets;
+   QStringList targetNames;
+   vector<DataElement*> elements = Service<ModelServices>()->getElements(TypeConverter::toString<RasterElement>());
+   for (vector<DataElement*>::const_iterator iter = elements.begin(); iter != elements.end(); ++iter)
+   {
+      RasterElement* pElement = dynamic_cast<RasterElement*>(*iter);
+      vector<double> centerValues;
+      vector<double> fwhm;
+      if (pElement != NULL && pElement != pInput && getWavelengths(pElement->getMetadata(), centerValues, fwhm))
+      {
+         targets.push_back(pElement);
+         targetNames.append(QString::fromStdString(pElement->getName()));
+      }
+   }
+
+   if (targets.empty())
+   {
+      return NULL;
+   }
+
+   bool accepted = false;
+   QString targetName = QInputDialog::getItem(Service<DesktopServices>()->getMainWidget(),
+      QString::fromStdString(getName()), "Resample to the wavelengths of:", targetNames, 0, false, &accepted);
+   int index = targetNames.indexOf(targetName);
+   if (accepted == false || index < 0)
+   {
+      return NULL;
+   }
+
+   return targets[index];
+}
+
+RasterElement* DataSetResampler::createOutputRasterElement(const RasterElement* pInput,
+   const vector<double>& centerValues, const vector<double>& fwhm, const vector<int>& toBands,
+   string& errorMessage) const
+{
+   const string outputName = pInput->getName() + " - Resampled";
+
+   // If a resampled data set already exists, make sure that the user wants to recreate it
+   // In batch mode, do not prompt the user; simply destroy the existing data set
+   Service<ModelServices> pModel;
+   DataElement* pExisting = pModel->getElement(outputName, TypeConverter::toString<RasterElement>(), NULL);
+   if (pExisting != NULL)
+   {
+      if (isBatch() == false && QMessageBox::question(NULL, QString::fromStdString(getName()),
+         QString::fromStdString("A data set named \"" + outputName + "\" already exists.\n"
+         "Would you like to replace it?"), QMessageBox::Yes, QMessageBox::No) == QMessageBox::No)
+      {
+         errorMessage = "A data set named \"" + outputName + "\" already exists.";
+         return NULL;
+      }
+
+      if (isBatch() == false)
+      {
+         Service<DesktopServices> pDesktop;
+         pDesktop->deleteWindow(pDesktop->getWindow(outputName, SPATIAL_DATA_WINDOW));
+      }
+
+      if (pModel->destroyElement(pExisting) == false)
+      {
+         errorMessage = "Unable to destroy the existing data set \"" + outputName + "\".";
+         return NULL;
+      }
+   }
+
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(pInput->getDataDescriptor());
+   VERIFYRV(pDescriptor != NULL, NULL);
+   const unsigned int numRows = pDescriptor->getRowCount();
+   const unsigned int numColumns = pDescriptor->getColumnCount();
+   const unsigned int numBands = toBands.size();
+
+   // Try to keep the results in memory, falling back to a temporary file on disk
+   RasterElement* pOutput = RasterUtilities::createRasterElement(outputName, numRows, numColumns, numBands,
+      FLT4BYTES, BIP, true);
+   if (pOutput == NULL)
+   {
+      pOutput = RasterUtilities::createRasterElement(outputName, numRows, numColumns, numBands,
+         FLT4BYTES, BIP, false);
+   }
+
+   if (pOutput == NULL)
+   {
+      errorMessage = "Unable to create the resampled data set.";
+      return NULL;
+   }
+
+   RasterDataDescriptor* pOutputDescriptor = dynamic_cast<RasterDataDescriptor*>(pOutput->getDataDescriptor());
+   VERIFYRV(pOutputDescriptor != NULL, NULL);
+   pOutputDescriptor->setMetadata(pInput->getMetadata());
+
+   const Units* pUnits = pDescriptor->getUnits();
+   if (pUnits != NULL)
+   {
+      pOutputDescriptor->setUnits(pUnits);
+   }
+
+   // Replace the input wavelengths with those of the resampled bands
+   vector<double> startValues;
+   vector<double> outputCenterValues;
+   vector<double> endValues;
+   for (vector<int>::const_iterator iter = toBands.begin(); iter != toBands.end(); ++iter)
+   {
+      outputCenterValues.push_back(centerValues[*iter]);
+      if (fwhm.size() == centerValues.size())
+      {
+         startValues.push_back(centerValues[*iter] - fwhm[*iter] / 2.0);
+         endValues.push_back(centerValues[*iter] + fwhm[*iter] / 2.0);
+      }
+   }
+
+   FactoryResource<DynamicObject> pWavelengthData;
+   Wavelengths wavelengths(pWavelengthData.get());
+   wavelengths.setUnits(Wavelengths::MICRONS);
+   wavelengths.setStartValues(startValues, Wavelengths::MICRONS);
+   wavelengths.setCenterValues(outputCenterValues, Wavelengths::MICRONS);
+   wavelengths.setEndValues(endValues, Wavelengths::MICRONS);
+   if (wavelengths.applyToDataset(pOutput) == false)
+   {
+      pModel->destroyElement(pOutput);
+      errorMessage = "Unable to set the wavelengths of the resampled data set.";
+      return NULL;
+   }
+
+   return pOutput;
+}
+
+bool DataSetResampler::getWavelengths(const DynamicObject* pWavelengthData, vector<double>& centerValues,
+   vector<double>& fwhm)
+{
+   if (pWavelengthData == NULL)
+   {
+      return false;
+   }
+
+   // Work on a copy so the units of the source are not changed
+   FactoryResource<DynamicObject> pWavelengthCopy;
+   Wavelengths wavelengths(pWavelengthCopy.get());
+   if (wavelengths.initializeFromDynamicObject(pWavelengthData) == false || wavelengths.hasCenterValues() == false)
+   {
+      return false;
+   }
+
+   wavelengths.setUnits(Wavelengths::MICRONS);
+   centerValues = wavelengths.getCenterValues();
+   fwhm = wavelengths.getFwhm();
+   if (fwhm.size() != centerValues.size())
+   {
+      fwhm.clear();
+   }
+
+   return true;
+}
+
+DataSetResamplerThread::DataSetResamplerThread(const DataSetResamplerInput& input,
+   int threadCount,
+   int threadIndex,
+   mta::ThreadReporter& reporter) :
+   mta::AlgorithmThread(threadIndex, reporter),
+   mInput(input),
+   mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
+      input.mpInput->getDataDescriptor())->getRowCount())),
+   mSuccess(false)
+{
+}
+
+void DataSetResamplerThread::run()
+{
+   EncodingType encoding = static_cast<const RasterDataDescriptor*>(
+      mInput.mpInput->getDataDescriptor())->getDataType();
+   switchOnEncoding(encoding, DataSetResamplerThread::resampleRows, NULL);
+}
+
+bool DataSetResamplerThread::isSuccessful() const
+{
+   return mSuccess;
+}
+
+template<class T>
+void DataSetResamplerThread::resampleRows(const T* pDummyData)
+{
+   if (mRowRange.mLast < mRowRange.mFirst)
+   {
+      mSuccess = true;
+      return;
+   }
+
+   const RasterDataDescriptor* pInputDescriptor =
+      static_cast<const RasterDataDescriptor*>(mInput.mpInput->getDataDescriptor());
+   const RasterDataDescriptor* pOutputDescriptor =
+      static_cast<const RasterDataDescriptor*>(mInput.mpOutput->getDataDescriptor());
+   const unsigned int numColumns = pInputDescriptor->getColumnCount();
+   const unsigned int numFromBands = pInputDescriptor->getBandCount();
+   const unsigned int numToBands = pOutputDescriptor->getBandCount();
+
+   FactoryResource<DataRequest> pInputRequest;
+   pInputRequest->setInterleaveFormat(BIP);
+   pInputRequest->setRows(pInputDescriptor->getActiveRow(mRowRange.mFirst),
+      pInputDescriptor->getActiveRow(mRowRange.mLast));
+   DataAccessor inputAccessor = mInput.mpInput->getDataAccessor(pInputRequest.release());
+
+   FactoryResource<DataRequest> pOutputRequest;
+   pOutputRequest->setInterleaveFormat(BIP);
+   pOutputRequest->setRows(pOutputDescriptor->getActiveRow(mRowRange.mFirst),
+      pOutputDescriptor->getActiveRow(mRowRange.mLast));
+   pOutputRequest->setWritable(true);
+   DataAccessor outputAccessor = mInput.mpOutput->getDataAccessor(pOutputRequest.release());
+
+   vector<double> fromSpectrum(numFromBands);
+   vector<double> toSpectrum(numToBands);
+   vector<double> workspace;
+   int oldPercentDone = -1;
+   for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
+   {
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         return;
+      }
+
+      int percentDone = mRowRange.computePercent(row);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+
+      if (inputAccessor.isValid() == false || outputAccessor.isValid() == false)
+      {
+         return;
+      }
+
+      const T* pInputPixel = reinterpret_cast<const T*>(inputAccessor->getRow());
+      float* pOutputPixel = reinterpret_cast<float*>(outputAccessor->getRow());
+      for (unsigned int column = 0; column < numColumns; ++column)
+      {
+         for (unsigned int band = 0; band < numFromBands; ++band)
+         {
+            fromSpectrum[band] = static_cast<double>(pInputPixel[band]);
+         }
+
+         if (numFromBands > 0 && numToBands > 0)
+         {
+            mInput.mPlan.apply(&fromSpectrum.front(), &toSpectrum.front(), workspace);
+         }
+
+         for (unsigned int band = 0; band < numToBands; ++band)
+         {
+            pOutputPixel[band] = static_cast<float>(toSpectrum[band]);
+         }
+
+         pInputPixel += numFromBands;
+         pOutputPixel += numToBands;
+      }
+
+      inputAccessor->nextRow();
+      outputAccessor->nextRow();
+   }
+
+   getReporter().reportProgress(getThreadIndex(), 100);
+   mSuccess = true;
+}
@@ -0,0 +1,121 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef DATASETRESAMPLER_H
+#define DATASETRESAMPLER_H
+
+#include "AlgorithmShell.h"
+#include "MultiThreadedAlgorithm.h"
+
+#include <string>
+#include <vector>
+
+class DynamicObject;
+class Progress;
+class RasterElement;
+class ResamplingPlan;
+
+struct DataSetResamplerInput
+{
+   DataSetResamplerInput(const RasterElement* pInput,
+      RasterElement* pOutput,
+      const ResamplingPlan& plan,
+      const bool* pAbortFlag) :
+         mpInput(pInput),
+         mpOutput(pOutput),
+         mPlan(plan),
+         mpAbortFlag(pAbortFlag)
+   {
+   }
+
+   const RasterElement* mpInput;
+   RasterElement* mpOutput;
+   const ResamplingPlan& mPlan;
+   const bool* mpAbortFlag;
+};
+
+/**
+ * Resamples the pixels in one tile of rows.
+ *
+ * Both cubes are accessed as BIP so each pixel's spectrum is contiguous in the
+ * input and each resampled spectrum is written contiguously to the output.
+ */
+class DataSetResamplerThread : public mta::AlgorithmThread
+{
+public:
+   DataSetResamplerThread(const DataSetResamplerInput& input,
+      int threadCount,
+      int threadIndex,
+      mta::ThreadReporter& reporter);
+
+   void run();
+   bool isSuccessful() const;
+
+   template<class T> void resampleRows(const T* pDummyData);
+
+private:
+   const DataSetResamplerInput& mInput;
+   mta::AlgorithmThread::Range mRowRange;
+   bool mSuccess;
+};
+
+struct DataSetResamplerOutput
+{
+   DataSetResamplerOutput() : mSuccess(false) {}
+
+   bool compileOverallResults(const std::vector<DataSetResamplerThread*>& threads)
+   {
+      mSuccess = true;
+      for (std::vector<DataSetResamplerThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+      {
+         if (*iter == NULL || (*iter)->isSuccessful() == false)
+         {
+            mSuccess = false;
+         }
+      }
+
+      return mSuccess;
+   }
+
+   bool mSuccess;
+};
+
+/**
+ * Resamples every pixel of a data set to the wavelengths of another sensor.
+ *
+ * The target wavelengths come from the "Wavelengths" argument or, if that is not
+ * set, from the wavelength metadata of the "Target Data Element". The resampling
+ * method and parameters are those selected in the Resampler options unless the
+ * "Resampler Method" argument is set. The result is a new floating point data set
+ * containing the target bands which could be resampled.
+ */
+class DataSetResampler : public AlgorithmShell
+{
+public:
+   DataSetResampler();
+   ~DataSetResampler();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool getOutputSpecification(PlugInArgList*& pArgList);
+
+   bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   bool abort();
+
+private:
+   RasterElement* getTargetElement(const RasterElement* pInput) const;
+   RasterElement* createOutputRasterElement(const RasterElement* pInput, const std::vector<double>& centerValues,
+      const std::vector<double>& fwhm, const std::vector<int>& toBands, std::string& errorMessage) const;
+
+   static bool getWavelengths(const DynamicObject* pWavelengthData, std::vector<double>& centerValues,
+      std::vector<double>& fwhm);
+
+   bool mAbortFlag;
+};
+
+#endif
@@ -7,28 +7,62 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
-#include "AppConfig.h"
 #include "GaussianResampler.h"
 
+#include <algorithm>
 #include <math.h>
 
-double GaussianResampler::resamplePoint(IndexPair indices, double toWavelength, double toFwhm)
+using namespace std;
+
+namespace
 {
-   unsigned int i;
-   double value = 0.0;
-   double scale = 0.0;
-   double sigma = toFwhm / (2.0*sqrt(2.0*log(2.0)));
-   
-   for (i = 0; i < mFromData.size(); ++i)
+   // Source values whose weight is below exp(-18), about 1.5e-8, of the weight of the closest
+   // source value are ignored, which gives the same results as the full kernel to well within
+   // single precision; this is the distance beyond the closest value in standard deviations squared
+   const double sTruncationSquare = 36.0;
+}
+
+void GaussianResampler::getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights)
+{
+   const double sigma = toFwhm / (2.0*sqrt(2.0*log(2.0)));
+
+   // mFromWavelengths is sorted, so the closest value is on one side of the band center and
+   // the values inside the truncated kernel are contiguous
+   vector<double>::const_iterator center =
+      lower_bound(mFromWavelengths.begin(), mFromWavelengths.end(), toWavelength);
+   double closest = -1.0;
+   if (center != mFromWavelengths.end())
+   {
+      closest = *center - toWavelength;
+   }
+   if (center != mFromWavelengths.begin() && (closest < 0.0 || toWavelength - *(center - 1) < closest))
    {
-      double ratio = (toWavelength-mFromWavelengths[i])/sigma;
-      double exponent = -ratio*ratio*0.5;
-      double probability = 1.0 / (sigma * sqrt(2.0*PI)) * exp(exponent);
-      scale += probability;
-      value += mFromData[i] * probability;
+      closest = toWavelength - *(center - 1);
    }
 
-   value /= scale;
+   // Weights are taken relative to the closest value so a narrow band cannot underflow all of
+   // them; the constant factors of the Gaussian cancel when the weights are normalized
+   const double closestSquare = (closest / sigma) * (closest / sigma);
+   const double halfWidth = sigma * sqrt(closestSquare + sTruncationSquare);
+   vector<double>::const_iterator first =
+      lower_bound(mFromWavelengths.begin(), center, toWavelength - halfWidth);
+   vector<double>::const_iterator last = upper_bound(center, mFromWavelengths.end(), toWavelength + halfWidth);
 
-   return value;
+   double scale = 0.0;
+   weights.mDataWeights.reserve(last - first);
+   for (vector<double>::const_iterator iter = first; iter != last; ++iter)
+   {
+      double ratio = (toWavelength - *iter) / sigma;
+      double probability = exp((closestSquare - ratio * ratio) * 0.5);
+      if (probability > 0.0)
+      {
+         scale += probability;
+         weights.mDataWeights.push_back(make_pair(static_cast<int>(iter - mFromWavelengths.begin()), probability));
+      }
+   }
+
+   for (unsigned int i = 0; i < weights.mDataWeights.size(); ++i)
+   {
+      weights.mDataWeights[i].second /= scale;
+   }
 }
@@ -15,10 +15,10 @@
 class GaussianResampler : public Interpolator
 {
 public:
-   GaussianResampler(const std::vector<double>& fromWavelengths, const std::vector<double>& fromData, double dropOutWindow) :
-      Interpolator(fromWavelengths, fromData, dropOutWindow) {}
+   GaussianResampler(const std::vector<double>& fromWavelengths, double dropOutWindow) :
+      Interpolator(fromWavelengths, dropOutWindow) {}
 private:
-   double resamplePoint(IndexPair indices, double toWavelength, double toFwhm);
+   void getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights);
 };
 
 
@@ -14,13 +14,16 @@
 
 #include "AppConfig.h"
 #include "Interpolator.h"
-#include "ResamplerOptions.h"
 
 using namespace std;
 
-Interpolator::Interpolator(const std::vector<double>& fromWavelengths,
-   const std::vector<double>& fromData, double dropOutWindow) :
-   mFromWavelengths(fromWavelengths), mFromData(fromData), mDropOutWindow(dropOutWindow) 
+Interpolator::Interpolator(const std::vector<double>& fromWavelengths, double dropOutWindow) :
+   mFromWavelengths(fromWavelengths), mDropOutWindow(dropOutWindow), mUpperIndex(0)
+{
+   // Do nothing
+}
+
+Interpolator::~Interpolator()
 {
    // Do nothing
 }
@@ -43,7 +46,7 @@ bool Interpolator::canExtrapolate(double sourceWavelength1,
    return false;
 }
 
-bool Interpolator::constructorInputsAreValid(string& errorMessage)
+bool Interpolator::inputsAreValid(string& errorMessage)
 {
    if (mDropOutWindow < 0.0)
    {
@@ -62,12 +65,6 @@ bool Interpolator::constructorInputsAreValid(string& errorMessage)
       errorMessage = "Signature wavelengths have duplicate values.";
       return false;
    }
-   
-   if (mFromData.size() == 0)
-   {
-      errorMessage = "Signature has no data.";
-      return false;
-   }
 
    return true;
 }
@@ -89,52 +86,30 @@ bool Interpolator::hasDuplicateValues(const std::vector<double>& values)
    return false;
 }
 
-bool Interpolator::run(const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm, 
-                       std::vector<double>& toData, std::vector<int>& toBands, string& errorMessage)
+bool Interpolator::getPointWeights(double toWavelength, double toFwhm, PointWeights& weights,
+                                   string& errorMessage)
 {
-   if (constructorInputsAreValid(errorMessage) == false)
+   weights.mDataWeights.clear();
+   weights.mCurvatureWeights.clear();
+
+   IndexPair indices;
+   if (getSourceIndices(toWavelength, indices, errorMessage) == false)
    {
       return false;
    }
 
-   toData.clear();
-   toBands.clear();
-   toData.reserve(toWavelengths.size());
-   toBands.reserve(toWavelengths.size());
-
-   double defaultFwhm = ResamplerOptions::getSettingFullWidthHalfMax();
-   unsigned int i;
-   for (i = 0; i < toWavelengths.size(); ++i)
+   if (indices.mLeftIndex != -1)
    {
-      IndexPair indices;
-      if (getSourceIndices(toWavelengths[i], indices, errorMessage) == false)
+      if (indices.mLeftIndex == indices.mRightIndex)
       {
-         return false;
+         weights.mDataWeights.push_back(make_pair(indices.mLeftIndex, 1.0));
       }
-
-      if (indices.mLeftIndex != -1)
+      else
       {
-         double value = 0.0;
-         if (indices.mLeftIndex == indices.mRightIndex)
-         {
-            value = mFromData[indices.mLeftIndex];
-         }
-         else
-         {
-            double fwhm=toFwhm.size() == 0? defaultFwhm : toFwhm[i];
-            value = resamplePoint(indices, toWavelengths[i], fwhm);
-         }
-         toData.push_back(value);
-         toBands.push_back(i);
+         getWeights(indices, toWavelength, toFwhm, weights);
       }
    }
 
-   if (toBands.size() == 0)
-   {
-      errorMessage = "No bands could be resampled.";
-      return false;
-   }
-
    return true;
 }
 
@@ -174,8 +149,9 @@ bool Interpolator::getSourceIndices(double toWavelength, IndexPair& pair, string
    }
    else
    {
+      // Start at the first source wavelength past the target rather than scanning from the beginning
       unsigned int i;
-      for (i = 0; i < mFromWavelengths.size(); ++i)
+      for (i = getUpperIndex(toWavelength); i < mFromWavelengths.size(); ++i)
       {
          if (mFromWavelengths[i]>toWavelength)
          {
@@ -233,6 +209,25 @@ bool Interpolator::getSourceIndices(double toWavelength, IndexPair& pair, string
    return true;
 }
 
+unsigned int Interpolator::getUpperIndex(double toWavelength)
+{
+   // Targets are normally requested in increasing order, so the search continues from the
+   // previous target and all of the targets are located in one sweep over the source wavelengths
+   if (mUpperIndex > mFromWavelengths.size() ||
+      (mUpperIndex > 0 && mFromWavelengths[mUpperIndex - 1] > toWavelength))
+   {
+      mUpperIndex = upper_bound(mFromWavelengths.begin(), mFromWavelengths.end(), toWavelength) -
+         mFromWavelengths.begin();
+   }
+
+   while (mUpperIndex < mFromWavelengths.size() && mFromWavelengths[mUpperIndex] <= toWavelength)
+   {
+      ++mUpperIndex;
+   }
+
+   return mUpperIndex;
+}
+
 bool Interpolator::canUseSinglePoint(double fromWavelength, double toWavelength)
 {
    return fabs(fromWavelength-toWavelength) < mDropOutWindow/20.0;
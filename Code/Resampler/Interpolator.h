@@ -11,6 +11,7 @@
 #define INTERPOLATOR_H
 
 #include <string>
+#include <utility>
 #include <vector>
 
 struct IndexPair
@@ -18,26 +19,60 @@ struct IndexPair
    int mLeftIndex, mRightIndex;
 };
 
+/**
+ * The weights which produce one resampled value.
+ *
+ * The value is the sum of each source value times its weight in mDataWeights, plus
+ * the sum of each spline second derivative at a source wavelength times its weight
+ * in mCurvatureWeights. Indices refer to the sorted source wavelengths.
+ */
+struct PointWeights
+{
+   std::vector<std::pair<int, double> > mDataWeights;
+   std::vector<std::pair<int, double> > mCurvatureWeights;
+};
+
 class Interpolator
 {
 public:
-   Interpolator(const std::vector<double>& fromWavelengths,
-      const std::vector<double>& fromData, double dropOutWindow);
+   Interpolator(const std::vector<double>& fromWavelengths, double dropOutWindow);
+   virtual ~Interpolator();
 
-   bool run(const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm, 
-      std::vector<double>& toData, std::vector<int>& toBands, std::string& errorMessage);
+   bool inputsAreValid(std::string& errorMessage);
+
+   /**
+    * Computes the weights which resample the source values to a wavelength.
+    *
+    * @param toWavelength
+    *        The wavelength to resample to.
+    * @param toFwhm
+    *        The full width at half maximum of the band at toWavelength.
+    * @param weights
+    *        Receives the weights. Both vectors are empty if the wavelength cannot be resampled.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    *
+    * @return False if an error occurred, true otherwise.
+    */
+   bool getPointWeights(double toWavelength, double toFwhm, PointWeights& weights, std::string& errorMessage);
 
    bool noResamplingNecessary(const std::vector<double>& toWavelengths);
 
    const std::vector<double>& mFromWavelengths;
-   const std::vector<double>& mFromData;
    const double mDropOutWindow;
 
 protected:
-   virtual double resamplePoint(IndexPair indices, double toWavelength, double toFwhm) = 0;
+   virtual void getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights) = 0;
+
+   /**
+    * Returns the index of the first source wavelength greater than toWavelength, or the
+    * number of source wavelengths if there is none.
+    *
+    * This is fastest when called with increasing wavelengths.
+    */
+   unsigned int getUpperIndex(double toWavelength);
 
 private:
-   bool constructorInputsAreValid(std::string& errorMessage);
 
 
    bool getSourceIndices(double toWavelength, IndexPair& pair, std::string& errorMessage);
@@ -46,6 +81,8 @@ private:
 
    inline bool canExtrapolate(double sourceWavelength1, double sourceWavelength2, double destWavelength);
    static bool hasDuplicateValues(const std::vector<double>& values);
+
+   unsigned int mUpperIndex;
 };
 
 #endif
@@ -9,17 +9,16 @@
 
 #include "LinearInterpolator.h"
 
-LinearInterpolator::LinearInterpolator(const std::vector<double>& fromWavelengths,
-   const std::vector<double>& fromData, double dropOutWindow) :
-   Interpolator(fromWavelengths, fromData, dropOutWindow)
+LinearInterpolator::LinearInterpolator(const std::vector<double>& fromWavelengths, double dropOutWindow) :
+   Interpolator(fromWavelengths, dropOutWindow)
 {
    // Do nothing
 }
 
-double LinearInterpolator::resamplePoint(IndexPair indices, double toWavelength, double toFwhm)
+void LinearInterpolator::getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights)
 {
-   return mFromData[indices.mLeftIndex] +
-      (toWavelength-mFromWavelengths[indices.mLeftIndex]) *
-      (mFromData[indices.mRightIndex]-mFromData[indices.mLeftIndex]) /
+   const double fraction = (toWavelength-mFromWavelengths[indices.mLeftIndex]) /
       (mFromWavelengths[indices.mRightIndex]-mFromWavelengths[indices.mLeftIndex]);
+   weights.mDataWeights.push_back(std::make_pair(indices.mLeftIndex, 1.0 - fraction));
+   weights.mDataWeights.push_back(std::make_pair(indices.mRightIndex, fraction));
 }
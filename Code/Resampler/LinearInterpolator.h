@@ -15,11 +15,10 @@
 class LinearInterpolator : public Interpolator
 {
 public:
-   LinearInterpolator(const std::vector<double>& fromWavelengths,
-      const std::vector<double>& fromData, double dropOutWindow);
+   LinearInterpolator(const std::vector<double>& fromWavelengths, double dropOutWindow);
 
 private:
-   double resamplePoint(IndexPair indices, double toWavelength, double toFwhm);
+   void getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights);
 };
 
 #endif
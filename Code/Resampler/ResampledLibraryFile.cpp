@@ -0,0 +1,186 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ResampledLibraryFile.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+   /**
+    * The file starts with this header, followed by the target wavelengths, the target FWHM values,
+    * the resampler method, the signature hashes and the resampled data. All values are in the byte
+    * order of the computer which wrote the file.
+    */
+   struct ResampledLibraryHeader
+   {
+      char mMagic[8];
+      unsigned int mByteOrder;
+      unsigned int mVersion;
+      unsigned int mBandCount;
+      unsigned int mFwhmCount;
+      unsigned int mSignatureCount;
+      unsigned int mMethodLength;
+      double mDropOutWindow;
+      double mDefaultFwhm;
+   };
+
+   const char sMagic[8] = { 'R', 'S', 'M', 'P', 'L', 'I', 'B', '\0' };
+   const unsigned int sByteOrder = 0x01020304;
+   const unsigned int sVersion = 1;
+
+   /**
+    * Copies values from the file contents, checking that they are within the file.
+    */
+   template<typename T>
+   bool readValues(const char*& pData, const char* pEnd, vector<T>& values, size_t count)
+   {
+      const size_t bytes = count * sizeof(T);
+      if (static_cast<size_t>(pEnd - pData) < bytes || (count != 0 && bytes / count != sizeof(T)))
+      {
+         return false;
+      }
+
+      values.resize(count);
+      if (count != 0)
+      {
+         memcpy(&values.front(), pData, bytes);
+      }
+      pData += bytes;
+      return true;
+   }
+
+   template<typename T>
+   bool writeValues(QFile& file, const vector<T>& values)
+   {
+      const qint64 bytes = static_cast<qint64>(values.size() * sizeof(T));
+      return values.empty() || file.write(reinterpret_cast<const char*>(&values.front()), bytes) == bytes;
+   }
+}
+
+string ResampledLibraryFile::getFilename(const string& libraryFilename, unsigned int gridHash)
+{
+   return libraryFilename + "." + QString::number(gridHash, 16).rightJustified(8, '0').toStdString() + ".rsl";
+}
+
+uint64_t ResampledLibraryFile::hashSpectrum(const vector<double>& wavelengths, const vector<double>& values)
+{
+   // 64-bit FNV-1a over the bytes of the values, so large libraries do not have collisions
+   uint64_t hash = 14695981039346656037ULL;
+   const vector<double>* pVectors[] = { &wavelengths, &values };
+   for (int i = 0; i < 2; ++i)
+   {
+      const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(
+         pVectors[i]->empty() ? NULL : &pVectors[i]->front());
+      const size_t numBytes = pVectors[i]->size() * sizeof(double);
+      for (size_t byte = 0; byte < numBytes; ++byte)
+      {
+         hash ^= pBytes[byte];
+         hash *= 1099511628211ULL;
+      }
+   }
+
+   return hash;
+}
+
+bool ResampledLibraryFile::read(const string& filename, Contents& contents)
+{
+   contents = Contents();
+
+   QFile file(QString::fromStdString(filename));
+   if (file.open(QIODevice::ReadOnly) == false || file.size() < static_cast<qint64>(sizeof(ResampledLibraryHeader)))
+   {
+      return false;
+   }
+
+   const qint64 fileSize = file.size();
+   const char* pBegin = reinterpret_cast<const char*>(file.map(0, fileSize));
+   vector<char> buffer;
+   if (pBegin == NULL)
+   {
+      buffer.resize(static_cast<vector<char>::size_type>(fileSize));
+      if (file.read(&buffer.front(), fileSize) != fileSize)
+      {
+         return false;
+      }
+      pBegin = &buffer.front();
+   }
+   const char* pEnd = pBegin + fileSize;
+
+   ResampledLibraryHeader header;
+   memcpy(&header, pBegin, sizeof(header));
+   if (memcmp(header.mMagic, sMagic, sizeof(sMagic)) != 0 || header.mByteOrder != sByteOrder ||
+      header.mVersion != sVersion)
+   {
+      return false;
+   }
+
+   const char* pData = pBegin + sizeof(header);
+   const size_t dataCount = static_cast<size_t>(header.mSignatureCount) * header.mBandCount;
+   vector<char> method;
+   if (readValues(pData, pEnd, contents.mToWavelengths, header.mBandCount) == false ||
+      readValues(pData, pEnd, contents.mToFwhm, header.mFwhmCount) == false ||
+      readValues(pData, pEnd, method, header.mMethodLength) == false ||
+      readValues(pData, pEnd, contents.mHashes, header.mSignatureCount) == false ||
+      readValues(pData, pEnd, contents.mData, dataCount) == false || pData != pEnd)
+   {
+      contents = Contents();
+      return false;
+   }
+
+   contents.mResamplerMethod.assign(method.begin(), method.end());
+   contents.mDropOutWindow = header.mDropOutWindow;
+   contents.mDefaultFwhm = header.mDefaultFwhm;
+   return true;
+}
+
+bool ResampledLibraryFile::write(const string& filename, const Contents& contents)
+{
+   if (contents.mData.size() != contents.mHashes.size() * contents.mToWavelengths.size())
+   {
+      return false;
+   }
+
+   ResampledLibraryHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.mMagic, sMagic, sizeof(sMagic));
+   header.mByteOrder = sByteOrder;
+   header.mVersion = sVersion;
+   header.mBandCount = static_cast<unsigned int>(contents.mToWavelengths.size());
+   header.mFwhmCount = static_cast<unsigned int>(contents.mToFwhm.size());
+   header.mSignatureCount = static_cast<unsigned int>(contents.mHashes.size());
+   header.mMethodLength = static_cast<unsigned int>(contents.mResamplerMethod.size());
+   header.mDropOutWindow = contents.mDropOutWindow;
+   header.mDefaultFwhm = contents.mDefaultFwhm;
+
+   QFile file(QString::fromStdString(filename));
+   if (file.open(QIODevice::WriteOnly | QIODevice::Truncate) == false)
+   {
+      return false;
+   }
+
+   const vector<char> method(contents.mResamplerMethod.begin(), contents.mResamplerMethod.end());
+   if (file.write(reinterpret_cast<const char*>(&header), sizeof(header)) != sizeof(header) ||
+      writeValues(file, contents.mToWavelengths) == false || writeValues(file, contents.mToFwhm) == false ||
+      writeValues(file, method) == false || writeValues(file, contents.mHashes) == false ||
+      writeValues(file, contents.mData) == false)
+   {
+      // A partial file would be rejected when it is read, but do not leave it behind
+      file.close();
+      file.remove();
+      return false;
+   }
+
+   return true;
+}
@@ -0,0 +1,68 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RESAMPLEDLIBRARYFILE_H
+#define RESAMPLEDLIBRARYFILE_H
+
+#include "AppConfig.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Reads and writes the resampled copy of a spectral library which is kept next to the library file.
+ *
+ * There is one file for each wavelength grid a library has been resampled to. The file holds the
+ * grid and the resampler settings, followed by a hash of the native wavelengths and reflectances of
+ * each signature and a dense matrix with one row of resampled values per signature. Rows are found
+ * by the hash of the signature data, so a signature which has been edited since the file was
+ * written is simply not found.
+ */
+namespace ResampledLibraryFile
+{
+   /**
+    * The contents of a resampled library file.
+    */
+   struct Contents
+   {
+      Contents() :
+         mDropOutWindow(0.0),
+         mDefaultFwhm(0.0) {}
+
+      std::vector<double> mToWavelengths;
+      std::vector<double> mToFwhm;
+      std::string mResamplerMethod;
+      double mDropOutWindow;
+      double mDefaultFwhm;
+      std::vector<uint64_t> mHashes;
+      std::vector<double> mData;    // One row of mToWavelengths.size() values per hash, NaN if not resampled
+   };
+
+   /**
+    * Returns the name of the file holding the library resampled to the grid with the given hash.
+    */
+   std::string getFilename(const std::string& libraryFilename, unsigned int gridHash);
+
+   /**
+    * Computes the hash identifying the native data of a signature.
+    */
+   uint64_t hashSpectrum(const std::vector<double>& wavelengths, const std::vector<double>& values);
+
+   /**
+    * Reads a resampled library file. Returns false if the file does not exist or is not valid.
+    */
+   bool read(const std::string& filename, Contents& contents);
+
+   /**
+    * Writes a resampled library file, replacing an existing file.
+    */
+   bool write(const std::string& filename, const Contents& contents);
+}
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "PlugInRegistration.h"
+#include "ResampledSignatureCache.h"
+#include "ResamplerOptions.h"
+#include "Signature.h"
+#include "Slot.h"
+#include "SpectralVersion.h"
+
+#include <QtCore/QMutexLocker>
+
+#include <string.h>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralResampler, ResampledSignatureCache);
+
+namespace
+{
+   // Results are kept for this many wavelength grids per signature
+   const unsigned int sMaxResultsPerSignature = 4;
+
+   unsigned int hashValues(const vector<double>& values, unsigned int hash)
+   {
+      // FNV-1a over the bytes of the values
+      const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(values.empty() ? NULL : &values.front());
+      const size_t numBytes = values.size() * sizeof(double);
+      for (size_t i = 0; i < numBytes; ++i)
+      {
+         hash ^= pBytes[i];
+         hash *= 16777619U;
+      }
+
+      return hash;
+   }
+}
+
+ResampledSignatureCache* ResampledSignatureCache::spInstance = NULL;
+
+ResampledSignatureCache::ResampledSignatureCache()
+{
+   setName("Resampled Signature Cache");
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+   setType("Resampler");
+   setDescription("Keeps resampled signature values for the session.");
+   setDescriptorId("{F1D4AE82-0953-46DF-82D3-34FAFD176E22}");
+   executeOnStartup(true);
+   destroyAfterExecute(false);
+   allowMultipleInstances(false);
+   setWizardSupported(false);
+}
+
+ResampledSignatureCache::~ResampledSignatureCache()
+{
+   clear();
+   if (spInstance == this)
+   {
+      spInstance = NULL;
+   }
+}
+
+ResampledSignatureCache* ResampledSignatureCache::instance()
+{
+   return spInstance;
+}
+
+bool ResampledSignatureCache::getInputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = NULL;
+   return true;
+}
+
+bool ResampledSignatureCache::getOutputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = NULL;
+   return true;
+}
+
+bool ResampledSignatureCache::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   // Only the instance executed at startup is kept for the session. Other instances, such as those
+   // created to read the plug-in descriptors, are never executed and must not replace it.
+   if (spInstance == NULL)
+   {
+      spInstance = this;
+   }
+
+   return true;
+}
+
+bool ResampledSignatureCache::find(Signature* pSignature, const vector<double>& toWavelengths,
+   const vector<double>& toFwhm, const string& resamplerMethod, vector<double>& toData, vector<int>& toBands)
+{
+   QMutexLocker lock(&mMutex);
+   map<Signature*, list<Result> >::iterator signatureIter = mResults.find(pSignature);
+   if (signatureIter == mResults.end())
+   {
+      return false;
+   }
+
+   const unsigned int gridHash = getGridHash(toWavelengths, toFwhm);
+   const double dropOutWindow = ResamplerOptions::getSettingDropOutWindow();
+   const double defaultFwhm = ResamplerOptions::getSettingFullWidthHalfMax();
+   list<Result>& results = signatureIter->second;
+   for (list<Result>::iterator iter = results.begin(); iter != results.end(); ++iter)
+   {
+      if (iter->mGridHash == gridHash && iter->mResamplerMethod == resamplerMethod &&
+         iter->mDropOutWindow == dropOutWindow && iter->mDefaultFwhm == defaultFwhm &&
+         iter->mToWavelengths == toWavelengths && iter->mToFwhm == toFwhm)
+      {
+         results.splice(results.begin(), results, iter);
+         toData = results.front().mToData;
+         toBands = results.front().mToBands;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void ResampledSignatureCache::insert(Signature* pSignature, const vector<double>& toWavelengths,
+   const vector<double>& toFwhm, const string& resamplerMethod, const vector<double>& toData,
+   const vector<int>& toBands)
+{
+   if (pSignature == NULL)
+   {
+      return;
+   }
+
+   QMutexLocker lock(&mMutex);
+   map<Signature*, list<Result> >::iterator signatureIter = mResults.find(pSignature);
+   if (signatureIter == mResults.end())
+   {
+      pSignature->attach(SIGNAL_NAME(Subject, Modified), Slot(this, &ResampledSignatureCache::signatureChanged));
+      pSignature->attach(SIGNAL_NAME(Subject, Deleted), Slot(this, &ResampledSignatureCache::signatureChanged));
+      signatureIter = mResults.insert(make_pair(pSignature, list<Result>())).first;
+   }
+
+   list<Result>& results = signatureIter->second;
+   results.push_front(Result());
+
+   Result& result = results.front();
+   result.mGridHash = getGridHash(toWavelengths, toFwhm);
+   result.mToWavelengths = toWavelengths;
+   result.mToFwhm = toFwhm;
+   result.mResamplerMethod = resamplerMethod;
+   result.mDropOutWindow = ResamplerOptions::getSettingDropOutWindow();
+   result.mDefaultFwhm = ResamplerOptions::getSettingFullWidthHalfMax();
+   result.mToData = toData;
+   result.mToBands = toBands;
+
+   if (results.size() > sMaxResultsPerSignature)
+   {
+      results.pop_back();
+   }
+}
+
+void ResampledSignatureCache::clear()
+{
+   QMutexLocker lock(&mMutex);
+   while (mResults.empty() == false)
+   {
+      remove(mResults.begin()->first, true);
+   }
+}
+
+unsigned int ResampledSignatureCache::getGridHash(const vector<double>& toWavelengths, const vector<double>& toFwhm)
+{
+   return hashValues(toFwhm, hashValues(toWavelengths, 2166136261U));
+}
+
+void ResampledSignatureCache::signatureChanged(Subject& subject, const string& signal, const boost::any& value)
+{
+   // A deleted signature detaches itself
+   QMutexLocker lock(&mMutex);
+   remove(dynamic_cast<Signature*>(&subject), signal != SIGNAL_NAME(Subject, Deleted));
+}
+
+void ResampledSignatureCache::remove(Signature* pSignature, bool detach)
+{
+   map<Signature*, list<Result> >::iterator signatureIter = mResults.find(pSignature);
+   if (signatureIter == mResults.end())
+   {
+      return;
+   }
+
+   if (detach)
+   {
+      pSignature->detach(SIGNAL_NAME(Subject, Modified), Slot(this, &ResampledSignatureCache::signatureChanged));
+      pSignature->detach(SIGNAL_NAME(Subject, Deleted), Slot(this, &ResampledSignatureCache::signatureChanged));
+   }
+
+   mResults.erase(signatureIter);
+}
@@ -0,0 +1,105 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RESAMPLEDSIGNATURECACHE_H
+#define RESAMPLEDSIGNATURECACHE_H
+
+#include "ExecutableShell.h"
+
+#include <QtCore/QMutex>
+
+#include <boost/any.hpp>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+class Signature;
+class Subject;
+
+/**
+ * Keeps the resampled values of signatures for the rest of the session.
+ *
+ * Detection algorithms resample each selected signature to the data set wavelengths
+ * every time they run, usually with the same signatures and data set as the previous
+ * run. Results are stored per signature for the most recently used wavelength grids
+ * and are discarded when the signature is modified or deleted.
+ *
+ * This plug-in is created at startup and kept for the session so the results, and the
+ * Resampler module holding them, live longer than the individual Resampler instances.
+ */
+class ResampledSignatureCache : public ExecutableShell
+{
+public:
+   ResampledSignatureCache();
+   ~ResampledSignatureCache();
+
+   /**
+    * Returns the cache, or \c NULL if the plug-in has not been executed at startup.
+    */
+   static ResampledSignatureCache* instance();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool getOutputSpecification(PlugInArgList*& pArgList);
+   bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+
+   /**
+    * Gets previously stored results for a signature.
+    *
+    * @return True if results were stored for the same wavelengths, FWHM and
+    *         resampler settings, false otherwise.
+    */
+   bool find(Signature* pSignature, const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm,
+      const std::string& resamplerMethod, std::vector<double>& toData, std::vector<int>& toBands);
+
+   /**
+    * Stores the results of resampling a signature.
+    */
+   void insert(Signature* pSignature, const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm,
+      const std::string& resamplerMethod, const std::vector<double>& toData, const std::vector<int>& toBands);
+
+   void clear();
+
+   /**
+    * Computes the hash used to compare wavelength grids.
+    */
+   static unsigned int getGridHash(const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm);
+
+protected:
+   void signatureChanged(Subject& subject, const std::string& signal, const boost::any& value);
+
+private:
+   struct Result
+   {
+      unsigned int mGridHash;
+      std::vector<double> mToWavelengths;
+      std::vector<double> mToFwhm;
+      std::string mResamplerMethod;
+      double mDropOutWindow;
+      double mDefaultFwhm;
+      std::vector<double> mToData;
+      std::vector<int> mToBands;
+   };
+
+   /**
+    * Removes the results of a signature. The caller must hold mMutex.
+    */
+   void remove(Signature* pSignature, bool detach);
+
+   static ResampledSignatureCache* spInstance;
+
+   // Resamplers are called from several threads, so every access to mResults holds this
+   QMutex mMutex;
+
+   // The most recently used result for each signature is at the front of its list
+   std::map<Signature*, std::list<Result> > mResults;
+};
+
+#endif
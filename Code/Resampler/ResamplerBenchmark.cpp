@@ -0,0 +1,556 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include <QtCore/QTime>
+
+#include "AppVerify.h"
+#include "Filename.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "Progress.h"
+#include "ProgressTracker.h"
+#include "ResamplerBenchmark.h"
+#include "ResamplerImp.h"
+#include "ResamplerOptions.h"
+#include "SpectralVersion.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <math.h>
+#include <sstream>
+#include <stdlib.h>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralResampler, ResamplerBenchmark);
+
+namespace
+{
+   struct BenchmarkGrid
+   {
+      const char* mpName;
+      vector<double> mFromWavelengths;
+      vector<double> mToWavelengths;
+      vector<double> mToFwhm;
+   };
+
+   vector<double> evenlySpaced(double first, double last, unsigned int count)
+   {
+      vector<double> values(count);
+      for (unsigned int i = 0; i < count; ++i)
+      {
+         values[i] = first + (last - first) * i / (count - 1);
+      }
+
+      return values;
+   }
+
+   /**
+    * Returns grids typical of the spectral library and sensor wavelengths in use.
+    */
+   vector<BenchmarkGrid> getBenchmarkGrids()
+   {
+      vector<BenchmarkGrid> grids(3);
+
+      // A 1 nm field spectrometer library resampled to an AVIRIS-like sensor
+      grids[0].mpName = "Library to hyperspectral";
+      grids[0].mFromWavelengths = evenlySpaced(0.35, 2.5, 2151);
+      grids[0].mToWavelengths = evenlySpaced(0.4, 2.5, 224);
+      grids[0].mToFwhm.assign(grids[0].mToWavelengths.size(), 0.01);
+
+      // The same library resampled to the reflective Landsat TM bands
+      const double tmCenters[] = { 0.485, 0.56, 0.66, 0.83, 1.65, 2.215 };
+      const double tmFwhm[] = { 0.07, 0.08, 0.06, 0.13, 0.2, 0.27 };
+      grids[1].mpName = "Library to multispectral";
+      grids[1].mFromWavelengths = grids[0].mFromWavelengths;
+      grids[1].mToWavelengths.assign(tmCenters, tmCenters + sizeof(tmCenters) / sizeof(tmCenters[0]));
+      grids[1].mToFwhm.assign(tmFwhm, tmFwhm + sizeof(tmFwhm) / sizeof(tmFwhm[0]));
+
+      // One hyperspectral sensor resampled to another
+      grids[2].mpName = "Hyperspectral to hyperspectral";
+      grids[2].mFromWavelengths = grids[0].mToWavelengths;
+      grids[2].mToWavelengths = evenlySpaced(0.41, 2.45, 210);
+      grids[2].mToFwhm.assign(grids[2].mToWavelengths.size(), 0.0105);
+
+      return grids;
+   }
+
+   /**
+    * Creates smooth, distinct spectra so the results do not depend on the data.
+    */
+   vector<double> createSpectra(const vector<double>& wavelengths, unsigned int numSpectra)
+   {
+      vector<double> spectra;
+      spectra.reserve(wavelengths.size() * numSpectra);
+      for (unsigned int spectrum = 0; spectrum < numSpectra; ++spectrum)
+      {
+         const double phase = 0.37 * spectrum;
+         for (vector<double>::const_iterator iter = wavelengths.begin(); iter != wavelengths.end(); ++iter)
+         {
+            spectra.push_back(0.3 + 0.2 * sin(4.0 * *iter + phase) + 0.05 * cos(23.0 * *iter - phase));
+         }
+      }
+
+      return spectra;
+   }
+
+   string makeKey(const string& method, const string& mode, unsigned int fromBands, unsigned int toBands)
+   {
+      stringstream key;
+      key << method << "," << mode << "," << fromBands << "," << toBands;
+      return key.str();
+   }
+
+   const unsigned int sSpectraPerPass = 1000;
+
+   // The number of spectra compared with a direct interpolation
+   const unsigned int sReferenceSpectra = 5;
+
+   /**
+    * Resamples a spectrum by interpolating directly between the source values, without a ResamplingPlan.
+    *
+    * Only the target wavelengths between two source wavelengths closer together than the drop out
+    * window are resampled, since the resampler may extrapolate or use a single point for the others.
+    *
+    * @return True if the method has a reference implementation, false otherwise.
+    */
+   bool resampleReference(const string& method, const vector<double>& fromWavelengths, const double* pFromData,
+      const vector<double>& toWavelengths, double dropOutWindow, vector<double>& toData, vector<int>& toBands)
+   {
+      const bool spline = (method == ResamplerOptions::CubicSplineMethod());
+      if (spline == false && method != ResamplerOptions::LinearMethod())
+      {
+         return false;
+      }
+
+      // Natural spline second derivatives from the tridiagonal system solved in full for this spectrum
+      const int numFrom = static_cast<int>(fromWavelengths.size());
+      const vector<double>& x = fromWavelengths;
+      vector<double> y2(numFrom, 0.0);
+      if (spline == true && numFrom > 2)
+      {
+         vector<double> u(numFrom, 0.0);
+         for (int i = 1; i < numFrom - 1; ++i)
+         {
+            const double sig = (x[i] - x[i - 1]) / (x[i + 1] - x[i - 1]);
+            const double p = sig * y2[i - 1] + 2.0;
+            y2[i] = (sig - 1.0) / p;
+            u[i] = (pFromData[i + 1] - pFromData[i]) / (x[i + 1] - x[i]) -
+               (pFromData[i] - pFromData[i - 1]) / (x[i] - x[i - 1]);
+            u[i] = (6.0 * u[i] / (x[i + 1] - x[i - 1]) - sig * u[i - 1]) / p;
+         }
+
+         y2[numFrom - 1] = 0.0;
+         for (int k = numFrom - 2; k >= 0; --k)
+         {
+            y2[k] = y2[k] * y2[k + 1] + u[k];
+         }
+      }
+
+      toData.clear();
+      toBands.clear();
+      for (unsigned int band = 0; band < toWavelengths.size(); ++band)
+      {
+         const double wavelength = toWavelengths[band];
+         const int right = static_cast<int>(upper_bound(x.begin(), x.end(), wavelength) - x.begin());
+         const int left = right - 1;
+         if (left < 0 || right >= numFrom || x[right] - x[left] >= dropOutWindow)
+         {
+            continue;
+         }
+
+         const double h = x[right] - x[left];
+         const double a = (x[right] - wavelength) / h;
+         const double b = (wavelength - x[left]) / h;
+         double value = a * pFromData[left] + b * pFromData[right];
+         if (spline == true)
+         {
+            value += ((a * a * a - a) * y2[left] + (b * b * b - b) * y2[right]) * (h * h) / 6.0;
+         }
+
+         toData.push_back(value);
+         toBands.push_back(band);
+      }
+
+      return true;
+   }
+
+   /**
+    * Checks the resampled values of the first few spectra against resampleReference().
+    */
+   bool compareToReference(const string& method, const BenchmarkGrid& grid, const vector<double>& fromData,
+      const vector<double>& toData, const vector<int>& toBands, ostream& failure)
+   {
+      const unsigned int fromBands = grid.mFromWavelengths.size();
+      const double dropOutWindow = ResamplerOptions::getSettingDropOutWindow();
+      for (unsigned int spectrum = 0; spectrum < sReferenceSpectra; ++spectrum)
+      {
+         vector<double> referenceData;
+         vector<int> referenceBands;
+         if (resampleReference(method, grid.mFromWavelengths, &fromData[spectrum * fromBands],
+            grid.mToWavelengths, dropOutWindow, referenceData, referenceBands) == false)
+         {
+            return true;
+         }
+
+         for (unsigned int i = 0; i < referenceBands.size(); ++i)
+         {
+            vector<int>::const_iterator bandIter = find(toBands.begin(), toBands.end(), referenceBands[i]);
+            if (bandIter == toBands.end())
+            {
+               failure << method << " resampling of " << grid.mpName << " did not resample band " <<
+                  referenceBands[i] << ".";
+               return false;
+            }
+
+            const double value = toData[spectrum * toBands.size() + (bandIter - toBands.begin())];
+            if (fabs(value - referenceData[i]) > 1e-9 * max(1.0, fabs(referenceData[i])))
+            {
+               failure << method << " resampling of " << grid.mpName << " differs from direct interpolation " <<
+                  "for band " << referenceBands[i] << " of spectrum " << spectrum << ".";
+               return false;
+            }
+         }
+      }
+
+      return true;
+   }
+}
+
+ResamplerBenchmark::ResamplerBenchmark() :
+   mAbortFlag(false)
+{
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+   setName("Resampler Benchmark");
+   setType("Resampler");
+   setDescription("Measures the number of spectra per second resampled by each Resampler method.");
+   setShortDescription("Measures Resampler performance.");
+   setDescriptorId("{3C0B0E9D-6E8A-4F57-9B4D-2A61C8F7E513}");
+   setAbortSupported(true);
+   setWizardSupported(false);
+}
+
+ResamplerBenchmark::~ResamplerBenchmark()
+{
+}
+
+bool ResamplerBenchmark::getInputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = Service<PlugInManagerServices>()->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+   VERIFY(pArgList->addArg<Progress>(Executable::ProgressArg(), NULL));
+   VERIFY(pArgList->addArg<Filename>("Results Filename", NULL,
+      "If set, the results are written to this file as comma separated values."));
+   VERIFY(pArgList->addArg<Filename>("Baseline Filename", NULL,
+      "If set, the results are compared to those in this file from a previous run."));
+   VERIFY(pArgList->addArg<double>("Tolerance", 0.25,
+      "The fraction by which a measurement may be slower than its baseline before it is a failure."));
+   VERIFY(pArgList->addArg<double>("Minimum Time", 0.5,
+      "The minimum number of seconds to spend on each measurement."));
+
+   return true;
+}
+
+bool ResamplerBenchmark::getOutputSpecification(PlugInArgList*& pArgList)
+{
+   pArgList = Service<PlugInManagerServices>()->getPlugInArgList();
+   VERIFY(pArgList != NULL);
+   VERIFY(pArgList->addArg<string>("Results", NULL, "The results as comma separated values."));
+
+   return true;
+}
+
+bool ResamplerBenchmark::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   VERIFY(pInArgList != NULL);
+   ProgressTracker progress(pInArgList->getPlugInArgValue<Progress>(Executable::ProgressArg()),
+      "Running the Resampler benchmark", "spectral", "8D3F6B52-1C7E-4A09-A4E2-5F0C9B7D2E61");
+   mAbortFlag = false;
+
+   string resultsFilename;
+   Filename* pResultsFilename = pInArgList->getPlugInArgValue<Filename>("Results Filename");
+   if (pResultsFilename != NULL)
+   {
+      resultsFilename = pResultsFilename->getFullPathAndName();
+   }
+
+   string baselineFilename;
+   Filename* pBaselineFilename = pInArgList->getPlugInArgValue<Filename>("Baseline Filename");
+   if (pBaselineFilename != NULL)
+   {
+      baselineFilename = pBaselineFilename->getFullPathAndName();
+   }
+
+   double tolerance = 0.25;
+   double minimumSeconds = 0.5;
+   pInArgList->getPlugInArgValue<double>("Tolerance", tolerance);
+   pInArgList->getPlugInArgValue<double>("Minimum Time", minimumSeconds);
+
+   vector<Measurement> measurements;
+   stringstream failure;
+   if (runBenchmark(minimumSeconds, progress.getCurrentProgress(), measurements, failure) == false)
+   {
+      if (mAbortFlag)
+      {
+         progress.abort();
+      }
+      else
+      {
+         progress.report(failure.str(), 0, ERRORS, true);
+      }
+
+      return false;
+   }
+
+   string results = formatResults(measurements);
+   progress.getCurrentStep()->addProperty("Results", results);
+   if (pOutArgList != NULL)
+   {
+      pOutArgList->setPlugInArgValue("Results", &results);
+   }
+
+   if (resultsFilename.empty() == false)
+   {
+      ofstream output(resultsFilename.c_str());
+      if (output.good() == false)
+      {
+         progress.report("Unable to create results file \"" + resultsFilename + "\".", 0, ERRORS, true);
+         return false;
+      }
+
+      output << results;
+   }
+
+   if (baselineFilename.empty() == false &&
+      compareToBaseline(measurements, baselineFilename, tolerance, failure) == false)
+   {
+      progress.report(failure.str(), 0, ERRORS, true);
+      return false;
+   }
+
+   progress.report("Resampler benchmark complete", 100, NORMAL);
+   progress.upALevel();
+   return true;
+}
+
+bool ResamplerBenchmark::abort()
+{
+   mAbortFlag = true;
+   return ExecutableShell::abort();
+}
+
+bool ResamplerBenchmark::runOperationalTests(Progress* pProgress, ostream& failure)
+{
+   // Timing is not meaningful in a quick operational test
+   return true;
+}
+
+bool ResamplerBenchmark::runAllTests(Progress* pProgress, ostream& failure)
+{
+   mAbortFlag = false;
+
+   vector<Measurement> measurements;
+   return runBenchmark(0.25, pProgress, measurements, failure);
+}
+
+bool ResamplerBenchmark::runBenchmark(double minimumSeconds, Progress* pProgress,
+   vector<Measurement>& measurements, ostream& failure)
+{
+   vector<string> methods;
+   methods.push_back(ResamplerOptions::LinearMethod());
+   methods.push_back(ResamplerOptions::CubicSplineMethod());
+   methods.push_back(ResamplerOptions::GaussianMethod());
+
+   const vector<BenchmarkGrid> grids = getBenchmarkGrids();
+   const int minimumMilliseconds = static_cast<int>(minimumSeconds * 1000.0);
+   const unsigned int numCases = methods.size() * grids.size();
+   unsigned int caseIndex = 0;
+
+   ResamplerImp resampler;
+   for (vector<BenchmarkGrid>::const_iterator grid = grids.begin(); grid != grids.end(); ++grid)
+   {
+      const unsigned int fromBands = grid->mFromWavelengths.size();
+      const vector<double> fromData = createSpectra(grid->mFromWavelengths, sSpectraPerPass);
+      for (vector<string>::const_iterator method = methods.begin(); method != methods.end(); ++method)
+      {
+         if (pProgress != NULL)
+         {
+            pProgress->updateProgress("Timing " + *method + " resampling: " + grid->mpName,
+               caseIndex * 100 / numCases, NORMAL);
+         }
+
+         ++caseIndex;
+
+         // Per-spectrum calls, as made by the detection algorithms for each signature
+         vector<double> fromSpectrum(fromBands);
+         vector<double> toSpectrum;
+         vector<double> singleData;
+         vector<int> toBands;
+         string errorMessage;
+         unsigned int numSpectra = 0;
+         QTime timer;
+         timer.start();
+         do
+         {
+            singleData.clear();
+            for (unsigned int spectrum = 0; spectrum < sSpectraPerPass; ++spectrum)
+            {
+               copy(fromData.begin() + spectrum * fromBands, fromData.begin() + (spectrum + 1) * fromBands,
+                  fromSpectrum.begin());
+               if (resampler.execute(fromSpectrum, toSpectrum, grid->mFromWavelengths, grid->mToWavelengths,
+                  grid->mToFwhm, toBands, errorMessage, *method) == false)
+               {
+                  failure << *method << " resampling failed for " << grid->mpName << ": " << errorMessage;
+                  return false;
+               }
+
+               singleData.insert(singleData.end(), toSpectrum.begin(), toSpectrum.end());
+            }
+
+            numSpectra += sSpectraPerPass;
+            if (mAbortFlag)
+            {
+               return false;
+            }
+         }
+         while (timer.elapsed() < minimumMilliseconds);
+
+         Measurement measurement;
+         measurement.mMethod = *method;
+         measurement.mMode = "single";
+         measurement.mFromBands = fromBands;
+         measurement.mToBands = toBands.size();
+         measurement.mSpectra = numSpectra;
+         measurement.mSeconds = max(timer.elapsed(), 1) / 1000.0;
+         measurement.mSpectraPerSecond = numSpectra / measurement.mSeconds;
+         measurements.push_back(measurement);
+
+         // One call for all of the spectra, as made when resampling a library or data set
+         vector<double> batchData;
+         numSpectra = 0;
+         timer.start();
+         do
+         {
+            if (resampler.executeBatch(fromData, batchData, grid->mFromWavelengths, grid->mToWavelengths,
+               grid->mToFwhm, toBands, errorMessage, *method, NULL) == false)
+            {
+               failure << *method << " batch resampling failed for " << grid->mpName << ": " << errorMessage;
+               return false;
+            }
+
+            numSpectra += sSpectraPerPass;
+            if (mAbortFlag)
+            {
+               return false;
+            }
+         }
+         while (timer.elapsed() < minimumMilliseconds);
+
+         measurement.mMode = "batch";
+         measurement.mSpectra = numSpectra;
+         measurement.mSeconds = max(timer.elapsed(), 1) / 1000.0;
+         measurement.mSpectraPerSecond = numSpectra / measurement.mSeconds;
+         measurements.push_back(measurement);
+
+         // A faster path is only useful if it gives the same answers
+         if (batchData.size() != singleData.size())
+         {
+            failure << *method << " batch resampling of " << grid->mpName << " returned " << batchData.size() <<
+               " values instead of " << singleData.size() << ".";
+            return false;
+         }
+
+         for (vector<double>::size_type i = 0; i < batchData.size(); ++i)
+         {
+            if (fabs(batchData[i] - singleData[i]) > 1e-9 * max(1.0, fabs(singleData[i])))
+            {
+               failure << *method << " batch resampling of " << grid->mpName << " differs from per-spectrum "
+                  "resampling at value " << i << ".";
+               return false;
+            }
+         }
+
+         // Both paths above share the cached plan, so also check the plan against a direct interpolation
+         if (compareToReference(*method, *grid, fromData, batchData, toBands, failure) == false)
+         {
+            return false;
+         }
+      }
+   }
+
+   if (pProgress != NULL)
+   {
+      pProgress->updateProgress("Resampler benchmark complete", 100, NORMAL);
+   }
+
+   return true;
+}
+
+bool ResamplerBenchmark::compareToBaseline(const vector<Measurement>& measurements,
+   const string& baselineFilename, double tolerance, ostream& failure) const
+{
+   ifstream input(baselineFilename.c_str());
+   if (input.good() == false)
+   {
+      failure << "Unable to read baseline file \"" << baselineFilename << "\".";
+      return false;
+   }
+
+   // Each line is method,mode,from_bands,to_bands,spectra,seconds,spectra_per_second
+   map<string, double> baseline;
+   string line;
+   getline(input, line);
+   while (getline(input, line))
+   {
+      // The key is the first four fields
+      string::size_type keyEnd = 0;
+      for (int field = 0; field < 4 && keyEnd != string::npos; ++field)
+      {
+         keyEnd = line.find(',', field == 0 ? 0 : keyEnd + 1);
+      }
+
+      if (keyEnd != string::npos)
+      {
+         baseline[line.substr(0, keyEnd)] = atof(line.substr(line.rfind(',') + 1).c_str());
+      }
+   }
+
+   bool success = true;
+   for (vector<Measurement>::const_iterator iter = measurements.begin(); iter != measurements.end(); ++iter)
+   {
+      const string key = makeKey(iter->mMethod, iter->mMode, iter->mFromBands, iter->mToBands);
+      map<string, double>::const_iterator baselineIter = baseline.find(key);
+      if (baselineIter != baseline.end() && iter->mSpectraPerSecond < baselineIter->second * (1.0 - tolerance))
+      {
+         failure << "Performance regression for " << key << ": " << iter->mSpectraPerSecond <<
+            " spectra per second compared to " << baselineIter->second << " in the baseline.\n";
+         success = false;
+      }
+   }
+
+   return success;
+}
+
+string ResamplerBenchmark::formatResults(const vector<Measurement>& measurements)
+{
+   stringstream results;
+   results << "method,mode,from_bands,to_bands,spectra,seconds,spectra_per_second\n";
+   for (vector<Measurement>::const_iterator iter = measurements.begin(); iter != measurements.end(); ++iter)
+   {
+      results << makeKey(iter->mMethod, iter->mMode, iter->mFromBands, iter->mToBands) << "," <<
+         iter->mSpectra << "," << iter->mSeconds << "," << iter->mSpectraPerSecond << "\n";
+   }
+
+   return results.str();
+}
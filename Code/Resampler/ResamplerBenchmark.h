@@ -0,0 +1,71 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RESAMPLERBENCHMARK_H
+#define RESAMPLERBENCHMARK_H
+
+#include "ExecutableShell.h"
+#include "Testable.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Measures how many spectra per second the Resampler methods process.
+ *
+ * Each method is timed for several source and target grid sizes, both calling
+ * Resampler::execute() once per spectrum and calling BatchResampler::executeBatch()
+ * once for all of the spectra. The results are written as comma separated values
+ * with one line per measurement. If a baseline file from a previous run is given,
+ * any measurement more than the tolerance slower than its baseline is a failure.
+ *
+ * runAllTests() runs the benchmark with the default arguments and also checks that
+ * the batched results match the per-spectrum results, and that the linear and cubic
+ * spline results for a few spectra match a direct interpolation which does not use
+ * the cached resampling plans.
+ */
+class ResamplerBenchmark : public ExecutableShell, public Testable
+{
+public:
+   ResamplerBenchmark();
+   ~ResamplerBenchmark();
+
+   bool getInputSpecification(PlugInArgList*& pArgList);
+   bool getOutputSpecification(PlugInArgList*& pArgList);
+
+   bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   bool abort();
+
+   bool runOperationalTests(Progress* pProgress, std::ostream& failure);
+   bool runAllTests(Progress* pProgress, std::ostream& failure);
+
+private:
+   struct Measurement
+   {
+      std::string mMethod;
+      std::string mMode;
+      unsigned int mFromBands;
+      unsigned int mToBands;
+      unsigned int mSpectra;
+      double mSeconds;
+      double mSpectraPerSecond;
+   };
+
+   bool runBenchmark(double minimumSeconds, Progress* pProgress, std::vector<Measurement>& measurements,
+      std::ostream& failure);
+   bool compareToBaseline(const std::vector<Measurement>& measurements, const std::string& baselineFilename,
+      double tolerance, std::ostream& failure) const;
+
+   static std::string formatResults(const std::vector<Measurement>& measurements);
+
+   bool mAbortFlag;
+};
+
+#endif
@@ -7,19 +7,58 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
-#include "GaussianResampler.h"
-#include "LinearInterpolator.h"
+#include "ConfigurationSettings.h"
+#include "DataVariant.h"
 #include "PlugInRegistration.h"
 #include "Progress.h"
+#include "ResampledLibraryFile.h"
+#include "ResampledSignatureCache.h"
 #include "ResamplerImp.h"
 #include "ResamplerOptions.h"
+#include "ResamplingPlan.h"
+#include "Signature.h"
+#include "SignatureSet.h"
 #include "SpectralVersion.h"
-#include "SplineInterpolator.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+#include <limits>
+#include <list>
+#include <map>
+#include <set>
 
 using namespace std;
 
 REGISTER_PLUGIN_BASIC(SpectralResampler, ResamplerImp);
 
+namespace
+{
+   // Callers usually resample many spectra between the same wavelengths, often through
+   // different instances of this plug-in and from several threads, so the most recently
+   // used plans are kept for all instances with the most recently used at the front.
+   QMutex sPlanMutex;
+   list<boost::shared_ptr<const ResamplingPlan> > sPlans;
+   const unsigned int sMaxPlans = 8;
+
+   void getSignatures(SignatureSet* pSignatureSet, vector<Signature*>& signatures)
+   {
+      vector<Signature*> members = pSignatureSet->getSignatures();
+      for (vector<Signature*>::iterator member = members.begin(); member != members.end(); ++member)
+      {
+         SignatureSet* pSubSet = dynamic_cast<SignatureSet*>(*member);
+         if (pSubSet != NULL)
+         {
+            getSignatures(pSubSet, signatures);
+         }
+         else if (*member != NULL)
+         {
+            signatures.push_back(*member);
+         }
+      }
+   }
+}
+
 ResamplerImp::ResamplerImp()
 {
    setCreator("Ball Aerospace & Technologies Corp.");
@@ -1206,148 +1245,346 @@ bool ResamplerImp::execute(const vector<double>& fromData,
    vector<double>& toData, const vector<double>& fromWavelengths, const vector<double>& toWavelengths, 
    const vector<double>& toFwhm, vector<int>& toBands, string& errorMessage, const string& resamplerMethod)
 {
-   vector<double> sortedFromWavelengths, sortedFromData, 
-      sortedToWavelengths, sortedToData, sortedToFwhm;
-   vector<int> sortedToBands;
+   if (fromData.size() != fromWavelengths.size())
+   {
+      errorMessage = "Number of input data values differs from number of input wavelengths.";
+      return false;
+   }
 
-   if (sortInputData(fromWavelengths, fromData, toWavelengths, toFwhm,
-         sortedFromWavelengths, sortedFromData, sortedToWavelengths, 
-         sortedToFwhm, sortedToBands, errorMessage) == false)
+   boost::shared_ptr<const ResamplingPlan> pPlan = getResamplingPlan(fromWavelengths, toWavelengths, toFwhm,
+      resamplerMethod, errorMessage);
+   if (pPlan.get() == NULL)
    {
       return false;
    }
 
-   auto_ptr<Interpolator> pInterpolator;
-   const double dropOutWindow = ResamplerOptions::getSettingDropOutWindow();
-   if (resamplerMethod == ResamplerOptions::LinearMethod())
+   // Both outputs are replaced rather than appended to, so callers such as ElmFile can reuse toBands
+   toBands = pPlan->getToBands();
+   return pPlan->apply(fromData, toData);
+}
+
+bool ResamplerImp::executeBatch(const vector<double>& fromData, vector<double>& toData,
+   const vector<double>& fromWavelengths, const vector<double>& toWavelengths, const vector<double>& toFwhm,
+   vector<int>& toBands, string& errorMessage, const string& resamplerMethod, Progress* pProgress)
+{
+   if (fromWavelengths.empty() || fromData.size() % fromWavelengths.size() != 0)
    {
-      pInterpolator = auto_ptr<Interpolator>
-         (new LinearInterpolator(sortedFromWavelengths, sortedFromData, dropOutWindow));
+      errorMessage = "Number of input data values is not a multiple of the number of input wavelengths.";
+      return false;
    }
-   else if (resamplerMethod == ResamplerOptions::CubicSplineMethod())
+
+   boost::shared_ptr<const ResamplingPlan> pPlan = getResamplingPlan(fromWavelengths, toWavelengths, toFwhm,
+      resamplerMethod.empty() ? ResamplerOptions::getSettingResamplerMethod() : resamplerMethod, errorMessage);
+   if (pPlan.get() == NULL)
    {
-      pInterpolator = auto_ptr<Interpolator>
-         (new SplineInterpolator(sortedFromWavelengths, sortedFromData,  dropOutWindow));
+      return false;
    }
-   else if (resamplerMethod == ResamplerOptions::GaussianMethod())
+
+   const unsigned int numSpectra = fromData.size() / fromWavelengths.size();
+   toBands = pPlan->getToBands();
+   toData.resize(numSpectra * toBands.size());
+   if (toData.empty())
    {
-      pInterpolator = auto_ptr<Interpolator>
-         (new GaussianResampler(sortedFromWavelengths, sortedFromData,  dropOutWindow));
+      return true;
    }
 
-   if (pInterpolator.get() == NULL)
+   ResampleBatchInput batchInput(*pPlan, &fromData.front(), &toData.front(), numSpectra);
+   ResampleBatchOutput batchOutput;
+   mta::ProgressObjectReporter reporter("Resampling spectra", pProgress);
+   mta::MultiThreadedAlgorithm<ResampleBatchInput, ResampleBatchOutput, ResampleBatchThread>
+      mtaResample(Service<ConfigurationSettings>()->getSettingThreadCount(), batchInput, batchOutput, &reporter);
+   mtaResample.run();
+
+   return true;
+}
+
+bool ResamplerImp::resampleSignature(Signature* pSignature, const vector<double>& toWavelengths,
+   const vector<double>& toFwhm, vector<double>& toData, vector<int>& toBands, string& errorMessage)
+{
+   if (pSignature == NULL)
    {
-      errorMessage = "Unable to create interpolator for resampling.";
+      errorMessage = "No signature was specified.";
       return false;
    }
 
-   if (pInterpolator->noResamplingNecessary(toWavelengths))
+   const string resamplerMethod = ResamplerOptions::getSettingResamplerMethod();
+   ResampledSignatureCache* pCache = ResampledSignatureCache::instance();
+   if (pCache != NULL && pCache->find(pSignature, toWavelengths, toFwhm, resamplerMethod, toData, toBands))
    {
-      copy(fromData.begin(), fromData.end(), back_inserter(toData));
-      for (unsigned int i = 0; i < fromData.size(); ++i)
-      {
-         toBands.push_back(i);
-      }
+      return true;
    }
-   else
+
+   const vector<double>* pFromData = dv_cast<vector<double> >(&pSignature->getData("Reflectance"));
+   const vector<double>* pFromWavelengths = dv_cast<vector<double> >(&pSignature->getData("Wavelength"));
+   if (pFromData == NULL || pFromWavelengths == NULL)
    {
-      if (pInterpolator->run(sortedToWavelengths, sortedToFwhm, toData, toBands, errorMessage) == false)
-      {
-         return false;
-      }
+      errorMessage = "The signature does not contain wavelength and reflectance data.";
+      return false;
+   }
+
+   // The rest of a library is usually needed as well, so resample it along with its first signature
+   SignatureSet* pLibrary = dynamic_cast<SignatureSet*>(pSignature->getParent());
+   string libraryError;
+   if (pCache != NULL && pLibrary != NULL &&
+      resampleLibrary(pLibrary, toWavelengths, toFwhm, NULL, libraryError) &&
+      pCache->find(pSignature, toWavelengths, toFwhm, resamplerMethod, toData, toBands))
+   {
+      return true;
+   }
+
+   if (execute(*pFromData, toData, *pFromWavelengths, toWavelengths, toFwhm, toBands, errorMessage,
+      resamplerMethod) == false)
+   {
+      return false;
+   }
 
-      sortOutputData(sortedToBands, toBands, toData);
-   }      
+   if (pCache != NULL)
+   {
+      pCache->insert(pSignature, toWavelengths, toFwhm, resamplerMethod, toData, toBands);
+   }
 
    return true;
 }
 
-bool ResamplerImp::sortInputData(const vector<double>& fromWavelengths, const vector<double>& fromData, 
-              const vector<double>& toWavelengths, const vector<double>& toFwhm,
-              vector<double>& sortedFromWavelengths, vector<double>& sortedFromData, 
-              vector<double>& sortedToWavelengths, vector<double>& sortedToFwhm,
-              vector<int>& sortedToBands, string& errorMessage)
+bool ResamplerImp::resampleLibrary(SignatureSet* pLibrary, const vector<double>& toWavelengths,
+   const vector<double>& toFwhm, Progress* pProgress, string& errorMessage)
 {
-   if (fromData.size() != fromWavelengths.size())
+   if (pLibrary == NULL)
    {
-      errorMessage = "Number of input data values differs from number of input wavelengths.";
+      errorMessage = "No spectral library was specified.";
       return false;
-   }   
-   
-   // for efficiency, reserve space for results
-   sortedFromWavelengths.reserve(fromWavelengths.size());
-   sortedFromData.reserve(fromData.size());
-   sortedToWavelengths.reserve(toWavelengths.size());
-   sortedToFwhm.reserve(toFwhm.size());
-   sortedToBands.reserve(toWavelengths.size());
+   }
+
+   ResampledSignatureCache* pCache = ResampledSignatureCache::instance();
+   if (pCache == NULL)
+   {
+      errorMessage = "The resampled signature cache is not available.";
+      return false;
+   }
+
+   // Find the signatures which have not been resampled to the wavelengths in this session
+   const string resamplerMethod = ResamplerOptions::getSettingResamplerMethod();
+   vector<Signature*> signatures;
+   getSignatures(pLibrary, signatures);
 
-   // construct vector of wavelength/data pairs
-   typedef vector<pair<double,double> > VecPair;
-   VecPair fromPairs;
-   fromPairs.reserve(fromWavelengths.size());
-   for (int i=0; i<(int)fromWavelengths.size(); ++i)
+   vector<Signature*> pendingSignatures;
+   vector<uint64_t> pendingHashes;
+   vector<double> toData;
+   vector<int> toBands;
+   for (vector<Signature*>::iterator iter = signatures.begin(); iter != signatures.end(); ++iter)
    {
-      pair<double,double> temp; 
-      temp.first = fromWavelengths[i];
-      temp.second = fromData[i];
-      fromPairs.push_back(temp);
+      const vector<double>* pFromData = dv_cast<vector<double> >(&(*iter)->getData("Reflectance"));
+      const vector<double>* pFromWavelengths = dv_cast<vector<double> >(&(*iter)->getData("Wavelength"));
+      if (pFromData == NULL || pFromWavelengths == NULL || pFromWavelengths->empty() ||
+         pFromData->size() != pFromWavelengths->size() ||
+         pCache->find(*iter, toWavelengths, toFwhm, resamplerMethod, toData, toBands))
+      {
+         continue;
+      }
+
+      pendingSignatures.push_back(*iter);
+      pendingHashes.push_back(ResampledLibraryFile::hashSpectrum(*pFromWavelengths, *pFromData));
    }
-   sort(fromPairs.begin(), fromPairs.end());
 
-   // extract the wavelengths and data from the sorted pairs
-   for (VecPair::const_iterator iter=fromPairs.begin(); iter!=fromPairs.end(); ++iter)
+   if (pendingSignatures.empty())
    {
-      sortedFromWavelengths.push_back(iter->first);
-      sortedFromData.push_back(iter->second);
+      return true;
    }
 
-   typedef vector<Triplet> VecTrip;
-   VecTrip toTriplets;
-   toTriplets.reserve(toWavelengths.size());
-   for (int i=0; i<(int)toWavelengths.size(); ++i)
+   // Read the copy of the library resampled to the same wavelengths in a previous session
+   ResampledLibraryFile::Contents contents;
+   string resampledFilename;
+   const string libraryFilename = pLibrary->getFilename();
+   if (libraryFilename.empty() == false)
+   {
+      resampledFilename = ResampledLibraryFile::getFilename(libraryFilename,
+         ResampledSignatureCache::getGridHash(toWavelengths, toFwhm));
+   }
+   if (resampledFilename.empty() || ResampledLibraryFile::read(resampledFilename, contents) == false ||
+      contents.mToWavelengths != toWavelengths || contents.mToFwhm != toFwhm ||
+      contents.mResamplerMethod != resamplerMethod ||
+      contents.mDropOutWindow != ResamplerOptions::getSettingDropOutWindow() ||
+      contents.mDefaultFwhm != ResamplerOptions::getSettingFullWidthHalfMax())
    {
-      Triplet temp; 
-      temp.mWavelength = toWavelengths[i];
-      temp.mFwhm =  (toFwhm.size() != 0) ? toFwhm[i] : 0.0;
-      temp.mBand = i;
-      toTriplets.push_back(temp);
+      contents = ResampledLibraryFile::Contents();
+      contents.mToWavelengths = toWavelengths;
+      contents.mToFwhm = toFwhm;
+      contents.mResamplerMethod = resamplerMethod;
+      contents.mDropOutWindow = ResamplerOptions::getSettingDropOutWindow();
+      contents.mDefaultFwhm = ResamplerOptions::getSettingFullWidthHalfMax();
    }
-   sort(toTriplets.begin(), toTriplets.end());
 
-   // extract the wavelengths, fwhm and indices from the sorted triplets
-   for (VecTrip::const_iterator iter=toTriplets.begin(); iter != toTriplets.end(); ++iter)
+   map<uint64_t, size_t> rows;
+   for (size_t row = 0; row < contents.mHashes.size(); ++row)
    {
-      sortedToWavelengths.push_back(iter->mWavelength);
-      if (toFwhm.size() != 0) sortedToFwhm.push_back(iter->mFwhm);
-      sortedToBands.push_back(iter->mBand);
+      rows[contents.mHashes[row]] = row;
    }
 
-   return true;
+   // Signatures which are not in the file are resampled in one batch for each set of wavelengths
+   const size_t numBands = toWavelengths.size();
+   map<vector<double>, vector<size_t> > groups;
+   for (size_t i = 0; i < pendingSignatures.size(); ++i)
+   {
+      map<uint64_t, size_t>::const_iterator rowIter = rows.find(pendingHashes[i]);
+      if (rowIter == rows.end())
+      {
+         groups[*dv_cast<vector<double> >(&pendingSignatures[i]->getData("Wavelength"))].push_back(i);
+         continue;
+      }
+
+      toData.clear();
+      toBands.clear();
+      const double* pRow = &contents.mData[rowIter->second * numBands];
+      for (size_t band = 0; band < numBands; ++band)
+      {
+         if (pRow[band] == pRow[band])
+         {
+            toData.push_back(pRow[band]);
+            toBands.push_back(static_cast<int>(band));
+         }
+      }
+      pCache->insert(pendingSignatures[i], toWavelengths, toFwhm, resamplerMethod, toData, toBands);
+   }
+
+   bool success = true;
+   bool rowsAdded = false;
+   for (map<vector<double>, vector<size_t> >::const_iterator groupIter = groups.begin();
+      groupIter != groups.end(); ++groupIter)
+   {
+      const vector<size_t>& indices = groupIter->second;
+      vector<double> fromData;
+      fromData.reserve(indices.size() * groupIter->first.size());
+      for (vector<size_t>::const_iterator index = indices.begin(); index != indices.end(); ++index)
+      {
+         const vector<double>* pFromData =
+            dv_cast<vector<double> >(&pendingSignatures[*index]->getData("Reflectance"));
+         fromData.insert(fromData.end(), pFromData->begin(), pFromData->end());
+      }
+
+      // Keep resampling the other groups, so their signatures are not resampled one at a time
+      vector<double> batchData;
+      if (executeBatch(fromData, batchData, groupIter->first, toWavelengths, toFwhm, toBands, errorMessage,
+         resamplerMethod, pProgress) == false)
+      {
+         success = false;
+         continue;
+      }
+
+      for (size_t spectrum = 0; spectrum < indices.size(); ++spectrum)
+      {
+         const vector<double>::const_iterator spectrumBegin = batchData.begin() + spectrum * toBands.size();
+         toData.assign(spectrumBegin, spectrumBegin + toBands.size());
+         pCache->insert(pendingSignatures[indices[spectrum]], toWavelengths, toFwhm, resamplerMethod, toData,
+            toBands);
+
+         const size_t offset = contents.mData.size();
+         contents.mData.resize(offset + numBands, numeric_limits<double>::quiet_NaN());
+         for (size_t band = 0; band < toBands.size(); ++band)
+         {
+            contents.mData[offset + toBands[band]] = toData[band];
+         }
+         contents.mHashes.push_back(pendingHashes[indices[spectrum]]);
+         rowsAdded = true;
+      }
+   }
+
+   // Save the new rows for the next session, keeping only the rows of signatures still in the library.
+   // The library may be in a read-only location, in which case it is resampled again next session.
+   if (rowsAdded && resampledFilename.empty() == false)
+   {
+      set<uint64_t> libraryHashes;
+      for (vector<Signature*>::iterator iter = signatures.begin(); iter != signatures.end(); ++iter)
+      {
+         const vector<double>* pFromData = dv_cast<vector<double> >(&(*iter)->getData("Reflectance"));
+         const vector<double>* pFromWavelengths = dv_cast<vector<double> >(&(*iter)->getData("Wavelength"));
+         if (pFromData != NULL && pFromWavelengths != NULL)
+         {
+            libraryHashes.insert(ResampledLibraryFile::hashSpectrum(*pFromWavelengths, *pFromData));
+         }
+      }
+
+      ResampledLibraryFile::Contents saved = contents;
+      saved.mHashes.clear();
+      saved.mData.clear();
+      for (size_t row = 0; row < contents.mHashes.size(); ++row)
+      {
+         if (libraryHashes.erase(contents.mHashes[row]) > 0)
+         {
+            saved.mHashes.push_back(contents.mHashes[row]);
+            saved.mData.insert(saved.mData.end(), contents.mData.begin() + row * numBands,
+               contents.mData.begin() + (row + 1) * numBands);
+         }
+      }
+
+      ResampledLibraryFile::write(resampledFilename, saved);
+   }
+
+   return success;
 }
 
-void ResamplerImp::sortOutputData(const vector<int>& sortedToBands,
-   vector<int>& toBands, vector<double>& toData)
+boost::shared_ptr<const ResamplingPlan> ResamplerImp::getResamplingPlan(const vector<double>& fromWavelengths,
+   const vector<double>& toWavelengths, const vector<double>& toFwhm, const string& resamplerMethod,
+   string& errorMessage)
 {
-   vector<int> sortedOriginalBands;
-   sortedOriginalBands.reserve(toData.size());
+   const double dropOutWindow = ResamplerOptions::getSettingDropOutWindow();
+   const double defaultFwhm = ResamplerOptions::getSettingFullWidthHalfMax();
+   {
+      QMutexLocker lock(&sPlanMutex);
+      for (list<boost::shared_ptr<const ResamplingPlan> >::iterator iter = sPlans.begin(); iter != sPlans.end(); ++iter)
+      {
+         if ((*iter)->matches(fromWavelengths, toWavelengths, toFwhm, resamplerMethod, dropOutWindow, defaultFwhm))
+         {
+            sPlans.splice(sPlans.begin(), sPlans, iter);
+            return sPlans.front();
+         }
+      }
+   }
 
-   typedef vector<pair<int,double> > VecPair;
-   VecPair pairs;
-   pairs.reserve(toData.size());
+   // Build the plan without holding the lock, since other threads may be using different plans.
+   // Callers keep their own reference, so a plan which is evicted stays valid until they are done with it.
+   boost::shared_ptr<ResamplingPlan> pPlan(new ResamplingPlan());
+   if (pPlan->initialize(fromWavelengths, toWavelengths, toFwhm, resamplerMethod,
+      dropOutWindow, defaultFwhm, errorMessage) == false)
+   {
+      return boost::shared_ptr<const ResamplingPlan>();
+   }
 
-   for (unsigned int i=0; i<toBands.size(); ++i)
+   QMutexLocker lock(&sPlanMutex);
+   sPlans.push_front(pPlan);
+   if (sPlans.size() > sMaxPlans)
    {
-      pair<int,double> temp;
-      temp.first = sortedToBands[toBands[i]];
-      temp.second = toData.at(i);
-      pairs.push_back(temp);
+      sPlans.pop_back();
    }
 
-   sort(pairs.begin(), pairs.end());
+   return pPlan;
+}
 
-   for (unsigned int j=0; j<toData.size(); ++j)
-   {
-      toBands[j] = pairs[j].first;
-      toData[j] = pairs[j].second;
+ResampleBatchThread::ResampleBatchThread(const ResampleBatchInput& input, int threadCount, int threadIndex,
+   mta::ThreadReporter& reporter) :
+   mta::AlgorithmThread(threadIndex, reporter),
+   mInput(input),
+   mSpectrumRange(getThreadRange(threadCount, input.mNumSpectra))
+{
+}
+
+void ResampleBatchThread::run()
+{
+   const unsigned int fromCount = mInput.mPlan.getFromCount();
+   const unsigned int toCount = mInput.mPlan.getToBands().size();
+   vector<double> workspace;
+   int oldPercentDone = -1;
+   for (int spectrum = mSpectrumRange.mFirst; spectrum <= mSpectrumRange.mLast; ++spectrum)
+   {
+      int percentDone = mSpectrumRange.computePercent(spectrum);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+
+      mInput.mPlan.apply(mInput.mpFromData + spectrum * fromCount, mInput.mpToData + spectrum * toCount,
+         workspace);
    }
+
+   getReporter().reportProgress(getThreadIndex(), 100);
 }
@@ -10,11 +10,19 @@
 #ifndef RESAMPLERIMP_H
 #define RESAMPLERIMP_H
 
+#include "BatchResampler.h"
+#include "MultiThreadedAlgorithm.h"
 #include "Resampler.h"
 #include "PlugInShell.h"
+#include "SignatureResampler.h"
 #include "Testable.h"
 
-class ResamplerImp : public PlugInShell, public Resampler, public Testable
+#include <boost/shared_ptr.hpp>
+
+class ResamplingPlan;
+
+class ResamplerImp : public PlugInShell, public Resampler, public BatchResampler, public SignatureResampler,
+   public Testable
 {
 public:
    ResamplerImp();
@@ -29,6 +37,18 @@ public:
       const std::vector<double>& toFwhm, std::vector<int>& toBands, std::string& errorMessage,
       const std::string& resamplerMethod);
 
+   bool executeBatch(const std::vector<double>& fromData, std::vector<double>& toData,
+      const std::vector<double>& fromWavelengths, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, std::vector<int>& toBands, std::string& errorMessage,
+      const std::string& resamplerMethod, Progress* pProgress);
+
+   bool resampleSignature(Signature* pSignature, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, std::vector<double>& toData, std::vector<int>& toBands,
+      std::string& errorMessage);
+
+   bool resampleLibrary(SignatureSet* pLibrary, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, Progress* pProgress, std::string& errorMessage);
+
    bool runOperationalTests(Progress* pProgress, std::ostream& failure) ;
    bool runAllTests(Progress* pProgress, std::ostream& failure) ;
 
@@ -62,21 +82,45 @@ private:
       const std::vector<double>& toFwhm, std::vector<int>& toBands, std::string& errorMessage,
       const std::string& resamplerMethod);
 
-   bool sortInputData(const std::vector<double>& fromWavelengths, const std::vector<double>& fromData, 
-                 const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm,
-                 std::vector<double>& sortedFromWavelengths, std::vector<double>& sortedFromData, 
-                 std::vector<double>& sortedToWavelengths, std::vector<double>& sortedToFwhm,
-                 std::vector<int>& sortedToBands, std::string& errorMessage);
+   static boost::shared_ptr<const ResamplingPlan> getResamplingPlan(const std::vector<double>& fromWavelengths,
+      const std::vector<double>& toWavelengths, const std::vector<double>& toFwhm,
+      const std::string& resamplerMethod, std::string& errorMessage);
+};
+
+struct ResampleBatchInput
+{
+   ResampleBatchInput(const ResamplingPlan& plan, const double* pFromData, double* pToData,
+      unsigned int numSpectra) :
+      mPlan(plan),
+      mpFromData(pFromData),
+      mpToData(pToData),
+      mNumSpectra(numSpectra) {}
+
+   const ResamplingPlan& mPlan;
+   const double* mpFromData;
+   double* mpToData;
+   unsigned int mNumSpectra;
+};
+
+class ResampleBatchThread : public mta::AlgorithmThread
+{
+public:
+   ResampleBatchThread(const ResampleBatchInput& input, int threadCount, int threadIndex,
+      mta::ThreadReporter& reporter);
 
-   void sortOutputData(const std::vector<int>& sortedToBands, std::vector<int>& toBands, std::vector<double>& toData);
+   void run();
 
-   // construct vector of wavelength/fwhm/index triplets
-   struct Triplet
+private:
+   const ResampleBatchInput& mInput;
+   mta::AlgorithmThread::Range mSpectrumRange;
+};
+
+struct ResampleBatchOutput
+{
+   bool compileOverallResults(const std::vector<ResampleBatchThread*>& threads)
    {
-      double mWavelength, mFwhm;
-      int mBand;
-      bool operator<(const Triplet&  other) const { return mWavelength < other.mWavelength; }
-   };
+      return true;
+   }
 };
 
 #endif
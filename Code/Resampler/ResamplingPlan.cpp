@@ -0,0 +1,322 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "GaussianResampler.h"
+#include "LinearInterpolator.h"
+#include "ResamplerOptions.h"
+#include "ResamplingPlan.h"
+#include "SplineInterpolator.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace std;
+
+namespace
+{
+   struct TargetBand
+   {
+      double mWavelength;
+      double mFwhm;
+      int mBand;
+      bool operator<(const TargetBand& other) const { return mWavelength < other.mWavelength; }
+   };
+
+   // Four independent partial sums let the compiler use packed multiplies and adds
+   // without changing the order of the additions within each sum
+   inline double dotProduct(const double* pWeights, const double* pValues, unsigned int count)
+   {
+      double sum0 = 0.0;
+      double sum1 = 0.0;
+      double sum2 = 0.0;
+      double sum3 = 0.0;
+      unsigned int i = 0;
+      for (; i + 4 <= count; i += 4)
+      {
+         sum0 += pWeights[i] * pValues[i];
+         sum1 += pWeights[i + 1] * pValues[i + 1];
+         sum2 += pWeights[i + 2] * pValues[i + 2];
+         sum3 += pWeights[i + 3] * pValues[i + 3];
+      }
+
+      for (; i < count; ++i)
+      {
+         sum0 += pWeights[i] * pValues[i];
+      }
+
+      return (sum0 + sum1) + (sum2 + sum3);
+   }
+}
+
+ResamplingPlan::ResamplingPlan() :
+   mValid(false),
+   mDropOutWindow(0.0),
+   mDefaultFwhm(0.0)
+{
+   // Do nothing
+}
+
+ResamplingPlan::~ResamplingPlan()
+{
+   // Do nothing
+}
+
+bool ResamplingPlan::initialize(const vector<double>& fromWavelengths, const vector<double>& toWavelengths,
+   const vector<double>& toFwhm, const string& resamplerMethod, double dropOutWindow, double defaultFwhm,
+   string& errorMessage)
+{
+   mValid = false;
+   mResamplerMethod = resamplerMethod;
+   mDropOutWindow = dropOutWindow;
+   mDefaultFwhm = defaultFwhm;
+   mFromWavelengths = fromWavelengths;
+   mToWavelengths = toWavelengths;
+   mToFwhm = toFwhm;
+   mToBands.clear();
+   mRowStarts.assign(1, 0);
+   mRowFirstColumns.clear();
+   mColumns.clear();
+   mWeights.clear();
+   mCurvatureRowStarts.assign(1, 0);
+   mCurvatureColumns.clear();
+   mCurvatureWeights.clear();
+   mSortedFromWavelengths.clear();
+   mSortedFromBands.clear();
+   mSplineSolver.initialize(mSortedFromWavelengths);
+
+   if (toFwhm.empty() == false && toFwhm.size() != toWavelengths.size())
+   {
+      errorMessage = "Number of FWHM values differs from number of output wavelengths.";
+      return false;
+   }
+
+   // Sort the source wavelengths, remembering the original index of each
+   vector<pair<double, int> > fromPairs;
+   fromPairs.reserve(fromWavelengths.size());
+   for (unsigned int i = 0; i < fromWavelengths.size(); ++i)
+   {
+      fromPairs.push_back(make_pair(fromWavelengths[i], static_cast<int>(i)));
+   }
+   sort(fromPairs.begin(), fromPairs.end());
+
+   mSortedFromWavelengths.reserve(fromPairs.size());
+   mSortedFromBands.reserve(fromPairs.size());
+   for (vector<pair<double, int> >::const_iterator iter = fromPairs.begin(); iter != fromPairs.end(); ++iter)
+   {
+      mSortedFromWavelengths.push_back(iter->first);
+      mSortedFromBands.push_back(iter->second);
+   }
+
+   auto_ptr<Interpolator> pInterpolator;
+   if (resamplerMethod == ResamplerOptions::LinearMethod())
+   {
+      pInterpolator = auto_ptr<Interpolator>(new LinearInterpolator(mSortedFromWavelengths, dropOutWindow));
+   }
+   else if (resamplerMethod == ResamplerOptions::CubicSplineMethod())
+   {
+      pInterpolator = auto_ptr<Interpolator>(new SplineInterpolator(mSortedFromWavelengths, dropOutWindow));
+   }
+   else if (resamplerMethod == ResamplerOptions::GaussianMethod())
+   {
+      pInterpolator = auto_ptr<Interpolator>(new GaussianResampler(mSortedFromWavelengths, dropOutWindow));
+   }
+
+   if (pInterpolator.get() == NULL)
+   {
+      errorMessage = "Unable to create interpolator for resampling.";
+      return false;
+   }
+
+   // Data which is already at the target wavelengths is copied band for band
+   if (pInterpolator->noResamplingNecessary(toWavelengths))
+   {
+      for (unsigned int i = 0; i < fromWavelengths.size(); ++i)
+      {
+         mToBands.push_back(i);
+         mColumns.push_back(i);
+         mWeights.push_back(1.0);
+         mRowStarts.push_back(mColumns.size());
+         mRowFirstColumns.push_back(i);
+         mCurvatureRowStarts.push_back(0);
+      }
+
+      mValid = true;
+      return true;
+   }
+
+   if (pInterpolator->inputsAreValid(errorMessage) == false)
+   {
+      return false;
+   }
+
+   vector<TargetBand> targets(toWavelengths.size());
+   for (unsigned int i = 0; i < toWavelengths.size(); ++i)
+   {
+      targets[i].mWavelength = toWavelengths[i];
+      targets[i].mFwhm = (toFwhm.empty() ? defaultFwhm : toFwhm[i]);
+      targets[i].mBand = i;
+   }
+   sort(targets.begin(), targets.end());
+
+   // Compute the weights in wavelength order, then store them in band order
+   vector<PointWeights> pointWeights;
+   vector<pair<int, unsigned int> > bandOrder;
+   pointWeights.reserve(targets.size());
+   bandOrder.reserve(targets.size());
+   for (vector<TargetBand>::const_iterator iter = targets.begin(); iter != targets.end(); ++iter)
+   {
+      PointWeights weights;
+      if (pInterpolator->getPointWeights(iter->mWavelength, iter->mFwhm, weights, errorMessage) == false)
+      {
+         return false;
+      }
+
+      if (weights.mDataWeights.empty() == false)
+      {
+         bandOrder.push_back(make_pair(iter->mBand, static_cast<unsigned int>(pointWeights.size())));
+         pointWeights.push_back(weights);
+      }
+   }
+
+   if (bandOrder.empty() == true)
+   {
+      errorMessage = "No bands could be resampled.";
+      return false;
+   }
+
+   sort(bandOrder.begin(), bandOrder.end());
+   for (vector<pair<int, unsigned int> >::const_iterator iter = bandOrder.begin(); iter != bandOrder.end(); ++iter)
+   {
+      const PointWeights& weights = pointWeights[iter->second];
+      mToBands.push_back(iter->first);
+      const unsigned int rowStart = mColumns.size();
+      for (unsigned int i = 0; i < weights.mDataWeights.size(); ++i)
+      {
+         mColumns.push_back(mSortedFromBands[weights.mDataWeights[i].first]);
+         mWeights.push_back(weights.mDataWeights[i].second);
+      }
+
+      // Rows whose source values are adjacent in the input can be applied without the column indices
+      int firstColumn = mColumns[rowStart];
+      for (unsigned int i = rowStart; i < mColumns.size() && firstColumn >= 0; ++i)
+      {
+         if (mColumns[i] != firstColumn + static_cast<int>(i - rowStart))
+         {
+            firstColumn = -1;
+         }
+      }
+      mRowFirstColumns.push_back(firstColumn);
+
+      for (unsigned int i = 0; i < weights.mCurvatureWeights.size(); ++i)
+      {
+         mCurvatureColumns.push_back(weights.mCurvatureWeights[i].first);
+         mCurvatureWeights.push_back(weights.mCurvatureWeights[i].second);
+      }
+
+      mRowStarts.push_back(mColumns.size());
+      mCurvatureRowStarts.push_back(mCurvatureColumns.size());
+   }
+
+   if (mCurvatureWeights.empty() == false)
+   {
+      mSplineSolver.initialize(mSortedFromWavelengths);
+   }
+
+   mValid = true;
+   return true;
+}
+
+bool ResamplingPlan::isValid() const
+{
+   return mValid;
+}
+
+bool ResamplingPlan::matches(const vector<double>& fromWavelengths, const vector<double>& toWavelengths,
+   const vector<double>& toFwhm, const string& resamplerMethod, double dropOutWindow, double defaultFwhm) const
+{
+   return mValid && mResamplerMethod == resamplerMethod && mDropOutWindow == dropOutWindow &&
+      mDefaultFwhm == defaultFwhm && mFromWavelengths == fromWavelengths && mToWavelengths == toWavelengths &&
+      mToFwhm == toFwhm;
+}
+
+const vector<int>& ResamplingPlan::getToBands() const
+{
+   return mToBands;
+}
+
+unsigned int ResamplingPlan::getFromCount() const
+{
+   return mFromWavelengths.size();
+}
+
+void ResamplingPlan::apply(const double* pFromData, double* pToData) const
+{
+   vector<double> workspace;
+   apply(pFromData, pToData, workspace);
+}
+
+void ResamplingPlan::apply(const double* pFromData, double* pToData, vector<double>& workspace) const
+{
+   const double* pCurvature = NULL;
+   if (mCurvatureWeights.empty() == false)
+   {
+      const unsigned int numFromBands = mSortedFromBands.size();
+      workspace.resize(3 * numFromBands);
+      double* pSortedFromData = &workspace[0];
+      double* pSecondDerivatives = pSortedFromData + numFromBands;
+      for (unsigned int i = 0; i < numFromBands; ++i)
+      {
+         pSortedFromData[i] = pFromData[mSortedFromBands[i]];
+      }
+
+      mSplineSolver.solve(pSortedFromData, pSecondDerivatives, pSecondDerivatives + numFromBands);
+      pCurvature = pSecondDerivatives;
+   }
+
+   const unsigned int numRows = mToBands.size();
+   for (unsigned int row = 0; row < numRows; ++row)
+   {
+      double value = 0.0;
+      if (mRowFirstColumns[row] >= 0)
+      {
+         value = dotProduct(&mWeights[mRowStarts[row]], pFromData + mRowFirstColumns[row],
+            mRowStarts[row + 1] - mRowStarts[row]);
+      }
+      else
+      {
+         for (unsigned int i = mRowStarts[row]; i < mRowStarts[row + 1]; ++i)
+         {
+            value += mWeights[i] * pFromData[mColumns[i]];
+         }
+      }
+
+      for (unsigned int i = mCurvatureRowStarts[row]; i < mCurvatureRowStarts[row + 1]; ++i)
+      {
+         value += mCurvatureWeights[i] * pCurvature[mCurvatureColumns[i]];
+      }
+
+      pToData[row] = value;
+   }
+}
+
+bool ResamplingPlan::apply(const vector<double>& fromData, vector<double>& toData) const
+{
+   if (mValid == false || fromData.size() != mFromWavelengths.size())
+   {
+      return false;
+   }
+
+   toData.resize(mToBands.size());
+   if (toData.empty() == false)
+   {
+      apply(&fromData.front(), &toData.front());
+   }
+
+   return true;
+}
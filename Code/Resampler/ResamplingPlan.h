@@ -0,0 +1,137 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RESAMPLINGPLAN_H
+#define RESAMPLINGPLAN_H
+
+#include "SplineInterpolator.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Precomputed weights which resample data from one set of wavelengths to another.
+ *
+ * Creating a plan does all of the work which depends only on the wavelengths:
+ * sorting, locating the source wavelengths around each target wavelength and
+ * evaluating the interpolation weights. The plan can then be applied to any number
+ * of spectra sampled at the same source wavelengths, each of which only costs a
+ * sparse dot product per target band (plus a forward and back substitution through the
+ * factored spline system for cubic splines).
+ * Gaussian weights are truncated to the source wavelengths near each band center,
+ * so for ordered input data each band reads one short contiguous run of values.
+ *
+ * The results are the same as ResamplerImp::execute() for the same inputs.
+ */
+class ResamplingPlan
+{
+public:
+   ResamplingPlan();
+   ~ResamplingPlan();
+
+   /**
+    * Computes the plan.
+    *
+    * @param fromWavelengths
+    *        The wavelengths of the data which will be resampled. These do not need to be sorted.
+    * @param toWavelengths
+    *        The wavelengths to resample to. These do not need to be sorted.
+    * @param toFwhm
+    *        The full width at half maximum of each target band. If empty, defaultFwhm is used.
+    * @param resamplerMethod
+    *        One of the ResamplerOptions methods.
+    * @param dropOutWindow
+    *        The largest gap between source wavelengths which is interpolated across.
+    * @param defaultFwhm
+    *        The full width at half maximum used when toFwhm is empty.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    *
+    * @return False if the plan could not be computed, true otherwise.
+    */
+   bool initialize(const std::vector<double>& fromWavelengths, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, const std::string& resamplerMethod, double dropOutWindow,
+      double defaultFwhm, std::string& errorMessage);
+
+   bool isValid() const;
+
+   /**
+    * Returns whether this plan was computed from the given inputs.
+    */
+   bool matches(const std::vector<double>& fromWavelengths, const std::vector<double>& toWavelengths,
+      const std::vector<double>& toFwhm, const std::string& resamplerMethod, double dropOutWindow,
+      double defaultFwhm) const;
+
+   /**
+    * Returns the indices of the target bands which can be resampled, in ascending order.
+    */
+   const std::vector<int>& getToBands() const;
+
+   unsigned int getFromCount() const;
+
+   /**
+    * Resamples one spectrum.
+    *
+    * @param pFromData
+    *        The source values, ordered as the source wavelengths passed to initialize().
+    * @param pToData
+    *        Receives one value for each of getToBands().
+    */
+   void apply(const double* pFromData, double* pToData) const;
+
+   /**
+    * Resamples one spectrum using caller supplied scratch space.
+    *
+    * This avoids an allocation for each spectrum when many spectra are resampled
+    * in a loop. Each thread needs its own workspace.
+    *
+    * @param pFromData
+    *        The source values, ordered as the source wavelengths passed to initialize().
+    * @param pToData
+    *        Receives one value for each of getToBands().
+    * @param workspace
+    *        Scratch space which is resized as needed.
+    */
+   void apply(const double* pFromData, double* pToData, std::vector<double>& workspace) const;
+
+   /**
+    * Resamples one spectrum.
+    *
+    * @return False if the size of fromData differs from the number of source wavelengths.
+    */
+   bool apply(const std::vector<double>& fromData, std::vector<double>& toData) const;
+
+private:
+   bool mValid;
+   std::string mResamplerMethod;
+   double mDropOutWindow;
+   double mDefaultFwhm;
+   std::vector<double> mFromWavelengths;
+   std::vector<double> mToWavelengths;
+   std::vector<double> mToFwhm;
+
+   std::vector<int> mToBands;
+
+   // Row r of the weights covers entries [mRowStarts[r], mRowStarts[r + 1]); columns are original source indices
+   std::vector<unsigned int> mRowStarts;
+   // The first column of each row whose columns are consecutive, or -1
+   std::vector<int> mRowFirstColumns;
+   std::vector<int> mColumns;
+   std::vector<double> mWeights;
+
+   // Cubic spline terms: weights on the second derivatives, whose columns are sorted source indices
+   std::vector<unsigned int> mCurvatureRowStarts;
+   std::vector<int> mCurvatureColumns;
+   std::vector<double> mCurvatureWeights;
+   std::vector<double> mSortedFromWavelengths;
+   std::vector<int> mSortedFromBands;
+   NaturalSplineSolver mSplineSolver;
+};
+
+#endif
@@ -9,86 +9,86 @@
 
 #include "SplineInterpolator.h"
 
+#include <algorithm>
+
 using namespace std;
-SplineInterpolator::SplineInterpolator(const vector<double>& fromWavelengths,
-   const vector<double>& fromData, double dropOutWindow) :
-   Interpolator(fromWavelengths, fromData, dropOutWindow), y2(fromWavelengths.size())
+SplineInterpolator::SplineInterpolator(const vector<double>& fromWavelengths, double dropOutWindow) :
+   Interpolator(fromWavelengths, dropOutWindow)
 {
-   const double endPointDerivative = 2.0e30; // signals endpoint second derivative = 0.0
+   // Do nothing
+}
+
+void SplineInterpolator::getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights)
+{
+   // The spline value is linear in the source values and their second derivatives
+   const int numWavelengths = mFromWavelengths.size();
+   int khi = min(max(static_cast<int>(getUpperIndex(toWavelength)), 1), numWavelengths - 1);
+   int klo = khi - 1;
+
+   double h = mFromWavelengths[khi]-mFromWavelengths[klo];
+   double a = (mFromWavelengths[khi]-toWavelength)/h;
+   double b = (toWavelength-mFromWavelengths[klo])/h;
 
-   spline(fromWavelengths, fromData, fromData.size(), endPointDerivative, endPointDerivative, y2);
+   weights.mDataWeights.push_back(make_pair(klo, a));
+   weights.mDataWeights.push_back(make_pair(khi, b));
+   weights.mCurvatureWeights.push_back(make_pair(klo, (a*a*a-a)*(h*h)/6.0));
+   weights.mCurvatureWeights.push_back(make_pair(khi, (b*b*b-b)*(h*h)/6.0));
 }
 
-double SplineInterpolator::resamplePoint(IndexPair indices, double toWavelength, double toFwhm)
+NaturalSplineSolver::NaturalSplineSolver()
 {
-   return splint(mFromData.size(), mFromWavelengths, mFromData, y2, toWavelength);
+   // Do nothing
 }
 
-void SplineInterpolator::spline(const vector<double>& x, const vector<double>& y,
-   int n, double yp1, double ypn, vector<double>& y2)
+void NaturalSplineSolver::initialize(const vector<double>& x)
 {
-   int i, k;
-   double p, qn, sig, un;
-   vector<double> u(n);
+   const unsigned int n = x.size();
+   mInverseSpacing.assign(n, 0.0);
+   mSpanScale.assign(n, 0.0);
+   mSig.assign(n, 0.0);
+   mInversePivot.assign(n, 0.0);
+   mFactor.assign(n, 0.0);
 
-   if (yp1 > 0.99e30)
+   for (unsigned int i = 0; i + 1 < n; ++i)
    {
-      y2[0] = u[0] = 0.0;
-   }
-   else
-   {
-      y2[0] = -0.5;
-      u[0]  = (3.0/(x[1]-x[0]))*((y[1]-y[0])/(x[1]-x[0])-yp1);
+      mInverseSpacing[i] = 1.0/(x[i+1]-x[i]);
    }
 
-   for (i=1; i<n-1; i++)
+   // The decomposition of the tridiagonal system with zero second derivatives at both ends
+   for (unsigned int i = 1; i + 1 < n; ++i)
    {
-      sig=(x[i]-x[i-1])/(x[i+1]-x[i-1]);
-      p = sig*y2[i-1]+2.0;
-      y2[i]=(sig-1.0)/p;
-      u[i]=(y[i+1]-y[i])/(x[i+1]-x[i]) - (y[i]-y[i-1])/(x[i]-x[i-1]);
-      u[i]=(6.0*u[i]/(x[i+1]-x[i-1])-sig*u[i-1])/p;
+      mSig[i] = (x[i]-x[i-1])/(x[i+1]-x[i-1]);
+      double p = mSig[i]*mFactor[i-1]+2.0;
+      mInversePivot[i] = 1.0/p;
+      mFactor[i] = (mSig[i]-1.0)/p;
+      mSpanScale[i] = 6.0/(x[i+1]-x[i-1]);
    }
+}
 
-   if (ypn > 0.99e30)
-   {
-      qn = un = 0.0;
-   }
-   else
+unsigned int NaturalSplineSolver::getSize() const
+{
+   return mFactor.size();
+}
+
+void NaturalSplineSolver::solve(const double* pY, double* pY2, double* pWork) const
+{
+   const unsigned int n = mFactor.size();
+   if (n == 0)
    {
-      qn = 0.5;
-      un = (3.0/(x[n-1]-x[n-2]))*(ypn-(y[n-1]-y[n-2])/(x[n-1]-x[n-2]));
+      return;
    }
 
-   y2[n-1] = (un-qn*u[n-2])/(qn*y2[n-2]+1.0);
-   for (k=n-2; k>=0; k--)
+   double* pU = pWork;
+   pU[0] = 0.0;
+   for (unsigned int i = 1; i + 1 < n; ++i)
    {
-      y2[k] = y2[k]*y2[k+1]+u[k];
+      double u = (pY[i+1]-pY[i])*mInverseSpacing[i] - (pY[i]-pY[i-1])*mInverseSpacing[i-1];
+      pU[i] = (u*mSpanScale[i]-mSig[i]*pU[i-1])*mInversePivot[i];
    }
-}
-
-double SplineInterpolator::splint(int n, const vector<double>& xorgn,
-   const vector<double>& yorgn, const vector<double>& y2, double x)
-{
-   int k, klo, khi;
-   double h, a, b;
 
-   klo = 0;
-   khi = n-1;
-   while (khi-klo > 1) 
+   pY2[n-1] = 0.0;
+   for (int k = static_cast<int>(n)-2; k >= 0; --k)
    {
-      k=(khi+klo) >> 1;
-      if (xorgn[k] > x)
-      {
-         khi=k;
-      }
-      else
-      {
-         klo=k;
-      }
+      pY2[k] = mFactor[k]*pY2[k+1]+pU[k];
    }
-   h = xorgn[khi]-xorgn[klo];
-   a = (xorgn[khi]-x)/h;
-   b = (x-xorgn[klo])/h;
-   return a*yorgn[klo]+b*yorgn[khi]+((a*a*a-a)*y2[klo]+(b*b*b-b)*y2[khi])*(h*h)/6.0;
 }
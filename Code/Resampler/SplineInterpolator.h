@@ -15,19 +15,51 @@
 class SplineInterpolator : public Interpolator
 {
 public:
-   SplineInterpolator(const std::vector<double>& fromWavelengths,
-      const std::vector<double>& fromData, double dropOutWindow);
+   SplineInterpolator(const std::vector<double>& fromWavelengths, double dropOutWindow);
+
 private:
-   double resamplePoint(IndexPair indices, double toWavelength, double toFwhm);
+   void getWeights(IndexPair indices, double toWavelength, double toFwhm, PointWeights& weights);
+};
 
-   static void spline(const std::vector<double>& x, const std::vector<double>& y, int n,
-      double yp1, double ypn, std::vector<double>& y2);
+/**
+ * Computes the second derivatives of natural cubic splines through values at fixed wavelengths.
+ *
+ * The tridiagonal system only depends on the wavelengths, so it is factored once by
+ * initialize() and each set of values only needs a forward and a back substitution.
+ */
+class NaturalSplineSolver
+{
+public:
+   NaturalSplineSolver();
 
-   static double splint(int n, const std::vector<double>& xorgn,
-      const std::vector<double>& yorgn, const std::vector<double>& y2, double x);
+   /**
+    * Factors the system for a set of wavelengths.
+    *
+    * @param x
+    *        The sorted wavelengths.
+    */
+   void initialize(const std::vector<double>& x);
 
-   std::vector<double> y2;
-};
+   unsigned int getSize() const;
+
+   /**
+    * Computes the second derivatives for one set of values.
+    *
+    * @param pY
+    *        The value at each wavelength.
+    * @param pY2
+    *        Receives the second derivative at each wavelength.
+    * @param pWork
+    *        Scratch space for getSize() values.
+    */
+   void solve(const double* pY, double* pY2, double* pWork) const;
 
+private:
+   std::vector<double> mInverseSpacing;
+   std::vector<double> mSpanScale;
+   std::vector<double> mSig;
+   std::vector<double> mInversePivot;
+   std::vector<double> mFactor;
+};
 
 #endif
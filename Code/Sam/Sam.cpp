@@ -26,11 +26,11 @@
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
 #include "RasterUtilities.h"
-#include "Resampler.h"
 #include "Sam.h"
 #include "SamDlg.h"
 #include "SamErr.h"
 #include "Signature.h"
+#include "SignatureResampler.h"
 #include "SpectralUtilities.h"
 #include "SpectralVersion.h"
 #include "Statistics.h"
@@ -169,7 +169,7 @@ bool Sam::extractFromGui()
       return false;
    }
    mInputs.mThreshold = mpSamGui->getThreshold();
-   mInputs.mSignatures = mpSamGui->getExtractedSignatures();
+   mInputs.mSignatures = SpectralUtilities::extractSignatures(mpSamGui->getSignatures());
    mInputs.mResultsName = mpSamGui->getResultsName();
    mInputs.mpAoi = mpSamGui->getAoi();
    mInputs.mbCreatePseudocolor = mpSamGui->isPseudocolorLayerUsed();
@@ -590,7 +590,7 @@ bool SamAlgorithm::resampleSpectrum(Signature* pSignature,
 
    vector<double> fwhm = const_cast<Wavelengths&>(wavelengths).getFwhm();
    PlugInResource resampler("Resampler");
-   Resampler* pResampler = dynamic_cast<Resampler*>(resampler.get());
+   SignatureResampler* pResampler = dynamic_cast<SignatureResampler*>(resampler.get());
    if (pResampler == NULL)
    {
       string messageText = "The resampler plug-in could not be created.";
@@ -599,26 +599,12 @@ bool SamAlgorithm::resampleSpectrum(Signature* pSignature,
       return false;
    }
    string err;
-   try
-   {
-      vector<double> sigReflectance = dv_cast<vector<double> >(pSignature->getData("Reflectance"));
-      resampledAmplitude.reserve(sigReflectance.size());
-      resampledBands.reserve(sigReflectance.size());
-      if (!pResampler->execute(sigReflectance,
-                              resampledAmplitude,
-                              dv_cast<vector<double> >(pSignature->getData("Wavelength")),
-                              wavelengths.getCenterValues(),
-                              fwhm,
-                              resampledBands,
-                              err))
-      {
-         string messageText = "Resampling failed: " + err;
-         if (pProgress != NULL) pProgress->updateProgress(messageText, 0, ERRORS);
-         pStep->finalize(Message::Failure, messageText);
-         return false;
-      }
-   }
-   catch(std::bad_cast&)
+   if (!pResampler->resampleSignature(pSignature,
+                                      wavelengths.getCenterValues(),
+                                      fwhm,
+                                      resampledAmplitude,
+                                      resampledBands,
+                                      err))
    {
       string messageText = "Resampling failed: " + err;
       if (pProgress != NULL) pProgress->updateProgress(messageText, 0, ERRORS);
@@ -0,0 +1,51 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BINARYSIGNATURESET_H
+#define BINARYSIGNATURESET_H
+
+#include "AppConfig.h"
+
+/**
+ * The layout of a binary spectral library file.
+ *
+ * The file starts with this header and is followed by three sections at the given offsets:
+ *  - The shared wavelength grid in microns, as mBandCount doubles in ascending order.
+ *  - The reflectance matrix, as mSignatureCount rows of mBandCount floats. A NaN marks a
+ *    wavelength which is not part of a signature.
+ *  - The records, which hold the name and metadata of the library followed by the name, units
+ *    and metadata of each signature.
+ *
+ * A string in the records is an unsigned int length followed by that many characters. Metadata
+ * is an unsigned int count followed by a name, a type name and an XML value string for each entry.
+ * The units of a signature are the unit name, the UnitType as an XML string and the scale from
+ * standard as a double. All values are in the byte order of the computer which wrote the file, which is
+ * identified by mByteOrder.
+ */
+struct BinarySignatureSetHeader
+{
+   char mMagic[8];
+   unsigned int mByteOrder;
+   unsigned int mVersion;
+   unsigned int mSignatureCount;
+   unsigned int mBandCount;
+   int64_t mWavelengthOffset;
+   int64_t mDataOffset;
+   int64_t mRecordOffset;
+   int64_t mRecordBytes;
+};
+
+namespace BinarySignatureSet
+{
+   const char sMagic[8] = { 'S', 'P', 'E', 'C', 'L', 'I', 'B', '\0' };
+   const unsigned int sByteOrder = 0x01020304;
+   const unsigned int sVersion = 1;
+}
+
+#endif
@@ -0,0 +1,327 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BinarySignatureSet.h"
+#include "BinarySignatureSetExporter.h"
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "FileDescriptor.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "ProgressTracker.h"
+#include "SignatureSet.h"
+#include "SpectralUtilities.h"
+#include "SpectralVersion.h"
+#include "StringUtilities.h"
+#include "TypeConverter.h"
+#include "Units.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralSignature, BinarySignatureSetExporter);
+
+namespace
+{
+   void getSignatures(SignatureSet* pSignatureSet, vector<Signature*>& signatures)
+   {
+      vector<Signature*> members = pSignatureSet->getSignatures();
+      for (vector<Signature*>::iterator member = members.begin(); member != members.end(); ++member)
+      {
+         SignatureSet* pSubSet = dynamic_cast<SignatureSet*>(*member);
+         if (pSubSet != NULL)
+         {
+            getSignatures(pSubSet, signatures);
+         }
+         else if (*member != NULL)
+         {
+            signatures.push_back(*member);
+         }
+      }
+   }
+
+   template<typename T>
+   void appendValue(vector<char>& records, const T& value)
+   {
+      const char* pValue = reinterpret_cast<const char*>(&value);
+      records.insert(records.end(), pValue, pValue + sizeof(T));
+   }
+
+   void appendString(vector<char>& records, const string& value)
+   {
+      appendValue(records, static_cast<unsigned int>(value.size()));
+      records.insert(records.end(), value.begin(), value.end());
+   }
+
+   void appendMetadata(vector<char>& records, const DynamicObject* pMetadata)
+   {
+      vector<string> names;
+      if (pMetadata != NULL)
+      {
+         pMetadata->getAttributeNames(names);
+      }
+
+      // Nested objects are not written, as in the ASCII signature format
+      vector<string> entries;
+      for (vector<string>::const_iterator name = names.begin(); name != names.end(); ++name)
+      {
+         const DataVariant& value = pMetadata->getAttribute(*name);
+         if (value.getTypeName() == TypeConverter::toString<DynamicObject>())
+         {
+            continue;
+         }
+
+         DataVariant::Status status = DataVariant::SUCCESS;
+         string text = value.toXmlString(&status);
+         if (status == DataVariant::SUCCESS)
+         {
+            entries.push_back(*name);
+            entries.push_back(value.getTypeName());
+            entries.push_back(text);
+         }
+      }
+
+      appendValue(records, static_cast<unsigned int>(entries.size() / 3));
+      for (vector<string>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry)
+      {
+         appendString(records, *entry);
+      }
+   }
+
+   /**
+    * Writes to the mapped file if it could be mapped, or with QFile::write() otherwise.
+    */
+   bool writeBytes(QFile& file, uchar* pMapped, int64_t offset, const void* pData, size_t bytes)
+   {
+      if (pMapped != NULL)
+      {
+         memcpy(pMapped + offset, pData, bytes);
+         return true;
+      }
+
+      return file.seek(offset) && file.write(static_cast<const char*>(pData), bytes) == static_cast<qint64>(bytes);
+   }
+
+   /**
+    * Removes a partially written library so an aborted or failed export does not leave a file behind.
+    */
+   void removeFile(QFile& file, uchar* pMapped)
+   {
+      if (pMapped != NULL)
+      {
+         file.unmap(pMapped);
+      }
+
+      file.close();
+      file.remove();
+   }
+}
+
+BinarySignatureSetExporter::BinarySignatureSetExporter()
+{
+   setDescriptorId("{5C3A9E27-0B4D-4F18-A6E2-8D71B5C94F30}");
+   setName("Binary Spectral Library Exporter");
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setShortDescription("Export spectral signature libraries to a single binary file.");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+   setExtensions("Binary Spectral Library Files (*.bsl)");
+   setSubtype(TypeConverter::toString<SignatureSet>());
+   setAbortSupported(true);
+}
+
+BinarySignatureSetExporter::~BinarySignatureSetExporter()
+{
+}
+
+bool BinarySignatureSetExporter::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY((pInArgList = Service<PlugInManagerServices>()->getPlugInArgList()) != NULL);
+   VERIFY(pInArgList->addArg<Progress>(Executable::ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<SignatureSet>(Exporter::ExportItemArg()));
+   VERIFY(pInArgList->addArg<FileDescriptor>(Exporter::ExportDescriptorArg()));
+   return true;
+}
+
+bool BinarySignatureSetExporter::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   VERIFY(pInArgList != NULL);
+   ProgressTracker progress(pInArgList->getPlugInArgValue<Progress>(Executable::ProgressArg()),
+      "Exporting binary spectral library", "spectral", "9D4E2A71-36C8-4B05-8F1E-C27A5D0B6E93");
+
+   SignatureSet* pSignatureSet = pInArgList->getPlugInArgValue<SignatureSet>(Exporter::ExportItemArg());
+   VERIFY(pSignatureSet != NULL);
+   FileDescriptor* pFileDescriptor = pInArgList->getPlugInArgValue<FileDescriptor>(Exporter::ExportDescriptorArg());
+   VERIFY(pFileDescriptor != NULL);
+
+   if (SpectralUtilities::loadSignatureData(pSignatureSet, progress.getCurrentProgress()) == false)
+   {
+      progress.report("Unable to load the signature data.", 0, ERRORS, true);
+      return false;
+   }
+
+   vector<Signature*> signatures;
+   getSignatures(pSignatureSet, signatures);
+   if (signatures.empty())
+   {
+      progress.report("No signatures to export.", 0, ERRORS, true);
+      return false;
+   }
+
+   // The grid holds every wavelength of every signature, so signatures from one sensor share every band
+   vector<const vector<double>*> wavelengthData(signatures.size(), NULL);
+   vector<const vector<double>*> reflectanceData(signatures.size(), NULL);
+   vector<double> grid;
+   for (vector<Signature*>::size_type index = 0; index < signatures.size(); ++index)
+   {
+      wavelengthData[index] = dv_cast<vector<double> >(&signatures[index]->getData("Wavelength"));
+      reflectanceData[index] = dv_cast<vector<double> >(&signatures[index]->getData("Reflectance"));
+      if (wavelengthData[index] == NULL || reflectanceData[index] == NULL ||
+         wavelengthData[index]->size() != reflectanceData[index]->size())
+      {
+         progress.report("Signature " + signatures[index]->getName() + " does not contain \"Wavelength\" and "
+            "\"Reflectance\" data of the same size.", 0, ERRORS, true);
+         return false;
+      }
+
+      if (index == 0 || *wavelengthData[index] != *wavelengthData[index - 1])
+      {
+         grid.insert(grid.end(), wavelengthData[index]->begin(), wavelengthData[index]->end());
+         sort(grid.begin(), grid.end());
+         grid.erase(unique(grid.begin(), grid.end()), grid.end());
+      }
+   }
+
+   if (grid.empty())
+   {
+      progress.report("The signatures do not contain any data.", 0, ERRORS, true);
+      return false;
+   }
+
+   // Names, units and metadata
+   vector<char> records;
+   appendString(records, pSignatureSet->getName());
+   appendMetadata(records, pSignatureSet->getMetadata());
+   for (vector<Signature*>::const_iterator signature = signatures.begin(); signature != signatures.end(); ++signature)
+   {
+      string unitName;
+      UnitType unitType = REFLECTANCE;
+      double unitScale = 1.0;
+      const Units* pUnits = (*signature)->getUnits("Reflectance");
+      if (pUnits != NULL)
+      {
+         unitName = pUnits->getUnitName();
+         unitType = pUnits->getUnitType();
+         unitScale = pUnits->getScaleFromStandard();
+      }
+
+      appendString(records, (*signature)->getName());
+      appendString(records, unitName);
+      appendString(records, StringUtilities::toXmlString(unitType));
+      appendValue(records, unitScale);
+      appendMetadata(records, (*signature)->getMetadata());
+   }
+
+   BinarySignatureSetHeader header;
+   memcpy(header.mMagic, BinarySignatureSet::sMagic, sizeof(header.mMagic));
+   header.mByteOrder = BinarySignatureSet::sByteOrder;
+   header.mVersion = BinarySignatureSet::sVersion;
+   header.mSignatureCount = signatures.size();
+   header.mBandCount = grid.size();
+   header.mWavelengthOffset = sizeof(header);
+   header.mDataOffset = header.mWavelengthOffset + static_cast<int64_t>(grid.size()) * sizeof(double);
+   header.mRecordOffset = header.mDataOffset +
+      static_cast<int64_t>(signatures.size()) * grid.size() * sizeof(float);
+   header.mRecordBytes = records.size();
+   const int64_t fileBytes = header.mRecordOffset + header.mRecordBytes;
+
+   QFile file(QString::fromStdString(pFileDescriptor->getFilename().getFullPathAndName()));
+   if (file.open(QIODevice::ReadWrite | QIODevice::Truncate) == false)
+   {
+      progress.report("Unable to open file for export.", 0, ERRORS, true);
+      return false;
+   }
+
+   if (file.resize(fileBytes) == false)
+   {
+      removeFile(file, NULL);
+      progress.report("Unable to open file for export.", 0, ERRORS, true);
+      return false;
+   }
+
+   // The header is written last, so the file is not recognized as a library until every row is in place
+   uchar* pMapped = file.map(0, fileBytes);
+   bool success = writeBytes(file, pMapped, header.mWavelengthOffset, &grid.front(), grid.size() * sizeof(double)) &&
+      (records.empty() || writeBytes(file, pMapped, header.mRecordOffset, &records.front(), records.size()));
+
+   vector<float> row(grid.size());
+   int lastPercent = -1;
+   for (vector<Signature*>::size_type index = 0; success && index < signatures.size(); ++index)
+   {
+      if (isAborted())
+      {
+         removeFile(file, pMapped);
+         progress.report("Exporter aborted", 0, ABORT, true);
+         return false;
+      }
+
+      int percent = static_cast<int>(100.0 * index / signatures.size());
+      if (percent != lastPercent)
+      {
+         progress.report("Exporting signatures", percent, NORMAL);
+         lastPercent = percent;
+      }
+
+      const vector<double>& wavelengths = *wavelengthData[index];
+      const vector<double>& reflectances = *reflectanceData[index];
+      if (wavelengths == grid)
+      {
+         copy(reflectances.begin(), reflectances.end(), row.begin());
+      }
+      else
+      {
+         fill(row.begin(), row.end(), numeric_limits<float>::quiet_NaN());
+         for (vector<double>::size_type band = 0; band < wavelengths.size(); ++band)
+         {
+            row[lower_bound(grid.begin(), grid.end(), wavelengths[band]) - grid.begin()] =
+               static_cast<float>(reflectances[band]);
+         }
+      }
+
+      success = writeBytes(file, pMapped, header.mDataOffset + static_cast<int64_t>(index) * row.size() *
+         sizeof(float), &row.front(), row.size() * sizeof(float));
+   }
+
+   success = success && writeBytes(file, pMapped, 0, &header, sizeof(header));
+   if (pMapped != NULL)
+   {
+      success = file.unmap(pMapped) && success;
+      pMapped = NULL;
+   }
+
+   if (success == false || file.flush() == false)
+   {
+      removeFile(file, pMapped);
+      progress.report("Unable to write the spectral library.", 0, ERRORS, true);
+      return false;
+   }
+
+   progress.report("Exported signature library.", 100, NORMAL);
+   progress.upALevel();
+   return true;
+}
@@ -0,0 +1,29 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BINARYSIGNATURESETEXPORTER_H
+#define BINARYSIGNATURESETEXPORTER_H
+
+#include "ExporterShell.h"
+
+/**
+ * Exports a signature set and the signatures in any nested signature sets to a single
+ * binary spectral library file. See BinarySignatureSetHeader for the layout of the file.
+ */
+class BinarySignatureSetExporter : public ExporterShell
+{
+public:
+   BinarySignatureSetExporter();
+   ~BinarySignatureSetExporter();
+
+   bool getInputSpecification(PlugInArgList*& pInArgList);
+   bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+};
+
+#endif
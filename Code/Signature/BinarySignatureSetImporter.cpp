@@ -0,0 +1,380 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BinarySignatureSet.h"
+#include "BinarySignatureSetImporter.h"
+#include "DataDescriptor.h"
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "FileDescriptor.h"
+#include "ImportDescriptor.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "ProgressTracker.h"
+#include "SignatureSet.h"
+#include "SpectralVersion.h"
+#include "StringUtilities.h"
+#include "TypeConverter.h"
+#include "Units.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <string.h>
+
+using namespace std;
+
+REGISTER_PLUGIN_BASIC(SpectralSignature, BinarySignatureSetImporter);
+
+namespace
+{
+   /**
+    * Reads values from the records of a mapped library without reading past their end.
+    */
+   class RecordReader
+   {
+   public:
+      RecordReader(const char* pBegin, const char* pEnd) :
+         mpCurrent(pBegin),
+         mpEnd(pEnd)
+      {
+      }
+
+      template<typename T>
+      bool read(T& value)
+      {
+         if (static_cast<size_t>(mpEnd - mpCurrent) < sizeof(T))
+         {
+            return false;
+         }
+
+         memcpy(&value, mpCurrent, sizeof(T));
+         mpCurrent += sizeof(T);
+         return true;
+      }
+
+      bool read(string& value)
+      {
+         unsigned int length = 0;
+         if (read(length) == false || static_cast<size_t>(mpEnd - mpCurrent) < length)
+         {
+            return false;
+         }
+
+         value.assign(mpCurrent, length);
+         mpCurrent += length;
+         return true;
+      }
+
+      /**
+       * Reads metadata into pMetadata, or skips it if pMetadata is NULL.
+       */
+      bool readMetadata(DynamicObject* pMetadata)
+      {
+         unsigned int count = 0;
+         if (read(count) == false)
+         {
+            return false;
+         }
+
+         string name;
+         string type;
+         string text;
+         for (unsigned int entry = 0; entry < count; ++entry)
+         {
+            if (read(name) == false || read(type) == false || read(text) == false)
+            {
+               return false;
+            }
+
+            if (pMetadata != NULL)
+            {
+               DataVariant value;
+               if (value.fromXmlString(type, text) == DataVariant::SUCCESS)
+               {
+                  pMetadata->setAttribute(name, value);
+               }
+               else
+               {
+                  pMetadata->setAttribute(name, text);
+               }
+            }
+         }
+
+         return true;
+      }
+
+   private:
+      const char* mpCurrent;
+      const char* mpEnd;
+   };
+
+   /**
+    * Returns whether a section of the given size starting at the given offset lies inside the file.
+    */
+   bool isSectionInFile(int64_t offset, uint64_t bytes, int64_t fileBytes)
+   {
+      return offset >= 0 && offset <= fileBytes && bytes <= static_cast<uint64_t>(fileBytes - offset);
+   }
+
+   /**
+    * Maps a library and returns its header, or NULL if the file is not a valid library.
+    */
+   const BinarySignatureSetHeader* mapLibrary(QFile& file)
+   {
+      if (file.open(QIODevice::ReadOnly) == false)
+      {
+         return NULL;
+      }
+
+      const int64_t fileBytes = file.size();
+      if (fileBytes < static_cast<int64_t>(sizeof(BinarySignatureSetHeader)))
+      {
+         return NULL;
+      }
+
+      const BinarySignatureSetHeader* pHeader =
+         reinterpret_cast<const BinarySignatureSetHeader*>(file.map(0, fileBytes));
+      if (pHeader == NULL || memcmp(pHeader->mMagic, BinarySignatureSet::sMagic, sizeof(pHeader->mMagic)) != 0 ||
+         pHeader->mByteOrder != BinarySignatureSet::sByteOrder || pHeader->mVersion != BinarySignatureSet::sVersion)
+      {
+         return NULL;
+      }
+
+      // Each section must be inside the file and aligned for its values. Sizes are compared against the bytes
+      // remaining after each offset so that corrupt counts or offsets cannot overflow the checks.
+      const uint64_t valueCount = static_cast<uint64_t>(pHeader->mSignatureCount) * pHeader->mBandCount;
+      if (valueCount > static_cast<uint64_t>(fileBytes) / sizeof(float))
+      {
+         return NULL;
+      }
+
+      if (pHeader->mWavelengthOffset < static_cast<int64_t>(sizeof(BinarySignatureSetHeader)) ||
+         pHeader->mWavelengthOffset % sizeof(double) != 0 || pHeader->mDataOffset % sizeof(float) != 0 ||
+         isSectionInFile(pHeader->mWavelengthOffset,
+            static_cast<uint64_t>(pHeader->mBandCount) * sizeof(double), fileBytes) == false ||
+         isSectionInFile(pHeader->mDataOffset, valueCount * sizeof(float), fileBytes) == false ||
+         pHeader->mRecordBytes < 0 ||
+         isSectionInFile(pHeader->mRecordOffset, static_cast<uint64_t>(pHeader->mRecordBytes), fileBytes) == false)
+      {
+         return NULL;
+      }
+
+      return pHeader;
+   }
+
+   RecordReader getRecords(const BinarySignatureSetHeader* pHeader)
+   {
+      const char* pRecords = reinterpret_cast<const char*>(pHeader) + pHeader->mRecordOffset;
+      return RecordReader(pRecords, pRecords + pHeader->mRecordBytes);
+   }
+}
+
+BinarySignatureSetImporter::BinarySignatureSetImporter()
+{
+   setDescriptorId("{E8B17C45-2D96-4A3F-9C60-7F2B84D1A5E9}");
+   setName("Binary Spectral Library Importer");
+   setSubtype("Signature Set");
+   setCreator("Ball Aerospace & Technologies Corp.");
+   setShortDescription("Import binary spectral signature libraries.");
+   setCopyright(SPECTRAL_COPYRIGHT);
+   setVersion(SPECTRAL_VERSION_NUMBER);
+   setProductionStatus(SPECTRAL_IS_PRODUCTION_RELEASE);
+   setExtensions("Binary Spectral Library Files (*.bsl)");
+   setAbortSupported(true);
+}
+
+BinarySignatureSetImporter::~BinarySignatureSetImporter()
+{
+}
+
+unsigned char BinarySignatureSetImporter::getFileAffinity(const string& filename)
+{
+   QFile file(QString::fromStdString(filename));
+   return mapLibrary(file) == NULL ? CAN_NOT_LOAD : CAN_LOAD;
+}
+
+vector<ImportDescriptor*> BinarySignatureSetImporter::getImportDescriptors(const string& filename)
+{
+   vector<ImportDescriptor*> descriptors;
+   if (filename.empty())
+   {
+      return descriptors;
+   }
+
+   QFile file(QString::fromStdString(filename));
+   const BinarySignatureSetHeader* pHeader = mapLibrary(file);
+   if (pHeader == NULL)
+   {
+      return descriptors;
+   }
+
+   FactoryResource<DynamicObject> pMetadata;
+   VERIFYRV(pMetadata.get() != NULL, descriptors);
+   RecordReader records = getRecords(pHeader);
+   string datasetName;
+   if (records.read(datasetName) == false || records.readMetadata(pMetadata.get()) == false)
+   {
+      return descriptors;
+   }
+   if (datasetName.empty())
+   {
+      datasetName = filename;
+   }
+
+   ImportDescriptorResource pImportDescriptor(datasetName, "SignatureSet");
+   VERIFYRV(pImportDescriptor.get() != NULL, descriptors);
+   DataDescriptor* pDataDescriptor = pImportDescriptor->getDataDescriptor();
+   VERIFYRV(pDataDescriptor != NULL, descriptors);
+
+   FactoryResource<FileDescriptor> pFileDescriptor;
+   VERIFYRV(pFileDescriptor.get() != NULL, descriptors);
+   pFileDescriptor->setFilename(filename);
+
+   pDataDescriptor->setFileDescriptor(pFileDescriptor.get());
+   pDataDescriptor->setMetadata(pMetadata.get());
+   descriptors.push_back(pImportDescriptor.release());
+   return descriptors;
+}
+
+bool BinarySignatureSetImporter::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY((pInArgList = Service<PlugInManagerServices>()->getPlugInArgList()) != NULL);
+   VERIFY(pInArgList->addArg<Progress>(Executable::ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<SignatureSet>(Importer::ImportElementArg()));
+   return true;
+}
+
+bool BinarySignatureSetImporter::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   pOutArgList = NULL;
+   return true;
+}
+
+bool BinarySignatureSetImporter::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   VERIFY(pInArgList != NULL);
+   ProgressTracker progress(pInArgList->getPlugInArgValue<Progress>(Executable::ProgressArg()),
+      "Loading binary spectral library", "spectral", "3A7F0C52-E94B-4D61-B8A3-5F62D1E07C48");
+
+   SignatureSet* pSignatureSet = pInArgList->getPlugInArgValue<SignatureSet>(Importer::ImportElementArg());
+   VERIFY(pSignatureSet != NULL);
+   DataDescriptor* pDataDescriptor = pSignatureSet->getDataDescriptor();
+   VERIFY(pDataDescriptor != NULL);
+   FileDescriptor* pFileDescriptor = pDataDescriptor->getFileDescriptor();
+   VERIFY(pFileDescriptor != NULL);
+
+   progress.getCurrentStep()->addProperty("filename", pFileDescriptor->getFilename().getFullPathAndName());
+
+   QFile file(QString::fromStdString(pFileDescriptor->getFilename().getFullPathAndName()));
+   const BinarySignatureSetHeader* pHeader = mapLibrary(file);
+   if (pHeader == NULL)
+   {
+      progress.report("The file is not a valid binary spectral library.", 0, ERRORS, true);
+      return false;
+   }
+
+   // The name and metadata of the library were read with the import descriptor
+   RecordReader records = getRecords(pHeader);
+   string name;
+   if (records.read(name) == false || records.readMetadata(NULL) == false)
+   {
+      progress.report("The spectral library is corrupt.", 0, ERRORS, true);
+      return false;
+   }
+
+   const char* pBase = reinterpret_cast<const char*>(pHeader);
+   const double* pGrid = reinterpret_cast<const double*>(pBase + pHeader->mWavelengthOffset);
+   const float* pData = reinterpret_cast<const float*>(pBase + pHeader->mDataOffset);
+   const unsigned int bandCount = pHeader->mBandCount;
+
+   Service<ModelServices> pModel;
+   vector<double> wavelengths;
+   vector<double> reflectances;
+   wavelengths.reserve(bandCount);
+   reflectances.reserve(bandCount);
+   int lastPercent = -1;
+   for (unsigned int index = 0; index < pHeader->mSignatureCount; ++index)
+   {
+      if (isAborted())
+      {
+         progress.report("Importer aborted", 0, ABORT, true);
+         return false;
+      }
+
+      int percent = static_cast<int>(100.0 * index / pHeader->mSignatureCount);
+      if (percent != lastPercent)
+      {
+         progress.report("Loading signatures", percent, NORMAL);
+         lastPercent = percent;
+      }
+
+      string unitName;
+      string unitType;
+      double unitScale = 1.0;
+      if (records.read(name) == false || records.read(unitName) == false || records.read(unitType) == false ||
+         records.read(unitScale) == false)
+      {
+         progress.report("The spectral library is corrupt.", 0, ERRORS, true);
+         return false;
+      }
+
+      // Signature names only need to be unique within the library
+      Signature* pSignature = static_cast<Signature*>(pModel->createElement(name,
+         TypeConverter::toString<Signature>(), pSignatureSet));
+      for (unsigned int suffix = 2; pSignature == NULL && suffix <= pHeader->mSignatureCount + 1; ++suffix)
+      {
+         pSignature = static_cast<Signature*>(pModel->createElement(name + " (" +
+            StringUtilities::toDisplayString(suffix) + ")", TypeConverter::toString<Signature>(), pSignatureSet));
+      }
+
+      if (records.readMetadata(pSignature == NULL ? NULL : pSignature->getMetadata()) == false)
+      {
+         progress.report("The spectral library is corrupt.", 0, ERRORS, true);
+         return false;
+      }
+      if (pSignature == NULL)
+      {
+         progress.report("Unable to create signature " + name, percent, WARNING, true);
+         continue;
+      }
+
+      // NaN marks the wavelengths which are not part of this signature
+      wavelengths.clear();
+      reflectances.clear();
+      const float* pRow = pData + static_cast<size_t>(index) * bandCount;
+      for (unsigned int band = 0; band < bandCount; ++band)
+      {
+         if (pRow[band] == pRow[band])
+         {
+            wavelengths.push_back(pGrid[band]);
+            reflectances.push_back(pRow[band]);
+         }
+      }
+      pSignature->setData("Wavelength", wavelengths);
+      pSignature->setData("Reflectance", reflectances);
+
+      FactoryResource<Units> pUnits;
+      VERIFY(pUnits.get() != NULL);
+      pUnits->setUnitType(StringUtilities::fromXmlString<UnitType>(unitType));
+      pUnits->setUnitName(unitName);
+      pUnits->setScaleFromStandard(unitScale);
+      pSignature->setUnits("Reflectance", pUnits.get());
+
+      pSignatureSet->insertSignature(pSignature);
+   }
+
+   progress.report("Spectral signature library loaded", 100, NORMAL);
+   progress.upALevel();
+   return true;
+}
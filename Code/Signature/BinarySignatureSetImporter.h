@@ -0,0 +1,37 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BINARYSIGNATURESETIMPORTER_H
+#define BINARYSIGNATURESETIMPORTER_H
+
+#include "ImporterShell.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * Imports a binary spectral library written by the BinarySignatureSetExporter.
+ *
+ * The file is memory mapped, so the signatures are created directly from the shared
+ * wavelength grid and the reflectance matrix without parsing any text.
+ */
+class BinarySignatureSetImporter : public ImporterShell
+{
+public:
+   BinarySignatureSetImporter();
+   ~BinarySignatureSetImporter();
+
+   unsigned char getFileAffinity(const std::string& filename);
+   std::vector<ImportDescriptor*> getImportDescriptors(const std::string& filename);
+   bool getInputSpecification(PlugInArgList*& pInArgList);
+   bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include "ProgressTracker.h"
 #include "Signature.h"
 #include "SignatureExporter.h"
+#include "SpectralUtilities.h"
 #include "SpectralVersion.h"
 #include "StringUtilities.h"
 #include "TypeConverter.h"
@@ -67,6 +68,12 @@ bool SignatureExporter::execute(PlugInArgList* pInArgList, PlugInArgList* pOutAr
    bool exportMetadata;
    pInArgList->getPlugInArgValue<bool>(SpectralCommon::ExportMetadataArg(), exportMetadata);
 
+   if (SpectralUtilities::loadSignatureData(pSignature, progress.getCurrentProgress()) == false)
+   {
+      progress.report("Unable to load the signature data.", 0, ERRORS, true);
+      return false;
+   }
+
    vector<double> wavelengthData;
    vector<double> reflectanceData;
    try
@@ -0,0 +1,365 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "ObjectResource.h"
+#include "Signature.h"
+#include "SignatureFile.h"
+#include "StringUtilities.h"
+#include "Units.h"
+#include "Wavelengths.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <string.h>
+
+using namespace std;
+
+namespace
+{
+   inline bool isSpace(char character)
+   {
+      return character == ' ' || character == '\t' || character == '\r' || character == '\v' || character == '\f' ||
+         character == '\n';
+   }
+
+   string trimmed(const char* pBegin, const char* pEnd)
+   {
+      while (pBegin != pEnd && isSpace(*pBegin))
+      {
+         ++pBegin;
+      }
+      while (pEnd != pBegin && isSpace(*(pEnd - 1)))
+      {
+         --pEnd;
+      }
+
+      return string(pBegin, pEnd);
+   }
+
+   /**
+    * Finds the whitespace separated tokens in a line. Returns the number of tokens found, up to maxTokens.
+    */
+   int findTokens(const char* pBegin, const char* pEnd, const char* tokens[][2], int maxTokens)
+   {
+      int count = 0;
+      const char* pChar = pBegin;
+      while (count < maxTokens)
+      {
+         while (pChar != pEnd && isSpace(*pChar))
+         {
+            ++pChar;
+         }
+         if (pChar == pEnd)
+         {
+            break;
+         }
+
+         tokens[count][0] = pChar;
+         while (pChar != pEnd && !isSpace(*pChar))
+         {
+            ++pChar;
+         }
+         tokens[count++][1] = pChar;
+      }
+
+      return count;
+   }
+
+   /**
+    * Parses a decimal number without regard to the locale and without allocating memory.
+    *
+    * Numbers with up to 15 significant digits and a small exponent are converted exactly, since
+    * both the digits and the power of ten are exact doubles. Anything else is left to
+    * StringUtilities::fromXmlString().
+    */
+   bool parseNumber(const char* pBegin, const char* pEnd, double& value)
+   {
+      static const double sPowersOfTen[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+      const char* pChar = pBegin;
+      bool negative = false;
+      if (pChar != pEnd && (*pChar == '-' || *pChar == '+'))
+      {
+         negative = (*pChar == '-');
+         ++pChar;
+      }
+
+      double digits = 0.0;
+      int significantDigits = 0;
+      int totalDigits = 0;
+      int exponent = 0;
+      bool fraction = false;
+      for (; pChar != pEnd; ++pChar)
+      {
+         if (*pChar == '.' && !fraction)
+         {
+            fraction = true;
+            continue;
+         }
+         if (*pChar < '0' || *pChar > '9')
+         {
+            break;
+         }
+
+         ++totalDigits;
+         if (digits != 0.0 || *pChar != '0')
+         {
+            ++significantDigits;
+         }
+         digits = digits * 10.0 + (*pChar - '0');
+         if (fraction)
+         {
+            --exponent;
+         }
+      }
+
+      if (pChar != pEnd && (*pChar == 'e' || *pChar == 'E') && totalDigits > 0)
+      {
+         ++pChar;
+         bool negativeExponent = false;
+         if (pChar != pEnd && (*pChar == '-' || *pChar == '+'))
+         {
+            negativeExponent = (*pChar == '-');
+            ++pChar;
+         }
+
+         int exponentValue = 0;
+         const char* pExponent = pChar;
+         for (; pChar != pEnd && *pChar >= '0' && *pChar <= '9' && exponentValue < 1000; ++pChar)
+         {
+            exponentValue = exponentValue * 10 + (*pChar - '0');
+         }
+         if (pChar == pExponent)
+         {
+            totalDigits = 0;
+         }
+         exponent += negativeExponent ? -exponentValue : exponentValue;
+      }
+
+      if (pChar != pEnd || totalDigits == 0 || significantDigits > 15 || exponent < -22 || exponent > 22)
+      {
+         bool error = false;
+         value = StringUtilities::fromXmlString<double>(string(pBegin, pEnd), &error);
+         return !error;
+      }
+
+      value = exponent < 0 ? digits / sPowersOfTen[-exponent] : digits * sPowersOfTen[exponent];
+      if (negative)
+      {
+         value = -value;
+      }
+
+      return true;
+   }
+}
+
+const char* SignatureFile::findLineEnd(const char* pLine, const char* pEnd)
+{
+   const char* pLineEnd = static_cast<const char*>(memchr(pLine, '\n', pEnd - pLine));
+   return pLineEnd == NULL ? pEnd : pLineEnd;
+}
+
+bool SignatureFile::parseMetadataLine(const char* pLine, const char* pLineEnd, string& key, string& value)
+{
+   key.clear();
+   value.clear();
+   const char* pEquals = static_cast<const char*>(memchr(pLine, '=', pLineEnd - pLine));
+   if (pEquals == NULL)
+   {
+      return false;
+   }
+
+   if (memchr(pEquals + 1, '=', pLineEnd - pEquals - 1) == NULL)
+   {
+      key = trimmed(pLine, pEquals);
+      value = trimmed(pEquals + 1, pLineEnd);
+   }
+
+   return true;
+}
+
+void SignatureFile::setMetadataAttribute(DynamicObject* pMetadata, const string& key, const string& value)
+{
+   if (pMetadata == NULL)
+   {
+      return;
+   }
+
+   if ((key.size() >= 5 && key.compare(key.size() - 5, 5, "Bands") == 0) || key == "Pixels")
+   {
+      pMetadata->setAttribute(key, StringUtilities::fromXmlString<unsigned long>(value));
+   }
+   else if (key == "UnitType")
+   {
+      pMetadata->setAttribute(key, StringUtilities::fromXmlString<UnitType>(value));
+   }
+   else if (key == "UnitScale")
+   {
+      pMetadata->setAttribute(key, StringUtilities::fromXmlString<float>(value));
+   }
+   else
+   {
+      pMetadata->setAttribute(key, value);
+   }
+}
+
+bool SignatureFile::isDataLine(const char* pLine, const char* pLineEnd)
+{
+   // The values must be separated by a single whitespace character
+   const char* tokens[3][2];
+   double value = 0.0;
+   return findTokens(pLine, pLineEnd, tokens, 3) == 2 && tokens[1][0] == tokens[0][1] + 1 &&
+      parseNumber(tokens[0][0], tokens[0][1], value) && parseNumber(tokens[1][0], tokens[1][1], value);
+}
+
+bool SignatureFile::parseDataLine(const char* pLine, const char* pLineEnd, UnitType units, float unitScale,
+   vector<double>& wavelengths, vector<double>& reflectances)
+{
+   const char* tokens[3][2];
+   int tokenCount = 0;
+   if (memchr(pLine, '=', pLineEnd - pLine) == NULL)
+   {
+      tokenCount = findTokens(pLine, pLineEnd, tokens, 3);
+   }
+   if (tokenCount == 0)
+   {
+      return true;
+   }
+
+   double wavelength = 0.0, reflectance = 0.0;
+   bool error = parseNumber(tokens[0][0], tokens[0][1], wavelength) == false;
+   if (!error && wavelength > 50.0)
+   {
+      // Assume wavelength values are in nanometers and convert to microns
+      wavelength = Wavelengths::convertValue(wavelength, Wavelengths::NANOMETERS, Wavelengths::MICRONS);
+   }
+   if (!error && tokenCount == 2)
+   {
+      error = parseNumber(tokens[1][0], tokens[1][1], reflectance) == false;
+      if (units == REFLECTANCE && unitScale == 1.0 && reflectance > 2.0) // scale reflectance values to (0,1)
+                                                                         // Values assumed to be scaled 0 to 10000
+      {
+         reflectance *= 0.0001;
+      }
+   }
+
+   if (reflectance != 0.0)
+   {
+      if (reflectance < 0.0)
+      {
+         // zero out negative reflectances, black holes not expected
+         reflectance = 0.0;
+      }
+
+      wavelengths.push_back(wavelength);
+      reflectances.push_back(reflectance);
+   }
+
+   return !error;
+}
+
+bool SignatureFile::setData(Signature* pSignature, const vector<double>& wavelengths,
+   const vector<double>& reflectances)
+{
+   const DynamicObject* pMetadata = (pSignature == NULL ? NULL : pSignature->getMetadata());
+   FactoryResource<Units> pReflectanceUnits;
+   if (pMetadata == NULL || pReflectanceUnits.get() == NULL)
+   {
+      return false;
+   }
+
+   UnitType units = dv_cast<UnitType>(pMetadata->getAttribute("UnitType"), REFLECTANCE);
+   float unitScale = dv_cast<float>(pMetadata->getAttribute("UnitScale"), 1.0);
+   string unitName = dv_cast<string>(pMetadata->getAttribute("UnitName"), StringUtilities::toDisplayString(units));
+   pReflectanceUnits->setUnitType(units);
+   pReflectanceUnits->setUnitName(unitName);
+   if (unitScale != 0.0)
+   {
+      pReflectanceUnits->setScaleFromStandard(1.0 / unitScale);
+   }
+   pSignature->setUnits("Reflectance", pReflectanceUnits.get());
+   pSignature->setData("Wavelength", wavelengths);
+   pSignature->setData("Reflectance", reflectances);
+   return true;
+}
+
+void SignatureFile::parse(const string& filename, Contents& contents, bool readData)
+{
+   contents = Contents();
+
+   QFile sigFile(QString::fromStdString(filename));
+   if (sigFile.open(QIODevice::ReadOnly) == false || sigFile.size() <= 0)
+   {
+      return;
+   }
+
+   const qint64 fileSize = sigFile.size();
+   const char* pBegin = reinterpret_cast<const char*>(sigFile.map(0, fileSize));
+   vector<char> buffer;
+   if (pBegin == NULL)
+   {
+      buffer.resize(static_cast<vector<char>::size_type>(fileSize));
+      if (sigFile.read(&buffer.front(), fileSize) != fileSize)
+      {
+         return;
+      }
+      pBegin = &buffer.front();
+   }
+   const char* pEnd = pBegin + fileSize;
+
+   // The metadata ends at the first line without a '=', which must hold data
+   UnitType units = REFLECTANCE;
+   float unitScale = 1.0;
+   string key;
+   string value;
+   const char* pLine = pBegin;
+   for (; pLine < pEnd; pLine = findLineEnd(pLine, pEnd) + 1)
+   {
+      if (parseMetadataLine(pLine, findLineEnd(pLine, pEnd), key, value) == false)
+      {
+         break;
+      }
+      if (key.empty())
+      {
+         continue;
+      }
+
+      if (key == "UnitType")
+      {
+         units = StringUtilities::fromXmlString<UnitType>(value);
+      }
+      else if (key == "UnitScale")
+      {
+         unitScale = StringUtilities::fromXmlString<float>(value);
+      }
+      contents.mMetadata.push_back(make_pair(key, value));
+   }
+
+   if (pLine >= pEnd || isDataLine(pLine, findLineEnd(pLine, pEnd)) == false)
+   {
+      return;
+   }
+
+   // Mapped pages past the metadata are never touched if the data is not read
+   for (pLine = pBegin; readData && pLine < pEnd; )
+   {
+      const char* pLineEnd = findLineEnd(pLine, pEnd);
+      if (parseDataLine(pLine, pLineEnd, units, unitScale, contents.mWavelengths, contents.mReflectances) == false)
+      {
+         contents.mDataError = true;
+      }
+      pLine = pLineEnd + 1;
+   }
+
+   contents.mValid = true;
+}
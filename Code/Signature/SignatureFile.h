@@ -0,0 +1,90 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef SIGNATUREFILE_H
+#define SIGNATUREFILE_H
+
+#include "TypesFile.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class DynamicObject;
+class Signature;
+
+/**
+ * Parses the ASCII spectral signature format read by the SignatureImporter.
+ *
+ * A file starts with "key = value" metadata lines, followed by lines holding a wavelength
+ * and a reflectance. Only parse() and the line functions may be called from worker threads,
+ * since they do not use any services.
+ */
+namespace SignatureFile
+{
+   /**
+    * The contents of a signature file, as read by parse().
+    */
+   struct Contents
+   {
+      Contents() :
+         mValid(false),
+         mDataError(false) {}
+
+      bool mValid;
+      bool mDataError;
+      std::vector<std::pair<std::string, std::string> > mMetadata;
+      std::vector<double> mWavelengths;
+      std::vector<double> mReflectances;
+   };
+
+   /**
+    * Finds the end of the line starting at pLine, which is pEnd for the last line.
+    */
+   const char* findLineEnd(const char* pLine, const char* pEnd);
+
+   /**
+    * Returns true if the line is a metadata line. The key and value are set if the line
+    * contains a single '=', and are empty otherwise.
+    */
+   bool parseMetadataLine(const char* pLine, const char* pLineEnd, std::string& key, std::string& value);
+
+   /**
+    * Sets a metadata attribute with the type the SignatureImporter uses for the key.
+    */
+   void setMetadataAttribute(DynamicObject* pMetadata, const std::string& key, const std::string& value);
+
+   /**
+    * Returns true if the line holds a wavelength and a reflectance, which must follow the metadata.
+    */
+   bool isDataLine(const char* pLine, const char* pLineEnd);
+
+   /**
+    * Parses a data line and appends its values. Wavelengths in nanometers are converted to microns,
+    * reflectances scaled from 0 to 10000 are scaled to 0 to 1 and lines with no reflectance are skipped.
+    *
+    * @return False if a value could not be parsed. The values which could be parsed are still appended.
+    */
+   bool parseDataLine(const char* pLine, const char* pLineEnd, UnitType units, float unitScale,
+      std::vector<double>& wavelengths, std::vector<double>& reflectances);
+
+   /**
+    * Sets the data of a signature and its units, which are read from the signature metadata.
+    */
+   bool setData(Signature* pSignature, const std::vector<double>& wavelengths,
+      const std::vector<double>& reflectances);
+
+   /**
+    * Reads and parses a signature file. Contents::mValid is false if the file is not a signature file.
+    * If readData is false, only the metadata is read and the file is only read up to the first data line.
+    */
+   void parse(const std::string& filename, Contents& contents, bool readData = true);
+}
+
+#endif
@@ -20,15 +20,14 @@
 #include "PlugInRegistration.h"
 #include "ProgressTracker.h"
 #include "Signature.h"
+#include "SignatureFile.h"
 #include "SignatureImporter.h"
 #include "SpectralVersion.h"
 #include "StringUtilities.h"
-#include "Wavelengths.h"
 
-#include <boost/algorithm/string.hpp>
+#include <QtCore/QFile>
+#include <QtCore/QString>
 
-using namespace boost;
-using namespace boost::algorithm;
 using namespace std;
 
 REGISTER_PLUGIN_BASIC(SpectralSignature, SignatureImporter);
@@ -76,38 +75,17 @@ vector<ImportDescriptor*> SignatureImporter::getImportDescriptors(const string&
 
    bool readError = false;
    string line;
+   string key;
+   string value;
 
    // parse the metadata
    for (line = pSigFile.readLine(&readError);
-      (readError == false) && (line.find('=') != string::npos);
+      (readError == false) && SignatureFile::parseMetadataLine(line.data(), line.data() + line.size(), key, value);
       line = pSigFile.readLine(&readError))
    {
-      vector<string> metadataEntry;
-
-      trim(line);
-      split(metadataEntry, line, is_any_of("="));
-      if (metadataEntry.size() == 2)
+      if (key.empty() == false)
       {
-         string key = metadataEntry[0];
-         string value = metadataEntry[1];
-         trim(key);
-         trim(value);
-         if (ends_with(key, "Bands") || key == "Pixels")
-         {
-            pMetadata->setAttribute(key, StringUtilities::fromXmlString<unsigned long>(value));
-         }
-         else if (key == "UnitType")
-         {
-            pMetadata->setAttribute(key, StringUtilities::fromXmlString<UnitType>(value));
-         }
-         else if (key == "UnitScale")
-         {
-            pMetadata->setAttribute(key, StringUtilities::fromXmlString<float>(value));
-         }
-         else
-         {
-            pMetadata->setAttribute(key, value);
-         }
+         SignatureFile::setMetadataAttribute(pMetadata.get(), key, value);
       }
    }
    if ((readError == true) && (pSigFile.eof() != 1))
@@ -115,18 +93,7 @@ vector<ImportDescriptor*> SignatureImporter::getImportDescriptors(const string&
       return descriptors;
    }
    // Verify that the next line contains float float pairs
-   vector<string> dataEntry;
-
-   trim(line);
-   split(dataEntry, line, is_space());
-   if (dataEntry.size() != 2)
-   {
-      return descriptors;
-   }
-   bool error = false;
-   StringUtilities::fromXmlString<float>(dataEntry[0], &error);
-   !error && StringUtilities::fromXmlString<float>(dataEntry[1], &error);
-   if (error)
+   if (SignatureFile::isDataLine(line.data(), line.data() + line.size()) == false)
    {
       return descriptors;
    }
@@ -182,15 +149,38 @@ bool SignatureImporter::execute(PlugInArgList* pInArgList, PlugInArgList* OutArg
    UnitType units = dv_cast<UnitType>(pMetadata->getAttribute("UnitType"), REFLECTANCE);
    float unitScale = dv_cast<float>(pMetadata->getAttribute("UnitScale"), 1.0);
 
-   LargeFileResource pSigFile;
-   VERIFY(pSigFile.open(pFileDescriptor->getFilename().getFullPathAndName(), O_RDONLY | O_BINARY, S_IREAD));
+   // Map the file so the lines are parsed in place
+   QFile sigFile(QString::fromStdString(pFileDescriptor->getFilename().getFullPathAndName()));
+   if (sigFile.open(QIODevice::ReadOnly) == false)
+   {
+      progress.report("Unable to read signature file", 0, ERRORS, true);
+      return false;
+   }
+
+   const qint64 fileSize = sigFile.size();
+   const char* pBegin = NULL;
+   vector<char> buffer;
+   if (fileSize > 0)
+   {
+      pBegin = reinterpret_cast<const char*>(sigFile.map(0, fileSize));
+      if (pBegin == NULL)
+      {
+         buffer.resize(static_cast<vector<char>::size_type>(fileSize));
+         if (sigFile.read(&buffer.front(), fileSize) != fileSize)
+         {
+            progress.report("Unable to read signature file", 0, ERRORS, true);
+            return false;
+         }
+         pBegin = &buffer.front();
+      }
+   }
+   const char* pEnd = pBegin + fileSize;
 
    // Read the signature data
    vector<double> wavelengthData, reflectanceData;
 
-   int64_t fileSize = pSigFile.fileLength();
-   bool readError = false;
-   for (string line = pSigFile.readLine(&readError); readError == false; line = pSigFile.readLine(&readError))
+   int lastPercent = -1;
+   for (const char* pLine = pBegin; pLine < pEnd; )
    {
       if (isAborted())
       {
@@ -198,74 +188,22 @@ bool SignatureImporter::execute(PlugInArgList* pInArgList, PlugInArgList* OutArg
          return false;
       }
 
-      int64_t fileLocation = pSigFile.tell();
-      progress.report("Loading signature data", static_cast<int>(fileLocation * 100.0 / fileSize), NORMAL);
-
-      trim(line);
-      if (line.empty())
+      const char* pLineEnd = SignatureFile::findLineEnd(pLine, pEnd);
+      int percent = static_cast<int>((pLineEnd - pBegin) * 100.0 / fileSize);
+      if (percent != lastPercent)
       {
-         continue;
+         progress.report("Loading signature data", percent, NORMAL);
+         lastPercent = percent;
       }
-      if (line.find('=') == string::npos)
-      {
-         double wavelength = 0.0, reflectance = 0.0;
-         vector<string> dataEntry;
-         split(dataEntry, line, is_space());
-         bool error = true;
-         if (dataEntry.size() >= 1)
-         {
-            wavelength = StringUtilities::fromXmlString<double>(dataEntry[0], &error);
-            if (wavelength > 50.0)
-            {
-               // Assume wavelength values are in nanometers and convert to microns
-               wavelength = Wavelengths::convertValue(wavelength, Wavelengths::NANOMETERS, Wavelengths::MICRONS);
-            }
-         }
-         if (!error && dataEntry.size() == 2)
-         {
-            reflectance = StringUtilities::fromXmlString<double>(dataEntry[1], &error);
-            if (units == REFLECTANCE && unitScale == 1.0 && reflectance > 2.0) // scale reflectance values to (0,1)
-                                                                               // Values assumed to be scaled 0 to 10000
-            {
-               reflectance *= 0.0001;
-            }
-         }
-         if (error)
-         {
-            progress.report("Error parsing signature data", 0, ERRORS, true);
-         }
 
-         if (reflectance != 0.0)
-         {
-            if (reflectance < 0.0)
-            {
-               // zero out negative reflectances, black holes not expected
-               reflectance = 0.0;
-            }
-
-            wavelengthData.push_back(wavelength);
-            reflectanceData.push_back(reflectance);
-         }
+      if (SignatureFile::parseDataLine(pLine, pLineEnd, units, unitScale, wavelengthData, reflectanceData) == false)
+      {
+         progress.report("Error parsing signature data", 0, ERRORS, true);
       }
+      pLine = pLineEnd + 1;
    }
 
-   if ((readError == true) && (pSigFile.eof() != 1))
-   {
-      progress.report("Unable to read signature file", 0, ERRORS, true);
-      return false;
-   }
-   FactoryResource<Units> pReflectanceUnits;
-   VERIFY(pReflectanceUnits.get() != NULL);
-   string unitName = dv_cast<string>(pMetadata->getAttribute("UnitName"), StringUtilities::toDisplayString(units));
-   pReflectanceUnits->setUnitType(units);
-   pReflectanceUnits->setUnitName(unitName);
-   if (unitScale != 0.0)
-   {
-      pReflectanceUnits->setScaleFromStandard(1.0 / unitScale);
-   }
-   pSignature->setUnits("Reflectance", pReflectanceUnits.get());
-   pSignature->setData("Wavelength", wavelengthData);
-   pSignature->setData("Reflectance", reflectanceData);
+   VERIFY(SignatureFile::setData(pSignature, wavelengthData, reflectanceData));
    progress.report("Spectral signature loaded", 100, NORMAL);
    progress.upALevel();
    return true;
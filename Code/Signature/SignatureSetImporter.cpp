@@ -11,6 +11,7 @@
 #include <QtCore/QFileInfo>
 
 #include "AppVerify.h"
+#include "ConfigurationSettings.h"
 #include "DataDescriptor.h"
 #include "DataVariant.h"
 #include "DynamicObject.h"
@@ -18,12 +19,15 @@
 #include "FileResource.h"
 #include "ImportDescriptor.h"
 #include "MessageLogMgr.h"
+#include "ModelServices.h"
 #include "ObjectResource.h"
 #include "PlugInArgList.h"
 #include "PlugInManagerServices.h"
 #include "PlugInRegistration.h"
 #include "PlugInResource.h"
 #include "ProgressTracker.h"
+#include "Signature.h"
+#include "SignatureFile.h"
 #include "SignatureSet.h"
 #include "SignatureSetImporter.h"
 #include "SpectralVersion.h"
@@ -59,11 +63,62 @@ namespace
    {
       return dynamic_cast<Signature*>(p);
    }
+
+   /**
+    * Creates a signature from a file read by a SignatureFileReaderThread. Returns NULL if the file is not
+    * a signature file or the signature could not be created, so the file is left to the importers.
+    * If setData is false, the signature is left without data for SpectralUtilities::loadSignatureData().
+    */
+   Signature* createSignature(const string& filename, const SignatureFile::Contents& contents,
+      SignatureSet* pSignatureSet, bool setData)
+   {
+      if (contents.mValid == false)
+      {
+         return NULL;
+      }
+
+      FactoryResource<DynamicObject> pMetadata;
+      FactoryResource<FileDescriptor> pFileDescriptor;
+      if (pMetadata.get() == NULL || pFileDescriptor.get() == NULL)
+      {
+         return NULL;
+      }
+
+      for (vector<pair<string, string> >::const_iterator entry = contents.mMetadata.begin();
+         entry != contents.mMetadata.end(); ++entry)
+      {
+         SignatureFile::setMetadataAttribute(pMetadata.get(), entry->first, entry->second);
+      }
+      string name = dv_cast<string>(pMetadata->getAttribute("Name"), filename);
+
+      Service<ModelServices> pModel;
+      DataDescriptor* pDescriptor = pModel->createDataDescriptor(name, "Signature", pSignatureSet);
+      if (pDescriptor == NULL)
+      {
+         return NULL;
+      }
+      pFileDescriptor->setFilename(filename);
+      pDescriptor->setFileDescriptor(pFileDescriptor.get());
+      pDescriptor->setMetadata(pMetadata.get());
+
+      Signature* pSignature = static_cast<Signature*>(pModel->createElement(pDescriptor));
+      if (pSignature != NULL && setData &&
+         SignatureFile::setData(pSignature, contents.mWavelengths, contents.mReflectances) == false)
+      {
+         pModel->destroyElement(pSignature);
+         pSignature = NULL;
+      }
+
+      return pSignature;
+   }
 };
 
 REGISTER_PLUGIN_BASIC(SpectralSignature, SignatureSetImporter);
 
-SignatureSetImporter::SignatureSetImporter() : mDatasetNumber(0), mXml(Service<MessageLogMgr>()->getLog(), false)
+SignatureSetImporter::SignatureSetImporter() :
+   mDatasetNumber(0),
+   mXml(Service<MessageLogMgr>()->getLog(), false),
+   mAbortFlag(false)
 {
    setDescriptorId("{792F86A1-AAB3-4333-A3DB-39A9B13F6CC6}");
    setName("Spectral Signature Library Importer");
@@ -81,6 +136,12 @@ SignatureSetImporter::~SignatureSetImporter()
 {
 }
 
+bool SignatureSetImporter::abort()
+{
+   mAbortFlag = true;
+   return ImporterShell::abort();
+}
+
 unsigned char SignatureSetImporter::getFileAffinity(const string &filename)
 {
    // is this an XML file?
@@ -215,16 +276,10 @@ bool SignatureSetImporter::execute(PlugInArgList* pInArgList, PlugInArgList* Out
       expr += "/signature";
       XPath2Result *pResult = mXml.query(expr, XPath2Result::SNAPSHOT_RESULT);
       VERIFY(pResult != NULL);
+      vector<string> filenames;
       int nodeTotal = pResult->getSnapshotLength();
       for (int nodeNum = 0; nodeNum < nodeTotal; ++nodeNum)
       {
-         if (isAborted())
-         {
-            progress.abort();
-            return false;
-         }
-         int percent = static_cast<int>(100.0 * nodeNum / nodeTotal);
-         progress.report("Importing signature library", percent, NORMAL);
          if (!pResult->snapshotItem(nodeNum) || !pResult->isNode())
          {
             continue;
@@ -250,6 +305,46 @@ bool SignatureSetImporter::execute(PlugInArgList* pInArgList, PlugInArgList* Out
                }
             }
          }
+         filenames.push_back(filename);
+      }
+
+      // Read and parse the signature files concurrently
+      mAbortFlag = false;
+      const bool readData = !getSettingLoadSignatureDataOnDemand();
+      vector<SignatureFile::Contents> contents(filenames.size());
+      if (filenames.empty() == false)
+      {
+         SignatureFileReaderInput readerInput(filenames, contents, readData, &mAbortFlag);
+         SignatureFileReaderOutput readerOutput;
+         mta::ProgressObjectReporter reporter("Reading signature files", progress.getCurrentProgress());
+         mta::MultiThreadedAlgorithm<SignatureFileReaderInput, SignatureFileReaderOutput, SignatureFileReaderThread>
+            mtaReader(Service<ConfigurationSettings>()->getSettingThreadCount(), readerInput, readerOutput, &reporter);
+         mtaReader.run();
+      }
+
+      // Create the signatures in library order, using the importers for files in other formats
+      Service<ModelServices> pModel;
+      for (vector<string>::size_type fileNum = 0; fileNum < filenames.size(); ++fileNum)
+      {
+         if (isAborted())
+         {
+            progress.abort();
+            return false;
+         }
+         int percent = static_cast<int>(100.0 * fileNum / filenames.size());
+         progress.report("Importing signature library", percent, NORMAL);
+
+         const string& filename = filenames[fileNum];
+         Signature* pSig = createSignature(filename, contents[fileNum], pSignatureSet, readData);
+         if (pSig != NULL)
+         {
+            if (contents[fileNum].mDataError)
+            {
+               progress.report("Error parsing signature data in " + filename, percent, WARNING, true);
+            }
+            pSignatureSet->insertSignature(pSig);
+            continue;
+         }
 
          ImporterResource importer("Auto Importer", filename, pProgress);
          if (importer->getPlugIn() == NULL)
@@ -260,7 +355,6 @@ bool SignatureSetImporter::execute(PlugInArgList* pInArgList, PlugInArgList* Out
          if (importer->execute())
          {
             vector<DataElement*> elements = importer->getImportedElements();
-            vector<Signature*> sigs(elements.size(), NULL);
             for (vector<DataElement*>::iterator element = elements.begin(); element != elements.end(); ++element)
             {
                Signature* pSig = dynamic_cast<Signature*>(*element);
@@ -268,7 +362,7 @@ bool SignatureSetImporter::execute(PlugInArgList* pInArgList, PlugInArgList* Out
                {
                   pSignatureSet->insertSignature(pSig);
                   // reparent the signature
-                  Service<ModelServices>()->setElementParent(pSig, pSignatureSet);
+                  pModel->setElementParent(pSig, pSignatureSet);
                }
             }
          }
@@ -293,3 +387,28 @@ bool SignatureSetImporter::execute(PlugInArgList* pInArgList, PlugInArgList* Out
    progress.upALevel();
    return true;
 }
+
+SignatureFileReaderThread::SignatureFileReaderThread(const SignatureFileReaderInput& input, int threadCount,
+   int threadIndex, mta::ThreadReporter& reporter) :
+   mta::AlgorithmThread(threadIndex, reporter),
+   mInput(input),
+   mThreadCount(threadCount > 0 ? threadCount : 1)
+{
+}
+
+void SignatureFileReaderThread::run()
+{
+   const int fileCount = static_cast<int>(mInput.mFilenames.size());
+   for (int fileNum = getThreadIndex(); fileNum < fileCount; fileNum += mThreadCount)
+   {
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         break;
+      }
+
+      getReporter().reportProgress(getThreadIndex(), 100 * fileNum / fileCount);
+      SignatureFile::parse(mInput.mFilenames[fileNum], mInput.mContents[fileNum], mInput.mReadData);
+   }
+
+   getReporter().reportProgress(getThreadIndex(), 100);
+}
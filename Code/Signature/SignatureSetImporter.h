@@ -10,9 +10,15 @@
 #ifndef SIGNATURESETIMPORTER_H
 #define SIGNATURESETIMPORTER_H
 
+#include "ConfigurationSettings.h"
 #include "ImporterShell.h"
+#include "MultiThreadedAlgorithm.h"
+#include "SignatureFile.h"
 #include "xmlreader.h"
 
+#include <string>
+#include <vector>
+
 class SignatureSetImporter : public ImporterShell
 {
 public:
@@ -24,6 +30,13 @@ public:
    bool getInputSpecification(PlugInArgList*& pInArgList);
    bool getOutputSpecification(PlugInArgList*& pOutArgList);
    bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   bool abort();
+
+   /**
+    * If true, only the names and metadata of the signatures in a library are imported. The data of
+    * each signature is imported by SpectralUtilities::loadSignatureData() when it is first needed.
+    */
+   SETTING(LoadSignatureDataOnDemand, SignatureSetImporter, bool, false);
 
 private:
    std::vector<ImportDescriptor*> createImportDescriptors(XERCES_CPP_NAMESPACE_QUALIFIER DOMTreeWalker* pTree, std::vector<std::string>& datasetPath);
@@ -31,6 +44,48 @@ private:
    unsigned int mDatasetNumber;
    XmlReader mXml;
    std::string mFilename;
+   bool mAbortFlag;
+};
+
+struct SignatureFileReaderInput
+{
+   SignatureFileReaderInput(const std::vector<std::string>& filenames,
+      std::vector<SignatureFile::Contents>& contents, bool readData, const bool* pAbortFlag) :
+      mFilenames(filenames),
+      mContents(contents),
+      mReadData(readData),
+      mpAbortFlag(pAbortFlag) {}
+
+   const std::vector<std::string>& mFilenames;
+   std::vector<SignatureFile::Contents>& mContents;
+   bool mReadData;
+   const bool* mpAbortFlag;
+};
+
+/**
+ * Reads and parses the signature files of a library, leaving the creation of the signatures
+ * to the main thread. The files are interleaved between the threads, since the time to read
+ * each file is usually dominated by the latency of opening it rather than by its size.
+ */
+class SignatureFileReaderThread : public mta::AlgorithmThread
+{
+public:
+   SignatureFileReaderThread(const SignatureFileReaderInput& input, int threadCount, int threadIndex,
+      mta::ThreadReporter& reporter);
+
+   void run();
+
+private:
+   const SignatureFileReaderInput& mInput;
+   int mThreadCount;
+};
+
+struct SignatureFileReaderOutput
+{
+   bool compileOverallResults(const std::vector<SignatureFileReaderThread*>& threads)
+   {
+      return true;
+   }
 };
 
 #endif
\ No newline at end of file
@@ -1848,6 +1848,7 @@ void SignaturePlotObject::setSignaturePlotValues(CurveCollection* pCollection, S
 
    pCollection->clear();
 
+   SpectralUtilities::loadSignatureData(pSignature);
    const DataVariant& wavelengthVariant = pSignature->getData("Wavelength");
    vector<double> wavelengthData;
    wavelengthVariant.getValue(wavelengthData);
@@ -21,6 +21,8 @@ public:
    LibraryBuilder();
    ~LibraryBuilder();
    SETTING(SpectralLibraryHelp, SpectralContextSensitiveHelp, std::string, "");
+   SETTING(MatchMetric, LibraryBuilder, std::string, "Spectral Angle");
+   SETTING(MatchCount, LibraryBuilder, unsigned int, 10);
 
    bool setBatch();
    bool getInputSpecification(PlugInArgList*& pArgList);
@@ -11,6 +11,7 @@
 #include <QtCore/QFileInfo>
 #include <QtGui/QApplication>
 #include <QtGui/QBitmap>
+#include <QtGui/QComboBox>
 #include <QtGui/QDialogButtonBox>
 #include <QtGui/QFrame>
 #include <QtGui/QHeaderView>
@@ -21,16 +22,24 @@
 #include "AppVerify.h"
 #include "ConfigurationSettings.h"
 #include "CustomTreeWidget.h"
+#include "DataVariant.h"
 #include "DesktopServices.h"
+#include "DynamicObject.h"
 #include "FileDescriptor.h"
+#include "LayerList.h"
 #include "LibraryBuilder.h"
 #include "ModelServices.h"
 #include "PlugInArgList.h"
 #include "PlugInResource.h"
+#include "RasterElement.h"
 #include "SignatureSelector.h"
 #include "SignatureSet.h"
 #include "Slot.h"
+#include "SpatialDataView.h"
 #include "SpectralLibraryDlg.h"
+#include "SpectralSignatureSelector.h"
+#include "SpectralUtilities.h"
+#include "Wavelengths.h"
 
 using namespace std;
 
@@ -108,6 +117,8 @@ SpectralLibraryDlg::SpectralLibraryDlg(Progress* pProgress, Step* pStep, QWidget
    QLabel* pSignatureLabel = new QLabel("Signatures:", this);
    pSignatureLabel->setFont(ftBold);
 
+   columnNames.append("Match Score");
+
    mpSignatureTree = new CustomTreeWidget(this);
    mpSignatureTree->setColumnCount(columnNames.count());
    mpSignatureTree->setHeaderLabels(columnNames);
@@ -128,6 +139,7 @@ SpectralLibraryDlg::SpectralLibraryDlg(Progress* pProgress, Step* pStep, QWidget
    {
       pHeader->setDefaultAlignment(Qt::AlignLeft | Qt::AlignVCenter);
       pHeader->resizeSection(0, 150);
+      pHeader->resizeSection(1, 250);
       pHeader->setStretchLastSection(true);
       pHeader->setSortIndicatorShown(true);
    }
@@ -149,11 +161,34 @@ SpectralLibraryDlg::SpectralLibraryDlg(Progress* pProgress, Step* pStep, QWidget
    mpSaveSigButton->setToolTip("Click this button to save the selected signature(s) to a file.");
    mpSaveSigButton->setWhatsThis("Click this button to save the selected signature(s) to a file.");
 
+   mpMatchSigButton = new QPushButton("&Match...", this);
+   mpMatchSigButton->setToolTip("Click this button to find the signatures in the currently selected "
+      "spectral library which best match a pixel, AOI or signature.");
+   mpMatchSigButton->setWhatsThis("Click this button to find the signatures in the currently selected "
+      "spectral library which best match a pixel, AOI or signature.  The library signatures are "
+      "resampled to the wavelengths of the current data set, the best matches are selected and their "
+      "scores are displayed.  A lower score is a better match.");
+
+   mpMetricCombo = new QComboBox(this);
+   mpMetricCombo->setEditable(false);
+   mpMetricCombo->addItem(QString::fromStdString(
+      SpectralLibraryMatcher::getMetricName(SpectralLibraryMatcher::SPECTRAL_ANGLE)));
+   mpMetricCombo->addItem(QString::fromStdString(
+      SpectralLibraryMatcher::getMetricName(SpectralLibraryMatcher::SPECTRAL_INFORMATION_DIVERGENCE)));
+   mpMetricCombo->addItem(QString::fromStdString(
+      SpectralLibraryMatcher::getMetricName(SpectralLibraryMatcher::EUCLIDEAN_DISTANCE)));
+   mpMetricCombo->setToolTip("Select the score used to match signatures.");
+   int metricIndex = mpMetricCombo->findText(QString::fromStdString(LibraryBuilder::getSettingMatchMetric()));
+   mpMetricCombo->setCurrentIndex(metricIndex < 0 ? 0 : metricIndex);
+
    QVBoxLayout* pSignatureLayout = new QVBoxLayout();
    pSignatureLayout->setMargin(0);
    pSignatureLayout->setSpacing(5);
    pSignatureLayout->addWidget(mpAddSigButton);
    pSignatureLayout->addWidget(mpRemoveSigButton);
+   pSignatureLayout->addSpacing(10);
+   pSignatureLayout->addWidget(mpMatchSigButton);
+   pSignatureLayout->addWidget(mpMetricCombo);
    pSignatureLayout->addStretch();
    pSignatureLayout->addWidget(mpSaveSigButton);
 
@@ -224,6 +259,7 @@ SpectralLibraryDlg::SpectralLibraryDlg(Progress* pProgress, Step* pStep, QWidget
    VERIFYNR(connect(mpAddSigButton, SIGNAL(clicked()), this, SLOT(addSignature())));
    VERIFYNR(connect(mpRemoveSigButton, SIGNAL(clicked()), this, SLOT(removeSignature())));
    VERIFYNR(connect(mpSaveSigButton, SIGNAL(clicked()), this, SLOT(saveSignature())));
+   VERIFYNR(connect(mpMatchSigButton, SIGNAL(clicked()), this, SLOT(matchSignature())));
    if (LibraryBuilder::hasSettingSpectralLibraryHelp())
    {
       pButtonBox->addButton(QDialogButtonBox::Help);
@@ -255,6 +291,8 @@ void SpectralLibraryDlg::abortSearch()
    {
       mpSigSelector->abortSearch();
    }
+
+   mMatcher.abort();
 }
 
 bool SpectralLibraryDlg::addLibrary(SignatureSet* pSignatureSet)
@@ -631,6 +669,23 @@ QString SpectralLibraryDlg::getSignatureExporterName() const
    return QString();
 }
 
+RasterElement* SpectralLibraryDlg::getCurrentRasterElement() const
+{
+   Service<DesktopServices> pDesktop;
+
+   SpatialDataView* pView = dynamic_cast<SpatialDataView*>(pDesktop->getCurrentWorkspaceWindowView());
+   if (pView != NULL)
+   {
+      LayerList* pLayerList = pView->getLayerList();
+      if (pLayerList != NULL)
+      {
+         return pLayerList->getPrimaryRasterElement();
+      }
+   }
+
+   return NULL;
+}
+
 void SpectralLibraryDlg::updateLibraryName(Subject& subject, const string& signal, const boost::any& value)
 {
    SignatureSet* pSignatureSet = dynamic_cast<SignatureSet*>(&subject);
@@ -1006,6 +1061,126 @@ void SpectralLibraryDlg::saveSignature()
    }
 }
 
+void SpectralLibraryDlg::matchSignature()
+{
+   mpLibraryTree->closeActiveCellWidget(true);
+   mpSignatureTree->closeActiveCellWidget(true);
+
+   SignatureSet* pSignatureSet = getSelectedLibrary();
+   if (pSignatureSet == NULL)
+   {
+      return;
+   }
+
+   // Select the query spectrum, which may be the mean of an AOI in the current data set
+   RasterElement* pRaster = getCurrentRasterElement();
+   SpectralSignatureSelector* pSelector = new SpectralSignatureSelector(pRaster, mpProgress, this,
+      QAbstractItemView::SingleSelection);
+   pSelector->setWindowTitle("Select Spectrum to Match");
+   mpSigSelector = pSelector;
+
+   vector<Signature*> querySignatures;
+   if (pSelector->exec() == QDialog::Accepted)
+   {
+      querySignatures = pSelector->getSignatures();
+   }
+
+   delete mpSigSelector;
+   mpSigSelector = NULL;
+
+   Signature* pQuery = querySignatures.empty() ? NULL : querySignatures.front();
+   if (pQuery == NULL || dynamic_cast<SignatureSet*>(pQuery) != NULL)
+   {
+      if (querySignatures.empty() == false)
+      {
+         QMessageBox::warning(this, windowTitle(), "Select a single signature to match, not a spectral library.");
+      }
+      return;
+   }
+
+   // Compare at the data set wavelengths so the resampled library is reused by each query from the data set
+   vector<double> wavelengths;
+   vector<double> fwhm;
+   DynamicObject* pMetadata = (pRaster == NULL ? NULL : pRaster->getMetadata());
+   if (pMetadata != NULL)
+   {
+      Wavelengths rasterWavelengths(pMetadata);
+      if (rasterWavelengths.isEmpty() == false)
+      {
+         if (rasterWavelengths.hasEndValues() == false || rasterWavelengths.hasStartValues() == false)
+         {
+            rasterWavelengths.calculateFwhm();
+         }
+
+         wavelengths = rasterWavelengths.getCenterValues();
+         fwhm = rasterWavelengths.getFwhm();
+      }
+   }
+   if (wavelengths.empty())
+   {
+      SpectralUtilities::loadSignatureData(pQuery, mpProgress);
+
+      const vector<double>* pQueryWavelengths = dv_cast<vector<double> >(&pQuery->getData("Wavelength"));
+      if (pQueryWavelengths != NULL)
+      {
+         wavelengths = *pQueryWavelengths;
+      }
+   }
+
+   QApplication::setOverrideCursor(Qt::WaitCursor);
+
+   SpectralLibraryMatcher::Metric metric =
+      SpectralLibraryMatcher::getMetric(mpMetricCombo->currentText().toStdString());
+   LibraryBuilder::setSettingMatchMetric(SpectralLibraryMatcher::getMetricName(metric));
+
+   string errorMessage;
+   vector<SpectralLibraryMatcher::Match> matches;
+   vector<Signature*> librarySignatures =
+      SpectralUtilities::extractSignatures(vector<Signature*>(1, pSignatureSet));
+   bool success = mMatcher.setLibrary(librarySignatures, wavelengths, fwhm, mpProgress, errorMessage) &&
+      mMatcher.findMatches(pQuery, metric, LibraryBuilder::getSettingMatchCount(), matches, mpProgress,
+      errorMessage);
+
+   QApplication::restoreOverrideCursor();
+
+   if (success == false)
+   {
+      QMessageBox::warning(this, windowTitle(), QString::fromStdString("Unable to match the signature: " +
+         errorMessage));
+      return;
+   }
+
+   // Display the scores and select the matching signatures in the list
+   mpSignatureTree->clearSelection();
+   for (map<QTreeWidgetItem*, Signature*>::iterator iter = mSignatures.begin(); iter != mSignatures.end(); ++iter)
+   {
+      iter->first->setText(2, QString());
+   }
+
+   QTreeWidgetItem* pBestItem = NULL;
+   for (vector<SpectralLibraryMatcher::Match>::iterator matchIter = matches.begin(); matchIter != matches.end();
+      ++matchIter)
+   {
+      for (map<QTreeWidgetItem*, Signature*>::iterator iter = mSignatures.begin(); iter != mSignatures.end(); ++iter)
+      {
+         if (iter->second == matchIter->mpSignature)
+         {
+            iter->first->setText(2, QString::number(matchIter->mScore, 'g', 6));
+            mpSignatureTree->setItemSelected(iter->first, true);
+            if (pBestItem == NULL)
+            {
+               pBestItem = iter->first;
+            }
+         }
+      }
+   }
+
+   if (pBestItem != NULL)
+   {
+      mpSignatureTree->scrollToItem(pBestItem);
+   }
+}
+
 void SpectralLibraryDlg::updateSignatureList()
 {
    while (mSignatures.empty() == false)
@@ -1029,6 +1204,8 @@ void SpectralLibraryDlg::updateSignatureList()
    mpAddSigButton->setEnabled(pSignatureSet != NULL);
    mpRemoveSigButton->setEnabled(pSignatureSet != NULL);
    mpSaveSigButton->setEnabled(pSignatureSet != NULL);
+   mpMatchSigButton->setEnabled(pSignatureSet != NULL);
+   mpMetricCombo->setEnabled(pSignatureSet != NULL);
 
    if (pSignatureSet == NULL)
    {
@@ -15,6 +15,8 @@
 #include <QtGui/QPushButton>
 #include <QtGui/QTreeWidgetItem>
 
+#include "SpectralLibraryMatcher.h"
+
 #include <boost/any.hpp>
 
 #include <map>
@@ -22,6 +24,8 @@
 
 class CustomTreeWidget;
 class Progress;
+class QComboBox;
+class RasterElement;
 class Signature;
 class SignatureSelector;
 class SignatureSet;
@@ -52,6 +56,7 @@ protected:
    bool saveSignatures(const std::vector<Signature*>& signatures, const QStringList& sigFilenames,
       const QString& strExporter);
    QString getSignatureExporterName() const;
+   RasterElement* getCurrentRasterElement() const;
 
    void updateLibraryName(Subject& subject, const std::string& signal, const boost::any& value);
    void updateSignatureName(Subject& subject, const std::string& signal, const boost::any& value);
@@ -69,6 +74,7 @@ protected slots:
    void addSignature();
    void removeSignature();
    void saveSignature();
+   void matchSignature();
 
    void updateSignatureList();
    void updateSignatureData(QTreeWidgetItem* pItem, int iColumn);
@@ -84,11 +90,14 @@ private:
    QPushButton* mpAddSigButton;
    QPushButton* mpRemoveSigButton;
    QPushButton* mpSaveSigButton;
+   QPushButton* mpMatchSigButton;
+   QComboBox* mpMetricCombo;
 
    std::map<QTreeWidgetItem*, SignatureSet*> mLibraries;
    std::map<QTreeWidgetItem*, Signature*> mSignatures;
 
    SignatureSelector* mpSigSelector;
+   SpectralLibraryMatcher mMatcher;
 };
 
 #endif
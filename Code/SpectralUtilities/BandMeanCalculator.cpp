@@ -0,0 +1,495 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BandMeanCalculator.h"
+#include "BitMask.h"
+#include "ConfigurationSettings.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ObjectResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "Slot.h"
+#include "switchOnEncoding.h"
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+#include <boost/any.hpp>
+
+#include <algorithm>
+#include <list>
+#include <map>
+
+using namespace std;
+
+namespace
+{
+   inline void addCompensated(double& sum, double& compensation, double value)
+   {
+      const double adjusted = value - compensation;
+      const double total = sum + adjusted;
+      compensation = (total - sum) - adjusted;
+      sum = total;
+   }
+
+   struct BandMeanInput
+   {
+      BandMeanInput(const RasterElement* pRaster, const BitMask* pMask, unsigned int rowStep,
+         unsigned int columnStep, const bool* pAbortFlag) :
+            mpRaster(pRaster),
+            mpMask(pMask),
+            mRowStep(rowStep),
+            mColumnStep(columnStep),
+            mpAbortFlag(pAbortFlag)
+      {
+      }
+
+      const RasterElement* mpRaster;
+      const BitMask* mpMask;
+      unsigned int mRowStep;
+      unsigned int mColumnStep;
+      const bool* mpAbortFlag;
+   };
+
+   class BandMeanThread : public mta::AlgorithmThread
+   {
+   public:
+      BandMeanThread(const BandMeanInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mRowRange(getThreadRange(threadCount, static_cast<const RasterDataDescriptor*>(
+            input.mpRaster->getDataDescriptor())->getRowCount())),
+         mCount(0.0),
+         mSuccess(false)
+      {
+      }
+
+      void run()
+      {
+         EncodingType encoding =
+            static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor())->getDataType();
+         switchOnEncoding(encoding, BandMeanThread::accumulate, NULL);
+      }
+
+      template<class T>
+      void accumulate(const T* pDummyData)
+      {
+         const RasterDataDescriptor* pDescriptor =
+            static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+         const unsigned int numBands = pDescriptor->getBandCount();
+         const unsigned int numColumns = pDescriptor->getColumnCount();
+         mSums.assign(numBands, 0.0);
+         mCompensations.assign(numBands, 0.0);
+         mCount = 0.0;
+
+         // Start at the first row of this thread's range which the row step includes
+         const int rowStep = static_cast<int>(mInput.mRowStep);
+         mRowRange.mFirst = max(0, mRowRange.mFirst);
+         mRowRange.mLast = min(mRowRange.mLast, static_cast<int>(pDescriptor->getRowCount()) - 1);
+         int firstRow = mRowRange.mFirst;
+         if (firstRow % rowStep != 0)
+         {
+            firstRow += rowStep - firstRow % rowStep;
+         }
+
+         if (firstRow > mRowRange.mLast)
+         {
+            mSuccess = true;
+            return;
+         }
+
+         FactoryResource<DataRequest> pRequest;
+         pRequest->setInterleaveFormat(BIP);
+         pRequest->setRows(pDescriptor->getActiveRow(firstRow), pDescriptor->getActiveRow(mRowRange.mLast));
+         DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+         if (accessor.isValid() == false)
+         {
+            return;
+         }
+
+         double* pSums = &mSums.front();
+         double* pCompensations = &mCompensations.front();
+         const unsigned int pixelStep = mInput.mColumnStep * numBands;
+         int oldPercentDone = -1;
+         for (int row = firstRow; row <= mRowRange.mLast; row += rowStep)
+         {
+            int percentDone = mRowRange.computePercent(row);
+            if (percentDone > oldPercentDone)
+            {
+               oldPercentDone = percentDone;
+               getReporter().reportProgress(getThreadIndex(), percentDone);
+            }
+
+            if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+            {
+               return;
+            }
+
+            VERIFYNRV(accessor.isValid());
+            const T* pPixel = reinterpret_cast<const T*>(accessor->getRow());
+            for (unsigned int column = 0; column < numColumns; column += mInput.mColumnStep, pPixel += pixelStep)
+            {
+               if (mInput.mpMask == NULL || mInput.mpMask->getPixel(column, row))
+               {
+                  for (unsigned int band = 0; band < numBands; ++band)
+                  {
+                     addCompensated(pSums[band], pCompensations[band], static_cast<double>(pPixel[band]));
+                  }
+                  ++mCount;
+               }
+            }
+
+            for (int step = 0; step < rowStep && accessor.isValid(); ++step)
+            {
+               accessor->nextRow();
+            }
+         }
+
+         getReporter().reportProgress(getThreadIndex(), 100);
+         mSuccess = true;
+      }
+
+      const vector<double>& getSums() const
+      {
+         return mSums;
+      }
+
+      const vector<double>& getCompensations() const
+      {
+         return mCompensations;
+      }
+
+      double getCount() const
+      {
+         return mCount;
+      }
+
+      bool isSuccessful() const
+      {
+         return mSuccess;
+      }
+
+   private:
+      const BandMeanInput& mInput;
+      mta::AlgorithmThread::Range mRowRange;
+      vector<double> mSums;
+      vector<double> mCompensations;
+      double mCount;
+      bool mSuccess;
+   };
+
+   struct BandMeanOutput
+   {
+      BandMeanOutput(unsigned int numBands) :
+         mSums(numBands, 0.0),
+         mCompensations(numBands, 0.0),
+         mCount(0.0),
+         mSuccess(false)
+      {
+      }
+
+      bool compileOverallResults(const vector<BandMeanThread*>& threads)
+      {
+         mSuccess = true;
+         for (vector<BandMeanThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            const BandMeanThread* pThread = *iter;
+            if (pThread == NULL || pThread->isSuccessful() == false)
+            {
+               mSuccess = false;
+               continue;
+            }
+
+            const vector<double>& sums = pThread->getSums();
+            const vector<double>& compensations = pThread->getCompensations();
+            for (unsigned int band = 0; band < sums.size() && band < mSums.size(); ++band)
+            {
+               addCompensated(mSums[band], mCompensations[band], sums[band]);
+               addCompensated(mSums[band], mCompensations[band], -compensations[band]);
+            }
+            mCount += pThread->getCount();
+         }
+
+         return mSuccess;
+      }
+
+      vector<double> mSums;
+      vector<double> mCompensations;
+      double mCount;
+      bool mSuccess;
+   };
+
+   // Means are kept for this many masks and step factors per element
+   const unsigned int sMaxMeansPerElement = 4;
+
+   /**
+    * Identifies the pixels a mask selects, so a mask which is edited does not match its earlier means.
+    */
+   unsigned int hashMask(const BitMask* pMask)
+   {
+      if (pMask == NULL)
+      {
+         return 0;
+      }
+
+      int x1 = 0;
+      int y1 = 0;
+      int x2 = 0;
+      int y2 = 0;
+      pMask->getBoundingBox(x1, y1, x2, y2);
+
+      // FNV-1a over the bounding box, the outside flag and one bit per pixel in the bounding box
+      unsigned int hash = 2166136261U;
+      const int header[] = { x1, y1, x2, y2, pMask->isOutsideSelected() ? 1 : 0 };
+      const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(header);
+      for (size_t i = 0; i < sizeof(header); ++i)
+      {
+         hash ^= pBytes[i];
+         hash *= 16777619U;
+      }
+
+      unsigned int bits = 0;
+      unsigned int numBits = 0;
+      for (int y = y1; y <= y2; ++y)
+      {
+         for (int x = x1; x <= x2; ++x)
+         {
+            bits = (bits << 1) | (pMask->getPixel(x, y) ? 1 : 0);
+            if (++numBits == 8)
+            {
+               hash ^= bits;
+               hash *= 16777619U;
+               bits = 0;
+               numBits = 0;
+            }
+         }
+      }
+
+      hash ^= bits;
+      hash *= 16777619U;
+      return hash;
+   }
+
+   /**
+    * Keeps band means for the rest of the session. The means of an element are
+    * discarded when the element is modified or deleted.
+    */
+   class BandMeanCache
+   {
+   public:
+      struct Means
+      {
+         bool mMasked;
+         unsigned int mMaskHash;
+         int mMaskCount;
+         unsigned int mRowStep;
+         unsigned int mColumnStep;
+         vector<double> mMeans;
+         double mCount;
+      };
+
+      ~BandMeanCache()
+      {
+         QMutexLocker lock(&mMutex);
+         while (mMeans.empty() == false)
+         {
+            remove(mMeans.begin()->first, true);
+         }
+      }
+
+      bool find(RasterElement* pRaster, const Means& key, vector<double>& means, double& count)
+      {
+         QMutexLocker lock(&mMutex);
+         map<RasterElement*, list<Means> >::iterator rasterIter = mMeans.find(pRaster);
+         if (rasterIter == mMeans.end())
+         {
+            return false;
+         }
+
+         list<Means>& rasterMeans = rasterIter->second;
+         for (list<Means>::iterator iter = rasterMeans.begin(); iter != rasterMeans.end(); ++iter)
+         {
+            if (iter->mMasked == key.mMasked && iter->mMaskHash == key.mMaskHash &&
+               iter->mMaskCount == key.mMaskCount && iter->mRowStep == key.mRowStep &&
+               iter->mColumnStep == key.mColumnStep)
+            {
+               rasterMeans.splice(rasterMeans.begin(), rasterMeans, iter);
+               means = rasterMeans.front().mMeans;
+               count = rasterMeans.front().mCount;
+               return true;
+            }
+         }
+
+         return false;
+      }
+
+      void insert(RasterElement* pRaster, const Means& means)
+      {
+         QMutexLocker lock(&mMutex);
+         map<RasterElement*, list<Means> >::iterator rasterIter = mMeans.find(pRaster);
+         if (rasterIter == mMeans.end())
+         {
+            pRaster->attach(SIGNAL_NAME(Subject, Modified), Slot(this, &BandMeanCache::elementChanged));
+            pRaster->attach(SIGNAL_NAME(Subject, Deleted), Slot(this, &BandMeanCache::elementChanged));
+            rasterIter = mMeans.insert(make_pair(pRaster, list<Means>())).first;
+         }
+
+         list<Means>& rasterMeans = rasterIter->second;
+         rasterMeans.push_front(means);
+         if (rasterMeans.size() > sMaxMeansPerElement)
+         {
+            rasterMeans.pop_back();
+         }
+      }
+
+      void elementChanged(Subject& subject, const string& signal, const boost::any& value)
+      {
+         // A deleted element detaches itself
+         QMutexLocker lock(&mMutex);
+         remove(dynamic_cast<RasterElement*>(&subject), signal != SIGNAL_NAME(Subject, Deleted));
+      }
+
+   private:
+      void remove(RasterElement* pRaster, bool detach)
+      {
+         map<RasterElement*, list<Means> >::iterator rasterIter = mMeans.find(pRaster);
+         if (rasterIter == mMeans.end())
+         {
+            return;
+         }
+
+         if (detach)
+         {
+            pRaster->detach(SIGNAL_NAME(Subject, Modified), Slot(this, &BandMeanCache::elementChanged));
+            pRaster->detach(SIGNAL_NAME(Subject, Deleted), Slot(this, &BandMeanCache::elementChanged));
+         }
+
+         mMeans.erase(rasterIter);
+      }
+
+      QMutex mMutex;
+
+      // The most recently used means of each element are at the front of its list
+      map<RasterElement*, list<Means> > mMeans;
+   };
+
+   BandMeanCache sCache;
+
+   BandMeanCache::Means getCacheKey(const BitMask* pMask, unsigned int rowStep, unsigned int columnStep)
+   {
+      BandMeanCache::Means key;
+      key.mMasked = (pMask != NULL);
+      key.mMaskHash = hashMask(pMask);
+      key.mMaskCount = (pMask == NULL ? 0 : pMask->getCount());
+      key.mRowStep = rowStep;
+      key.mColumnStep = columnStep;
+      key.mCount = 0.0;
+      return key;
+   }
+}
+
+BandMeanCalculator::BandMeanCalculator(RasterElement* pRaster, const BitMask* pMask, unsigned int rowStep,
+                                       unsigned int columnStep) :
+   mpRaster(pRaster),
+   mpMask(pMask),
+   mRowStep(max(rowStep, 1U)),
+   mColumnStep(max(columnStep, 1U)),
+   mCount(0.0)
+{
+}
+
+BandMeanCalculator::~BandMeanCalculator()
+{
+}
+
+bool BandMeanCalculator::compute(Progress* pProgress, const bool* pAbortFlag, const string& message)
+{
+   mMeans.clear();
+   mCount = 0.0;
+
+   VERIFY(mpRaster != NULL);
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   VERIFY(pDescriptor != NULL);
+   const EncodingType encoding = pDescriptor->getDataType();
+   if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+   {
+      return false;
+   }
+
+   BandMeanInput input(mpRaster, mpMask, mRowStep, mColumnStep, pAbortFlag);
+   BandMeanOutput output(pDescriptor->getBandCount());
+   mta::ProgressObjectReporter reporter(message, pProgress);
+   mta::MultiThreadedAlgorithm<BandMeanInput, BandMeanOutput, BandMeanThread>
+      mtaMeans(Service<ConfigurationSettings>()->getSettingThreadCount(), input, output, &reporter);
+   mtaMeans.run();
+
+   if ((pAbortFlag != NULL && *pAbortFlag) || output.mSuccess == false || output.mCount == 0.0)
+   {
+      return false;
+   }
+
+   mCount = output.mCount;
+   mMeans.resize(output.mSums.size());
+   for (unsigned int band = 0; band < mMeans.size(); ++band)
+   {
+      mMeans[band] = (output.mSums[band] - output.mCompensations[band]) / mCount;
+   }
+
+   return true;
+}
+
+bool BandMeanCalculator::findCachedMeans()
+{
+   VERIFY(mpRaster != NULL);
+   const RasterDataDescriptor* pDescriptor = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   if (pDescriptor == NULL)
+   {
+      return false;
+   }
+
+   vector<double> means;
+   double count = 0.0;
+   if (sCache.find(mpRaster, getCacheKey(mpMask, mRowStep, mColumnStep), means, count) == false ||
+      count <= 0.0 || means.size() != pDescriptor->getBandCount())
+   {
+      return false;
+   }
+
+   mMeans.swap(means);
+   mCount = count;
+   return true;
+}
+
+void BandMeanCalculator::cacheMeans() const
+{
+   VERIFYNRV(mpRaster != NULL);
+   if (mMeans.empty() == true)
+   {
+      return;
+   }
+
+   BandMeanCache::Means means = getCacheKey(mpMask, mRowStep, mColumnStep);
+   means.mMeans = mMeans;
+   means.mCount = mCount;
+   sCache.insert(mpRaster, means);
+}
+
+const vector<double>& BandMeanCalculator::getMeans() const
+{
+   return mMeans;
+}
+
+double BandMeanCalculator::getCount() const
+{
+   return mCount;
+}
@@ -0,0 +1,102 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BANDMEANCALCULATOR_H
+#define BANDMEANCALCULATOR_H
+
+#include <string>
+#include <vector>
+
+class BitMask;
+class Progress;
+class RasterElement;
+
+/**
+ * Computes the mean value of every band of a raster element in a single pass.
+ *
+ * The rows of the element are divided between the threads specified in the
+ * configuration settings. Each thread reads its rows once in BIP order and keeps
+ * compensated (Kahan) sums for every band, and the partial sums from the threads
+ * are combined with the same compensation, so the means stay accurate for very
+ * large scenes.
+ *
+ * The means can be kept in memory for the rest of the session, so later runs over
+ * the same pixels can reuse them instead of reading the data again. Kept means are
+ * discarded when the element is modified or deleted.
+ */
+class BandMeanCalculator
+{
+public:
+   /**
+    * Creates a calculator.
+    *
+    * @param pRaster
+    *        The raster element. Complex data is not supported.
+    * @param pMask
+    *        Optional mask of pixels to include. If \c NULL, all pixels are included.
+    * @param rowStep
+    *        Only every rowStep-th row is included.
+    * @param columnStep
+    *        Only every columnStep-th column is included.
+    */
+   BandMeanCalculator(RasterElement* pRaster, const BitMask* pMask = NULL, unsigned int rowStep = 1,
+      unsigned int columnStep = 1);
+   ~BandMeanCalculator();
+
+   /**
+    * Reads the data and computes the band means.
+    *
+    * @param pProgress
+    *        Optional progress object which is updated as the rows are read.
+    * @param pAbortFlag
+    *        Optional flag which is checked as the rows are read. If it becomes
+    *        true, the computation stops and false is returned.
+    * @param message
+    *        The progress message.
+    *
+    * @return True if the means were computed, false otherwise.
+    */
+   bool compute(Progress* pProgress = NULL, const bool* pAbortFlag = NULL,
+      const std::string& message = "Computing band means");
+
+   /**
+    * Gets means kept by cacheMeans() for the same element, mask and step factors.
+    *
+    * The mask is compared by the pixels it selects, so an AOI which has been edited
+    * since the means were kept is not matched.
+    *
+    * @return True if means were found, false if compute() needs to be called.
+    */
+   bool findCachedMeans();
+
+   /**
+    * Keeps the computed means for later calculators over the same pixels.
+    */
+   void cacheMeans() const;
+
+   const std::vector<double>& getMeans() const;
+
+   /**
+    * Returns the number of pixels included in the means.
+    */
+   double getCount() const;
+
+private:
+   BandMeanCalculator(const BandMeanCalculator& rhs);
+   BandMeanCalculator& operator=(const BandMeanCalculator& rhs);
+
+   RasterElement* mpRaster;
+   const BitMask* mpMask;
+   unsigned int mRowStep;
+   unsigned int mColumnStep;
+   std::vector<double> mMeans;
+   double mCount;
+};
+
+#endif
@@ -0,0 +1,438 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BitMask.h"
+#include "BitMaskIterator.h"
+#include "CovarianceEstimator.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ObjectResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "switchOnEncoding.h"
+
+#include <algorithm>
+#include <math.h>
+
+using namespace std;
+
+namespace
+{
+   template<class T>
+   void addTypedPixel(T* pData, CovarianceAccumulator* pAccumulator, double* pValues)
+   {
+      unsigned int numBands = pAccumulator->getNumBands();
+      for (unsigned int band = 0; band < numBands; ++band)
+      {
+         pValues[band] = static_cast<double>(pData[band]);
+      }
+      pAccumulator->addPixel(pValues);
+   }
+
+   template<class T>
+   void addTypedRow(T* pRow, CovarianceAccumulator* pAccumulator, double* pValues, unsigned int numColumns,
+      const BitMask* pMask, int row, int startColumn)
+   {
+      unsigned int numBands = pAccumulator->getNumBands();
+      T* pPixel = pRow;
+      for (unsigned int col = 0; col < numColumns; ++col, pPixel += numBands)
+      {
+         if (pMask == NULL || pMask->getPixel(startColumn + static_cast<int>(col), row))
+         {
+            for (unsigned int band = 0; band < numBands; ++band)
+            {
+               pValues[band] = static_cast<double>(pPixel[band]);
+            }
+            pAccumulator->addPixel(pValues);
+         }
+      }
+   }
+
+   // Linear congruential generator so the sample order is identical on every platform
+   class BlockShuffle
+   {
+   public:
+      BlockShuffle(unsigned int seed) : mState(seed) {}
+
+      ptrdiff_t operator()(ptrdiff_t range)
+      {
+         mState = mState * 1103515245 + 12345;
+         return static_cast<ptrdiff_t>((mState >> 8) % static_cast<unsigned int>(range));
+      }
+
+   private:
+      unsigned int mState;
+   };
+}
+
+CovarianceAccumulator::CovarianceAccumulator(unsigned int numBands)
+{
+   reset(numBands);
+}
+
+CovarianceAccumulator::~CovarianceAccumulator()
+{
+}
+
+void CovarianceAccumulator::reset(unsigned int numBands)
+{
+   mNumBands = numBands;
+   mCount = 0.0;
+   mMeans.assign(numBands, 0.0);
+   mCrossProducts.assign(numBands * numBands, 0.0);
+   mDelta.assign(numBands, 0.0);
+}
+
+unsigned int CovarianceAccumulator::getNumBands() const
+{
+   return mNumBands;
+}
+
+double CovarianceAccumulator::getCount() const
+{
+   return mCount;
+}
+
+void CovarianceAccumulator::addPixel(const double* pValues)
+{
+   if (pValues == NULL || mNumBands == 0)
+   {
+      return;
+   }
+
+   // Welford's update: delta uses the old mean, the cross-product uses the new one
+   mCount += 1.0;
+   double scale = 1.0 / mCount;
+   for (unsigned int band = 0; band < mNumBands; ++band)
+   {
+      mDelta[band] = pValues[band] - mMeans[band];
+      mMeans[band] += mDelta[band] * scale;
+   }
+
+   for (unsigned int band1 = 0; band1 < mNumBands; ++band1)
+   {
+      double* pRow = &mCrossProducts[band1 * mNumBands];
+      const double delta1 = mDelta[band1];
+      for (unsigned int band2 = band1; band2 < mNumBands; ++band2)
+      {
+         pRow[band2] += delta1 * (pValues[band2] - mMeans[band2]);
+      }
+   }
+}
+
+void CovarianceAccumulator::addPixel(const void* pData, EncodingType encoding)
+{
+   if (pData == NULL || mNumBands == 0)
+   {
+      return;
+   }
+
+   vector<double> values(mNumBands);
+   switchOnEncoding(encoding, addTypedPixel, const_cast<void*>(pData), this, &values.front());
+}
+
+bool CovarianceAccumulator::merge(const CovarianceAccumulator& other)
+{
+   if (other.mCount == 0.0)
+   {
+      return other.mNumBands == mNumBands || other.mNumBands == 0;
+   }
+
+   if (mCount == 0.0)
+   {
+      *this = other;
+      return true;
+   }
+
+   if (other.mNumBands != mNumBands)
+   {
+      return false;
+   }
+
+   // Chan et al. pairwise combination of the two partial results
+   double total = mCount + other.mCount;
+   double weight = mCount * other.mCount / total;
+   for (unsigned int band = 0; band < mNumBands; ++band)
+   {
+      mDelta[band] = other.mMeans[band] - mMeans[band];
+   }
+
+   for (unsigned int band1 = 0; band1 < mNumBands; ++band1)
+   {
+      for (unsigned int band2 = band1; band2 < mNumBands; ++band2)
+      {
+         unsigned int index = band1 * mNumBands + band2;
+         mCrossProducts[index] += other.mCrossProducts[index] + mDelta[band1] * mDelta[band2] * weight;
+      }
+   }
+
+   for (unsigned int band = 0; band < mNumBands; ++band)
+   {
+      mMeans[band] += mDelta[band] * other.mCount / total;
+   }
+   mCount = total;
+
+   return true;
+}
+
+const vector<double>& CovarianceAccumulator::getMeans() const
+{
+   return mMeans;
+}
+
+const vector<double>& CovarianceAccumulator::getCrossProducts() const
+{
+   return mCrossProducts;
+}
+
+bool CovarianceAccumulator::setStatistics(double count, const vector<double>& means,
+                                          const vector<double>& crossProducts)
+{
+   if (count < 0.0 || crossProducts.size() != means.size() * means.size())
+   {
+      return false;
+   }
+
+   reset(means.size());
+   mCount = count;
+   mMeans = means;
+   mCrossProducts = crossProducts;
+
+   return true;
+}
+
+bool CovarianceAccumulator::getCovariance(double** pMatrix) const
+{
+   if (pMatrix == NULL || mCount < 2.0)
+   {
+      return false;
+   }
+
+   double scale = 1.0 / (mCount - 1.0);
+   for (unsigned int band1 = 0; band1 < mNumBands; ++band1)
+   {
+      for (unsigned int band2 = band1; band2 < mNumBands; ++band2)
+      {
+         double value = mCrossProducts[band1 * mNumBands + band2] * scale;
+         pMatrix[band1][band2] = value;
+         pMatrix[band2][band1] = value;
+      }
+   }
+
+   return true;
+}
+
+bool CovarianceAccumulator::getSecondMoment(double* pMatrix) const
+{
+   if (pMatrix == NULL || mCount < 1.0)
+   {
+      return false;
+   }
+
+   double scale = 1.0 / mCount;
+   for (unsigned int band1 = 0; band1 < mNumBands; ++band1)
+   {
+      for (unsigned int band2 = band1; band2 < mNumBands; ++band2)
+      {
+         double value = mCrossProducts[band1 * mNumBands + band2] * scale + mMeans[band1] * mMeans[band2];
+         pMatrix[band1 * mNumBands + band2] = value;
+         pMatrix[band2 * mNumBands + band1] = value;
+      }
+   }
+
+   return true;
+}
+
+AdaptiveCovarianceEstimator::AdaptiveCovarianceEstimator(RasterElement* pRaster, const BitMask* pMask,
+                                                         double tolerance, unsigned int blockSize,
+                                                         unsigned int seed) :
+   mpRaster(pRaster),
+   mpMask(pMask),
+   mTolerance(tolerance),
+   mBlockSize(max(blockSize, 1U)),
+   mStartRow(0),
+   mEndRow(0),
+   mStartColumn(0),
+   mEndColumn(0),
+   mNumBlockColumns(0),
+   mNextBlock(0),
+   mRelativeChange(1.0),
+   mNumChecksBelowTolerance(0)
+{
+   if (mpRaster == NULL)
+   {
+      return;
+   }
+
+   const RasterDataDescriptor* pDesc = dynamic_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   if (pDesc == NULL || pDesc->getRowCount() == 0 || pDesc->getColumnCount() == 0)
+   {
+      return;
+   }
+
+   mEncoding = pDesc->getDataType();
+   if (mEncoding == INT4SCOMPLEX || mEncoding == FLT8COMPLEX)
+   {
+      return;
+   }
+
+   BitMaskIterator it(mpMask, mpRaster);
+   if (it.getCount() == 0)
+   {
+      return;
+   }
+   mStartRow = static_cast<unsigned int>(it.getBoundingBoxStartRow());
+   mEndRow = static_cast<unsigned int>(it.getBoundingBoxEndRow());
+   mStartColumn = static_cast<unsigned int>(it.getBoundingBoxStartColumn());
+   mEndColumn = static_cast<unsigned int>(it.getBoundingBoxEndColumn());
+
+   unsigned int numBlockRows = (mEndRow - mStartRow) / mBlockSize + 1;
+   mNumBlockColumns = (mEndColumn - mStartColumn) / mBlockSize + 1;
+   mBlockOrder.resize(numBlockRows * mNumBlockColumns);
+   for (unsigned int block = 0; block < mBlockOrder.size(); ++block)
+   {
+      mBlockOrder[block] = block;
+   }
+
+   BlockShuffle shuffle(seed);
+   random_shuffle(mBlockOrder.begin(), mBlockOrder.end(), shuffle);
+
+   mAccumulator.reset(pDesc->getBandCount());
+}
+
+AdaptiveCovarianceEstimator::~AdaptiveCovarianceEstimator()
+{
+}
+
+bool AdaptiveCovarianceEstimator::isValid() const
+{
+   return mAccumulator.getNumBands() > 0 && mBlockOrder.empty() == false;
+}
+
+bool AdaptiveCovarianceEstimator::processNextBlock()
+{
+   if (isValid() == false || mNextBlock >= mBlockOrder.size())
+   {
+      return false;
+   }
+
+   unsigned int block = mBlockOrder[mNextBlock++];
+   unsigned int firstRow = mStartRow + (block / mNumBlockColumns) * mBlockSize;
+   unsigned int firstColumn = mStartColumn + (block % mNumBlockColumns) * mBlockSize;
+   unsigned int lastRow = min(firstRow + mBlockSize - 1, mEndRow);
+   unsigned int lastColumn = min(firstColumn + mBlockSize - 1, mEndColumn);
+   unsigned int numColumns = lastColumn - firstColumn + 1;
+
+   const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   pRequest->setRows(pDesc->getActiveRow(firstRow), pDesc->getActiveRow(lastRow), 1);
+   pRequest->setColumns(pDesc->getActiveColumn(firstColumn), pDesc->getActiveColumn(lastColumn), numColumns);
+   DataAccessor accessor = mpRaster->getDataAccessor(pRequest.release());
+
+   // Blocks of a sparse or non-convex mask may not contain any pixels, which must not count as a
+   // check where the estimate did not change
+   const double previousCount = mAccumulator.getCount();
+   vector<double> values(mAccumulator.getNumBands());
+   for (unsigned int row = firstRow; row <= lastRow; ++row)
+   {
+      VERIFY(accessor.isValid());
+      switchOnEncoding(mEncoding, addTypedRow, accessor->getRow(), &mAccumulator, &values.front(), numColumns,
+         mpMask, static_cast<int>(row), static_cast<int>(firstColumn));
+      accessor->nextRow();
+   }
+
+   if (mAccumulator.getCount() != previousCount)
+   {
+      checkConvergence();
+   }
+   return true;
+}
+
+void AdaptiveCovarianceEstimator::checkConvergence()
+{
+   unsigned int numBands = mAccumulator.getNumBands();
+   if (mTolerance <= 0.0 || mAccumulator.getCount() <= static_cast<double>(numBands))
+   {
+      return;
+   }
+
+   // Compare the upper triangle of the unnormalized estimate against the previous check
+   const vector<double>& crossProducts = mAccumulator.getCrossProducts();
+   double scale = 1.0 / (mAccumulator.getCount() - 1.0);
+   bool havePrevious = (mPreviousCovariance.size() == crossProducts.size());
+   mPreviousCovariance.resize(crossProducts.size(), 0.0);
+
+   double diffNorm = 0.0;
+   double norm = 0.0;
+   for (unsigned int band1 = 0; band1 < numBands; ++band1)
+   {
+      for (unsigned int band2 = band1; band2 < numBands; ++band2)
+      {
+         unsigned int index = band1 * numBands + band2;
+         double value = crossProducts[index] * scale;
+         double diff = value - mPreviousCovariance[index];
+         diffNorm += diff * diff;
+         norm += value * value;
+         mPreviousCovariance[index] = value;
+      }
+   }
+
+   if (havePrevious == false)
+   {
+      return;
+   }
+
+   mRelativeChange = (norm > 0.0) ? sqrt(diffNorm / norm) : 0.0;
+   if (mRelativeChange < mTolerance)
+   {
+      ++mNumChecksBelowTolerance;
+   }
+   else
+   {
+      mNumChecksBelowTolerance = 0;
+   }
+}
+
+bool AdaptiveCovarianceEstimator::isConverged() const
+{
+   return mNumChecksBelowTolerance >= 2;
+}
+
+double AdaptiveCovarianceEstimator::getRelativeChange() const
+{
+   return mRelativeChange;
+}
+
+unsigned int AdaptiveCovarianceEstimator::getNumBlocks() const
+{
+   return mBlockOrder.size();
+}
+
+unsigned int AdaptiveCovarianceEstimator::getNumBlocksProcessed() const
+{
+   return mNextBlock;
+}
+
+int AdaptiveCovarianceEstimator::getPercentSampled() const
+{
+   if (mBlockOrder.empty())
+   {
+      return 100;
+   }
+
+   return static_cast<int>(100.0 * mNextBlock / mBlockOrder.size());
+}
+
+const CovarianceAccumulator& AdaptiveCovarianceEstimator::getAccumulator() const
+{
+   return mAccumulator;
+}
@@ -0,0 +1,219 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef COVARIANCEESTIMATOR_H
+#define COVARIANCEESTIMATOR_H
+
+#include "TypesFile.h"
+
+#include <vector>
+
+class BitMask;
+class RasterElement;
+
+/**
+ * Accumulates the sufficient statistics needed for a band covariance matrix.
+ *
+ * The pixel count, band means and the matrix of centered cross-products are
+ * updated one pixel at a time in a single pass. Two accumulators built from
+ * different pixels can be merged, which gives the same result as having added
+ * all of the pixels to one accumulator.
+ */
+class CovarianceAccumulator
+{
+public:
+   CovarianceAccumulator(unsigned int numBands = 0);
+   ~CovarianceAccumulator();
+
+   /**
+    * Discards all accumulated statistics.
+    *
+    * @param numBands
+    *        The number of bands in each pixel added after the reset.
+    */
+   void reset(unsigned int numBands);
+
+   unsigned int getNumBands() const;
+
+   /**
+    * Returns the number of pixels accumulated.
+    *
+    * The count is held as a double so statistics merged over many large
+    * data sets do not overflow.
+    */
+   double getCount() const;
+
+   /**
+    * Adds a pixel to the statistics.
+    *
+    * @param pValues
+    *        The band values of the pixel. This must contain getNumBands() values.
+    */
+   void addPixel(const double* pValues);
+
+   /**
+    * Adds a pixel of raw raster data to the statistics.
+    *
+    * @param pData
+    *        The BIP band values of the pixel.
+    * @param encoding
+    *        The data type of the values in pData. Complex types are not supported.
+    */
+   void addPixel(const void* pData, EncodingType encoding);
+
+   /**
+    * Adds the statistics from another accumulator to this one.
+    *
+    * @param other
+    *        The accumulator to merge. It must have the same number of bands
+    *        or be empty.
+    *
+    * @return False if the number of bands differ, true otherwise.
+    */
+   bool merge(const CovarianceAccumulator& other);
+
+   const std::vector<double>& getMeans() const;
+
+   /**
+    * Returns the sums of centered cross-products.
+    *
+    * The values are stored row major in a getNumBands() x getNumBands() vector.
+    * Only the upper triangle (column >= row) is maintained.
+    */
+   const std::vector<double>& getCrossProducts() const;
+
+   /**
+    * Replaces the accumulated statistics, e.g. with values previously saved to disk.
+    *
+    * @param count
+    *        The number of pixels represented by the statistics.
+    * @param means
+    *        The band means.
+    * @param crossProducts
+    *        The row major sums of centered cross-products as returned by
+    *        getCrossProducts().
+    *
+    * @return False if the vector sizes are inconsistent, true otherwise.
+    */
+   bool setStatistics(double count, const std::vector<double>& means, const std::vector<double>& crossProducts);
+
+   /**
+    * Computes the sample covariance matrix.
+    *
+    * @param pMatrix
+    *        A getNumBands() x getNumBands() matrix which will receive the covariance.
+    *
+    * @return False if fewer than two pixels have been accumulated, true otherwise.
+    */
+   bool getCovariance(double** pMatrix) const;
+
+   /**
+    * Computes the second moment matrix, i.e. the mean of the outer product of each pixel with itself.
+    *
+    * @param pMatrix
+    *        A row major getNumBands() x getNumBands() array which will receive the second moment.
+    *
+    * @return False if no pixels have been accumulated, true otherwise.
+    */
+   bool getSecondMoment(double* pMatrix) const;
+
+private:
+   unsigned int mNumBands;
+   double mCount;
+   std::vector<double> mMeans;
+   std::vector<double> mCrossProducts;
+   std::vector<double> mDelta;
+};
+
+/**
+ * Estimates the band covariance of a raster element from a random sample of spatial blocks.
+ *
+ * The scene is divided into square blocks which are visited in a random order.
+ * Only the data in each visited block is requested from the element. After each
+ * block the covariance estimate is compared with the estimate from the previous
+ * check, and sampling is considered converged once the relative change (Frobenius
+ * norm) has stayed below the requested tolerance for two consecutive checks. Blocks
+ * which do not contain any pixels of the mask are not checked.
+ *
+ * The caller drives the estimator so progress and abort can be handled the way
+ * the calling plug-in already does:
+ * @code
+ * AdaptiveCovarianceEstimator estimator(pRaster, pMask, 0.001);
+ * while (!estimator.isConverged() && estimator.processNextBlock())
+ * {
+ *    if (isAborted()) break;
+ *    pProgress->updateProgress("Sampling...", estimator.getPercentSampled(), NORMAL);
+ * }
+ * @endcode
+ */
+class AdaptiveCovarianceEstimator
+{
+public:
+   /**
+    * Creates an estimator.
+    *
+    * @param pRaster
+    *        The raster element to sample. Complex data is not supported.
+    * @param pMask
+    *        Optional mask of pixels to include. Blocks outside the bounding box
+    *        of the mask are never read. If \c NULL, all pixels are included.
+    * @param tolerance
+    *        The relative change in the covariance estimate at which sampling stops.
+    *        Zero or less will sample every block.
+    * @param blockSize
+    *        The width and height of each sample block in pixels.
+    * @param seed
+    *        Seed for the block ordering so runs can be reproduced.
+    */
+   AdaptiveCovarianceEstimator(RasterElement* pRaster, const BitMask* pMask = NULL, double tolerance = 0.001,
+      unsigned int blockSize = 32, unsigned int seed = 1);
+   ~AdaptiveCovarianceEstimator();
+
+   bool isValid() const;
+
+   /**
+    * Reads the next block in the sample order and adds its pixels to the estimate.
+    *
+    * @return False if all blocks have been processed or the block could not be read.
+    */
+   bool processNextBlock();
+
+   bool isConverged() const;
+   double getRelativeChange() const;
+   unsigned int getNumBlocks() const;
+   unsigned int getNumBlocksProcessed() const;
+   int getPercentSampled() const;
+
+   const CovarianceAccumulator& getAccumulator() const;
+
+private:
+   AdaptiveCovarianceEstimator(const AdaptiveCovarianceEstimator& rhs);
+   AdaptiveCovarianceEstimator& operator=(const AdaptiveCovarianceEstimator& rhs);
+
+   void checkConvergence();
+
+   RasterElement* mpRaster;
+   const BitMask* mpMask;
+   EncodingType mEncoding;
+   double mTolerance;
+   unsigned int mBlockSize;
+   unsigned int mStartRow;
+   unsigned int mEndRow;
+   unsigned int mStartColumn;
+   unsigned int mEndColumn;
+   unsigned int mNumBlockColumns;
+   std::vector<unsigned int> mBlockOrder;
+   unsigned int mNextBlock;
+   CovarianceAccumulator mAccumulator;
+   std::vector<double> mPreviousCovariance;
+   double mRelativeChange;
+   unsigned int mNumChecksBelowTolerance;
+};
+
+#endif
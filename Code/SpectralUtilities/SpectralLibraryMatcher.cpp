@@ -0,0 +1,530 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "BatchResampler.h"
+#include "ConfigurationSettings.h"
+#include "DataVariant.h"
+#include "MultiThreadedAlgorithm.h"
+#include "PlugInResource.h"
+#include "Progress.h"
+#include "Signature.h"
+#include "SignatureResampler.h"
+#include "SignatureSet.h"
+#include "Slot.h"
+#include "SpectralLibraryMatcher.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <set>
+
+using namespace std;
+
+namespace
+{
+   // Values are clamped to this before taking logarithms for the spectral information divergence
+   const double sMinimumValue = 1e-12;
+
+   inline bool isValid(double value)
+   {
+      return value == value;
+   }
+
+   /**
+    * Resamples spectra which share the same wavelengths. Each spectrum in toData receives one value
+    * for each of toWavelengths, which is NaN for the bands which could not be resampled.
+    */
+   bool resampleSpectra(const vector<double>& fromData, const vector<double>& fromWavelengths,
+      const vector<double>& toWavelengths, const vector<double>& toFwhm, vector<double>& toData,
+      Progress* pProgress, string& errorMessage)
+   {
+      PlugInResource resampler("Resampler");
+      BatchResampler* pResampler = dynamic_cast<BatchResampler*>(resampler.get());
+      if (pResampler == NULL)
+      {
+         errorMessage = "The resampler plug-in could not be created.";
+         return false;
+      }
+
+      vector<double> resampledData;
+      vector<int> toBands;
+      if (pResampler->executeBatch(fromData, resampledData, fromWavelengths, toWavelengths, toFwhm, toBands,
+         errorMessage, string(), pProgress) == false)
+      {
+         return false;
+      }
+
+      const size_t numSpectra = fromWavelengths.empty() ? 0 : fromData.size() / fromWavelengths.size();
+      toData.assign(numSpectra * toWavelengths.size(), numeric_limits<double>::quiet_NaN());
+      if (toBands.empty())
+      {
+         return true;
+      }
+
+      for (size_t spectrum = 0; spectrum < numSpectra; ++spectrum)
+      {
+         const double* pFrom = &resampledData[spectrum * toBands.size()];
+         double* pTo = &toData[spectrum * toWavelengths.size()];
+         for (size_t band = 0; band < toBands.size(); ++band)
+         {
+            if (toBands[band] >= 0 && static_cast<size_t>(toBands[band]) < toWavelengths.size())
+            {
+               pTo[toBands[band]] = pFrom[band];
+            }
+         }
+      }
+
+      return true;
+   }
+
+   struct MatchInput
+   {
+      MatchInput(const vector<float>& spectra, const vector<double>& query, const vector<double>& logQuery,
+         SpectralLibraryMatcher::Metric metric, unsigned int count, const bool* pAbortFlag) :
+            mSpectra(spectra),
+            mQuery(query),
+            mLogQuery(logQuery),
+            mMetric(metric),
+            mCount(count),
+            mpAbortFlag(pAbortFlag)
+      {
+      }
+
+      const vector<float>& mSpectra;
+      const vector<double>& mQuery;
+      const vector<double>& mLogQuery;
+      SpectralLibraryMatcher::Metric mMetric;
+      unsigned int mCount;
+      const bool* mpAbortFlag;
+   };
+
+   // The score and row of a match, ordered so the worst match is at the top of a heap
+   typedef pair<double, size_t> Score;
+
+   class MatchThread : public mta::AlgorithmThread
+   {
+   public:
+      MatchThread(const MatchInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter) :
+         mta::AlgorithmThread(threadIndex, reporter),
+         mInput(input),
+         mRowRange(getThreadRange(threadCount, static_cast<int>(input.mQuery.empty() ? 0 :
+            input.mSpectra.size() / input.mQuery.size()))),
+         mSuccess(false)
+      {
+      }
+
+      void run()
+      {
+         const size_t numBands = mInput.mQuery.size();
+         int oldPercentDone = -1;
+         for (int row = mRowRange.mFirst; row <= mRowRange.mLast; ++row)
+         {
+            int percentDone = mRowRange.computePercent(row);
+            if (percentDone > oldPercentDone)
+            {
+               oldPercentDone = percentDone;
+               getReporter().reportProgress(getThreadIndex(), percentDone);
+
+               if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+               {
+                  return;
+               }
+            }
+
+            double score = 0.0;
+            if (computeScore(&mInput.mSpectra[row * numBands], score) == false)
+            {
+               continue;
+            }
+
+            // Keep the best matches in a heap with the worst of them at the front
+            if (mScores.size() < mInput.mCount)
+            {
+               mScores.push_back(Score(score, row));
+               push_heap(mScores.begin(), mScores.end());
+            }
+            else if (mScores.empty() == false && Score(score, row) < mScores.front())
+            {
+               pop_heap(mScores.begin(), mScores.end());
+               mScores.back() = Score(score, row);
+               push_heap(mScores.begin(), mScores.end());
+            }
+         }
+
+         getReporter().reportProgress(getThreadIndex(), 100);
+         mSuccess = true;
+      }
+
+      const vector<Score>& getScores() const
+      {
+         return mScores;
+      }
+
+      bool isSuccessful() const
+      {
+         return mSuccess;
+      }
+
+   private:
+      bool computeScore(const float* pSpectrum, double& score) const
+      {
+         const double* pQuery = &mInput.mQuery.front();
+         const size_t numBands = mInput.mQuery.size();
+         switch (mInput.mMetric)
+         {
+         case SpectralLibraryMatcher::SPECTRAL_ANGLE:
+         {
+            double dot = 0.0, queryNorm = 0.0, spectrumNorm = 0.0;
+            for (size_t band = 0; band < numBands; ++band)
+            {
+               const double value = pSpectrum[band];
+               if (isValid(value) && isValid(pQuery[band]))
+               {
+                  dot += pQuery[band] * value;
+                  queryNorm += pQuery[band] * pQuery[band];
+                  spectrumNorm += value * value;
+               }
+            }
+            if (queryNorm <= 0.0 || spectrumNorm <= 0.0)
+            {
+               return false;
+            }
+
+            score = acos(max(-1.0, min(1.0, dot / sqrt(queryNorm * spectrumNorm))));
+            return true;
+         }
+
+         case SpectralLibraryMatcher::SPECTRAL_INFORMATION_DIVERGENCE:
+         {
+            // The spectra are normalized over the bands both of them cover
+            double querySum = 0.0, spectrumSum = 0.0;
+            for (size_t band = 0; band < numBands; ++band)
+            {
+               if (isValid(pSpectrum[band]) && isValid(pQuery[band]))
+               {
+                  querySum += max(pQuery[band], sMinimumValue);
+                  spectrumSum += max(static_cast<double>(pSpectrum[band]), sMinimumValue);
+               }
+            }
+            if (querySum <= 0.0 || spectrumSum <= 0.0)
+            {
+               return false;
+            }
+
+            const double* pLogQuery = &mInput.mLogQuery.front();
+            const double logSumRatio = log(spectrumSum) - log(querySum);
+            score = 0.0;
+            for (size_t band = 0; band < numBands; ++band)
+            {
+               if (isValid(pSpectrum[band]) && isValid(pQuery[band]))
+               {
+                  const double value = max(static_cast<double>(pSpectrum[band]), sMinimumValue);
+                  score += (max(pQuery[band], sMinimumValue) / querySum - value / spectrumSum) *
+                     (pLogQuery[band] - log(value) + logSumRatio);
+               }
+            }
+            return true;
+         }
+
+         case SpectralLibraryMatcher::EUCLIDEAN_DISTANCE:
+         {
+            bool covered = false;
+            double sum = 0.0;
+            for (size_t band = 0; band < numBands; ++band)
+            {
+               if (isValid(pSpectrum[band]) && isValid(pQuery[band]))
+               {
+                  const double difference = pQuery[band] - pSpectrum[band];
+                  sum += difference * difference;
+                  covered = true;
+               }
+            }
+
+            score = sqrt(sum);
+            return covered;
+         }
+
+         default:
+            return false;
+         }
+      }
+
+      const MatchInput& mInput;
+      mta::AlgorithmThread::Range mRowRange;
+      vector<Score> mScores;
+      bool mSuccess;
+   };
+
+   struct MatchOutput
+   {
+      MatchOutput(unsigned int count) :
+         mCount(count),
+         mSuccess(false)
+      {
+      }
+
+      bool compileOverallResults(const vector<MatchThread*>& threads)
+      {
+         mScores.clear();
+         mSuccess = false;
+         for (vector<MatchThread*>::const_iterator iter = threads.begin(); iter != threads.end(); ++iter)
+         {
+            const MatchThread* pThread = *iter;
+            if (pThread == NULL || pThread->isSuccessful() == false)
+            {
+               mScores.clear();
+               return false;
+            }
+
+            const vector<Score>& scores = pThread->getScores();
+            mScores.insert(mScores.end(), scores.begin(), scores.end());
+         }
+
+         const size_t count = min(static_cast<size_t>(mCount), mScores.size());
+         partial_sort(mScores.begin(), mScores.begin() + count, mScores.end());
+         mScores.resize(count);
+         mSuccess = true;
+         return true;
+      }
+
+      unsigned int mCount;
+      vector<Score> mScores;
+      bool mSuccess;
+   };
+}
+
+SpectralLibraryMatcher::SpectralLibraryMatcher() :
+   mAbortFlag(false)
+{
+}
+
+SpectralLibraryMatcher::~SpectralLibraryMatcher()
+{
+   clearLibrary(NULL);
+}
+
+bool SpectralLibraryMatcher::setLibrary(const vector<Signature*>& signatures, const vector<double>& wavelengths,
+   const vector<double>& fwhm, Progress* pProgress, string& errorMessage)
+{
+   if (mSignatures.empty() == false && signatures == mLibrary && wavelengths == mWavelengths && fwhm == mFwhm)
+   {
+      return true;
+   }
+
+   clearLibrary(NULL);
+   if (wavelengths.empty())
+   {
+      errorMessage = "No wavelengths were specified to compare the signatures at.";
+      return false;
+   }
+
+   PlugInResource resampler("Resampler");
+   SignatureResampler* pResampler = dynamic_cast<SignatureResampler*>(resampler.get());
+   if (pResampler == NULL)
+   {
+      errorMessage = "The resampler plug-in could not be created.";
+      return false;
+   }
+
+   // Resample each library as a whole, which reuses the copy of the library resampled to the
+   // same wavelengths by the detection algorithms or saved next to the library file
+   set<SignatureSet*> libraries;
+   for (vector<Signature*>::const_iterator iter = signatures.begin(); iter != signatures.end(); ++iter)
+   {
+      SignatureSet* pLibrary = (*iter == NULL ? NULL : dynamic_cast<SignatureSet*>((*iter)->getParent()));
+      if (pLibrary != NULL && libraries.insert(pLibrary).second)
+      {
+         string libraryError;
+         pResampler->resampleLibrary(pLibrary, wavelengths, fwhm, pProgress, libraryError);
+      }
+   }
+
+   // Each signature is then only copied from the results kept by the resampler
+   const size_t numBands = wavelengths.size();
+   vector<double> toData;
+   vector<int> toBands;
+   for (vector<Signature*>::const_iterator iter = signatures.begin(); iter != signatures.end(); ++iter)
+   {
+      Signature* pSignature = *iter;
+      if (pSignature == NULL ||
+         pResampler->resampleSignature(pSignature, wavelengths, fwhm, toData, toBands, errorMessage) == false ||
+         toBands.empty() || toData.size() != toBands.size())
+      {
+         continue;
+      }
+
+      const size_t offset = mSpectra.size();
+      mSpectra.resize(offset + numBands, numeric_limits<float>::quiet_NaN());
+      for (size_t band = 0; band < toBands.size(); ++band)
+      {
+         if (toBands[band] >= 0 && static_cast<size_t>(toBands[band]) < numBands)
+         {
+            mSpectra[offset + toBands[band]] = static_cast<float>(toData[band]);
+         }
+      }
+      mSignatures.push_back(pSignature);
+   }
+
+   if (mSignatures.empty())
+   {
+      if (errorMessage.empty())
+      {
+         errorMessage = "None of the library signatures cover the wavelengths.";
+      }
+      mSpectra.clear();
+      return false;
+   }
+
+   // The results are discarded if any of the signatures change
+   mLibrary = signatures;
+   mWavelengths = wavelengths;
+   mFwhm = fwhm;
+   for (vector<Signature*>::const_iterator iter = mSignatures.begin(); iter != mSignatures.end(); ++iter)
+   {
+      (*iter)->attach(SIGNAL_NAME(Subject, Modified), Slot(this, &SpectralLibraryMatcher::signatureChanged));
+      (*iter)->attach(SIGNAL_NAME(Subject, Deleted), Slot(this, &SpectralLibraryMatcher::signatureChanged));
+   }
+
+   errorMessage.clear();
+   if (pProgress != NULL)
+   {
+      pProgress->updateProgress("Resampling library signatures", 100, NORMAL);
+   }
+
+   return true;
+}
+
+bool SpectralLibraryMatcher::findMatches(Signature* pQuery, Metric metric, unsigned int count,
+   vector<Match>& matches, Progress* pProgress, string& errorMessage)
+{
+   matches.clear();
+   mAbortFlag = false;
+   if (mSignatures.empty())
+   {
+      errorMessage = "No library signatures have been resampled.";
+      return false;
+   }
+   if (pQuery == NULL || metric.isValid() == false)
+   {
+      errorMessage = "No query spectrum or metric was specified.";
+      return false;
+   }
+   if (count == 0)
+   {
+      return true;
+   }
+
+   const vector<double>* pWavelengths = dv_cast<vector<double> >(&pQuery->getData("Wavelength"));
+   const vector<double>* pReflectances = dv_cast<vector<double> >(&pQuery->getData("Reflectance"));
+   if (pWavelengths == NULL || pReflectances == NULL || pWavelengths->size() != pReflectances->size())
+   {
+      errorMessage = "The query spectrum does not contain wavelength and reflectance data.";
+      return false;
+   }
+
+   // Pixel spectra are usually at the library wavelengths already
+   vector<double> query;
+   if (*pWavelengths == mWavelengths)
+   {
+      query = *pReflectances;
+   }
+   else if (resampleSpectra(*pReflectances, *pWavelengths, mWavelengths, mFwhm, query, NULL, errorMessage) == false)
+   {
+      return false;
+   }
+
+   vector<double> logQuery(query.size(), 0.0);
+   if (metric == SPECTRAL_INFORMATION_DIVERGENCE)
+   {
+      for (size_t band = 0; band < query.size(); ++band)
+      {
+         logQuery[band] = log(max(query[band], sMinimumValue));
+      }
+   }
+
+   MatchInput input(mSpectra, query, logQuery, metric, count, &mAbortFlag);
+   MatchOutput output(count);
+   mta::ProgressObjectReporter reporter("Searching the spectral library", pProgress);
+   mta::MultiThreadedAlgorithm<MatchInput, MatchOutput, MatchThread>
+      mtaMatch(Service<ConfigurationSettings>()->getSettingThreadCount(), input, output, &reporter);
+   mtaMatch.run();
+
+   if (mAbortFlag || output.mSuccess == false)
+   {
+      errorMessage = mAbortFlag ? "The library search was aborted." : "The library search failed.";
+      return false;
+   }
+
+   for (vector<Score>::const_iterator iter = output.mScores.begin(); iter != output.mScores.end(); ++iter)
+   {
+      Match match;
+      match.mpSignature = mSignatures[iter->second];
+      match.mScore = iter->first;
+      matches.push_back(match);
+   }
+
+   return true;
+}
+
+void SpectralLibraryMatcher::abort()
+{
+   mAbortFlag = true;
+}
+
+string SpectralLibraryMatcher::getMetricName(Metric metric)
+{
+   switch (metric)
+   {
+   case SPECTRAL_ANGLE:
+      return "Spectral Angle";
+   case SPECTRAL_INFORMATION_DIVERGENCE:
+      return "Spectral Information Divergence";
+   case EUCLIDEAN_DISTANCE:
+      return "Euclidean Distance";
+   default:
+      return string();
+   }
+}
+
+SpectralLibraryMatcher::Metric SpectralLibraryMatcher::getMetric(const string& name)
+{
+   for (int value = SPECTRAL_ANGLE; value <= EUCLIDEAN_DISTANCE; ++value)
+   {
+      if (getMetricName(static_cast<MetricEnum>(value)) == name)
+      {
+         return static_cast<MetricEnum>(value);
+      }
+   }
+
+   return Metric();
+}
+
+void SpectralLibraryMatcher::signatureChanged(Subject& subject, const string& signal, const boost::any& value)
+{
+   // A deleted signature detaches itself
+   clearLibrary(signal == SIGNAL_NAME(Subject, Deleted) ? dynamic_cast<Signature*>(&subject) : NULL);
+}
+
+void SpectralLibraryMatcher::clearLibrary(Signature* pDeletedSignature)
+{
+   for (vector<Signature*>::const_iterator iter = mSignatures.begin(); iter != mSignatures.end(); ++iter)
+   {
+      if (*iter != pDeletedSignature)
+      {
+         (*iter)->detach(SIGNAL_NAME(Subject, Modified), Slot(this, &SpectralLibraryMatcher::signatureChanged));
+         (*iter)->detach(SIGNAL_NAME(Subject, Deleted), Slot(this, &SpectralLibraryMatcher::signatureChanged));
+      }
+   }
+
+   mLibrary.clear();
+   mSignatures.clear();
+   mWavelengths.clear();
+   mFwhm.clear();
+   mSpectra.clear();
+}
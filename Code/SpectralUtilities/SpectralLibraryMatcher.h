@@ -0,0 +1,134 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Ball Aerospace & Technologies Corporation
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef SPECTRALLIBRARYMATCHER_H
+#define SPECTRALLIBRARYMATCHER_H
+
+#include "EnumWrapper.h"
+
+#include <boost/any.hpp>
+
+#include <string>
+#include <vector>
+
+class Progress;
+class Signature;
+class Subject;
+
+/**
+ * Finds the signatures in a spectral library which best match a query spectrum.
+ *
+ * setLibrary() resamples every library signature once to a common set of wavelengths,
+ * usually those of the data set the queries come from, and keeps the results in one dense
+ * matrix. The signatures are resampled with SignatureResampler::resampleLibrary(), so a
+ * library already resampled to the same wavelengths, by a detection algorithm or in a
+ * previous session, is not resampled again. Each query, such as a pixel from
+ * SpectralUtilities::getPixelSignature() or an AOI mean from
+ * SpectralUtilities::convertAoiToSignature(), is then resampled once to the same wavelengths
+ * and scored against every row of the matrix in parallel. Only the best matches are kept by
+ * each thread, so a query against a large library takes a single pass over the matrix.
+ *
+ * Bands which either spectrum does not cover are skipped when a signature is scored, and
+ * signatures without any such bands are never matched. A lower score is always a better match.
+ */
+class SpectralLibraryMatcher
+{
+public:
+   enum MetricEnum
+   {
+      SPECTRAL_ANGLE,                  /**< The angle between the spectra in radians. */
+      SPECTRAL_INFORMATION_DIVERGENCE, /**< The symmetric relative entropy of the normalized spectra. */
+      EUCLIDEAN_DISTANCE               /**< The Euclidean distance between the spectra. */
+   };
+
+   /**
+    * @EnumWrapper SpectralLibraryMatcher::MetricEnum.
+    */
+   typedef EnumWrapper<MetricEnum> Metric;
+
+   struct Match
+   {
+      Signature* mpSignature;
+      double mScore;
+   };
+
+   SpectralLibraryMatcher();
+   ~SpectralLibraryMatcher();
+
+   /**
+    * Resamples the library signatures to the given wavelengths.
+    *
+    * If the signatures and wavelengths are the same as in the previous call and none of the
+    * signatures have been modified or deleted since, the previous results are kept.
+    *
+    * @param signatures
+    *        The library signatures. Signature sets are not searched, so use
+    *        SpectralUtilities::extractSignatures() first.
+    * @param wavelengths
+    *        The center wavelengths in microns to compare the spectra at.
+    * @param fwhm
+    *        The full width at half maximum of each of wavelengths. This may be empty.
+    * @param pProgress
+    *        Optional progress object updated while the signatures are resampled.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    *
+    * @return True if at least one signature could be resampled. Signatures without wavelength
+    *         and reflectance data are not matched.
+    */
+   bool setLibrary(const std::vector<Signature*>& signatures, const std::vector<double>& wavelengths,
+      const std::vector<double>& fwhm, Progress* pProgress, std::string& errorMessage);
+
+   /**
+    * Scores a query spectrum against every library signature.
+    *
+    * @param pQuery
+    *        The query spectrum.
+    * @param metric
+    *        The score to compute.
+    * @param count
+    *        The maximum number of matches to return.
+    * @param matches
+    *        Receives the best matches, best first.
+    * @param pProgress
+    *        Optional progress object updated while the library is searched.
+    * @param errorMessage
+    *        Receives the reason for a failure.
+    *
+    * @return False if the search failed or was aborted.
+    */
+   bool findMatches(Signature* pQuery, Metric metric, unsigned int count, std::vector<Match>& matches,
+      Progress* pProgress, std::string& errorMessage);
+
+   /**
+    * Stops a search in progress. This may be called while findMatches() runs.
+    */
+   void abort();
+
+   static std::string getMetricName(Metric metric);
+   static Metric getMetric(const std::string& name);
+
+protected:
+   void signatureChanged(Subject& subject, const std::string& signal, const boost::any& value);
+
+private:
+   SpectralLibraryMatcher(const SpectralLibraryMatcher& rhs);
+   SpectralLibraryMatcher& operator=(const SpectralLibraryMatcher& rhs);
+
+   void clearLibrary(Signature* pDeletedSignature);
+
+   std::vector<Signature*> mLibrary;
+   std::vector<Signature*> mSignatures;     // The signature of each row of mSpectra
+   std::vector<double> mWavelengths;
+   std::vector<double> mFwhm;
+   std::vector<float> mSpectra;             // One row per signature, NaN where a band is not covered
+   bool mAbortFlag;
+};
+
+#endif
@@ -198,7 +198,14 @@ vector<Signature*> SpectralSignatureSelector::getSignatures() const
       }
       return sigs;
    }
-   return SignatureSelector::getSignatures();
+
+   // Only the selected signatures are loaded from a library imported without its data
+   sigs = SignatureSelector::getSignatures();
+   for (vector<Signature*>::iterator sig = sigs.begin(); sig != sigs.end(); ++sig)
+   {
+      SpectralUtilities::loadSignatureData(*sig);
+   }
+   return sigs;
 }
 
 void SpectralSignatureSelector::usePseudocolorLayer(bool bPseudocolor)
@@ -12,11 +12,20 @@
 #include "BitMask.h"
 #include "BitMaskIterator.h"
 #include "DataAccessorImpl.h"
+#include "DataDescriptor.h"
 #include "DataRequest.h"
 #include "DataVariant.h"
+#include "FileDescriptor.h"
+#include "Importer.h"
 #include "MessageLogResource.h"
+#include "ModelServices.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInResource.h"
 #include "RasterDataDescriptor.h"
 #include "RasterElement.h"
+#include "RasterPager.h"
+#include "RasterUtilities.h"
 #include "Signature.h"
 #include "SignatureSet.h"
 #include "SpectralUtilities.h"
@@ -65,6 +74,7 @@ std::vector<Signature*> SpectralUtilities::extractSignatures(const std::vector<S
          }
          else
          {
+            loadSignatureData(pSignature);
             extractedSignatures.push_back(pSignature);
          }
       }
@@ -73,6 +83,49 @@ std::vector<Signature*> SpectralUtilities::extractSignatures(const std::vector<S
    return extractedSignatures;
 }
 
+bool SpectralUtilities::loadSignatureData(Signature* pSignature, Progress* pProgress)
+{
+   if (pSignature == NULL)
+   {
+      return false;
+   }
+
+   SignatureSet* pSignatureSet = dynamic_cast<SignatureSet*>(pSignature);
+   if (pSignatureSet != NULL)
+   {
+      bool success = true;
+      const std::vector<Signature*>& setSignatures = pSignatureSet->getSignatures();
+      for (std::vector<Signature*>::const_iterator iter = setSignatures.begin(); iter != setSignatures.end(); ++iter)
+      {
+         success = loadSignatureData(*iter, pProgress) && success;
+      }
+
+      return success;
+   }
+
+   // A deferred signature has a signature file but no data components
+   if (pSignature->getData("Wavelength").isValid())
+   {
+      return true;
+   }
+
+   const DataDescriptor* pDescriptor = pSignature->getDataDescriptor();
+   const FileDescriptor* pFileDescriptor = (pDescriptor == NULL ? NULL : pDescriptor->getFileDescriptor());
+   if (pFileDescriptor == NULL || pFileDescriptor->getFilename().getFullPathAndName().empty())
+   {
+      return true;
+   }
+
+   ExecutableResource pImporter("Spectral Signature Importer", std::string(), pProgress, true);
+   if (pImporter->getPlugIn() == NULL)
+   {
+      return false;
+   }
+
+   pImporter->getInArgList().setPlugInArgValue(Importer::ImportElementArg(), pSignature);
+   return pImporter->execute();
+}
+
 Signature* SpectralUtilities::getPixelSignature(RasterElement* pDataset, const Opticks::PixelLocation& pixel)
 {
    if (pDataset == NULL)
@@ -316,3 +369,61 @@ std::string SpectralUtilities::getFailedDataRequestErrorMessage(const DataReques
 
    return errorMessage;
 }
+
+RasterElement* SpectralUtilities::createGainOffsetElement(const std::string& name, RasterElement* pSource,
+   const std::vector<double>& gains, const std::vector<double>& offsets, EncodingType dataType, bool clipNegative)
+{
+   VERIFYRV(pSource != NULL, NULL);
+   const RasterDataDescriptor* pSourceDescriptor =
+      dynamic_cast<const RasterDataDescriptor*>(pSource->getDataDescriptor());
+   VERIFYRV(pSourceDescriptor != NULL, NULL);
+
+   const unsigned int numBands = pSourceDescriptor->getBandCount();
+   if (gains.size() != numBands || (offsets.empty() == false && offsets.size() != numBands) ||
+      (dataType != FLT4BYTES && dataType != FLT8BYTES))
+   {
+      return NULL;
+   }
+
+   // The element is created without any data; the pager provides it on demand
+   RasterDataDescriptor* pDescriptor = RasterUtilities::generateRasterDataDescriptor(name, pSource,
+      pSourceDescriptor->getRowCount(), pSourceDescriptor->getColumnCount(), numBands,
+      pSourceDescriptor->getInterleaveFormat(), dataType, ON_DISK_READ_ONLY);
+   VERIFYRV(pDescriptor != NULL, NULL);
+   pDescriptor->setMetadata(pSourceDescriptor->getMetadata());
+
+   ModelResource<RasterElement> pElement(static_cast<RasterElement*>(
+      Service<ModelServices>()->createElement(pDescriptor)));
+   if (pElement.get() == NULL)
+   {
+      return NULL;
+   }
+
+   ExecutableResource pPager("GainOffsetPager");
+   if (pPager->getPlugIn() == NULL)
+   {
+      return NULL;
+   }
+
+   std::vector<double> pagerGains(gains);
+   std::vector<double> pagerOffsets(offsets);
+   pPager->getInArgList().setPlugInArgValue("Raster Element", pElement.get());
+   pPager->getInArgList().setPlugInArgValue("Source Element", pSource);
+   pPager->getInArgList().setPlugInArgValue("Gains", &pagerGains);
+   pPager->getInArgList().setPlugInArgValue("Offsets", &pagerOffsets);
+   pPager->getInArgList().setPlugInArgValue("Clip Negative Values", &clipNegative);
+   if (pPager->execute() == false)
+   {
+      return NULL;
+   }
+
+   RasterPager* pRasterPager = dynamic_cast<RasterPager*>(pPager->getPlugIn());
+   if (pRasterPager == NULL)
+   {
+      return NULL;
+   }
+
+   pPager->releasePlugIn();
+   pElement->setPager(pRasterPager);
+   return pElement.release();
+}
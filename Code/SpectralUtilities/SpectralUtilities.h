@@ -11,12 +11,14 @@
 #define SPECTRALUTILITIES_H
 
 #include "Location.h"
+#include "TypesFile.h"
 
 #include <string>
 #include <vector>
 
 class AoiElement;
 class DataRequest;
+class Progress;
 class RasterElement;
 class Signature;
 
@@ -32,7 +34,8 @@ namespace SpectralUtilities
     *  and/or signature sets.
     *
     *  This method extracts all signatures from any signature sets and creates
-    *  a single vector of signatures.
+    *  a single vector of signatures. The data of any extracted signatures which
+    *  have not been loaded yet is loaded with loadSignatureData().
     *
     *  @param   signatures
     *           The signatures, including any signature sets that should be
@@ -42,6 +45,28 @@ namespace SpectralUtilities
     */
    std::vector<Signature*> extractSignatures(const std::vector<Signature*>& signatures);
 
+   /**
+    *  Loads the "Wavelength" and "Reflectance" data of a signature which was
+    *  imported without its data.
+    *
+    *  A signature library may be imported with only the names and metadata of
+    *  its signatures, leaving each signature without any data but with the
+    *  file descriptor of its signature file. The data is then imported from
+    *  that file the first time this method is called for the signature, so
+    *  any code which reads signature data should call this method first.
+    *
+    *  @param   pSignature
+    *           The signature to load. If this is a signature set, the data of
+    *           every signature in the set is loaded.
+    *  @param   pProgress
+    *           The progress object to use while importing the data. May be \c NULL.
+    *
+    *  @return  \c True if the signature data is available, which includes
+    *           signatures whose data was never deferred. \c False if the
+    *           data could not be imported.
+    */
+   bool loadSignatureData(Signature* pSignature, Progress* pProgress = NULL);
+
    /**
     *  Creates a signature from a single pixel in a data set.
     *
@@ -103,6 +128,33 @@ namespace SpectralUtilities
     *        This string will be empty if no common errors were detected.
     */
    std::string getFailedDataRequestErrorMessage(const DataRequest* pRequest, const RasterElement* pElement);
+
+   /**
+    * Create a virtual raster element which applies per-band gains and offsets to another element.
+    *
+    * The values of the new element are computed as source * gain + offset by the
+    * GainOffsetPager each time they are read, so no corrected copy of the source
+    * data is made and the source data is not modified. The new element is read
+    * only and is created as a child of pSource.
+    *
+    * @param name
+    *        The name of the new element.
+    * @param pSource
+    *        The element containing the uncorrected data. This must not be destroyed before the new element.
+    * @param gains
+    *        The gain for each band of pSource.
+    * @param offsets
+    *        The offset for each band of pSource. If empty, no offset is applied.
+    * @param dataType
+    *        The data type of the new element. This must be FLT4BYTES or FLT8BYTES.
+    * @param clipNegative
+    *        If true, negative corrected values are set to zero.
+    *
+    * @return The new element, or \c NULL if the element or its pager could not be created.
+    */
+   RasterElement* createGainOffsetElement(const std::string& name, RasterElement* pSource,
+      const std::vector<double>& gains, const std::vector<double>& offsets, EncodingType dataType,
+      bool clipNegative);
 }
 
 #endif